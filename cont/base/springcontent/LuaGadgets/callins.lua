@@ -88,6 +88,7 @@ CallInsList = {
 	"TerraformComplete",
 	"AllowWeaponTargetCheck",
 	"AllowWeaponTarget",
+	"AllowWeaponTargets",
 
 	"RecvSkirmishAIMessage",
 
@@ -156,6 +156,7 @@ local callInLists = {
 	"TerraformComplete",
 	"AllowWeaponTargetCheck",
 	"AllowWeaponTarget",
+	"AllowWeaponTargets",
 	-- unsynced
 	"DrawUnit",
 	"DrawFeature",
@@ -1250,6 +1251,47 @@ function gadgetHandler:AllowWeaponTarget(attackerID, targetID, attackerWeaponNum
 	return allowed, priority
 end
 
+function gadgetHandler:AllowWeaponTargets(attackerID, attackerWeaponNum, attackerWeaponDefID, targetIDs)
+	-- per target: nil (no gadget cares), false or the highest priority
+	-- (at least 1.0, as in AllowWeaponTarget)
+	local results = {}
+
+	local function MergeResult(i, targetAllowed, targetPriority)
+		if (targetAllowed) then
+			if (type(targetPriority) ~= "number") then
+				targetPriority = 1.0
+			end
+			targetPriority = math.max(1.0, targetPriority)
+			if (type(results[i]) == "number") then
+				targetPriority = math.max(results[i], targetPriority)
+			end
+			results[i] = targetPriority
+		elseif (targetAllowed == false and results[i] == nil) then
+			results[i] = false
+		end
+	end
+
+	for _, g in ipairs(self.AllowWeaponTargetsList) do
+		local gadgetResults = g:AllowWeaponTargets(attackerID, attackerWeaponNum, attackerWeaponDefID, targetIDs)
+
+		if (type(gadgetResults) == "table") then
+			for i = 1, #targetIDs do
+				local r = gadgetResults[i]
+				MergeResult(i, r and r ~= false, r)
+			end
+		end
+	end
+
+	-- gadgets that only know the per-target call-in still get asked
+	if (#self.AllowWeaponTargetList > 0) then
+		for i = 1, #targetIDs do
+			MergeResult(i, self:AllowWeaponTarget(attackerID, targetIDs[i], attackerWeaponNum, attackerWeaponDefID))
+		end
+	end
+
+	return results
+end
+
 
 --------------------------------------------------------------------------------
 --
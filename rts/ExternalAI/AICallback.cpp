@@ -847,7 +847,7 @@ static int FilterUnitsVector(const std::vector<CUnit*>& units, int* unitIds, int
 
 	return a;
 }
-static int FilterUnitsList(const std::list<CUnit*>& units, int* unitIds, int unitIds_max, bool (*includeUnit)(const CUnit*) = NULL)
+static int FilterUnitsList(const std::vector<CUnit*>& units, int* unitIds, int unitIds_max, bool (*includeUnit)(const CUnit*) = NULL)
 {
 	int a = 0;
 
@@ -856,7 +856,7 @@ static int FilterUnitsList(const std::list<CUnit*>& units, int* unitIds, int uni
 		unitIds_max = MAX_UNITS;
 	}
 
-	std::list<CUnit*>::const_iterator ui;
+	std::vector<CUnit*>::const_iterator ui;
 	for (ui = units.begin(); (ui != units.end()) && (a < unitIds_max); ++ui) {
 		CUnit* u = *ui;
 
@@ -3540,7 +3540,7 @@ EXPORT(int) skirmishAiCallback_getTeamUnits(int skirmishAIId, int* unitIds, int
 	int a = 0;
 
 	const int teamId = skirmishAIId_teamId[skirmishAIId];
-	for (std::list<CUnit*>::iterator ui = uh->activeUnits.begin();
+	for (std::vector<CUnit*>::iterator ui = uh->activeUnits.begin();
 			ui != uh->activeUnits.end(); ++ui) {
 		CUnit* u = *ui;
 
@@ -0,0 +1,193 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include "DemoBenchmark.h"
+
+#include "System/mmgr.h"
+
+#include "Sim/Misc/GlobalConstants.h"
+#include "System/TimeProfiler.h"
+#include "System/Platform/Misc.h"
+#include "System/Sync/SyncChecker.h"
+
+#include <algorithm>
+#include <fstream>
+
+using boost::posix_time::microsec_clock;
+using boost::posix_time::time_duration;
+
+CDemoBenchmark* demoBenchmark = NULL;
+
+
+/**
+ * @brief Escape special characters and wrap in double quotes.
+ */
+static std::string Quote(const std::string& value)
+{
+	std::string esc(value);
+	std::string::size_type pos = 0;
+	while ((pos = esc.find_first_of("\"\\", pos)) != std::string::npos) {
+		esc.insert(pos, "\\");
+		pos += 2;
+	}
+	return "\"" + esc + "\"";
+}
+
+/**
+ * @brief Value below which the given fraction of the (sorted) samples lie.
+ */
+static float Percentile(const std::vector<float>& sorted, float fraction)
+{
+	if (sorted.empty())
+		return 0.0f;
+
+	return sorted[size_t(fraction * (sorted.size() - 1) + 0.5f)];
+}
+
+/**
+ * @brief Same for a histogram; frames not in it took 0ms.
+ */
+static unsigned Percentile(const std::map<unsigned, unsigned>& histogram, size_t numFrames, float fraction)
+{
+	if (numFrames == 0)
+		return 0;
+
+	size_t numCounted = 0;
+	for (std::map<unsigned, unsigned>::const_iterator it = histogram.begin(); it != histogram.end(); ++it) {
+		numCounted += it->second;
+	}
+
+	const size_t rank = size_t(fraction * (numFrames - 1) + 0.5f);
+	size_t n = numFrames - numCounted;
+
+	if (rank < n)
+		return 0;
+
+	for (std::map<unsigned, unsigned>::const_iterator it = histogram.begin(); it != histogram.end(); ++it) {
+		n += it->second;
+		if (rank < n)
+			return it->first;
+	}
+
+	return histogram.rbegin()->first;
+}
+
+
+CDemoBenchmark::CDemoBenchmark(const std::string& demoFileName, const std::string& reportFileName)
+	: demoFileName(demoFileName)
+	, reportFileName(reportFileName)
+{
+}
+
+
+void CDemoBenchmark::SimFrameStart()
+{
+	frameStartTime = microsec_clock::universal_time();
+
+	if (frameTimes.empty())
+		startTime = frameStartTime;
+
+	profiler.GetTotals(frameStartTotals);
+}
+
+void CDemoBenchmark::SimFrameEnd(int frameNum)
+{
+	const time_duration frameTime = microsec_clock::universal_time() - frameStartTime;
+
+	frameTimes.push_back(frameTime.total_microseconds() * 0.001f);
+
+	// the difference of the totals is the time a timer ran within this frame
+	profiler.GetTotals(frameEndTotals);
+
+	std::map<std::string, unsigned>::const_iterator it;
+	for (it = frameEndTotals.begin(); it != frameEndTotals.end(); ++it) {
+		std::map<std::string, unsigned>::const_iterator sit = frameStartTotals.find(it->first);
+
+		const unsigned startTotal = (sit != frameStartTotals.end())? sit->second: 0;
+		const unsigned time = it->second - startTotal;
+
+		if (time == 0)
+			continue;
+
+		TimerRecord& tr = timers[it->first];
+		tr.total += time;
+		tr.frameTimes[time] += 1;
+	}
+
+#ifdef SYNCCHECK
+	if ((frameNum % CHECKSUM_INTERVAL) == 0) {
+		checksums[frameNum] = CSyncChecker::GetChecksum();
+	}
+#endif
+}
+
+
+bool CDemoBenchmark::WriteReport() const
+{
+	std::ofstream out(reportFileName.c_str());
+
+	if (!out.good())
+		return false;
+
+	const size_t numFrames = frameTimes.size();
+	const float wallTime = (numFrames > 0)?
+		((microsec_clock::universal_time() - startTime).total_microseconds() * 0.000001f):
+		0.0f;
+
+	std::vector<float> sortedFrameTimes(frameTimes);
+	std::sort(sortedFrameTimes.begin(), sortedFrameTimes.end());
+
+	float simTime = 0.0f;
+	for (size_t n = 0; n < numFrames; n++) {
+		simTime += frameTimes[n];
+	}
+
+	out << "{\n";
+	out << "  " << Quote("demo") << ": " << Quote(demoFileName) << ",\n";
+	out << "  " << Quote("frames") << ": " << numFrames << ",\n";
+	out << "  " << Quote("wallTime") << ": " << wallTime << ",\n";
+	out << "  " << Quote("framesPerSecond") << ": " << ((wallTime > 0.0f)? (numFrames / wallTime): 0.0f) << ",\n";
+	out << "  " << Quote("realTimeFactor") << ": " << ((wallTime > 0.0f)? (numFrames / (wallTime * GAME_SPEED)): 0.0f) << ",\n";
+	out << "  " << Quote("peakResidentMemory") << ": " << Platform::GetPeakResidentMemory() << ",\n";
+
+	// SimFrame durations, in milliseconds
+	out << "  " << Quote("simFrame") << ": {\n";
+	out << "    " << Quote("total") << ": " << simTime << ",\n";
+	out << "    " << Quote("mean") << ": " << ((numFrames > 0)? (simTime / numFrames): 0.0f) << ",\n";
+	out << "    " << Quote("p50") << ": " << Percentile(sortedFrameTimes, 0.50f) << ",\n";
+	out << "    " << Quote("p90") << ": " << Percentile(sortedFrameTimes, 0.90f) << ",\n";
+	out << "    " << Quote("p99") << ": " << Percentile(sortedFrameTimes, 0.99f) << ",\n";
+	out << "    " << Quote("max") << ": " << ((numFrames > 0)? sortedFrameTimes.back(): 0.0f) << "\n";
+	out << "  },\n";
+
+	// profiler timers, in (whole) milliseconds spent within SimFrame
+	out << "  " << Quote("timers") << ": {";
+
+	std::map<std::string, TimerRecord>::const_iterator it;
+	for (it = timers.begin(); it != timers.end(); ++it) {
+		const TimerRecord& tr = it->second;
+
+		out << ((it != timers.begin())? ",\n": "\n");
+		out << "    " << Quote(it->first) << ": {";
+		out << Quote("total") << ": " << tr.total << ", ";
+		out << Quote("p50") << ": " << Percentile(tr.frameTimes, numFrames, 0.50f) << ", ";
+		out << Quote("p90") << ": " << Percentile(tr.frameTimes, numFrames, 0.90f) << ", ";
+		out << Quote("p99") << ": " << Percentile(tr.frameTimes, numFrames, 0.99f) << ", ";
+		out << Quote("max") << ": " << tr.frameTimes.rbegin()->first << "}";
+	}
+
+	out << "\n  },\n";
+
+	// sync checksums (only available in SYNCCHECK builds)
+	out << "  " << Quote("checksums") << ": [";
+
+	std::map<int, unsigned>::const_iterator cit;
+	for (cit = checksums.begin(); cit != checksums.end(); ++cit) {
+		out << ((cit != checksums.begin())? ",\n": "\n");
+		out << "    {" << Quote("frame") << ": " << cit->first << ", " << Quote("checksum") << ": " << cit->second << "}";
+	}
+
+	out << "\n  ]\n";
+	out << "}\n";
+
+	return out.good();
+}
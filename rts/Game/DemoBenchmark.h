@@ -0,0 +1,67 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#ifndef DEMO_BENCHMARK_H
+#define DEMO_BENCHMARK_H
+
+#include <map>
+#include <string>
+#include <vector>
+#include <boost/noncopyable.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+
+/**
+ * @brief Measures a demo replay started with --benchmark-demo
+ *
+ * The game server feeds the demo to the local client without pacing, so
+ * CGame simulates the frames back-to-back. Each SimFrame is timed, as are
+ * the CTimeProfiler timers running within it; once the demo has ended a
+ * JSON report with these timings, the peak memory use and the sync
+ * checksum of every CHECKSUM_INTERVAL'th frame is written.
+ */
+class CDemoBenchmark : public boost::noncopyable
+{
+public:
+	CDemoBenchmark(const std::string& demoFileName, const std::string& reportFileName);
+
+	void SimFrameStart();
+	void SimFrameEnd(int frameNum);
+
+	/// @return whether the report could be written
+	bool WriteReport() const;
+
+	const std::string& GetReportFileName() const { return reportFileName; }
+
+private:
+	/// (profiler times are in whole milliseconds) time -> number of frames
+	typedef std::map<unsigned, unsigned> Histogram;
+
+	struct TimerRecord {
+		TimerRecord(): total(0) {}
+		unsigned total;
+		/// frames in which the timer did not run are not counted
+		Histogram frameTimes;
+	};
+
+	static const int CHECKSUM_INTERVAL = 900;
+
+	const std::string demoFileName;
+	const std::string reportFileName;
+
+	/// start of the first frame, loading is not part of the benchmark
+	boost::posix_time::ptime startTime;
+	boost::posix_time::ptime frameStartTime;
+
+	/// SimFrame durations in milliseconds
+	std::vector<float> frameTimes;
+
+	std::map<std::string, TimerRecord> timers;
+	std::map<std::string, unsigned> frameStartTotals;
+	std::map<std::string, unsigned> frameEndTotals;
+
+	/// frame number -> sync checksum
+	std::map<int, unsigned> checksums;
+};
+
+extern CDemoBenchmark* demoBenchmark;
+
+#endif // DEMO_BENCHMARK_H
@@ -23,6 +23,7 @@
 #include "ClientSetup.h"
 #include "CommandMessage.h"
 #include "ConsoleHistory.h"
+#include "DemoBenchmark.h"
 #include "GameHelper.h"
 #include "GameServer.h"
 #include "GameVersion.h"
@@ -104,6 +105,7 @@
 #include "Sim/Misc/TeamHandler.h"
 #include "Sim/Misc/Wind.h"
 #include "Sim/Misc/ResourceHandler.h"
+#include "Sim/Misc/SimScheduler.h"
 #include "Sim/MoveTypes/MoveInfo.h"
 #include "Sim/MoveTypes/GroundMoveType.h"
 #include "Sim/Path/IPathManager.h"
@@ -416,6 +418,7 @@ CGame::~CGame()
 	SafeDelete(damageArrayHandler);
 	SafeDelete(explGenHandler);
 	SafeDelete(helper);
+	SafeDelete(simScheduler);
 	SafeDelete((mapInfo = const_cast<CMapInfo*>(mapInfo)));
 
 	CGroundMoveType::DeleteLineTable();
@@ -532,6 +535,7 @@ void CGame::LoadSimulation(const std::string& mapName)
 	CWordCompletion::CreateInstance();
 
 	// simulation components
+	simScheduler = new CSimScheduler();
 	helper = new CGameHelper();
 	ground = new CGround();
 
@@ -892,6 +896,18 @@ bool CGame::Update()
 	}
 	LEAVE_SYNCED_CODE();
 
+	// the server sends everything before it marks the demo as ended, so
+	// once that happened and all packets are processed the benchmark is done
+	if (demoBenchmark != NULL && !gu->globalQuit && gameServer->HasDemoEnded() && net->Peek(0) == NULL) {
+		if (demoBenchmark->WriteReport()) {
+			LOG("Benchmark report written to %s", demoBenchmark->GetReportFileName().c_str());
+		} else {
+			LOG_L(L_ERROR, "Could not write benchmark report to %s", demoBenchmark->GetReportFileName().c_str());
+		}
+
+		gu->globalQuit = true;
+	}
+
 	//TODO move this to ::Draw()?
 	if (gs->frameNum == 0 || gs->paused)
 		eventHandler.UpdateObjects(); // we must add new rendering objects even if the game has not started yet
@@ -1671,11 +1687,11 @@ void CGame::DumpState(int newMinFrameNum, int newMaxFrameNum, int newFramePeriod
 	if ((gs->frameNum % gFramePeriod) != 0) { return; }
 
 	// we only care about the synced projectile data here
-	const std::list<CUnit*>& units = uh->activeUnits;
+	const std::vector<CUnit*>& units = uh->activeUnits;
 	const CFeatureSet& features = featureHandler->GetActiveFeatures();
 	      ProjectileContainer& projectiles = ph->syncedProjectiles;
 
-	std::list<CUnit*>::const_iterator unitsIt;
+	std::vector<CUnit*>::const_iterator unitsIt;
 	CFeatureSet::const_iterator featuresIt;
 	ProjectileContainer::iterator projectilesIt;
 	std::vector<LocalModelPiece*>::const_iterator piecesIt;
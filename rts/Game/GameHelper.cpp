@@ -38,6 +38,8 @@
 #include "System/myMath.h"
 #include "System/Sync/SyncTracer.h"
 
+#include <algorithm>
+
 //////////////////////////////////////////////////////////////////////
 // Construction/Destruction
 //////////////////////////////////////////////////////////////////////
@@ -45,7 +47,7 @@
 CGameHelper* helper;
 
 
-CGameHelper::CGameHelper()
+CGameHelper::CGameHelper(): explosionDepth(0), weaponTargetFrame(-1)
 {
 	stdExplosionGenerator = new CStdExplosionGenerator();
 }
@@ -250,9 +252,19 @@ void CGameHelper::Explosion(const ExplosionParams& params) {
 			DoExplosionDamage(hitFeature, expPos, damageAOE, damages, weaponDefID);
 		}
 	} else {
+		// damaging a unit can kill it and trigger its death-explosion
+		// while we are still iterating, so every level of nesting gets
+		// its own buffers (std::deque keeps references to them stable)
+		if (explosionDepth >= explosionBuffers.size()) {
+			explosionBuffers.push_back(ExplosionBuffers());
+		}
+
+		ExplosionBuffers& buffers = explosionBuffers[explosionDepth++];
+
 		{
 			// damage all units within the explosion radius
-			const vector<CUnit*>& units = qf->GetUnitsExact(expPos, damageAOE);
+			std::vector<CUnit*>& units = buffers.units;
+			qf->GetUnitsExact(units, expPos, damageAOE);
 			bool hitUnitDamaged = false;
 
 			for (vector<CUnit*>::const_iterator ui = units.begin(); ui != units.end(); ++ui) {
@@ -275,7 +287,8 @@ void CGameHelper::Explosion(const ExplosionParams& params) {
 
 		{
 			// damage all features within the explosion radius
-			const vector<CFeature*>& features = qf->GetFeaturesExact(expPos, damageAOE);
+			std::vector<CFeature*>& features = buffers.features;
+			qf->GetFeaturesExact(features, expPos, damageAOE);
 			bool hitFeatureDamaged = false;
 
 			for (vector<CFeature*>::const_iterator fi = features.begin(); fi != features.end(); ++fi) {
@@ -293,6 +306,8 @@ void CGameHelper::Explosion(const ExplosionParams& params) {
 			}
 		}
 
+		explosionDepth--;
+
 		// deform the map if the explosion was above-ground
 		// (but had large enough radius to touch the ground)
 		if (altitude >= -1.0f) {
@@ -350,7 +365,8 @@ static inline void QueryUnits(TFilter filter, TQuery& query)
 {
 	GML_RECMUTEX_LOCK(qnum);
 
-	const vector<int> &quads = qf->GetQuads(query.pos, query.radius);
+	static vector<int> quads;
+	qf->GetQuads(quads, query.pos, query.radius);
 
 	const int tempNum = gs->tempNum++;
 	
@@ -360,8 +376,8 @@ static inline void QueryUnits(TFilter filter, TQuery& query)
 			if (!filter.Team(t)) {
 				continue;
 			}
-			std::list<CUnit*>::const_iterator ui;
-			const std::list<CUnit*>& allyTeamUnits = quad.teamUnits[t];
+			std::vector<CUnit*>::const_iterator ui;
+			const std::vector<CUnit*>& allyTeamUnits = quad.teamUnits[t];
 			for (ui = allyTeamUnits.begin(); ui != allyTeamUnits.end(); ++ui) {
 				if ((*ui)->tempNum != tempNum) {
 					(*ui)->tempNum = tempNum;
@@ -620,10 +636,127 @@ public:
 
 
 
-void CGameHelper::GenerateWeaponTargets(const CWeapon* weapon, const CUnit* lastTargetUnit, std::multimap<float, CUnit*>& targets)
+// the area in which GenerateWeaponTargets looks for targets of <weapon>;
+// units seen only on radar can appear up to radarErrorSize further away
+static float GetWeaponTargetSearchRadius(const CWeapon* weapon)
+{
+	const float heightRadius = (weapon->weaponPos.y - std::max(0.0f, readmap->initMinHeight)) * weapon->heightMod;
+	const float errorRadius = radarhandler->radarErrorSize[weapon->owner->allyteam];
+
+	return std::max(0.0f, weapon->range + heightRadius) + errorRadius;
+}
+
+static int GetWeaponTargetBucketKey(const CUnit* unit)
+{
+	float3 pos = unit->pos;
+	pos.ClampInBounds();
+
+	const int qx = std::min(int(pos.x) / CQuadField::QUAD_SIZE, qf->GetNumQuadsX() - 1);
+	const int qz = std::min(int(pos.z) / CQuadField::QUAD_SIZE, qf->GetNumQuadsZ() - 1);
+
+	return ((unit->allyteam * qf->GetNumQuadsZ() + qz) * qf->GetNumQuadsX() + qx);
+}
+
+// heap order for PopWeaponTarget: lowest priority first, ties are broken
+// by unit ID so the order does not depend on the STL implementation
+struct WeaponTargetHeapOrder {
+	bool operator () (const CGameHelper::WeaponTarget& a, const CGameHelper::WeaponTarget& b) const {
+		if (a.first != b.first)
+			return (a.first > b.first);
+
+		return (a.second->id > b.second->id);
+	}
+};
+
+
+void CGameHelper::PrepareWeaponTargets(const std::vector<CUnit*>& units)
+{
+	// buckets only last for one frame (their candidates may die)
+	for (std::vector<int>::const_iterator ki = weaponTargetBucketKeys.begin(); ki != weaponTargetBucketKeys.end(); ++ki) {
+		weaponTargetBucketIndex[*ki] = -1;
+	}
+
+	weaponTargetBucketKeys.clear();
+	weaponTargetBuckets.clear();
+	weaponTargetCandidates.clear();
+	weaponTargetBucketIndex.resize(teamHandler->ActiveAllyTeams() * qf->GetNumQuadsX() * qf->GetNumQuadsZ(), -1);
+	weaponTargetFrame = gs->frameNum;
+
+	for (std::vector<CUnit*>::const_iterator ui = units.begin(); ui != units.end(); ++ui) {
+		const CUnit* unit = *ui;
+
+		if (unit->weapons.empty() || unit->dontFire)
+			continue;
+
+		const int key = GetWeaponTargetBucketKey(unit);
+
+		if (weaponTargetBucketIndex[key] == -1) {
+			WeaponTargetBucket bucket;
+			bucket.allyTeam = unit->allyteam;
+			bucket.minx = unit->pos.x; bucket.maxx = unit->pos.x;
+			bucket.minz = unit->pos.z; bucket.maxz = unit->pos.z;
+			bucket.candidatesBeg = -1;
+			bucket.candidatesEnd = -1;
+
+			weaponTargetBucketIndex[key] = weaponTargetBuckets.size();
+			weaponTargetBucketKeys.push_back(key);
+			weaponTargetBuckets.push_back(bucket);
+		}
+
+		WeaponTargetBucket& bucket = weaponTargetBuckets[weaponTargetBucketIndex[key]];
+
+		for (std::vector<CWeapon*>::const_iterator wi = unit->weapons.begin(); wi != unit->weapons.end(); ++wi) {
+			const float radius = GetWeaponTargetSearchRadius(*wi);
+
+			bucket.minx = std::min(bucket.minx, unit->pos.x - radius);
+			bucket.maxx = std::max(bucket.maxx, unit->pos.x + radius);
+			bucket.minz = std::min(bucket.minz, unit->pos.z - radius);
+			bucket.maxz = std::max(bucket.maxz, unit->pos.z + radius);
+		}
+	}
+}
+
+void CGameHelper::GatherWeaponTargetCandidates(int allyTeam, float minx, float minz, float maxx, float maxz)
+{
+	// a unit is in every quad its radius overlaps, so any unit that
+	// overlaps the rectangle is in one of the quads it touches
+	const int qminx = Clamp(int(minx) / CQuadField::QUAD_SIZE, 0, qf->GetNumQuadsX() - 1);
+	const int qmaxx = Clamp(int(maxx) / CQuadField::QUAD_SIZE, 0, qf->GetNumQuadsX() - 1);
+	const int qminz = Clamp(int(minz) / CQuadField::QUAD_SIZE, 0, qf->GetNumQuadsZ() - 1);
+	const int qmaxz = Clamp(int(maxz) / CQuadField::QUAD_SIZE, 0, qf->GetNumQuadsZ() - 1);
+
+	const int tempNum = gs->tempNum++;
+
+	for (int z = qminz; z <= qmaxz; ++z) {
+		for (int x = qminx; x <= qmaxx; ++x) {
+			const CQuadField::Quad& quad = qf->GetQuadAt(x, z);
+
+			for (int t = 0; t < teamHandler->ActiveAllyTeams(); ++t) {
+				if (teamHandler->Ally(allyTeam, t))
+					continue;
+
+				const std::vector<CUnit*>& allyTeamUnits = quad.teamUnits[t];
+
+				for (std::vector<CUnit*>::const_iterator ui = allyTeamUnits.begin(); ui != allyTeamUnits.end(); ++ui) {
+					CUnit* unit = *ui;
+
+					if (unit->tempNum == tempNum)
+						continue;
+
+					unit->tempNum = tempNum;
+					weaponTargetCandidates.push_back(unit);
+				}
+			}
+		}
+	}
+}
+
+void CGameHelper::GenerateWeaponTargets(const CWeapon* weapon, const CUnit* lastTargetUnit, std::vector<WeaponTarget>& targets)
 {
 	GML_RECMUTEX_LOCK(qnum); // GenerateTargets
 
+	targets.clear();
+
 	const CUnit* attacker = weapon->owner;
 	const float radius    = weapon->range;
 	const float3& pos     = attacker->pos;
@@ -634,110 +767,172 @@ void CGameHelper::GenerateWeaponTargets(const CWeapon* weapon, const CUnit* last
 	const float secDamage = weapon->weaponDef->damages.GetDefaultDamage() * weapon->salvoSize / weapon->reloadTime * GAME_SPEED;
 	const bool paralyzer  = !!weapon->weaponDef->damages.paralyzeDamageTime;
 
-	const std::vector<int>& quads = qf->GetQuads(pos, radius + (aHeight - std::max(0.f, readmap->initMinHeight)) * heightMod);
+	const float searchRadius = GetWeaponTargetSearchRadius(weapon);
 
-	const int tempNum = gs->tempNum++;
+	WeaponTargetBucket* bucket = NULL;
 
-	typedef std::vector<int>::const_iterator VectorIt;
-	typedef std::list<CUnit*>::const_iterator ListIt;
-	
-	for (VectorIt qi = quads.begin(); qi != quads.end(); ++qi) {
-		for (int t = 0; t < teamHandler->ActiveAllyTeams(); ++t) {
-			if (teamHandler->Ally(attacker->allyteam, t)) {
-				continue;
-			}
+	if (weaponTargetFrame == gs->frameNum) {
+		const unsigned int bucketKey = GetWeaponTargetBucketKey(attacker);
+		const int bucketIdx = (bucketKey < weaponTargetBucketIndex.size())? weaponTargetBucketIndex[bucketKey]: -1;
 
-			const std::list<CUnit*>& allyTeamUnits = qf->GetQuad(*qi).teamUnits[t];
+		if (bucketIdx != -1) {
+			bucket = &weaponTargetBuckets[bucketIdx];
 
-			for (ListIt ui = allyTeamUnits.begin(); ui != allyTeamUnits.end(); ++ui) {
-				CUnit* targetUnit = *ui;
-				float targetPriority = 1.0f;
+			// the owner can have moved since PrepareWeaponTargets
+			if ((pos.x - searchRadius) < bucket->minx || (pos.x + searchRadius) > bucket->maxx)
+				bucket = NULL;
+			else if ((pos.z - searchRadius) < bucket->minz || (pos.z + searchRadius) > bucket->maxz)
+				bucket = NULL;
+		}
+	}
 
-				if (luaRules != NULL) {
-					const int targetAllowed = luaRules->AllowWeaponTarget(attacker->id, targetUnit->id, weapon->weaponNum, weapon->weaponDef->id, &targetPriority);
+	const size_t numCandidates = weaponTargetCandidates.size();
 
-					if (targetAllowed >= 0) {
-						if (targetAllowed > 0) {
-							targets.insert(std::pair<float, CUnit*>(targetPriority, targetUnit));
-						}
+	size_t candidatesBeg = numCandidates;
+	size_t candidatesEnd = numCandidates;
 
-						continue;
-					}
-				}
+	if (bucket != NULL) {
+		if (bucket->candidatesBeg == -1) {
+			GatherWeaponTargetCandidates(bucket->allyTeam, bucket->minx, bucket->minz, bucket->maxx, bucket->maxz);
 
+			bucket->candidatesBeg = numCandidates;
+			bucket->candidatesEnd = weaponTargetCandidates.size();
+		}
 
-				if (targetUnit->tempNum != tempNum && (targetUnit->category & weapon->onlyTargetCategory)) {
-					targetUnit->tempNum = tempNum;
+		candidatesBeg = bucket->candidatesBeg;
+		candidatesEnd = bucket->candidatesEnd;
+	} else {
+		GatherWeaponTargetCandidates(attacker->allyteam, pos.x - searchRadius, pos.z - searchRadius, pos.x + searchRadius, pos.z + searchRadius);
 
-					if (targetUnit->isUnderWater && !weapon->weaponDef->waterweapon) {
-						continue;
-					}
-					if (targetUnit->isDead) {
-						continue;
-					}
+		candidatesEnd = weaponTargetCandidates.size();
+	}
 
-					float3 targPos;
-					const unsigned short targetLOSState = targetUnit->losStatus[attacker->allyteam];
+	weaponTargetUnits.clear();
+	weaponTargetIDs.clear();
 
-					if (targetLOSState & LOS_INLOS) {
-						targPos = targetUnit->midPos;
-					} else if (targetLOSState & LOS_INRADAR) {
-						targPos = targetUnit->midPos + (targetUnit->posErrorVector * radarhandler->radarErrorSize[attacker->allyteam]);
-						targetPriority *= 10.0f;
-					} else {
-						continue;
-					}
+	for (size_t n = candidatesBeg; n < candidatesEnd; n++) {
+		CUnit* targetUnit = weaponTargetCandidates[n];
 
-					const float modRange = radius + (aHeight - targPos.y) * heightMod;
+		// candidates are shared by all weapons of the bucket,
+		// skip those that can not be within this one's range
+		if ((pos - targetUnit->pos).SqLength2D() > Square(searchRadius + targetUnit->radius)) {
+			continue;
+		}
 
-					if ((pos - targPos).SqLength2D() <= modRange * modRange) {
-						const float dist2D = (pos - targPos).Length2D();
-						const float rangeMul = (dist2D * weapon->weaponDef->proximityPriority + modRange * 0.4f + 100.0f);
-						const float damageMul = weapon->weaponDef->damages[targetUnit->armorType] * targetUnit->curArmorMultiple;
+		weaponTargetUnits.push_back(targetUnit);
+		weaponTargetIDs.push_back(targetUnit->id);
+	}
 
-						targetPriority *= rangeMul;
+	// NOTE: AllowWeaponTarget(s) can call back into Lua, which can not
+	// reach GenerateWeaponTargets, so the candidates stay in place
+	//
+	// ask Lua about all targets at once if the game supports it,
+	// otherwise (or if the call failed) about each one separately
+	bool haveLuaTargets = false;
 
-						if (targetLOSState & LOS_INLOS) {
-							targetPriority *= (secDamage + targetUnit->health);
+	if (luaRules != NULL && !weaponTargetIDs.empty()) {
+		haveLuaTargets = luaRules->AllowWeaponTargets(attacker->id, weapon->weaponNum, weapon->weaponDef->id, weaponTargetIDs, weaponTargetsAllowed, weaponTargetPriorities);
+	}
 
-							if (targetUnit == lastTargetUnit) {
-								targetPriority *= weapon->avoidTarget ? 10.0f : 0.4f;
-							}
+	for (size_t n = 0; n < weaponTargetUnits.size(); n++) {
+		CUnit* targetUnit = weaponTargetUnits[n];
+		float targetPriority = 1.0f;
 
-							if (paralyzer && targetUnit->paralyzeDamage > (modInfo.paralyzeOnMaxHealth? targetUnit->maxHealth: targetUnit->health)) {
-								targetPriority *= 4.0f;
-							}
+		if (luaRules != NULL) {
+			int targetAllowed = -1;
 
-							if (weapon->hasTargetWeight) {
-								targetPriority *= weapon->TargetWeight(targetUnit);
-							}
-						} else {
-							targetPriority *= (secDamage + 10000.0f);
-						}
+			if (haveLuaTargets) {
+				targetAllowed = weaponTargetsAllowed[n];
+				targetPriority = weaponTargetPriorities[n];
+			} else {
+				targetAllowed = luaRules->AllowWeaponTarget(attacker->id, targetUnit->id, weapon->weaponNum, weapon->weaponDef->id, &targetPriority);
+			}
 
-						if (targetLOSState & LOS_PREVLOS) {
-							targetPriority /= (damageMul * targetUnit->power * (0.7f + gs->randFloat() * 0.6f));
+			if (targetAllowed >= 0) {
+				if (targetAllowed > 0) {
+					targets.push_back(WeaponTarget(targetPriority, targetUnit));
+				}
 
-							if (targetUnit->category & weapon->badTargetCategory) {
-								targetPriority *= 100.0f;
-							}
-							if (targetUnit->crashing) {
-								targetPriority *= 1000.0f;
-							}
-						}
+				continue;
+			}
+		}
 
-						targets.insert(std::pair<float, CUnit*>(targetPriority, targetUnit));
-					}
+		if ((targetUnit->category & weapon->onlyTargetCategory) == 0) {
+			continue;
+		}
+		if (targetUnit->isUnderWater && !weapon->weaponDef->waterweapon) {
+			continue;
+		}
+		if (targetUnit->isDead) {
+			continue;
+		}
+
+		float3 targPos;
+		const unsigned short targetLOSState = targetUnit->losStatus[attacker->allyteam];
+
+		if (targetLOSState & LOS_INLOS) {
+			targPos = targetUnit->midPos;
+		} else if (targetLOSState & LOS_INRADAR) {
+			targPos = targetUnit->midPos + (targetUnit->posErrorVector * radarhandler->radarErrorSize[attacker->allyteam]);
+			targetPriority *= 10.0f;
+		} else {
+			continue;
+		}
+
+		const float modRange = radius + (aHeight - targPos.y) * heightMod;
+
+		if ((pos - targPos).SqLength2D() <= modRange * modRange) {
+			const float dist2D = (pos - targPos).Length2D();
+			const float rangeMul = (dist2D * weapon->weaponDef->proximityPriority + modRange * 0.4f + 100.0f);
+			const float damageMul = weapon->weaponDef->damages[targetUnit->armorType] * targetUnit->curArmorMultiple;
+
+			targetPriority *= rangeMul;
+
+			if (targetLOSState & LOS_INLOS) {
+				targetPriority *= (secDamage + targetUnit->health);
+
+				if (targetUnit == lastTargetUnit) {
+					targetPriority *= weapon->avoidTarget ? 10.0f : 0.4f;
+				}
+
+				if (paralyzer && targetUnit->paralyzeDamage > (modInfo.paralyzeOnMaxHealth? targetUnit->maxHealth: targetUnit->health)) {
+					targetPriority *= 4.0f;
+				}
+
+				if (weapon->hasTargetWeight) {
+					targetPriority *= weapon->TargetWeight(targetUnit);
 				}
+			} else {
+				targetPriority *= (secDamage + 10000.0f);
 			}
+
+			if (targetLOSState & LOS_PREVLOS) {
+				targetPriority /= (damageMul * targetUnit->power * (0.7f + gs->randFloat() * 0.6f));
+
+				if (targetUnit->category & weapon->badTargetCategory) {
+					targetPriority *= 100.0f;
+				}
+				if (targetUnit->crashing) {
+					targetPriority *= 1000.0f;
+				}
+			}
+
+			targets.push_back(WeaponTarget(targetPriority, targetUnit));
 		}
 	}
 
+	if (bucket == NULL) {
+		// candidates of a single weapon are not kept
+		weaponTargetCandidates.resize(numCandidates);
+	}
+
+	std::make_heap(targets.begin(), targets.end(), WeaponTargetHeapOrder());
+
 #ifdef TRACE_SYNC
 	{
 		tracefile << "[GenerateWeaponTargets] attackerID, attackRadius: " << attacker->id << ", " << radius << " ";
 
-		for (std::multimap<float, CUnit*>::const_iterator ti = targets.begin(); ti != targets.end(); ++ti)
+		for (std::vector<WeaponTarget>::const_iterator ti = targets.begin(); ti != targets.end(); ++ti)
 			tracefile << "\tpriority: " << (ti->first) <<  ", targetID: " << (ti->second)->id <<  " ";
 
 		tracefile << "\n";
@@ -745,6 +940,12 @@ void CGameHelper::GenerateWeaponTargets(const CWeapon* weapon, const CUnit* last
 #endif
 }
 
+const CGameHelper::WeaponTarget& CGameHelper::PopWeaponTarget(std::vector<WeaponTarget>& targets, size_t heapSize)
+{
+	std::pop_heap(targets.begin(), targets.begin() + heapSize, WeaponTargetHeapOrder());
+	return targets[heapSize - 1];
+}
+
 CUnit* CGameHelper::GetClosestUnit(const float3 &pos, float searchRadius)
 {
 	Query::ClosestUnit_ErrorPos_NOT_SYNCED q(pos, searchRadius);
@@ -833,7 +1034,9 @@ float3 CGameHelper::GetUnitErrorPos(const CUnit* unit, int allyteam)
 
 void CGameHelper::BuggerOff(float3 pos, float radius, bool spherical, bool forced, int teamId, CUnit* excludeUnit)
 {
-	const std::vector<CUnit*> &units = qf->GetUnitsExact(pos, radius + SQUARE_SIZE, spherical);
+	static std::vector<CUnit*> units;
+	qf->GetUnitsExact(units, pos, radius + SQUARE_SIZE, spherical);
+
 	const int allyTeamId = teamHandler->AllyTeam(teamId);
 
 	for (std::vector<CUnit*>::const_iterator ui = units.begin(); ui != units.end(); ++ui) {
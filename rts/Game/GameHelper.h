@@ -8,6 +8,7 @@
 #include "System/float3.h"
 #include "System/MemPool.h"
 
+#include <deque>
 #include <list>
 #include <map>
 #include <vector>
@@ -75,7 +76,25 @@ public:
 	float3 ClosestBuildSite(int team, const UnitDef* unitDef, float3 pos, float searchRadius, int minDist, int facing = 0);
 
 	void Update();
-	void GenerateWeaponTargets(const CWeapon* weapon, const CUnit* lastTargetUnit, std::multimap<float, CUnit*>& targets);
+
+	/// (priority, unit), lower priorities are better targets
+	typedef std::pair<float, CUnit*> WeaponTarget;
+
+	/**
+	 * Called before the units in <units> do their SlowUpdate; weapons
+	 * of the same allyteam whose owners are in the same quad then share
+	 * one set of candidate targets in GenerateWeaponTargets, gathered
+	 * from the quadfield (when first needed) for all of their ranges.
+	 */
+	void PrepareWeaponTargets(const std::vector<CUnit*>& units);
+	/**
+	 * Fills <targets> with the units <weapon> could attack, arranged
+	 * as a heap so that PopWeaponTarget can hand them out best first
+	 * and only as many are sorted as the weapon actually tries.
+	 */
+	void GenerateWeaponTargets(const CWeapon* weapon, const CUnit* lastTargetUnit, std::vector<WeaponTarget>& targets);
+	/// moves the best target of the heap targets[0, heapSize) to targets[heapSize - 1]
+	static const WeaponTarget& PopWeaponTarget(std::vector<WeaponTarget>& targets, size_t heapSize);
 
 	void DoExplosionDamage(CUnit* unit, CUnit* owner, const float3& expPos, float expRad, float expSpeed, float edgeEffectiveness, bool ignoreOwner, const DamageArray& damages, const int weaponDefID);
 	void DoExplosionDamage(CFeature* feature, const float3& expPos, float expRad, const DamageArray& damages, const int weaponDefID);
@@ -115,6 +134,43 @@ private:
 	 * into high trafic STL containers instead of pointers to them
 	 */
 	std::list<WaitingDamage*> waitingDamages[128];
+
+	/// reusable quadfield query results for Explosion, per nesting level
+	struct ExplosionBuffers {
+		std::vector<CUnit*> units;
+		std::vector<CFeature*> features;
+	};
+
+	std::deque<ExplosionBuffers> explosionBuffers;
+	unsigned int explosionDepth;
+
+	/// weapons sharing candidate targets, see PrepareWeaponTargets
+	struct WeaponTargetBucket {
+		int allyTeam;
+		/// covers the search areas of all weapons in the bucket
+		float minx, minz;
+		float maxx, maxz;
+		/// range in weaponTargetCandidates, -1 until gathered
+		int candidatesBeg;
+		int candidatesEnd;
+	};
+
+	/// quadfield units of enemy allyteams within the rectangle, each once
+	void GatherWeaponTargetCandidates(int allyTeam, float minx, float minz, float maxx, float maxz);
+
+	std::vector<WeaponTargetBucket> weaponTargetBuckets;
+	/// (allyteam, quad) -> bucket index or -1
+	std::vector<int> weaponTargetBucketIndex;
+	std::vector<int> weaponTargetBucketKeys;
+	std::vector<CUnit*> weaponTargetCandidates;
+	int weaponTargetFrame;
+
+	/// candidates within range of the weapon being processed
+	std::vector<CUnit*> weaponTargetUnits;
+	std::vector<int> weaponTargetIDs;
+	/// results of the batched AllowWeaponTargets call-in
+	std::vector<int> weaponTargetsAllowed;
+	std::vector<float> weaponTargetPriorities;
 };
 
 extern CGameHelper* helper;
@@ -132,6 +132,8 @@ CGameServer::CGameServer(const std::string& hostIP, int hostPort, const GameData
 	quitServer=false;
 	hasLocalClient = false;
 	localClientNumber = 0;
+	demoEnded = false;
+	fastForwardDemo = false;
 	isPaused = false;
 	userSpeedFactor = 1.0f;
 	internalSpeed = 1.0f;
@@ -545,6 +547,7 @@ bool CGameServer::SendDemoData(int targetFrameNum)
 
 	if (demoReader->ReachedEnd()) {
 		demoReader.reset();
+		demoEnded = true;
 		Message(DemoEnd);
 		gameEndTime = spring_gettime();
 		ret = false;
@@ -740,10 +743,19 @@ void CGameServer::Update()
 	lastUpdate = spring_gettime();
 
 	if (!isPaused && gameHasStarted) {
+		if (demoReader && hasLocalClient && fastForwardDemo) {
+			// send the demo frame by frame, without regard for the time it
+			// was recorded at, until the local client is <GAME_SPEED * 4>
+			// frames behind (its responses arrive once per UpdateLoop pass)
+			while (demoReader && (serverFrameNum - players[localClientNumber].lastFrameResponse) < (GAME_SPEED * 4)) {
+				modGameTime = demoReader->GetNextDemoReadTime() + 0.001f;
+				SendDemoData(-1);
+			}
+		}
 		// if we are not playing a demo, or have no local client, or the
 		// local client is less than <GAME_SPEED> frames behind, advance
 		// <modGameTime>
-		if (!demoReader || !hasLocalClient || (serverFrameNum - players[localClientNumber].lastFrameResponse) < GAME_SPEED)
+		else if (!demoReader || !hasLocalClient || (serverFrameNum - players[localClientNumber].lastFrameResponse) < GAME_SPEED)
 			modGameTime += (tdif * internalSpeed);
 	}
 
@@ -2104,6 +2116,18 @@ bool CGameServer::HasFinished() const
 	return quitServer;
 }
 
+bool CGameServer::HasDemoEnded() const
+{
+	Threading::RecursiveScopedLock scoped_lock(gameServerMutex);
+	return demoEnded;
+}
+
+void CGameServer::SetFastForwardDemo(bool b)
+{
+	Threading::RecursiveScopedLock scoped_lock(gameServerMutex);
+	fastForwardDemo = b;
+}
+
 void CGameServer::CreateNewFrame(bool fromServerThread, bool fixedFrameTime)
 {
 	if (!demoReader) {
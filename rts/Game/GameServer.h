@@ -85,6 +85,14 @@ public:
 	bool HasGameID() const { return generatedGameID; }
 	/// Is the server still running?
 	bool HasFinished() const;
+	/// Has the demo being played been sent completely?
+	bool HasDemoEnded() const;
+
+	/**
+	 * @brief Send a demo as fast as the local client can simulate it
+	 * (for benchmarking) instead of at the speed it was recorded with
+	 */
+	void SetFastForwardDemo(bool b);
 
 	void UpdateSpeedControl(int speedCtrl);
 	static std::string SpeedControlToString(int speedCtrl);
@@ -225,6 +233,9 @@ private:
 	bool hasLocalClient;
 	unsigned localClientNumber;
 
+	bool demoEnded;
+	bool fastForwardDemo;
+
 	/// If the server receives a command, it will forward it to clients if it is not in this set
 	std::set<std::string> commandBlacklist;
 
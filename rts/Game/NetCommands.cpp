@@ -10,6 +10,7 @@
 #include "Player.h"
 #include "PlayerHandler.h"
 #include "ChatMessage.h"
+#include "DemoBenchmark.h"
 #include "System/TimeProfiler.h"
 #include "WordCompletion.h"
 #include "IVideoCapturing.h"
@@ -35,6 +36,7 @@
 #include "System/Sound/ISound.h"
 
 #include <boost/cstdint.hpp>
+#include <limits>
 
 void CGame::ClientReadNet()
 {
@@ -103,6 +105,11 @@ void CGame::ClientReadNet()
 		// make sure ClientReadNet returns at least every 15 game frames
 		// so CGame can process keyboard input, and render etc.
 		timeLeft = GAME_SPEED/float(gu->minFPS) * gs->userSpeedFactor;
+
+		// when benchmarking, simulate everything the server sent so far
+		// (bounded by the 500ms limit below)
+		if (demoBenchmark != NULL)
+			timeLeft = std::numeric_limits<float>::max();
 	}
 
 	// always render at least 2FPS (will otherwise be highly unresponsive when catching up after a reconnection)
@@ -367,7 +374,14 @@ void CGame::ClientReadNet()
 			}
 			case NETMSG_NEWFRAME: {
 				timeLeft -= 1.0f;
-				SimFrame();
+
+				if (demoBenchmark != NULL) {
+					demoBenchmark->SimFrameStart();
+					SimFrame();
+					demoBenchmark->SimFrameEnd(gs->frameNum);
+				} else {
+					SimFrame();
+				}
 				// both NETMSG_SYNCRESPONSE and NETMSG_NEWFRAME are used for ping calculation by server
 #ifdef SYNCCHECK
 				net->Send(CBaseNetProtocol::Get().SendSyncResponse(gu->myPlayerNum, gs->frameNum, CSyncChecker::GetChecksum()));
@@ -1002,7 +1016,7 @@ void CGame::ClientReadNet()
 
 					// stop attacks against former foe
 					if (allied) {
-						for (std::list<CUnit*>::iterator it = uh->activeUnits.begin();
+						for (std::vector<CUnit*>::iterator it = uh->activeUnits.begin();
 								it != uh->activeUnits.end();
 								++it) {
 							if (teamHandler->Ally((*it)->allyteam, whichAllyTeam)) {
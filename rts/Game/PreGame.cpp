@@ -11,6 +11,7 @@
 #include "PreGame.h"
 
 #include "ClientSetup.h"
+#include "DemoBenchmark.h"
 #include "System/Sync/FPUCheck.h"
 #include "Game.h"
 #include "GameData.h"
@@ -200,6 +201,7 @@ void CPreGame::StartServer(const std::string& setupscript)
 	gameServer = new CGameServer(settings->hostIP, settings->hostPort, startupData, setup);
 	delete startupData;
 	gameServer->AddLocalClient(settings->myPlayerName, SpringVersion::GetFull());
+	gameServer->SetFastForwardDemo(demoBenchmark != NULL);
 	good_fpu_control_registers("after CGameServer creation");
 }
 
@@ -146,7 +146,7 @@ float TraceRay(const float3& start, const float3& dir, float length, int collisi
 			for (int* quadPtr = begQuad; quadPtr != endQuad; ++quadPtr) {
 				const CQuadField::Quad& quad = qf->GetQuad(*quadPtr);
 
-				for (std::list<CFeature*>::const_iterator ui = quad.features.begin(); ui != quad.features.end(); ++ui) {
+				for (std::vector<CFeature*>::const_iterator ui = quad.features.begin(); ui != quad.features.end(); ++ui) {
 					CFeature* f = *ui;
 
 					// NOTE:
@@ -174,7 +174,7 @@ float TraceRay(const float3& start, const float3& dir, float length, int collisi
 			for (int* quadPtr = begQuad; quadPtr != endQuad; ++quadPtr) {
 				const CQuadField::Quad& quad = qf->GetQuad(*quadPtr);
 
-				for (std::list<CUnit*>::const_iterator ui = quad.units.begin(); ui != quad.units.end(); ++ui) {
+				for (std::vector<CUnit*>::const_iterator ui = quad.units.begin(); ui != quad.units.end(); ++ui) {
 					CUnit* u = *ui;
 
 					if (u == owner)
@@ -240,8 +240,8 @@ float GuiTraceRay(const float3 &start, const float3 &dir, float length, bool use
 
 		qf->GetQuadsOnRay(start, dir, length, begQuad, endQuad);
 
-		std::list<CUnit*>::const_iterator ui;
-		std::list<CFeature*>::const_iterator fi;
+		std::vector<CUnit*>::const_iterator ui;
+		std::vector<CFeature*>::const_iterator fi;
 
 		for (int* quadPtr = begQuad; quadPtr != endQuad; ++quadPtr) {
 			const CQuadField::Quad& quad = qf->GetQuad(*quadPtr);
@@ -355,7 +355,7 @@ bool LineFeatureCol(const float3& start, const float3& dir, float length)
 	for (int* quadPtr = begQuad; quadPtr != endQuad; ++quadPtr) {
 		const CQuadField::Quad& quad = qf->GetQuad(*quadPtr);
 
-		for (std::list<CFeature*>::const_iterator ui = quad.features.begin(); ui != quad.features.end(); ++ui) {
+		for (std::vector<CFeature*>::const_iterator ui = quad.features.begin(); ui != quad.features.end(); ++ui) {
 			const CFeature* f = *ui;
 
 			if (!f->blocking || f->collisionVolume == NULL)
@@ -395,8 +395,8 @@ bool TestCone(
 		const CQuadField::Quad& quad = qf->GetQuad(*quadPtr);
 
 		if (testFriendly) {
-			const std::list<CUnit*>& units = quad.teamUnits[allyteam];
-			      std::list<CUnit*>::const_iterator unitsIt;
+			const std::vector<CUnit*>& units = quad.teamUnits[allyteam];
+			      std::vector<CUnit*>::const_iterator unitsIt;
 
 			for (unitsIt = units.begin(); unitsIt != units.end(); ++unitsIt) {
 				const CUnit* u = *unitsIt;
@@ -410,8 +410,8 @@ bool TestCone(
 		}
 
 		if (testNeutral) {
-			const std::list<CUnit*>& units = quad.units;
-			      std::list<CUnit*>::const_iterator unitsIt;
+			const std::vector<CUnit*>& units = quad.units;
+			      std::vector<CUnit*>::const_iterator unitsIt;
 
 			for (unitsIt = units.begin(); unitsIt != units.end(); ++unitsIt) {
 				const CUnit* u = *unitsIt;
@@ -427,8 +427,8 @@ bool TestCone(
 		}
 
 		if (testFeatures) {
-			const std::list<CFeature*>& features = quad.features;
-			      std::list<CFeature*>::const_iterator featuresIt;
+			const std::vector<CFeature*>& features = quad.features;
+			      std::vector<CFeature*>::const_iterator featuresIt;
 
 			for (featuresIt = features.begin(); featuresIt != features.end(); ++featuresIt) {
 				const CFeature* f = *featuresIt;
@@ -476,8 +476,8 @@ bool TestTrajectoryCone(
 
 		// friendly units in this quad
 		if (testFriendly) {
-			const std::list<CUnit*>& units = quad.teamUnits[allyteam];
-			      std::list<CUnit*>::const_iterator unitsIt;
+			const std::vector<CUnit*>& units = quad.teamUnits[allyteam];
+			      std::vector<CUnit*>::const_iterator unitsIt;
 
 			for (unitsIt = units.begin(); unitsIt != units.end(); ++unitsIt) {
 				const CUnit* u = *unitsIt;
@@ -492,8 +492,8 @@ bool TestTrajectoryCone(
 
 		// neutral units in this quad
 		if (testNeutral) {
-			const std::list<CUnit*>& units = quad.units;
-			      std::list<CUnit*>::const_iterator unitsIt;
+			const std::vector<CUnit*>& units = quad.units;
+			      std::vector<CUnit*>::const_iterator unitsIt;
 
 			for (unitsIt = units.begin(); unitsIt != units.end(); ++unitsIt) {
 				const CUnit* u = *unitsIt;
@@ -510,8 +510,8 @@ bool TestTrajectoryCone(
 
 		// features in this quad
 		if (testFeatures) {
-			const std::list<CFeature*>& features = quad.features;
-			      std::list<CFeature*>::const_iterator featuresIt;
+			const std::vector<CFeature*>& features = quad.features;
+			      std::vector<CFeature*>::const_iterator featuresIt;
 
 			for (featuresIt = features.begin(); featuresIt != features.end(); ++featuresIt) {
 				const CFeature* f = *featuresIt;
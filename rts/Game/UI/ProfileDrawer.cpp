@@ -47,11 +47,12 @@ void ProfileDrawer::Draw()
 	glDisable(GL_TEXTURE_2D);
 	glColor4f(0.0f, 0.0f, 0.5f, 0.5f);
 	if(!profiler.profile.empty()){
+		const size_t numRows = profiler.profile.size() + profiler.counts.size();
 		glBegin(GL_TRIANGLE_STRIP);
-		glVertex3f(start_x, end_y,                                      0);
-		glVertex3f(end_x,   end_y,                                      0);
-		glVertex3f(start_x, end_y-profiler.profile.size()*0.024f-0.01f, 0);
-		glVertex3f(end_x,   end_y-profiler.profile.size()*0.024f-0.01f, 0);
+		glVertex3f(start_x, end_y,                      0);
+		glVertex3f(end_x,   end_y,                      0);
+		glVertex3f(start_x, end_y-numRows*0.024f-0.01f, 0);
+		glVertex3f(end_x,   end_y-numRows*0.024f-0.01f, 0);
 		glEnd();
 	}
 
@@ -83,6 +84,24 @@ void ProfileDrawer::Draw()
 		fStartX += 0.01f;
 		font->glFormat(fStartX, fStartY, 0.7f, FONT_BASELINE | FONT_SCALE | FONT_NORM, "%s", pi->first.c_str());
 	}
+
+	// draw the counters below the timers (total count, count within the last 500ms, counter-name)
+	std::map<std::string, CTimeProfiler::CountRecord>::iterator ci;
+	for (ci = profiler.counts.begin(); ci != profiler.counts.end(); ++ci, ++y) {
+#if GML_MUTEX_PROFILER
+		const float fStartY = start_y - y * 0.018f;
+#else
+		const float fStartY = start_y - y * 0.024f;
+#endif
+		float fStartX = start_x + 0.005f + 0.015f + 0.005f;
+
+		fStartX += 0.09f;
+		font->glFormat(fStartX, fStartY, 0.7f, FONT_BASELINE | FONT_SCALE | FONT_NORM | FONT_RIGHT, "%u", ci->second.total);
+		fStartX += 0.04f;
+		font->glFormat(fStartX, fStartY, 0.7f, FONT_BASELINE | FONT_SCALE | FONT_NORM | FONT_RIGHT, "%u", ci->second.last);
+		fStartX += 0.05f;
+		font->glFormat(fStartX, fStartY, 0.7f, FONT_BASELINE | FONT_SCALE | FONT_NORM, "%s", ci->first.c_str());
+	}
 	font->End();
 
 	// draw the Timer selection boxes
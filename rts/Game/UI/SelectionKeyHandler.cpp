@@ -213,8 +213,8 @@ void CSelectionKeyHandler::DoSelection(std::string selectString)
 			}
 		} else {
 			// all units
-			std::list<CUnit*>* au=&uh->activeUnits;
-			for (std::list<CUnit*>::iterator ui=au->begin();ui!=au->end();++ui){
+			std::vector<CUnit*>* au=&uh->activeUnits;
+			for (std::vector<CUnit*>::iterator ui=au->begin();ui!=au->end();++ui){
 				selection.push_back(*ui);
 			}
 		}
@@ -229,8 +229,8 @@ void CSelectionKeyHandler::DoSelection(std::string selectString)
 			}
 		} else {
 		  // all units in viewport
-			std::list<CUnit*>* au=&uh->activeUnits;
-			for (std::list<CUnit*>::iterator ui=au->begin();ui!=au->end();++ui){
+			std::vector<CUnit*>* au=&uh->activeUnits;
+			for (std::vector<CUnit*>::iterator ui=au->begin();ui!=au->end();++ui){
 				if (camera->InView((*ui)->midPos,(*ui)->radius)){
 					selection.push_back(*ui);
 				}
@@ -265,8 +265,8 @@ void CSelectionKeyHandler::DoSelection(std::string selectString)
 			}
 		} else {
 		  // all units in mouse range
-			std::list<CUnit*>* au=&uh->activeUnits;
-			for(std::list<CUnit*>::iterator ui=au->begin();ui!=au->end();++ui){
+			std::vector<CUnit*>* au=&uh->activeUnits;
+			for(std::vector<CUnit*>::iterator ui=au->begin();ui!=au->end();++ui){
 				float3 up = (*ui)->pos;
 				if (cylindrical) {
 					up.y = 0;
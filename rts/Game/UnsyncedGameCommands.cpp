@@ -3061,7 +3061,7 @@ class BenchmarkScriptActionExecutor : public IUnsyncedActionExecutor {
 public:
 	// XXX '-' in command name is inconsistent with the rest of the commands, which only use "[a-zA-Z]" -> remove it
 	BenchmarkScriptActionExecutor() : IUnsyncedActionExecutor("Benchmark-Script",
-			"Runs the benchmark-script for a given unit-type") {}
+			"Runs the benchmark-script for all units of a given unit-type (* for all units)") {}
 
 	bool Execute(const UnsyncedAction& action) const {
 		CUnitScript::BenchmarkScript(action.GetArgs());
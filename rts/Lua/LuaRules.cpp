@@ -116,6 +116,7 @@ CLuaRules::CLuaRules()
 	haveTerraformComplete      = HasCallIn(L, "TerraformComplete");
 	haveAllowWeaponTargetCheck = HasCallIn(L, "AllowWeaponTargetCheck");
 	haveAllowWeaponTarget      = HasCallIn(L, "AllowWeaponTarget");
+	haveAllowWeaponTargets     = HasCallIn(L, "AllowWeaponTargets");
 	haveUnitPreDamaged         = HasCallIn(L, "UnitPreDamaged");
 	haveShieldPreDamaged       = HasCallIn(L, "ShieldPreDamaged");
 
@@ -199,6 +200,7 @@ bool CLuaRules::SyncedUpdateCallIn(lua_State *L, const string& name)
 	else if (name == "ShieldPreDamaged"      ) { UPDATE_HAVE_CALLIN(ShieldPreDamaged); }
 	else if (name == "AllowWeaponTargetCheck") { UPDATE_HAVE_CALLIN(AllowWeaponTargetCheck); }
 	else if (name == "AllowWeaponTarget"     ) { UPDATE_HAVE_CALLIN(AllowWeaponTarget); }
+	else if (name == "AllowWeaponTargets"    ) { UPDATE_HAVE_CALLIN(AllowWeaponTargets); }
 	else {
 		return CLuaHandleSynced::SyncedUpdateCallIn(L, name);
 	}
@@ -894,6 +896,72 @@ int CLuaRules::AllowWeaponTarget(
 	return ret;
 }
 
+bool CLuaRules::AllowWeaponTargets(
+	unsigned int attackerID,
+	unsigned int attackerWeaponNum,
+	unsigned int attackerWeaponDefID,
+	const std::vector<int>& targetIDs,
+	std::vector<int>& targetsAllowed,
+	std::vector<float>& targetPriorities)
+{
+	if (!haveAllowWeaponTargets)
+		return false;
+
+	LUA_CALL_IN_CHECK(L);
+	lua_checkstack(L, 4 + 3);
+
+	const int errfunc(SetupTraceback(L));
+	static const LuaHashString cmdStr("AllowWeaponTargets");
+
+	if (!cmdStr.GetGlobalFunc(L)) {
+		if (errfunc)
+			lua_pop(L, 1);
+		return false;
+	}
+
+	lua_pushnumber(L, attackerID);
+	lua_pushnumber(L, attackerWeaponNum);
+	lua_pushnumber(L, attackerWeaponDefID);
+	lua_createtable(L, targetIDs.size(), 0);
+
+	for (size_t n = 0; n < targetIDs.size(); n++) {
+		lua_pushnumber(L, targetIDs[n]);
+		lua_rawseti(L, -2, n + 1);
+	}
+
+	const bool success = RunCallInTraceback(cmdStr, 4, 1, errfunc);
+
+	if (!success)
+		return false;
+
+	targetsAllowed.clear();
+	targetsAllowed.resize(targetIDs.size(), -1);
+	targetPriorities.clear();
+	targetPriorities.resize(targetIDs.size(), 1.0f);
+
+	if (!lua_istable(L, -1)) {
+		LOG_L(L_WARNING, "%s() bad return value", cmdStr.GetString().c_str());
+		lua_pop(L, 1);
+		return true;
+	}
+
+	for (size_t n = 0; n < targetIDs.size(); n++) {
+		lua_rawgeti(L, -1, n + 1);
+
+		if (lua_isnumber(L, -1)) {
+			targetsAllowed[n] = 1;
+			targetPriorities[n] = lua_tonumber(L, -1);
+		} else if (lua_isboolean(L, -1)) {
+			targetsAllowed[n] = lua_toboolean(L, -1)? 1: 0;
+		}
+
+		lua_pop(L, 1);
+	}
+
+	lua_pop(L, 1);
+	return true;
+}
+
 /******************************************************************************/
 
 
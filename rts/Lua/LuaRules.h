@@ -69,6 +69,22 @@ class CLuaRules : public CLuaHandleSynced
 			unsigned int attackerWeaponNum,
 			unsigned int attackerWeaponDefID,
 			float* targetPriority);
+		/**
+		 * Batched version of AllowWeaponTarget, for all candidate
+		 * targets of one weapon; games defining it are not asked
+		 * per target. Lua returns an array holding per target a
+		 * priority (allowed), true (allowed with priority 1), false
+		 * (not allowed) or nil (up to the engine).
+		 * @return false if the call-in is not defined or failed,
+		 *   otherwise targetsAllowed holds 1, 0 or -1 per target
+		 */
+		bool AllowWeaponTargets(
+			unsigned int attackerID,
+			unsigned int attackerWeaponNum,
+			unsigned int attackerWeaponDefID,
+			const std::vector<int>& targetIDs,
+			std::vector<int>& targetsAllowed,
+			std::vector<float>& targetPriorities);
 
 		bool UnitPreDamaged(const CUnit* unit, const CUnit* attacker,
                              float damage, int weaponID, bool paralyzer,
@@ -112,6 +128,7 @@ class CLuaRules : public CLuaHandleSynced
 		bool haveShieldPreDamaged;
 		bool haveAllowWeaponTargetCheck;
 		bool haveAllowWeaponTarget;
+		bool haveAllowWeaponTargets;
 
 		bool haveDrawUnit;
 		bool haveDrawFeature;
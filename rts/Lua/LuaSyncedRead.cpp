@@ -1492,7 +1492,7 @@ int LuaSyncedRead::GetAllUnits(lua_State* L)
 {
 	CheckNoArgs(L, __FUNCTION__);
 	int count = 0;
-	std::list<CUnit*>::const_iterator uit;
+	std::vector<CUnit*>::const_iterator uit;
 	if (ActiveFullRead()) {
 		lua_createtable(L, uh->activeUnits.size(), 0);
 		for (uit = uh->activeUnits.begin(); uit != uh->activeUnits.end(); ++uit) {
@@ -1902,6 +1902,15 @@ int LuaSyncedRead::GetTeamUnitCount(lua_State* L)
 //  Spatial Unit Queries
 //
 
+// the quadfield query results are kept in reusable buffers,
+// except in GML builds where LuaSyncedRead can be entered by
+// several threads at once
+#ifdef USE_GML
+	#define QUERY_BUFFER_STORAGE
+#else
+	#define QUERY_BUFFER_STORAGE static
+#endif
+
 // Macro Requirements:
 //   L, it, units, and count
 
@@ -1978,7 +1987,8 @@ int LuaSyncedRead::GetUnitsInRectangle(lua_State* L)
 #define RECTANGLE_TEST ; // no test, GetUnitsExact is sufficient
 
 	vector<CUnit*>::const_iterator it;
-	const vector<CUnit*> &units = qf->GetUnitsExact(mins, maxs);
+	QUERY_BUFFER_STORAGE vector<CUnit*> units;
+	qf->GetUnitsExact(units, mins, maxs);
 
 	lua_newtable(L);
 	int count = 0;
@@ -2029,7 +2039,8 @@ int LuaSyncedRead::GetUnitsInBox(lua_State* L)
 	}
 
 	vector<CUnit*>::const_iterator it;
-	const vector<CUnit*> &units = qf->GetUnitsExact(mins, maxs);
+	QUERY_BUFFER_STORAGE vector<CUnit*> units;
+	qf->GetUnitsExact(units, mins, maxs);
 
 	lua_newtable(L);
 	int count = 0;
@@ -2081,7 +2092,8 @@ int LuaSyncedRead::GetUnitsInCylinder(lua_State* L)
 	}                                           \
 
 	vector<CUnit*>::const_iterator it;
-	const vector<CUnit*> &units = qf->GetUnitsExact(mins, maxs);
+	QUERY_BUFFER_STORAGE vector<CUnit*> units;
+	qf->GetUnitsExact(units, mins, maxs);
 
 	lua_newtable(L);
 	int count = 0;
@@ -2137,7 +2149,8 @@ int LuaSyncedRead::GetUnitsInSphere(lua_State* L)
 	}                                           \
 
 	vector<CUnit*>::const_iterator it;
-	const vector<CUnit*> &units = qf->GetUnitsExact(mins, maxs);
+	QUERY_BUFFER_STORAGE vector<CUnit*> units;
+	qf->GetUnitsExact(units, mins, maxs);
 
 	lua_newtable(L);
 	int count = 0;
@@ -2360,7 +2373,8 @@ int LuaSyncedRead::GetFeaturesInRectangle(lua_State* L)
 	const float3 mins(xmin, 0.0f, zmin);
 	const float3 maxs(xmax, 0.0f, zmax);
 
-	const vector<CFeature*>& rectFeatures = qf->GetFeaturesExact(mins, maxs);
+	QUERY_BUFFER_STORAGE vector<CFeature*> rectFeatures;
+	qf->GetFeaturesExact(rectFeatures, mins, maxs);
 	ProcessFeatures(L, rectFeatures);
 	return 1;
 }
@@ -2374,7 +2388,8 @@ int LuaSyncedRead::GetFeaturesInSphere(lua_State* L)
 
 	const float3 pos(x, y, z);
 
-	const vector<CFeature*>& sphFeatures = qf->GetFeaturesExact(pos, rad, true);
+	QUERY_BUFFER_STORAGE vector<CFeature*> sphFeatures;
+	qf->GetFeaturesExact(sphFeatures, pos, rad, true);
 	ProcessFeatures(L, sphFeatures);
 	return 1;
 }
@@ -2387,7 +2402,8 @@ int LuaSyncedRead::GetFeaturesInCylinder(lua_State* L)
 
 	const float3 pos(x, 0, z);
 
-	const vector<CFeature*>& cylFeatures = qf->GetFeaturesExact(pos, rad, false);
+	QUERY_BUFFER_STORAGE vector<CFeature*> cylFeatures;
+	qf->GetFeaturesExact(cylFeatures, pos, rad, false);
 	ProcessFeatures(L, cylFeatures);
 	return 1;
 }
@@ -2405,7 +2421,8 @@ int LuaSyncedRead::GetProjectilesInRectangle(lua_State* L)
 	const float3 mins(xmin, 0.0f, zmin);
 	const float3 maxs(xmax, 0.0f, zmax);
 
-	const vector<CProjectile*>& rectProjectiles = qf->GetProjectilesExact(mins, maxs);
+	QUERY_BUFFER_STORAGE vector<CProjectile*> rectProjectiles;
+	qf->GetProjectilesExact(rectProjectiles, mins, maxs);
 	const unsigned int rectProjectileCount = rectProjectiles.size();
 	unsigned int arrayIndex = 1;
 
@@ -529,6 +529,8 @@ static int MoveDataTable(lua_State* L, const void* data)
 	HSTR_PUSH_NUMBER(L, "heatMod",       md->heatMod);
 	HSTR_PUSH_NUMBER(L, "heatProduced",  md->heatProduced);
 
+	HSTR_PUSH_BOOL(L, "bidirectionalSearch", md->bidirectionalSearch);
+
 	HSTR_PUSH_STRING(L, "name", md->name);
 
 	return 1;
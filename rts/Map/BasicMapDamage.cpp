@@ -272,9 +272,9 @@ void CBasicMapDamage::UpdateLos()
 		}
 
 		RelosSquare* rs = &relosQue.front();
-		const std::list<CUnit*>& units = qf->GetQuadAt(rs->x, rs->y).units;
+		const std::vector<CUnit*>& units = qf->GetQuadAt(rs->x, rs->y).units;
 
-		std::list<CUnit*>::const_iterator ui;
+		std::vector<CUnit*>::const_iterator ui;
 		for (ui = units.begin(); ui != units.end(); ++ui) {
 			relosUnits.push_back((*ui)->id);
 		}
@@ -0,0 +1,187 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include <assert.h>
+#include "System/mmgr.h"
+
+#include "BlockingMap.h"
+
+// NOTE: the creg metadata lives in GroundBlockingObjectMap.cpp, so this
+// file has no dependencies on the rest of the engine (see test/engine)
+
+
+BlockingMapCellObjects BlockingMap::GetObjects(int idx) const
+{
+	const BlockingMapCell& cell = cells[idx];
+	BlockingMapCellObjects cellObjects;
+
+	cellObjects.numObjects = cell.numObjects;
+	cellObjects.structureMask = cell.structureMask;
+
+	if (cell.overflowBlock < 0) {
+		cellObjects.objectIDs = &cell.objectIDs[0];
+		cellObjects.objects = &cell.objects[0];
+	} else {
+		const BlockingMapOverflowBlock& block = overflowBlocks[cell.overflowBlock];
+
+		cellObjects.objectIDs = &block.objectIDs[0];
+		cellObjects.objects = &block.objects[0];
+	}
+
+	return cellObjects;
+}
+
+
+bool BlockingMap::Insert(int idx, int objectID, CSolidObject* object, bool structure)
+{
+	BlockingMapCell& cell = cells[idx];
+
+	if (cell.overflowBlock < 0) {
+		const int* ids = &cell.objectIDs[0];
+		const int* it = std::lower_bound(ids, ids + cell.numObjects, objectID);
+		const unsigned int pos = it - ids;
+
+		if (pos < cell.numObjects && *it == objectID)
+			return false;
+
+		if (cell.numObjects < BlockingMapCell::NUM_INLINE_OBJECTS) {
+			for (unsigned int n = cell.numObjects; n > pos; n--) {
+				cell.objectIDs[n] = cell.objectIDs[n - 1];
+				cell.objects[n] = cell.objects[n - 1];
+			}
+
+			cell.objectIDs[pos] = objectID;
+			cell.objects[pos] = object;
+			cell.numObjects += 1;
+
+			// shift the bits of all objects after pos up by one
+			const unsigned int lowBits = cell.structureMask & ((1U << pos) - 1);
+			const unsigned int highBits = (cell.structureMask >> pos) << (pos + 1);
+
+			cell.structureMask = lowBits | highBits | ((structure? 1U: 0U) << pos);
+			return true;
+		}
+
+		// cell is full, move its objects into an overflow block
+		const int blockIdx = AllocOverflowBlock();
+		BlockingMapOverflowBlock& block = overflowBlocks[blockIdx];
+
+		for (unsigned int n = 0; n < cell.numObjects; n++) {
+			block.objectIDs.push_back(cell.objectIDs[n]);
+			block.objects.push_back(cell.objects[n]);
+			block.structures.push_back((cell.structureMask >> n) & 1);
+
+			cell.objectIDs[n] = -1;
+			cell.objects[n] = NULL;
+		}
+
+		cell.overflowBlock = blockIdx;
+	}
+
+	BlockingMapOverflowBlock& block = overflowBlocks[cell.overflowBlock];
+
+	const std::vector<int>::iterator it = std::lower_bound(block.objectIDs.begin(), block.objectIDs.end(), objectID);
+	const unsigned int pos = it - block.objectIDs.begin();
+
+	if (it != block.objectIDs.end() && *it == objectID)
+		return false;
+
+	block.objectIDs.insert(it, objectID);
+	block.objects.insert(block.objects.begin() + pos, object);
+	block.structures.insert(block.structures.begin() + pos, structure);
+
+	cell.numObjects += 1;
+	cell.structureMask = GetStructureMask(block);
+	return true;
+}
+
+
+bool BlockingMap::Remove(int idx, int objectID)
+{
+	BlockingMapCell& cell = cells[idx];
+
+	if (cell.overflowBlock < 0) {
+		const int* ids = &cell.objectIDs[0];
+		const int* it = std::lower_bound(ids, ids + cell.numObjects, objectID);
+		const unsigned int pos = it - ids;
+
+		if (pos >= cell.numObjects || *it != objectID)
+			return false;
+
+		for (unsigned int n = pos + 1; n < cell.numObjects; n++) {
+			cell.objectIDs[n - 1] = cell.objectIDs[n];
+			cell.objects[n - 1] = cell.objects[n];
+		}
+
+		cell.numObjects -= 1;
+		cell.objectIDs[cell.numObjects] = -1;
+		cell.objects[cell.numObjects] = NULL;
+
+		// shift the bits of all objects after pos down by one
+		const unsigned int lowBits = cell.structureMask & ((1U << pos) - 1);
+		const unsigned int highBits = (cell.structureMask >> (pos + 1)) << pos;
+
+		cell.structureMask = lowBits | highBits;
+		return true;
+	}
+
+	BlockingMapOverflowBlock& block = overflowBlocks[cell.overflowBlock];
+
+	const std::vector<int>::iterator it = std::lower_bound(block.objectIDs.begin(), block.objectIDs.end(), objectID);
+	const unsigned int pos = it - block.objectIDs.begin();
+
+	if (it == block.objectIDs.end() || *it != objectID)
+		return false;
+
+	block.objectIDs.erase(it);
+	block.objects.erase(block.objects.begin() + pos);
+	block.structures.erase(block.structures.begin() + pos);
+
+	cell.numObjects -= 1;
+	cell.structureMask = GetStructureMask(block);
+
+	if (cell.numObjects <= BlockingMapCell::NUM_INLINE_OBJECTS) {
+		// objects fit into the cell again
+		for (unsigned int n = 0; n < cell.numObjects; n++) {
+			cell.objectIDs[n] = block.objectIDs[n];
+			cell.objects[n] = block.objects[n];
+		}
+
+		FreeOverflowBlock(cell.overflowBlock);
+		cell.overflowBlock = -1;
+	}
+
+	return true;
+}
+
+
+int BlockingMap::AllocOverflowBlock()
+{
+	if (freeOverflowBlocks.empty()) {
+		overflowBlocks.push_back(BlockingMapOverflowBlock());
+		return (overflowBlocks.size() - 1);
+	}
+
+	const int blockIdx = freeOverflowBlocks.back();
+	freeOverflowBlocks.pop_back();
+
+	assert(overflowBlocks[blockIdx].objectIDs.empty());
+	return blockIdx;
+}
+
+void BlockingMap::FreeOverflowBlock(int blockIdx)
+{
+	overflowBlocks[blockIdx].clear();
+	freeOverflowBlocks.push_back(blockIdx);
+}
+
+
+unsigned int BlockingMap::GetStructureMask(const BlockingMapOverflowBlock& block)
+{
+	unsigned int mask = 0;
+
+	for (unsigned int n = 0; n < block.structures.size(); n++) {
+		mask |= ((block.structures[n] != 0)? 1U: 0U) << std::min(n, 31U);
+	}
+
+	return mask;
+}
@@ -0,0 +1,123 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#ifndef BLOCKING_MAP_H
+#define BLOCKING_MAP_H
+
+#include <algorithm>
+#include <vector>
+
+#include "System/creg/creg_cond.h"
+
+class CSolidObject;
+
+/**
+ * The objects on one map square, in increasing order of their blocking-map
+ * ID. Up to NUM_INLINE_OBJECTS are kept in the cell itself, a cell holding
+ * more moves all of its objects into a block of the overflow pool owned by
+ * BlockingMap, so neither case costs an allocation per cell.
+ */
+struct BlockingMapCell
+{
+	CR_DECLARE_STRUCT(BlockingMapCell);
+
+	enum { NUM_INLINE_OBJECTS = 2 };
+
+	BlockingMapCell(): overflowBlock(-1), numObjects(0), structureMask(0) {
+		for (unsigned int n = 0; n < NUM_INLINE_OBJECTS; n++) {
+			objectIDs[n] = -1;
+			objects[n] = NULL;
+		}
+	}
+
+	int objectIDs[NUM_INLINE_OBJECTS];
+	CSolidObject* objects[NUM_INLINE_OBJECTS];
+
+	/// index into BlockingMap::overflowBlocks, -1 while the objects are inline
+	int overflowBlock;
+	unsigned int numObjects;
+	/// bit N is set if object N is a structure, bit 31 stands for all N >= 31
+	unsigned int structureMask;
+};
+
+struct BlockingMapOverflowBlock
+{
+	CR_DECLARE_STRUCT(BlockingMapOverflowBlock);
+
+	void clear() {
+		objectIDs.clear();
+		objects.clear();
+		structures.clear();
+	}
+
+	std::vector<int> objectIDs;
+	std::vector<CSolidObject*> objects;
+	std::vector<unsigned char> structures;
+};
+
+
+/**
+ * Read-only view of the objects of one cell,
+ * invalidated by any change to the BlockingMap.
+ */
+struct BlockingMapCellObjects
+{
+	BlockingMapCellObjects(): objectIDs(NULL), objects(NULL), numObjects(0), structureMask(0) {}
+
+	bool empty() const { return (numObjects == 0); }
+	unsigned int size() const { return numObjects; }
+
+	CSolidObject* operator [] (unsigned int n) const { return objects[n]; }
+
+	/// returns the index of the object with the given ID, or -1
+	int Find(int objectID) const {
+		const int* it = std::lower_bound(objectIDs, objectIDs + numObjects, objectID);
+
+		if (it == (objectIDs + numObjects) || *it != objectID)
+			return -1;
+
+		return (it - objectIDs);
+	}
+
+	bool HasStructures() const { return (structureMask != 0); }
+	/// exact for n < 31, beyond that true if any object >= 31 is a structure
+	bool MaybeStructure(unsigned int n) const { return (((structureMask >> std::min(n, 31U)) & 1) != 0); }
+
+	const int* objectIDs;
+	CSolidObject* const* objects;
+
+	unsigned int numObjects;
+	unsigned int structureMask;
+};
+
+
+/**
+ * All cells of the ground-blocking map plus the pool of overflow
+ * blocks for crowded cells; freed blocks keep their capacity and
+ * are reused by the next cell that overflows.
+ */
+struct BlockingMap
+{
+	CR_DECLARE_STRUCT(BlockingMap);
+
+	BlockingMap(int numCells = 0): cells(numCells) {}
+
+	BlockingMapCellObjects GetObjects(int idx) const;
+
+	/// returns false if the object was already in the cell
+	bool Insert(int idx, int objectID, CSolidObject* object, bool structure);
+	/// returns false if the object was not in the cell
+	bool Remove(int idx, int objectID);
+
+private:
+	int AllocOverflowBlock();
+	void FreeOverflowBlock(int blockIdx);
+
+	static unsigned int GetStructureMask(const BlockingMapOverflowBlock& block);
+
+private:
+	std::vector<BlockingMapCell> cells;
+	std::vector<BlockingMapOverflowBlock> overflowBlocks;
+	std::vector<int> freeOverflowBlocks;
+};
+
+#endif
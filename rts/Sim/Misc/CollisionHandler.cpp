@@ -17,9 +17,6 @@
 
 CR_BIND(CCollisionHandler, );
 
-unsigned int CCollisionHandler::numCollisionTests = 0;
-unsigned int CCollisionHandler::numIntersectionTests = 0;
-
 
 
 bool CCollisionHandler::DetectHit(const CUnit* u, const float3& p0, const float3& p1, CollisionQuery* q, bool forceTrace)
@@ -41,8 +38,8 @@ bool CCollisionHandler::DetectHit(const CUnit* u, const float3& p0, const float3
 
 	switch (u->collisionVolume->GetTestType()) {
 		// Collision(CUnit*) does not need p1 or q
-		case CollisionVolume::COLVOL_HITTEST_DISC: { hit = CCollisionHandler::Collision(u, p0       ); numCollisionTests    += 1; } break;
-		case CollisionVolume::COLVOL_HITTEST_CONT: { hit = CCollisionHandler::Intersect(u, p0, p1, q); numIntersectionTests += 1; } break;
+		case CollisionVolume::COLVOL_HITTEST_DISC: { hit = CCollisionHandler::Collision(u, p0       ); } break;
+		case CollisionVolume::COLVOL_HITTEST_CONT: { hit = CCollisionHandler::Intersect(u, p0, p1, q); } break;
 	}
 
 	return hit;
@@ -80,8 +77,6 @@ bool CCollisionHandler::Collision(const CUnit* u, const float3& p)
 		return false;
 	}
 
-	numCollisionTests += 1;
-
 	switch (u->collisionVolume->GetVolumeType()) {
 		case CollisionVolume::COLVOL_TYPE_SPHERE: {
 			return true;
@@ -111,8 +106,6 @@ bool CCollisionHandler::Collision(const CFeature* f, const float3& p)
 		return false;
 	}
 
-	numCollisionTests += 1;
-
 	switch (f->collisionVolume->GetVolumeType()) {
 		case CollisionVolume::COLVOL_TYPE_SPHERE: {
 			return true;
@@ -138,8 +131,8 @@ bool CCollisionHandler::CollisionFootprint(const CSolidObject* o, const float3&
 		const int square = int(p.x * invSquareSize) + int(p.z * invSquareSize) * gs->mapx;
 
 		if (square >= 0 && square < gs->mapSquares) {
-			const BlockingMapCell& cell = groundBlockingObjectMap->GetCell(square);
-			return cell.find(o->GetBlockingMapID()) != cell.end();
+			const BlockingMapCellObjects cell = groundBlockingObjectMap->GetCell(square);
+			return (cell.Find(o->GetBlockingMapID()) >= 0);
 		}
 	}
 	// If the object isn't marked on blocking map, or it is flying,
@@ -290,7 +283,6 @@ bool CCollisionHandler::Intersect(const CUnit* u, const float3& p0, const float3
 	m.Translate(u->relMidPos * float3(-1.0f, 1.0f, 1.0f));
 	m.Translate(v->GetOffsets());
 
-	numIntersectionTests += 1;
 	return CCollisionHandler::Intersect(v, m, p0, p1, q);
 }
 
@@ -302,7 +294,6 @@ bool CCollisionHandler::Intersect(const CFeature* f, const float3& p0, const flo
 	m.Translate(f->relMidPos * float3(-1.0f, 1.0f, 1.0f));
 	m.Translate(v->GetOffsets());
 
-	numIntersectionTests += 1;
 	return CCollisionHandler::Intersect(v, m, p0, p1, q);
 }
 
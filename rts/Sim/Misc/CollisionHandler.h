@@ -81,10 +81,6 @@ class CCollisionHandler {
 		static bool IntersectEllipsoid(const CollisionVolume* v, const float3& pi0, const float3& pi1, CollisionQuery* q);
 		static bool IntersectCylinder(const CollisionVolume* v, const float3& pi0, const float3& pi1, CollisionQuery* q);
 		static bool IntersectBox(const CollisionVolume* v, const float3& pi0, const float3& pi1, CollisionQuery* q);
-
-	private:
-		static unsigned int numCollisionTests;
-		static unsigned int numIntersectionTests;
 };
 
 #endif
@@ -9,7 +9,6 @@
 #include "GlobalConstants.h"
 #include "Sim/Objects/SolidObject.h"
 #include "Sim/Path/IPathManager.h"
-#include "System/creg/STL_Map.h"
 #include "lib/gml/gmlmut.h"
 
 CGroundBlockingObjectMap* groundBlockingObjectMap;
@@ -19,6 +18,29 @@ CR_REG_METADATA(CGroundBlockingObjectMap, (
 	CR_MEMBER(groundBlockingMap)
 ));
 
+CR_BIND(BlockingMapCell, )
+CR_REG_METADATA(BlockingMapCell, (
+	CR_MEMBER(objectIDs),
+	CR_MEMBER(objects),
+	CR_MEMBER(overflowBlock),
+	CR_MEMBER(numObjects),
+	CR_MEMBER(structureMask)
+));
+
+CR_BIND(BlockingMapOverflowBlock, )
+CR_REG_METADATA(BlockingMapOverflowBlock, (
+	CR_MEMBER(objectIDs),
+	CR_MEMBER(objects),
+	CR_MEMBER(structures)
+));
+
+CR_BIND(BlockingMap, )
+CR_REG_METADATA(BlockingMap, (
+	CR_MEMBER(cells),
+	CR_MEMBER(overflowBlocks),
+	CR_MEMBER(freeOverflowBlocks)
+));
+
 
 
 inline static const int GetObjectID(CSolidObject* obj)
@@ -54,12 +76,7 @@ void CGroundBlockingObjectMap::AddGroundBlockingObject(CSolidObject* object)
 		for (int xSqr = minXSqr; xSqr < maxXSqr; xSqr++) {
 			const int idx = xSqr + zSqr * gs->mapx;
 
-			BlockingMapCell& cell = groundBlockingMap[idx];
-			BlockingMapCellIt it = cell.find(objID);
-
-			if (it == cell.end()) {
-				cell[objID] = object;
-			}
+			groundBlockingMap.Insert(idx, objID, object, object->immobile);
 		}
 	}
 
@@ -96,11 +113,8 @@ void CGroundBlockingObjectMap::AddGroundBlockingObject(CSolidObject* object, con
 			const int idx = minXSqr + x + (minZSqr + z) * gs->mapx;
 			const int off = x + z * sx;
 
-			BlockingMapCell& cell = groundBlockingMap[idx];
-			BlockingMapCellIt it = cell.find(objID);
-
-			if ((it == cell.end()) && (yardMap[off] & mask)) {
-				cell[objID] = object;
+			if (yardMap[off] & mask) {
+				groundBlockingMap.Insert(idx, objID, object, object->immobile);
 			}
 		}
 	}
@@ -127,13 +141,9 @@ void CGroundBlockingObjectMap::RemoveGroundBlockingObject(CSolidObject* object)
 
 	for (int z = bz; z < bz + sz; ++z) {
 		for (int x = bx; x < bx + sx; ++x) {
-			int idx = x + z * gs->mapx;
-			BlockingMapCell& cell = groundBlockingMap[idx];
-			BlockingMapCellIt it = cell.find(objID);
+			const int idx = x + z * gs->mapx;
 
-			if (it != cell.end()) {
-				cell.erase(objID);
-			}
+			groundBlockingMap.Remove(idx, objID);
 		}
 	}
 
@@ -165,18 +175,17 @@ void CGroundBlockingObjectMap::MoveGroundBlockingObject(CSolidObject* object, fl
 CSolidObject* CGroundBlockingObjectMap::GroundBlockedUnsafe(int mapSquare, bool topMost) {
 	GML_STDMUTEX_LOCK(block); // GroundBlockedUnsafe
 
-	if (groundBlockingMap[mapSquare].empty()) {
+	const BlockingMapCellObjects cell = groundBlockingMap.GetObjects(mapSquare);
+
+	if (cell.empty()) {
 		return NULL;
 	}
 
-	const BlockingMapCell& cell = groundBlockingMap[mapSquare];
-	BlockingMapCellIt it = cell.begin();
-	CSolidObject* p = it->second;
-	CSolidObject* q = it->second;
-	++it;
+	CSolidObject* p = cell[0];
+	CSolidObject* q = cell[0];
 
-	for (; it != cell.end(); ++it) {
-		CSolidObject* obj = it->second;
+	for (unsigned int n = 1; n < cell.size(); n++) {
+		CSolidObject* obj = cell[n];
 		if (obj->pos.y > p->pos.y) { p = obj; }
 		if (obj->pos.y < q->pos.y) { q = obj; }
 	}
@@ -231,10 +240,9 @@ bool CGroundBlockingObjectMap::CanCloseYard(CSolidObject* yard)
 		for (int x = yard->mapPos.x; x < yard->mapPos.x + yard->xsize; ++x) {
 			const int idx = z * gs->mapx + x;
 
-			BlockingMapCell& cell = groundBlockingMap[idx];
-			BlockingMapCellIt it = cell.find(objID);
+			const BlockingMapCellObjects cell = groundBlockingMap.GetObjects(idx);
 
-			if (it == cell.end()) {
+			if (cell.Find(objID) < 0) {
 				// we are non-blocking in this part of
 				// our yardmap footprint, but something
 				// might be inside us
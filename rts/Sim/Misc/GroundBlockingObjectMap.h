@@ -3,22 +3,18 @@
 #ifndef GROUNDBLOCKINGOBJECTMAP_H
 #define GROUNDBLOCKINGOBJECTMAP_H
 
-#include <map>
-
+#include "BlockingMap.h"
 #include "System/creg/creg_cond.h"
 #include "System/float3.h"
 
 class CSolidObject;
-typedef std::map<int, CSolidObject*> BlockingMapCell;
-typedef BlockingMapCell::const_iterator BlockingMapCellIt;
-typedef std::vector<BlockingMapCell> BlockingMap;
 
 class CGroundBlockingObjectMap
 {
 	CR_DECLARE(CGroundBlockingObjectMap);
 
 public:
-	CGroundBlockingObjectMap(int numSquares) { groundBlockingMap.resize(numSquares); }
+	CGroundBlockingObjectMap(int numSquares): groundBlockingMap(numSquares) {}
 
 	void AddGroundBlockingObject(CSolidObject* object);
 	void AddGroundBlockingObject(CSolidObject* object, const unsigned char* yardMap, unsigned char mask);
@@ -36,7 +32,8 @@ public:
 	CSolidObject* GroundBlockedUnsafe(int mapSquare, bool topMost = true);
 
 	// for full thread safety, access via GetCell would need to be mutexed, but it appears only sim thread uses it
-	const BlockingMapCell& GetCell(int mapSquare) const { return groundBlockingMap[mapSquare]; }
+	// the returned view is invalidated by the next Add/Remove call
+	BlockingMapCellObjects GetCell(int mapSquare) const { return groundBlockingMap.GetObjects(mapSquare); }
 
 private:
 	BlockingMap groundBlockingMap;
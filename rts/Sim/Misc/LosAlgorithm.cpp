@@ -0,0 +1,458 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+/* based on original los code in LosHandler.{cpp,h} and RadarHandler.{cpp,h} */
+
+#include "LosAlgorithm.h"
+#include "System/myMath.h"
+
+#ifndef DEDICATED_NOSSE
+#include <xmmintrin.h>
+#endif
+
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+#include <cstdlib>
+
+
+//////////////////////////////////////////////////////////////////////
+namespace {
+//////////////////////////////////////////////////////////////////////
+
+
+#define MAX_LOS_TABLE 110
+
+typedef std::vector<int2> TPoints;
+typedef std::vector<int2> LosLine;
+typedef std::vector<LosLine> LosTable;
+
+
+class CLosTables
+{
+public:
+	static const LosTable& GetForLosSize(int losSize) {
+		static CLosTables instance;
+		const int tablenum = std::min(MAX_LOS_TABLE, losSize);
+		return instance.lostables[tablenum - 1];
+	}
+
+private:
+	std::vector<LosTable> lostables;
+
+	CLosTables();
+	void DrawLine(char* PaintTable, int x,int y,int Size);
+	LosLine OutputLine(int x,int y,int line);
+	void OutputTable(int table);
+};
+
+
+CLosTables::CLosTables()
+{
+	for (int a = 1; a <= MAX_LOS_TABLE; ++a) {
+		OutputTable(a);
+	}
+}
+
+
+struct int2_comparer
+{
+	bool operator () (const int2& a, const int2& b) const
+	{
+		if (a.x != b.x)
+			return a.x < b.x;
+		else
+			return a.y < b.y;
+	}
+};
+
+
+void CLosTables::OutputTable(int Table)
+{
+	TPoints Points;
+	LosTable lostable;
+
+	int Radius = Table;
+	char* PaintTable = new char[(Radius+1)*Radius];
+	memset(PaintTable, 0 , (Radius+1)*Radius);
+	int2 P;
+
+	int x, y, r2;
+
+	P.x = 0;
+	P.y = Radius;
+	Points.push_back(P);
+//  DrawLine(0, Radius, Radius);
+	for(float i=Radius; i>=1; i-=0.5f) {
+		r2 = (int)(i * i);
+
+		y = (int)i;
+		x = 1;
+		y = (int) (sqrt((float)r2 - 1) + 0.5f);
+		while (x < y) {
+			if(!PaintTable[x+y*Radius]) {
+				DrawLine(PaintTable, x, y, Radius);
+				P.x = x;
+				P.y = y;
+				Points.push_back(P);
+			}
+			if(!PaintTable[y+x*Radius]) {
+				DrawLine(PaintTable, y, x, Radius);
+				P.x = y;
+				P.y = x;
+				Points.push_back(P);
+			}
+
+			x += 1;
+			y = (int) (sqrt((float)r2 - x*x) + 0.5f);
+		}
+		if (x == y) {
+			if(!PaintTable[x+y*Radius]) {
+				DrawLine(PaintTable, x, y, Radius);
+				P.x = x;
+				P.y = y;
+				Points.push_back(P);
+			}
+		}
+	}
+
+	std::sort(Points.begin(), Points.end(), int2_comparer());
+
+	int Line = 1;
+	int Size = Points.size();
+	for(int j=0; j<Size; j++) {
+		lostable.push_back(OutputLine(Points.back().x, Points.back().y, Line));
+		Points.pop_back();
+		Line++;
+	}
+
+	lostables.push_back(lostable);
+
+	delete[] PaintTable;
+}
+
+
+LosLine CLosTables::OutputLine(int x, int y, int Line)
+{
+	LosLine losline;
+
+	int x0 = 0;
+	int y0 = 0;
+	int dx = x;
+	int dy = y;
+
+	if (abs(dx) > abs(dy)) {                    // slope <1
+		float m = (float) dy / (float) dx;      // compute slope
+		float b = y0 - m*x0;
+		dx = (dx < 0) ? -1 : 1;
+		while (x0 != x) {
+			x0 += dx;
+			losline.push_back(int2(x0, Round(m*x0 + b)));
+		}
+	} else if (dy != 0) {                       // slope = 1
+		float m = (float) dx / (float) dy;      // compute slope
+		float b = x0 - m*y0;
+		dy = (dy < 0) ? -1 : 1;
+		while (y0 != y) {
+			y0 += dy;
+			losline.push_back(int2(Round(m*y0 + b), y0));
+		}
+	}
+	return losline;
+}
+
+
+void CLosTables::DrawLine(char* PaintTable, int x, int y, int Size)
+{
+	int x0 = 0;
+	int y0 = 0;
+	int dx = x;
+	int dy = y;
+
+	if (abs(dx) > abs(dy)) {                    // slope <1
+		float m = (float) dy / (float) dx;      // compute slope
+		float b = y0 - m*x0;
+		dx = (dx < 0) ? -1 : 1;
+		while (x0 != x) {
+			x0 += dx;
+			PaintTable[x0+Round(m*x0 + b)*Size] = 1;
+		}
+	} else if (dy != 0) {                       // slope = 1
+		float m = (float) dx / (float) dy;      // compute slope
+		float b = x0 - m*y0;
+		dy = (dy < 0) ? -1 : 1;
+		while (y0 != y) {
+			y0 += dy;
+			PaintTable[Round(m*y0 + b)+y0*Size] = 1;
+		}
+	}
+}
+
+
+#ifndef DEDICATED_NOSSE
+/// all bits of lane n are set iff bit n of mask is set
+static inline __m128 LaneMask(int mask)
+{
+	static const union { int i[4]; __m128 v; } laneMasks[16] = {
+		#define LANE_MASK(m) {{ -((m >> 0) & 1), -((m >> 1) & 1), -((m >> 2) & 1), -((m >> 3) & 1) }}
+		LANE_MASK( 0), LANE_MASK( 1), LANE_MASK( 2), LANE_MASK( 3),
+		LANE_MASK( 4), LANE_MASK( 5), LANE_MASK( 6), LANE_MASK( 7),
+		LANE_MASK( 8), LANE_MASK( 9), LANE_MASK(10), LANE_MASK(11),
+		LANE_MASK(12), LANE_MASK(13), LANE_MASK(14), LANE_MASK(15),
+		#undef LANE_MASK
+	};
+
+	return laneMasks[mask].v;
+}
+#endif
+
+
+//////////////////////////////////////////////////////////////////////
+}; // end of anon namespace
+//////////////////////////////////////////////////////////////////////
+
+
+
+
+CLosAlgorithm::CLosAlgorithm(int2 size, float minMaxAng, float extraHeight, const float* heightmap)
+	: size(size)
+	, minMaxAng(minMaxAng)
+	, extraHeight(extraHeight)
+	, heightmap(heightmap)
+{
+	// create the tables now, LosAdd may be called from multiple threads
+	CLosTables::GetForLosSize(1);
+}
+
+
+bool CLosAlgorithm::ClampPos(int2& pos, int radius) const
+{
+	pos.x = Clamp(pos.x, 0, size.x - 1);
+	pos.y = Clamp(pos.y, 0, size.y - 1);
+
+	// FIXME: This additional margin is due to a suspect bug in losalgorithm
+	// causing rare crash with big units such as arm Colossus
+	return
+		(pos.x - radius < radius) || (pos.x + radius >= size.x - radius) ||
+		(pos.y - radius < radius) || (pos.y + radius >= size.y - radius);
+}
+
+
+void CLosAlgorithm::LosAdd(int2 pos, int radius, float baseHeight, std::vector<int>& squares)
+{
+#ifdef DEDICATED_NOSSE
+	LosAddScalar(pos, radius, baseHeight, squares);
+#else
+	if (radius <= 0) { return; }
+
+	if (ClampPos(pos, radius)) {
+		LosAddSIMD<true>(pos, radius, baseHeight, squares);
+	} else {
+		LosAddSIMD<false>(pos, radius, baseHeight, squares);
+	}
+#endif
+}
+
+void CLosAlgorithm::LosAddScalar(int2 pos, int radius, float baseHeight, std::vector<int>& squares)
+{
+	if (radius <= 0) { return; }
+
+	if (ClampPos(pos, radius)) {
+		SafeLosAdd(pos, radius, baseHeight, squares);
+	} else {
+		UnsafeLosAdd(pos, radius, baseHeight, squares);
+	}
+}
+
+
+#define MAP_SQUARE(pos) \
+	((pos).y * size.x + (pos).x)
+
+#define LOS_ADD(_square, _maxAng) \
+	{ \
+		const int square = _square; \
+		const float dh = heightmap[square] - baseHeight; \
+		float ang = (dh + extraHeight) * invR; \
+		if(ang > _maxAng) { \
+			squares.push_back(square); \
+			ang = dh * invR; \
+			if(ang > _maxAng) _maxAng = ang; \
+		} \
+	}
+
+
+void CLosAlgorithm::UnsafeLosAdd(int2 pos, int radius, float baseHeight, std::vector<int>& squares)
+{
+	const int mapSquare = MAP_SQUARE(pos);
+	const LosTable& table = CLosTables::GetForLosSize(radius);
+
+	baseHeight += heightmap[mapSquare];
+
+	size_t neededSpace = squares.size() + 1;
+	for(LosTable::const_iterator li = table.begin(); li != table.end(); ++li) {
+		neededSpace += li->size() * 4;
+	}
+	squares.reserve(neededSpace);
+
+	squares.push_back(mapSquare);
+
+	for(LosTable::const_iterator li = table.begin(); li != table.end(); ++li) {
+		const LosLine& line = *li;
+		float maxAng1 = minMaxAng;
+		float maxAng2 = minMaxAng;
+		float maxAng3 = minMaxAng;
+		float maxAng4 = minMaxAng;
+		float r = 1;
+
+		for(LosLine::const_iterator linei = line.begin(); linei != line.end(); ++linei) {
+			const float invR = 1.0f / r;
+
+			LOS_ADD(mapSquare + linei->x + linei->y * size.x, maxAng1);
+			LOS_ADD(mapSquare - linei->x - linei->y * size.x, maxAng2);
+			LOS_ADD(mapSquare - linei->x * size.x + linei->y, maxAng3);
+			LOS_ADD(mapSquare + linei->x * size.x - linei->y, maxAng4);
+
+			r++;
+		}
+	}
+}
+
+
+void CLosAlgorithm::SafeLosAdd(int2 pos, int radius, float baseHeight, std::vector<int>& squares)
+{
+	const int mapSquare = MAP_SQUARE(pos);
+	const LosTable& table = CLosTables::GetForLosSize(radius);
+
+	baseHeight += heightmap[mapSquare];
+
+	squares.push_back(mapSquare);
+
+	for (LosTable::const_iterator li = table.begin(); li != table.end(); ++li) {
+		const LosLine& line = *li;
+		float maxAng1 = minMaxAng;
+		float maxAng2 = minMaxAng;
+		float maxAng3 = minMaxAng;
+		float maxAng4 = minMaxAng;
+		float r = 1;
+
+		for(LosLine::const_iterator linei = line.begin(); linei != line.end(); ++linei) {
+			const float invR = 1.0f / r;
+
+			if ((pos.x + linei->x < size.x) && (pos.y + linei->y < size.y)) {
+				LOS_ADD(mapSquare + linei->x + linei->y * size.x, maxAng1);
+			}
+			if ((pos.x - linei->x >= 0) && (pos.y - linei->y >= 0)) {
+				LOS_ADD(mapSquare - linei->x - linei->y * size.x, maxAng2);
+			}
+			if ((pos.x + linei->y < size.x) && (pos.y - linei->x >= 0)) {
+				LOS_ADD(mapSquare - linei->x * size.x + linei->y, maxAng3);
+			}
+			if ((pos.x - linei->y >= 0) && (pos.y + linei->x < size.y)) {
+				LOS_ADD(mapSquare + linei->x * size.x - linei->y, maxAng4);
+			}
+
+			r++;
+		}
+	}
+}
+
+
+#ifndef DEDICATED_NOSSE
+template<bool safe>
+void __ALIGN_ARG__ CLosAlgorithm::LosAddSIMD(int2 pos, int radius, float baseHeight, std::vector<int>& squares)
+{
+	// NOTE:
+	//   the four rays of a line are independent, so each gets its own lane
+	//   (with its own max-angle) and the same float operations as in the
+	//   scalar LOS_ADD; squares are emitted in the same lane order, which
+	//   keeps the result identical to UnsafeLosAdd/SafeLosAdd
+	const int mapSquare = MAP_SQUARE(pos);
+	const LosTable& table = CLosTables::GetForLosSize(radius);
+
+	baseHeight += heightmap[mapSquare];
+
+	if (!safe) {
+		size_t neededSpace = squares.size() + 1;
+		for (LosTable::const_iterator li = table.begin(); li != table.end(); ++li) {
+			neededSpace += li->size() * 4;
+		}
+		squares.reserve(neededSpace);
+	}
+
+	squares.push_back(mapSquare);
+
+	const __m128 baseHeights = _mm_set1_ps(baseHeight);
+	const __m128 extraHeights = _mm_set1_ps(extraHeight);
+
+	for (LosTable::const_iterator li = table.begin(); li != table.end(); ++li) {
+		const LosLine& line = *li;
+
+		__m128 maxAngs = _mm_set1_ps(minMaxAng);
+		float r = 1;
+
+		// lines are at most MAX_LOS_TABLE squares long
+		int lineSquares[MAX_LOS_TABLE * 4 + 4];
+		int numLineSquares = 0;
+
+		for (LosLine::const_iterator linei = line.begin(); linei != line.end(); ++linei) {
+			const __m128 invRs = _mm_set1_ps(1.0f / r);
+
+			const int laneSquares[4] = {
+				mapSquare + linei->x + linei->y * size.x,
+				mapSquare - linei->x - linei->y * size.x,
+				mapSquare - linei->x * size.x + linei->y,
+				mapSquare + linei->x * size.x - linei->y,
+			};
+
+			int validMask = 0xF;
+			__m128 heights;
+
+			if (safe) {
+				validMask =
+					(((pos.x + linei->x <  size.x) && (pos.y + linei->y <  size.y)) << 0) |
+					(((pos.x - linei->x >= 0     ) && (pos.y - linei->y >= 0     )) << 1) |
+					(((pos.x + linei->y <  size.x) && (pos.y - linei->x >= 0     )) << 2) |
+					(((pos.x - linei->y >= 0     ) && (pos.y + linei->x <  size.y)) << 3);
+
+				heights = _mm_set_ps(
+					((validMask >> 3) & 1)? heightmap[laneSquares[3]]: 0.0f,
+					((validMask >> 2) & 1)? heightmap[laneSquares[2]]: 0.0f,
+					((validMask >> 1) & 1)? heightmap[laneSquares[1]]: 0.0f,
+					((validMask >> 0) & 1)? heightmap[laneSquares[0]]: 0.0f
+				);
+			} else {
+				heights = _mm_set_ps(
+					heightmap[laneSquares[3]],
+					heightmap[laneSquares[2]],
+					heightmap[laneSquares[1]],
+					heightmap[laneSquares[0]]
+				);
+			}
+
+			const __m128 dhs = _mm_sub_ps(heights, baseHeights);
+			const __m128 angs = _mm_mul_ps(_mm_add_ps(dhs, extraHeights), invRs);
+			const __m128 visible = (safe)?
+				_mm_and_ps(_mm_cmpgt_ps(angs, maxAngs), LaneMask(validMask)):
+				_mm_cmpgt_ps(angs, maxAngs);
+
+			const int visibleMask = _mm_movemask_ps(visible);
+
+			if (visibleMask != 0) {
+				// branch-free append of the visible lanes, in lane order
+				lineSquares[numLineSquares] = laneSquares[0]; numLineSquares += ((visibleMask >> 0) & 1);
+				lineSquares[numLineSquares] = laneSquares[1]; numLineSquares += ((visibleMask >> 1) & 1);
+				lineSquares[numLineSquares] = laneSquares[2]; numLineSquares += ((visibleMask >> 2) & 1);
+				lineSquares[numLineSquares] = laneSquares[3]; numLineSquares += ((visibleMask >> 3) & 1);
+
+				// lanes that saw their square raise their max-angle to dh / r
+				const __m128 newMaxAngs = _mm_max_ps(maxAngs, _mm_mul_ps(dhs, invRs));
+
+				maxAngs = _mm_or_ps(_mm_and_ps(visible, newMaxAngs), _mm_andnot_ps(visible, maxAngs));
+			}
+
+			r++;
+		}
+
+		squares.insert(squares.end(), lineSquares, lineSquares + numLineSquares);
+	}
+}
+#endif
@@ -0,0 +1,37 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+/* based on original los code in LosHandler.{cpp,h} and RadarHandler.{cpp,h} */
+
+#ifndef LOS_ALGORITHM_H
+#define LOS_ALGORITHM_H
+
+#include <vector>
+#include "System/Vec2.h"
+
+
+/// algorithm to calculate LOS squares using raycasting, taking terrain into account
+class CLosAlgorithm
+{
+public:
+	CLosAlgorithm(int2 size, float minMaxAng, float extraHeight, const float* heightmap);
+
+	void LosAdd(int2 pos, int radius, float baseHeight, std::vector<int>& squares);
+	/// reference version of LosAdd, tracing one ray at a time
+	void LosAddScalar(int2 pos, int radius, float baseHeight, std::vector<int>& squares);
+
+private:
+	/// clamps pos to the map, returns true if the rays need bounds-checks
+	bool ClampPos(int2& pos, int radius) const;
+
+	void UnsafeLosAdd(int2 pos, int radius, float baseHeight, std::vector<int>& squares);
+	void SafeLosAdd(int2 pos, int radius, float baseHeight, std::vector<int>& squares);
+	/// traces the 4 rays of each LOS line together, one per SIMD lane
+	template<bool safe> void LosAddSIMD(int2 pos, int radius, float baseHeight, std::vector<int>& squares);
+
+	const int2 size;
+	const float minMaxAng;
+	const float extraHeight;
+	const float* const heightmap;
+};
+
+#endif // LOS_ALGORITHM_H
@@ -2,14 +2,17 @@
 
 #include "System/mmgr.h"
 
+#include <algorithm>
 #include <list>
 #include <cstdlib>
 #include <cstring>
+#include <boost/bind.hpp>
 
 #include "LosHandler.h"
 #include "ModInfo.h"
 
 #include "Sim/Units/Unit.h"
+#include "Sim/Misc/SimScheduler.h"
 #include "Sim/Misc/TeamHandler.h"
 #include "Map/ReadMap.h"
 #include "System/Log/ILog.h"
@@ -86,7 +89,10 @@ CLosHandler::CLosHandler() :
 	losSizeX(std::max(1, gs->mapx >> losMipLevel)),
 	losSizeY(std::max(1, gs->mapy >> losMipLevel)),
 	requireSonarUnderWater(modInfo.requireSonarUnderWater),
-	losAlgo(int2(losSizeX, losSizeY), -1e6f, 15, readmap->GetMIPHeightMapSynced(losMipLevel))
+	losAlgo(int2(losSizeX, losSizeY), -1e6f, 15, readmap->GetMIPHeightMapSynced(losMipLevel)),
+	batchedUpdates(teamHandler->ActiveAllyTeams()),
+	numBatchedUpdates(0),
+	batchMoveUnits(false)
 {
 	for (int a = 0; a < teamHandler->ActiveAllyTeams(); ++a) {
 		losMaps[a].SetSize(losSizeX, losSizeY);
@@ -138,21 +144,33 @@ void CLosHandler::MoveUnit(CUnit* unit, bool redoCurrent)
 		if (!unit->los) {
 			return;
 		}
+		// queued updates of this instance still refer to its old position
+		FlushMoveUnits();
+
 		instance = unit->los;
-		CleanupInstance(instance);
+		CleanupInstanceNow(instance);
 		instance->losSquares.clear();
 		instance->basePos.x = baseX;
 		instance->basePos.y = baseY;
 		instance->baseSquare = baseSquare; //this could be a problem if several units are sharing the same instance
 		instance->baseAirPos.x = baseAirX;
 		instance->baseAirPos.y = baseAirY;
+
+		// full recompute, the terrain has changed
+		LosAdd(instance);
 	} else {
 		if (unit->los && (unit->los->baseSquare == baseSquare)) {
 			return;
 		}
 
-		FreeInstance(unit->los);
+		// if the old instance leaves the maps, this is merged with
+		// adding the new one (see LosMove) instead of doing a full
+		// remove followed by a full add
+		LosInstance* oldInstance = unit->los;
+		const bool removeOld = (oldInstance != NULL && ReleaseInstance(oldInstance));
+
 		const int hash = GetHashNum(unit);
+		bool addNew = true;
 
 		std::list<LosInstance*>::iterator lii;
 		for (lii = instanceHash[hash].begin(); lii != instanceHash[hash].end(); ++lii) {
@@ -161,27 +179,37 @@ void CLosHandler::MoveUnit(CUnit* unit, bool redoCurrent)
 			    (*lii)->airLosSize == unit->airLosRadius &&
 			    (*lii)->baseHeight == unit->losHeight    &&
 			    (*lii)->allyteam   == allyteam) {
-				AllocInstance(*lii);
-				unit->los = *lii;
-				return;
+				instance = *lii;
+				addNew = (instance->refCount == 0);
+				instance->refCount++;
+				break;
 			}
 		}
 
-		instance = new(mempool.Alloc(sizeof(LosInstance))) LosInstance(
-			unit->losRadius,
-			unit->airLosRadius,
-			allyteam,
-			int2(baseX,baseY),
-			baseSquare,
-			int2(baseAirX, baseAirY),
-			hash, unit->losHeight
-		);
-
-		instanceHash[hash].push_back(instance);
+		if (instance == NULL) {
+			instance = new(mempool.Alloc(sizeof(LosInstance))) LosInstance(
+				unit->losRadius,
+				unit->airLosRadius,
+				allyteam,
+				int2(baseX,baseY),
+				baseSquare,
+				int2(baseAirX, baseAirY),
+				hash, unit->losHeight
+			);
+
+			instanceHash[hash].push_back(instance);
+		}
+
 		unit->los = instance;
-	}
 
-	LosAdd(instance);
+		if (removeOld && addNew) {
+			LosMove(oldInstance, instance);
+		} else if (removeOld) {
+			CleanupInstance(oldInstance);
+		} else if (addNew) {
+			LosAdd(instance);
+		}
+	}
 }
 
 
@@ -190,61 +218,139 @@ void CLosHandler::LosAdd(LosInstance* instance)
 	assert(instance);
 	assert(teamHandler->IsValidAllyTeam(instance->allyteam));
 
+	if (batchMoveUnits) {
+		batchedUpdates[instance->allyteam].push_back(LosUpdate(instance, true));
+		numBatchedUpdates++;
+		return;
+	}
+
+	LosAddNow(instance);
+}
+
+void CLosHandler::LosAddNow(LosInstance* instance)
+{
+	instance->losSquares.clear();
 	losAlgo.LosAdd(instance->basePos, instance->losSize, instance->baseHeight, instance->losSquares);
+	std::sort(instance->losSquares.begin(), instance->losSquares.end());
 
 	if (instance->losSize > 0) { losMaps[instance->allyteam].AddMapSquares(instance->losSquares, instance->allyteam, 1); }
 	if (instance->airLosSize > 0) { airLosMaps[instance->allyteam].AddMapArea(instance->baseAirPos, instance->allyteam, instance->airLosSize, 1); }
 }
 
+void CLosHandler::LosMove(LosInstance* oldInstance, LosInstance* newInstance)
+{
+	assert(oldInstance->allyteam == newInstance->allyteam);
+
+	if (batchMoveUnits) {
+		batchedUpdates[newInstance->allyteam].push_back(LosUpdate(newInstance, oldInstance));
+		numBatchedUpdates++;
+		return;
+	}
+
+	LosMoveNow(oldInstance, newInstance);
+}
+
+void CLosHandler::LosMoveNow(LosInstance* oldInstance, LosInstance* newInstance)
+{
+	const int allyteam = newInstance->allyteam;
+
+	const bool samePos =
+		(newInstance->basePos.x  == oldInstance->basePos.x ) &&
+		(newInstance->basePos.y  == oldInstance->basePos.y ) &&
+		(newInstance->baseHeight == oldInstance->baseHeight) &&
+		(newInstance->losSize    == oldInstance->losSize   );
+
+	if (samePos) {
+		// only air LOS changed, the terrain LOS squares stay the same
+		newInstance->losSquares = oldInstance->losSquares;
+	} else {
+		// terrain LOS has to be ray-cast again, but only the squares
+		// that enter or leave it are touched on the map
+		newInstance->losSquares.clear();
+		losAlgo.LosAdd(newInstance->basePos, newInstance->losSize, newInstance->baseHeight, newInstance->losSquares);
+		std::sort(newInstance->losSquares.begin(), newInstance->losSquares.end());
+
+		losMaps[allyteam].MoveMapSquares(oldInstance->losSquares, newInstance->losSquares, allyteam);
+	}
+
+	// air LOS is circular, only update the squares entering and leaving it
+	if (newInstance->airLosSize == oldInstance->airLosSize) {
+		if (newInstance->airLosSize > 0) { airLosMaps[allyteam].MoveMapArea(oldInstance->baseAirPos, newInstance->baseAirPos, allyteam, newInstance->airLosSize); }
+	} else {
+		if (newInstance->airLosSize > 0) { airLosMaps[allyteam].AddMapArea(newInstance->baseAirPos, allyteam, newInstance->airLosSize, 1); }
+		if (oldInstance->airLosSize > 0) { airLosMaps[allyteam].AddMapArea(oldInstance->baseAirPos, allyteam, oldInstance->airLosSize, -1); }
+	}
+}
+
 
 void CLosHandler::FreeInstance(LosInstance* instance)
 {
 	if (instance == 0)
 		return;
 
+	if (ReleaseInstance(instance)) {
+		CleanupInstance(instance);
+	}
+}
+
+
+bool CLosHandler::ReleaseInstance(LosInstance* instance)
+{
 	instance->refCount--;
 
-	if (instance->refCount == 0) {
-		CleanupInstance(instance);
+	if (instance->refCount != 0)
+		return false;
 
-		if (!instance->toBeDeleted) {
-			instance->toBeDeleted = true;
-			toBeDeleted.push_back(instance);
-		}
+	bool removeFromMaps = true;
+
+	if (!instance->toBeDeleted) {
+		instance->toBeDeleted = true;
+		toBeDeleted.push_back(instance);
+	}
+
+	if (instance->hashNum >= LOSHANDLER_MAGIC_PRIME || instance->hashNum < 0) {
+		LOG_L(L_WARNING,
+				"[LosHandler::FreeInstance][1] bad LOS-instance hash (%d)",
+				instance->hashNum);
+	}
+
+	if (toBeDeleted.size() > 500) {
+		LosInstance* i = toBeDeleted.front();
+		toBeDeleted.pop_front();
 
-		if (instance->hashNum >= LOSHANDLER_MAGIC_PRIME || instance->hashNum < 0) {
+		if (i->hashNum >= LOSHANDLER_MAGIC_PRIME || i->hashNum < 0) {
 			LOG_L(L_WARNING,
-					"[LosHandler::FreeInstance][1] bad LOS-instance hash (%d)",
-					instance->hashNum);
+					"[LosHandler::FreeInstance][2] bad LOS-instance hash (%d)",
+					i->hashNum);
+			return removeFromMaps;
 		}
 
-		if (toBeDeleted.size() > 500) {
-			LosInstance* i = toBeDeleted.front();
-			toBeDeleted.pop_front();
+		i->toBeDeleted = false;
 
-			if (i->hashNum >= LOSHANDLER_MAGIC_PRIME || i->hashNum < 0) {
-				LOG_L(L_WARNING,
-						"[LosHandler::FreeInstance][2] bad LOS-instance hash (%d)",
-						i->hashNum);
-				return;
+		if (i->refCount == 0) {
+			if (i == instance) {
+				// has to leave the maps before it is gone
+				CleanupInstance(instance);
+				removeFromMaps = false;
 			}
 
-			i->toBeDeleted = false;
+			// the instance might still have queued updates
+			FlushMoveUnits();
 
-			if (i->refCount == 0) {
-				std::list<LosInstance*>::iterator lii;
+			std::list<LosInstance*>::iterator lii;
 
-				for (lii = instanceHash[i->hashNum].begin(); lii != instanceHash[i->hashNum].end(); ++lii) {
-					if ((*lii) == i) {
-						instanceHash[i->hashNum].erase(lii);
-						i->_DestructInstance(i);
-						mempool.Free(i, sizeof(LosInstance));
-						break;
-					}
+			for (lii = instanceHash[i->hashNum].begin(); lii != instanceHash[i->hashNum].end(); ++lii) {
+				if ((*lii) == i) {
+					instanceHash[i->hashNum].erase(lii);
+					i->_DestructInstance(i);
+					mempool.Free(i, sizeof(LosInstance));
+					break;
 				}
 			}
 		}
 	}
+
+	return removeFromMaps;
 }
 
 
@@ -258,22 +364,67 @@ int CLosHandler::GetHashNum(CUnit* unit)
 }
 
 
-void CLosHandler::AllocInstance(LosInstance* instance)
+void CLosHandler::CleanupInstance(LosInstance* instance)
 {
-	if (instance->refCount == 0) {
-		LosAdd(instance);
+	if (batchMoveUnits) {
+		batchedUpdates[instance->allyteam].push_back(LosUpdate(instance, false));
+		numBatchedUpdates++;
+		return;
 	}
-	instance->refCount++;
-}
 
+	CleanupInstanceNow(instance);
+}
 
-void CLosHandler::CleanupInstance(LosInstance* instance)
+void CLosHandler::CleanupInstanceNow(LosInstance* instance)
 {
 	if (instance->losSize > 0) { losMaps[instance->allyteam].AddMapSquares(instance->losSquares, instance->allyteam, -1); }
 	if (instance->airLosSize > 0) { airLosMaps[instance->allyteam].AddMapArea(instance->baseAirPos, instance->allyteam, instance->airLosSize, -1); }
 }
 
 
+void CLosHandler::FlushMoveUnits()
+{
+	if (numBatchedUpdates == 0)
+		return;
+
+	SCOPED_TIMER("LOSHandler::FlushMoveUnits");
+
+	// readmap is not thread-safe, push the heightmap updates afterwards
+	for (size_t a = 0; a < losMaps.size(); ++a) {
+		losMaps[a].SetDelayHeightMapUpdates(true);
+		airLosMaps[a].SetDelayHeightMapUpdates(true);
+	}
+
+	simScheduler->ParallelFor(batchedUpdates.size(), boost::bind(&CLosHandler::FlushAllyTeamUpdates, this, _1, _2));
+
+	for (size_t a = 0; a < losMaps.size(); ++a) {
+		losMaps[a].SetDelayHeightMapUpdates(false);
+		airLosMaps[a].SetDelayHeightMapUpdates(false);
+		losMaps[a].PushDelayedHeightMapUpdates();
+		airLosMaps[a].PushDelayedHeightMapUpdates();
+	}
+
+	numBatchedUpdates = 0;
+}
+
+void CLosHandler::FlushAllyTeamUpdates(unsigned int allyTeam, unsigned int threadNum)
+{
+	std::vector<LosUpdate>& updates = batchedUpdates[allyTeam];
+
+	for (std::vector<LosUpdate>::const_iterator it = updates.begin(); it != updates.end(); ++it) {
+		if (it->oldInstance != NULL) {
+			LosMoveNow(it->oldInstance, it->instance);
+		} else if (it->add) {
+			LosAddNow(it->instance);
+		} else {
+			CleanupInstanceNow(it->instance);
+		}
+	}
+
+	updates.clear();
+}
+
+
 void CLosHandler::Update(void)
 {
 	while (!delayQue.empty() && delayQue.front().timeoutTime < gs->frameNum) {
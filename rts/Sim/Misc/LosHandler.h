@@ -65,6 +65,7 @@ public:
 		, toBeDeleted(false)
 	{}
 
+ 	/// sorted, see CLosMap::MoveMapSquares
  	std::vector<int> losSquares;
 	int losSize;
 	int airLosSize;
@@ -109,6 +110,16 @@ public:
 	void MoveUnit(CUnit* unit, bool redoCurrent);
 	void FreeInstance(LosInstance* instance);
 
+	/**
+	 * While batching, MoveUnit and FreeInstance only do the LosInstance
+	 * bookkeeping and queue the (expensive) ray-casts and LOS-map updates,
+	 * FlushMoveUnits then runs those per allyteam on the sim threads.
+	 * Every allyteam replays its own queue in order, so the maps end up
+	 * the same as if all updates had been done immediately.
+	 */
+	void SetBatchMoveUnits(bool b) { batchMoveUnits = b; }
+	void FlushMoveUnits();
+
 	inline bool InLos(const CWorldObject* object, int allyTeam) const {
 		if (object->alwaysVisible || gs->globalLOS[allyTeam]) {
 			return true;
@@ -191,9 +202,17 @@ private:
 
 	void PostLoad();
 	void LosAdd(LosInstance* instance);
+	void LosAddNow(LosInstance* instance);
+	/// same as CleanupInstance(oldInstance) & LosAdd(newInstance), with less map churn
+	void LosMove(LosInstance* oldInstance, LosInstance* newInstance);
+	void LosMoveNow(LosInstance* oldInstance, LosInstance* newInstance);
 	int GetHashNum(CUnit* unit);
-	void AllocInstance(LosInstance* instance);
+	/// drops a reference, returns true if the instance has to be removed from the maps
+	bool ReleaseInstance(LosInstance* instance);
 	void CleanupInstance(LosInstance* instance);
+	void CleanupInstanceNow(LosInstance* instance);
+
+	void FlushAllyTeamUpdates(unsigned int allyTeam, unsigned int threadNum);
 
 	CLosAlgorithm losAlgo;
 
@@ -209,6 +228,21 @@ private:
 
 	std::deque<DelayedInstance> delayQue;
 
+	struct LosUpdate {
+		LosUpdate(LosInstance* i, bool a): instance(i), oldInstance(NULL), add(a) {}
+		LosUpdate(LosInstance* i, LosInstance* oi): instance(i), oldInstance(oi), add(true) {}
+
+		LosInstance* instance;
+		/// set for LosMove
+		LosInstance* oldInstance;
+		bool add;
+	};
+
+	/// queued updates per allyteam, see SetBatchMoveUnits
+	std::vector< std::vector<LosUpdate> > batchedUpdates;
+	unsigned int numBatchedUpdates;
+	bool batchMoveUnits;
+
 public:
 	void Update();
 	void DelayedFreeInstance(LosInstance* instance);
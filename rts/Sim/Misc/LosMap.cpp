@@ -30,9 +30,6 @@ void CLosMap::SetSize(int2 newSize)
 void CLosMap::AddMapArea(int2 pos, int allyteam, int radius, int amount)
 {
 	#ifdef USE_UNSYNCED_HEIGHTMAP
-	static const int LOS2HEIGHT_X = gs->mapx / size.x;
-	static const int LOS2HEIGHT_Z = gs->mapy / size.y;
-
 	const bool updateUnsyncedHeightMap = (allyteam >= 0 && (allyteam == gu->myAllyTeam || gu->spectatingFullView));
 	#endif
 
@@ -58,10 +55,6 @@ void CLosMap::AddMapArea(int2 pos, int allyteam, int radius, int amount)
 			map[losMapSquareIdx] += amount;
 
 			#ifdef USE_UNSYNCED_HEIGHTMAP
-			// update unsynced heightmap for all squares that
-			// cover LOSmap square <x, y> (LOSmap resolution
-			// is never greater than that of the heightmap)
-			//
 			// NOTE:
 			//     CLosMap is also used by RadarHandler, so only
 			//     update the unsynced heightmap from LosHandler
@@ -70,330 +63,180 @@ void CLosMap::AddMapArea(int2 pos, int allyteam, int radius, int amount)
 			if (!updateUnsyncedHeightMap) { continue; }
 			if (!squareEnteredLOS) { continue; }
 
-			const int hmxTL = lmx * LOS2HEIGHT_X, hmxBR = std::min(gs->mapxm1, (lmx + 1) * LOS2HEIGHT_X);
-			const int hmzTL = lmz * LOS2HEIGHT_Z, hmzBR = std::min(gs->mapym1, (lmz + 1) * LOS2HEIGHT_Z);
-
-			readmap->PushVisibleHeightMapUpdate(hmxTL, hmzTL,  hmxBR, hmzBR,  true);
+			PushHeightMapUpdate(losMapSquareIdx);
 			#endif
 		}
 	}
 }
 
-void CLosMap::AddMapSquares(const std::vector<int>& squares, int allyteam, int amount)
+void CLosMap::MoveMapArea(int2 oldPos, int2 newPos, int allyteam, int radius)
 {
-	#ifdef USE_UNSYNCED_HEIGHTMAP
-	static const int LOS2HEIGHT_X = gs->mapx / size.x;
-	static const int LOS2HEIGHT_Z = gs->mapy / size.y;
+	if (oldPos.x == newPos.x && oldPos.y == newPos.y)
+		return;
 
+	#ifdef USE_UNSYNCED_HEIGHTMAP
 	const bool updateUnsyncedHeightMap = (allyteam >= 0 && (allyteam == gu->myAllyTeam || gu->spectatingFullView));
+	#else
+	const bool updateUnsyncedHeightMap = false;
 	#endif
 
-	std::vector<int>::const_iterator lsi;
-	for (lsi = squares.begin(); lsi != squares.end(); ++lsi) {
-		const int losMapSquareIdx = *lsi;
-		#ifdef USE_UNSYNCED_HEIGHTMAP
-		const bool squareEnteredLOS = (map[losMapSquareIdx] == 0 && amount > 0);
-		#endif
-
-		map[losMapSquareIdx] += amount;
+	const int sy = std::max(         0, std::min(oldPos.y, newPos.y) - radius);
+	const int ey = std::min(size.y - 1, std::max(oldPos.y, newPos.y) + radius);
 
-		#ifdef USE_UNSYNCED_HEIGHTMAP
-		if (!updateUnsyncedHeightMap) { continue; }
-		if (!squareEnteredLOS) { continue; }
+	for (int lmz = sy; lmz <= ey; ++lmz) {
+		int ox1, ox2;
+		int nx1, nx2;
 
-		const int lmx = losMapSquareIdx % size.x;
-		const int lmz = losMapSquareIdx / size.x;
-		const int hmxTL = lmx * LOS2HEIGHT_X, hmxBR = std::min(gs->mapxm1, (lmx + 1) * LOS2HEIGHT_X);
-		const int hmzTL = lmz * LOS2HEIGHT_Z, hmzBR = std::min(gs->mapym1, (lmz + 1) * LOS2HEIGHT_Z);
+		GetAreaRowSpan(oldPos, radius, lmz, ox1, ox2);
+		GetAreaRowSpan(newPos, radius, lmz, nx1, nx2);
 
-		readmap->PushVisibleHeightMapUpdate(hmxTL, hmzTL,  hmxBR, hmzBR,  true);
-		#endif
+		// add first, so squares that stay inside are never seen as entering
+		AddMapRowSpan(lmz, nx1, nx2, ox1, ox2,  1, updateUnsyncedHeightMap);
+		AddMapRowSpan(lmz, ox1, ox2, nx1, nx2, -1, false);
 	}
 }
 
-
-
-//////////////////////////////////////////////////////////////////////
-namespace {
-//////////////////////////////////////////////////////////////////////
-
-
-#define MAX_LOS_TABLE 110
-
-typedef std::vector<int2> TPoints;
-typedef std::vector<int2> LosLine;
-typedef std::vector<LosLine> LosTable;
-
-
-class CLosTables
+void CLosMap::GetAreaRowSpan(int2 pos, int radius, int z, int& x1, int& x2) const
 {
-public:
-	static const LosTable& GetForLosSize(int losSize) {
-		static CLosTables instance;
-		const int tablenum = std::min(MAX_LOS_TABLE, losSize);
-		return instance.lostables[tablenum - 1];
-	}
+	const int rrx = (radius * radius) - Square(pos.y - z);
 
-private:
-	std::vector<LosTable> lostables;
+	x1 = 0;
+	x2 = -1;
 
-	CLosTables();
-	void DrawLine(char* PaintTable, int x,int y,int Size);
-	LosLine OutputLine(int x,int y,int line);
-	void OutputTable(int table);
-};
+	if (rrx < 0)
+		return;
 
+	// largest w with w*w <= rrx, like the per-square test in AddMapArea
+	int w = int(math::sqrt(float(rrx)));
+	while ((w * w) > rrx) { --w; }
+	while (((w + 1) * (w + 1)) <= rrx) { ++w; }
 
-CLosTables::CLosTables()
-{
-	for (int a = 1; a <= MAX_LOS_TABLE; ++a) {
-		OutputTable(a);
-	}
+	x1 = std::max(         0, pos.x - w);
+	x2 = std::min(size.x - 1, pos.x + w);
 }
 
-
-struct int2_comparer
+void CLosMap::AddMapRowSpan(int z, int x1, int x2, int ex1, int ex2, int amount, bool updateUnsyncedHeightMap)
 {
-	bool operator () (const int2& a, const int2& b) const
-	{
-		if (a.x != b.x)
-			return a.x < b.x;
-		else
-			return a.y < b.y;
-	}
-};
+	if (x1 > x2)
+		return;
+
+	// split [x1, x2] into the parts left and right of [ex1, ex2]
+	const int spans[2][2] = {
+		{x1, (ex1 <= ex2)? std::min(x2, ex1 - 1): x2},
+		{(ex1 <= ex2)? std::max(x1, ex2 + 1): (x2 + 1), x2},
+	};
+
+	for (int n = 0; n < 2; n++) {
+		for (int lmx = spans[n][0]; lmx <= spans[n][1]; ++lmx) {
+			const int losMapSquareIdx = (z * size.x) + lmx;
+			const bool squareEnteredLOS = (map[losMapSquareIdx] == 0 && amount > 0);
 
+			map[losMapSquareIdx] += amount;
 
-void CLosTables::OutputTable(int Table)
-{
-	TPoints Points;
-	LosTable lostable;
-
-	int Radius = Table;
-	char* PaintTable = new char[(Radius+1)*Radius];
-	memset(PaintTable, 0 , (Radius+1)*Radius);
-	int2 P;
-
-	int x, y, r2;
-
-	P.x = 0;
-	P.y = Radius;
-	Points.push_back(P);
-//  DrawLine(0, Radius, Radius);
-	for(float i=Radius; i>=1; i-=0.5f) {
-		r2 = (int)(i * i);
-
-		y = (int)i;
-		x = 1;
-		y = (int) (sqrt((float)r2 - 1) + 0.5f);
-		while (x < y) {
-			if(!PaintTable[x+y*Radius]) {
-				DrawLine(PaintTable, x, y, Radius);
-				P.x = x;
-				P.y = y;
-				Points.push_back(P);
-			}
-			if(!PaintTable[y+x*Radius]) {
-				DrawLine(PaintTable, y, x, Radius);
-				P.x = y;
-				P.y = x;
-				Points.push_back(P);
-			}
+			if (!updateUnsyncedHeightMap) { continue; }
+			if (!squareEnteredLOS) { continue; }
 
-			x += 1;
-			y = (int) (sqrt((float)r2 - x*x) + 0.5f);
-		}
-		if (x == y) {
-			if(!PaintTable[x+y*Radius]) {
-				DrawLine(PaintTable, x, y, Radius);
-				P.x = x;
-				P.y = y;
-				Points.push_back(P);
-			}
+			PushHeightMapUpdate(losMapSquareIdx);
 		}
 	}
+}
 
-	std::sort(Points.begin(), Points.end(), int2_comparer());
-
-	int Line = 1;
-	int Size = Points.size();
-	for(int j=0; j<Size; j++) {
-		lostable.push_back(OutputLine(Points.back().x, Points.back().y, Line));
-		Points.pop_back();
-		Line++;
-	}
+void CLosMap::AddMapSquares(const std::vector<int>& squares, int allyteam, int amount)
+{
+	#ifdef USE_UNSYNCED_HEIGHTMAP
+	const bool updateUnsyncedHeightMap = (allyteam >= 0 && (allyteam == gu->myAllyTeam || gu->spectatingFullView));
+	#endif
 
-	lostables.push_back(lostable);
+	std::vector<int>::const_iterator lsi;
+	for (lsi = squares.begin(); lsi != squares.end(); ++lsi) {
+		const int losMapSquareIdx = *lsi;
+		#ifdef USE_UNSYNCED_HEIGHTMAP
+		const bool squareEnteredLOS = (map[losMapSquareIdx] == 0 && amount > 0);
+		#endif
 
-	delete[] PaintTable;
-}
+		map[losMapSquareIdx] += amount;
 
+		#ifdef USE_UNSYNCED_HEIGHTMAP
+		if (!updateUnsyncedHeightMap) { continue; }
+		if (!squareEnteredLOS) { continue; }
 
-LosLine CLosTables::OutputLine(int x, int y, int Line)
-{
-	LosLine losline;
-
-	int x0 = 0;
-	int y0 = 0;
-	int dx = x;
-	int dy = y;
-
-	if (abs(dx) > abs(dy)) {                    // slope <1
-		float m = (float) dy / (float) dx;      // compute slope
-		float b = y0 - m*x0;
-		dx = (dx < 0) ? -1 : 1;
-		while (x0 != x) {
-			x0 += dx;
-			losline.push_back(int2(x0, Round(m*x0 + b)));
-		}
-	} else if (dy != 0) {                       // slope = 1
-		float m = (float) dx / (float) dy;      // compute slope
-		float b = x0 - m*y0;
-		dy = (dy < 0) ? -1 : 1;
-		while (y0 != y) {
-			y0 += dy;
-			losline.push_back(int2(Round(m*y0 + b), y0));
-		}
+		PushHeightMapUpdate(losMapSquareIdx);
+		#endif
 	}
-	return losline;
 }
 
 
-void CLosTables::DrawLine(char* PaintTable, int x, int y, int Size)
+void CLosMap::MoveMapSquares(const std::vector<int>& oldSquares, const std::vector<int>& newSquares, int allyteam)
 {
-	int x0 = 0;
-	int y0 = 0;
-	int dx = x;
-	int dy = y;
-
-	if (abs(dx) > abs(dy)) {                    // slope <1
-		float m = (float) dy / (float) dx;      // compute slope
-		float b = y0 - m*x0;
-		dx = (dx < 0) ? -1 : 1;
-		while (x0 != x) {
-			x0 += dx;
-			PaintTable[x0+Round(m*x0 + b)*Size] = 1;
-		}
-	} else if (dy != 0) {                       // slope = 1
-		float m = (float) dx / (float) dy;      // compute slope
-		float b = x0 - m*y0;
-		dy = (dy < 0) ? -1 : 1;
-		while (y0 != y) {
-			y0 += dy;
-			PaintTable[Round(m*y0 + b)+y0*Size] = 1;
-		}
-	}
-}
+	#ifdef USE_UNSYNCED_HEIGHTMAP
+	const bool updateUnsyncedHeightMap = (allyteam >= 0 && (allyteam == gu->myAllyTeam || gu->spectatingFullView));
+	#endif
 
+	std::vector<int>::const_iterator osi = oldSquares.begin();
+	std::vector<int>::const_iterator nsi = newSquares.begin();
 
-//////////////////////////////////////////////////////////////////////
-}; // end of anon namespace
-//////////////////////////////////////////////////////////////////////
+	// both lists are sorted, squares present in both keep their count
+	while (osi != oldSquares.end() || nsi != newSquares.end()) {
+		if (nsi == newSquares.end() || (osi != oldSquares.end() && *osi < *nsi)) {
+			map[*osi] -= 1; ++osi;
+			continue;
+		}
+		if (osi == oldSquares.end() || *nsi < *osi) {
+			const int losMapSquareIdx = *nsi;
+			#ifdef USE_UNSYNCED_HEIGHTMAP
+			const bool squareEnteredLOS = (map[losMapSquareIdx] == 0);
+			#endif
 
+			map[losMapSquareIdx] += 1; ++nsi;
 
-void CLosAlgorithm::LosAdd(int2 pos, int radius, float baseHeight, std::vector<int>& squares)
-{
-	if (radius <= 0) { return; }
+			#ifdef USE_UNSYNCED_HEIGHTMAP
+			if (!updateUnsyncedHeightMap) { continue; }
+			if (!squareEnteredLOS) { continue; }
 
-	pos.x = Clamp(pos.x, 0, size.x - 1);
-	pos.y = Clamp(pos.y, 0, size.y - 1);
+			PushHeightMapUpdate(losMapSquareIdx);
+			#endif
+			continue;
+		}
 
-	if ((pos.x - radius < radius) || (pos.x + radius >= size.x - radius) || // FIXME: This additional margin is due to a suspect bug in losalgorithm
-	    (pos.y - radius < radius) || (pos.y + radius >= size.y - radius)) { // causing rare crash with big units such as arm Colossus
-		SafeLosAdd(pos, radius, baseHeight, squares);
-	} else {
-		UnsafeLosAdd(pos, radius, baseHeight, squares);
+		++osi;
+		++nsi;
 	}
 }
 
 
-#define MAP_SQUARE(pos) \
-	((pos).y * size.x + (pos).x)
-
-#define LOS_ADD(_square, _maxAng) \
-	{ \
-		const int square = _square; \
-		const float dh = heightmap[square] - baseHeight; \
-		float ang = (dh + extraHeight) * invR; \
-		if(ang > _maxAng) { \
-			squares.push_back(square); \
-			ang = dh * invR; \
-			if(ang > _maxAng) _maxAng = ang; \
-		} \
-	}
-
-
-void CLosAlgorithm::UnsafeLosAdd(int2 pos, int radius, float baseHeight, std::vector<int>& squares)
+void CLosMap::PushHeightMapUpdate(int losMapSquareIdx)
 {
-	const int mapSquare = MAP_SQUARE(pos);
-	const LosTable& table = CLosTables::GetForLosSize(radius);
-
-	baseHeight += heightmap[mapSquare];
-
-	size_t neededSpace = squares.size() + 1;
-	for(LosTable::const_iterator li = table.begin(); li != table.end(); ++li) {
-		neededSpace += li->size() * 4;
+	#ifdef USE_UNSYNCED_HEIGHTMAP
+	if (delayHeightMapUpdates) {
+		delayedHeightMapUpdates.push_back(losMapSquareIdx);
+		return;
 	}
-	squares.reserve(neededSpace);
-
-	squares.push_back(mapSquare);
 
-	for(LosTable::const_iterator li = table.begin(); li != table.end(); ++li) {
-		const LosLine& line = *li;
-		float maxAng1 = minMaxAng;
-		float maxAng2 = minMaxAng;
-		float maxAng3 = minMaxAng;
-		float maxAng4 = minMaxAng;
-		float r = 1;
+	// update unsynced heightmap for all squares that
+	// cover LOSmap square <x, y> (LOSmap resolution
+	// is never greater than that of the heightmap)
+	const int los2HeightX = gs->mapx / size.x;
+	const int los2HeightZ = gs->mapy / size.y;
 
-		for(LosLine::const_iterator linei = line.begin(); linei != line.end(); ++linei) {
-			const float invR = 1.0f / r;
+	const int lmx = losMapSquareIdx % size.x;
+	const int lmz = losMapSquareIdx / size.x;
+	const int hmxTL = lmx * los2HeightX, hmxBR = std::min(gs->mapxm1, (lmx + 1) * los2HeightX);
+	const int hmzTL = lmz * los2HeightZ, hmzBR = std::min(gs->mapym1, (lmz + 1) * los2HeightZ);
 
-			LOS_ADD(mapSquare + linei->x + linei->y * size.x, maxAng1);
-			LOS_ADD(mapSquare - linei->x - linei->y * size.x, maxAng2);
-			LOS_ADD(mapSquare - linei->x * size.x + linei->y, maxAng3);
-			LOS_ADD(mapSquare + linei->x * size.x - linei->y, maxAng4);
-
-			r++;
-		}
-	}
+	readmap->PushVisibleHeightMapUpdate(hmxTL, hmzTL,  hmxBR, hmzBR,  true);
+	#endif
 }
 
-
-void CLosAlgorithm::SafeLosAdd(int2 pos, int radius, float baseHeight, std::vector<int>& squares)
+void CLosMap::PushDelayedHeightMapUpdates()
 {
-	const int mapSquare = MAP_SQUARE(pos);
-	const LosTable& table = CLosTables::GetForLosSize(radius);
-
-	baseHeight += heightmap[mapSquare];
-
-	squares.push_back(mapSquare);
-
-	for (LosTable::const_iterator li = table.begin(); li != table.end(); ++li) {
-		const LosLine& line = *li;
-		float maxAng1 = minMaxAng;
-		float maxAng2 = minMaxAng;
-		float maxAng3 = minMaxAng;
-		float maxAng4 = minMaxAng;
-		float r = 1;
-
-		for(LosLine::const_iterator linei = line.begin(); linei != line.end(); ++linei) {
-			const float invR = 1.0f / r;
+	const bool delayed = delayHeightMapUpdates;
 
-			if ((pos.x + linei->x < size.x) && (pos.y + linei->y < size.y)) {
-				LOS_ADD(mapSquare + linei->x + linei->y * size.x, maxAng1);
-			}
-			if ((pos.x - linei->x >= 0) && (pos.y - linei->y >= 0)) {
-				LOS_ADD(mapSquare - linei->x - linei->y * size.x, maxAng2);
-			}
-			if ((pos.x + linei->y < size.x) && (pos.y - linei->x >= 0)) {
-				LOS_ADD(mapSquare - linei->x * size.x + linei->y, maxAng3);
-			}
-			if ((pos.x - linei->y >= 0) && (pos.y + linei->x < size.y)) {
-				LOS_ADD(mapSquare + linei->x * size.x - linei->y, maxAng4);
-			}
+	delayHeightMapUpdates = false;
 
-			r++;
-		}
+	for (std::vector<int>::const_iterator it = delayedHeightMapUpdates.begin(); it != delayedHeightMapUpdates.end(); ++it) {
+		PushHeightMapUpdate(*it);
 	}
+
+	delayedHeightMapUpdates.clear();
+	delayHeightMapUpdates = delayed;
 }
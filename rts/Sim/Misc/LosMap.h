@@ -7,21 +7,28 @@
 
 #include <vector>
 #include "System/Vec2.h"
+#include "Sim/Misc/LosAlgorithm.h"
 
 /// map containing counts of how many units have Line Of Sight (LOS) to each square
 class CLosMap
 {
 public:
-	CLosMap() : size(0, 0) {}
+	CLosMap() : size(0, 0), delayHeightMapUpdates(false) {}
 
 	void SetSize(int2 size);
 	void SetSize(int w, int h) { SetSize(int2(w, h)); }
 
 	/// circular area, for airLosMap, circular radar maps, jammer maps, ...
 	void AddMapArea(int2 pos, int allyteam, int radius, int amount);
+	/// same result as removing the area at oldPos and adding it at newPos,
+	/// but only touches the squares that leave or enter the area
+	void MoveMapArea(int2 oldPos, int2 newPos, int allyteam, int radius);
 
 	/// arbitrary area, for losMap, non-circular radar maps, ...
 	void AddMapSquares(const std::vector<int>& squares, int allyteam, int amount);
+	/// same result as removing oldSquares and adding newSquares (both sorted),
+	/// but only touches the squares that are in just one of them
+	void MoveMapSquares(const std::vector<int>& oldSquares, const std::vector<int>& newSquares, int allyteam);
 
 	int operator[] (int square) const { return map[square]; }
 
@@ -34,30 +41,27 @@ public:
 	// FIXME temp fix for CBaseGroundDrawer and AI interface, which need raw data
 	unsigned short& front() { return map.front(); }
 
+	/**
+	 * While enabled, squares entering LOS are only remembered instead of
+	 * being pushed to the unsynced heightmap right away, so that maps of
+	 * different allyteams can be updated concurrently.
+	 */
+	void SetDelayHeightMapUpdates(bool b) { delayHeightMapUpdates = b; }
+	void PushDelayedHeightMapUpdates();
+
 protected:
+	void PushHeightMapUpdate(int losMapSquareIdx);
+
+	/// returns the first and last x of the circle (pos, radius) in row z, first > last if none
+	void GetAreaRowSpan(int2 pos, int radius, int z, int& x1, int& x2) const;
+	/// adds amount to the squares [x1, x2] of row z that are not in [ex1, ex2]
+	void AddMapRowSpan(int z, int x1, int x2, int ex1, int ex2, int amount, bool updateUnsyncedHeightMap);
 
 	int2 size;
 	std::vector<unsigned short> map;
-};
-
-
-/// algorithm to calculate LOS squares using raycasting, taking terrain into account
-class CLosAlgorithm
-{
-public:
-	CLosAlgorithm(int2 size, float minMaxAng, float extraHeight, const float* heightmap)
-	: size(size), minMaxAng(minMaxAng), extraHeight(extraHeight), heightmap(heightmap) {}
-
-	void LosAdd(int2 pos, int radius, float baseHeight, std::vector<int>& squares);
-
-private:
-	void UnsafeLosAdd(int2 pos, int radius, float baseHeight, std::vector<int>& squares);
-	void SafeLosAdd(int2 pos, int radius, float baseHeight, std::vector<int>& squares);
 
-	const int2 size;
-	const float minMaxAng;
-	const float extraHeight;
-	const float* const heightmap;
+	bool delayHeightMapUpdates;
+	std::vector<int> delayedHeightMapUpdates;
 };
 
 #endif // LOS_MAP_H
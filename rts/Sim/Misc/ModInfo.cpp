@@ -53,6 +53,8 @@ void CModInfo::Init(const char* modArchive)
 	allowPushingEnemyUnits = movementTbl.GetBool("allowPushingEnemyUnits", false);
 	allowCrushingAlliedUnits = movementTbl.GetBool("allowCrushingAlliedUnits", false);
 	allowUnitCollisionDamage = movementTbl.GetBool("allowUnitCollisionDamage", false);
+	twoPhaseGroundMoveUpdate = movementTbl.GetBool("twoPhaseGroundMoveUpdate", false);
+	queuedPathRequests = movementTbl.GetBool("queuedPathRequests", false);
 
 	// determine whether the modder allows the user to use team coloured nanospray
 	const LuaTable nanosprayTbl = root.SubTable("nanospray");
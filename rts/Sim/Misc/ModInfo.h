@@ -15,6 +15,8 @@ public:
 		, allowPushingEnemyUnits(false)
 		, allowCrushingAlliedUnits(false)
 		, allowUnitCollisionDamage(false)
+		, twoPhaseGroundMoveUpdate(false)
+		, queuedPathRequests(false)
 		, constructionDecay(true)
 		, constructionDecayTime(1000)
 		, constructionDecaySpeed(1.0f)
@@ -82,6 +84,8 @@ public:
 	bool allowPushingEnemyUnits;     // determines if enemy (ground-)units can be pushed during collisions
 	bool allowCrushingAlliedUnits;   // determines if allied (ground-)units can be crushed during collisions
 	bool allowUnitCollisionDamage;   // determines if units take damage from (skidding) collisions
+	bool twoPhaseGroundMoveUpdate;   // determines if ground units gather nearby objects in parallel before moving
+	bool queuedPathRequests;         // determines if the default pathfinder solves unit path-requests at the start of the next frame
 
 	// Build behaviour
 	/// Should constructions without builders decay?
@@ -4,15 +4,15 @@
 
 #include "lib/gml/gml.h"
 #include "QuadField.h"
+#include "QuadFieldBuckets.h"
 #include "Sim/Misc/GlobalSynced.h"
 #include "Sim/Misc/GlobalConstants.h"
 #include "Sim/Misc/TeamHandler.h"
 #include "Sim/Features/Feature.h"
 #include "Sim/Units/Unit.h"
 #include "Sim/Projectiles/Projectile.h"
-#include "System/creg/STL_List.h"
 
-#define REMOVE_PROJECTILE_FAST
+#include <iterator>
 
 CR_BIND(CQuadField, );
 CR_REG_METADATA(CQuadField, (
@@ -57,7 +57,7 @@ CR_REG_METADATA_SUB(CQuadField, Quad, (
 
 CQuadField* qf;
 
-CQuadField::CQuadField()
+CQuadField::CQuadField(): numChanges(0)
 {
 	numQuadsX = gs->mapx * SQUARE_SIZE / QUAD_SIZE;
 	numQuadsZ = gs->mapy * SQUARE_SIZE / QUAD_SIZE;
@@ -79,37 +79,11 @@ CQuadField::~CQuadField()
 
 std::vector<int> CQuadField::GetQuads(float3 pos, float radius) const
 {
-	pos.ClampInBounds();
-	assert(!math::isnan(pos.x));
-	assert(!math::isnan(pos.y));
-	assert(!math::isnan(pos.z));
-
 	std::vector<int> ret;
-
-	const int maxx = std::min(((int)(pos.x + radius)) / QUAD_SIZE + 1, numQuadsX - 1);
-	const int maxz = std::min(((int)(pos.z + radius)) / QUAD_SIZE + 1, numQuadsZ - 1);
-
-	const int minx = std::max(((int)(pos.x - radius)) / QUAD_SIZE, 0);
-	const int minz = std::max(((int)(pos.z - radius)) / QUAD_SIZE, 0);
-
-	if (maxz < minz || maxx < minx) {
-		return ret;
-	}
-
-	const float maxSqLength = (radius + QUAD_SIZE * 0.72f) * (radius + QUAD_SIZE * 0.72f);
-	ret.reserve((maxz - minz) * (maxx - minx));
-	for (int z = minz; z <= maxz; ++z) {
-		for (int x = minx; x <= maxx; ++x) {
-			if ((pos - float3(x * QUAD_SIZE + QUAD_SIZE * 0.5f, 0, z * QUAD_SIZE + QUAD_SIZE * 0.5f)).SqLength2D() < maxSqLength) {
-				ret.push_back(z * numQuadsX + x);
-			}
-		}
-	}
-
+	GetQuads(ret, pos, radius);
 	return ret;
 }
 
-
 unsigned int CQuadField::GetQuads(float3 pos, float radius, int*& begQuad, int*& endQuad) const
 {
 	pos.ClampInBounds();
@@ -120,33 +94,28 @@ unsigned int CQuadField::GetQuads(float3 pos, float radius, int*& begQuad, int*&
 	assert(begQuad == &tempQuads[0]);
 	assert(endQuad == &tempQuads[0]);
 
-	const int maxx = std::min(((int)(pos.x + radius)) / QUAD_SIZE + 1, numQuadsX - 1);
-	const int maxz = std::min(((int)(pos.z + radius)) / QUAD_SIZE + 1, numQuadsZ - 1);
+	endQuad = QuadFieldBuckets::GetQuads(pos.x, pos.z, radius, QUAD_SIZE, numQuadsX, numQuadsZ, endQuad);
 
-	const int minx = std::max(((int)(pos.x - radius)) / QUAD_SIZE, 0);
-	const int minz = std::max(((int)(pos.z - radius)) / QUAD_SIZE, 0);
+	return (endQuad - begQuad);
+}
 
-	if (maxz < minz || maxx < minx) {
-		return 0;
-	}
 
-	const float maxSqLength = (radius + QUAD_SIZE * 0.72f) * (radius + QUAD_SIZE * 0.72f);
-	for (int z = minz; z <= maxz; ++z) {
-		for (int x = minx; x <= maxx; ++x) {
-			const float3 quadCenterPos = float3(x * QUAD_SIZE + QUAD_SIZE * 0.5f, 0, z * QUAD_SIZE + QUAD_SIZE * 0.5f);
 
-			if ((pos - quadCenterPos).SqLength2D() < maxSqLength) {
-				*endQuad = z * numQuadsX + x; ++endQuad;
-			}
-		}
-	}
+void CQuadField::GetQuads(std::vector<int>& quads, float3 pos, float radius) const
+{
+	quads.clear();
 
-	return (endQuad - begQuad);
+	pos.ClampInBounds();
+	assert(!math::isnan(pos.x));
+	assert(!math::isnan(pos.y));
+	assert(!math::isnan(pos.z));
+
+	QuadFieldBuckets::GetQuads(pos.x, pos.z, radius, QUAD_SIZE, numQuadsX, numQuadsZ, std::back_inserter(quads));
 }
 
 
 
-std::vector<CUnit*> CQuadField::GetUnits(const float3& pos, float radius)
+void CQuadField::GetUnits(std::vector<CUnit*>& units, const float3& pos, float radius)
 {
 	GML_RECMUTEX_LOCK(qnum); // GetUnits
 
@@ -157,24 +126,21 @@ std::vector<CUnit*> CQuadField::GetUnits(const float3& pos, float radius)
 
 	GetQuads(pos, radius, begQuad, endQuad);
 
-	std::vector<CUnit*> units;
-	std::list<CUnit*>::iterator ui;
+	units.clear();
 
 	for (int* a = begQuad; a != endQuad; ++a) {
-		Quad& quad = baseQuads[*a];
+		const std::vector<CUnit*>& quadUnits = baseQuads[*a].units;
 
-		for (ui = quad.units.begin(); ui != quad.units.end(); ++ui) {
+		for (std::vector<CUnit*>::const_iterator ui = quadUnits.begin(); ui != quadUnits.end(); ++ui) {
 			if ((*ui)->tempNum == tempNum) { continue; }
 
 			(*ui)->tempNum = tempNum;
 			units.push_back(*ui);
 		}
 	}
-
-	return units;
 }
 
-std::vector<CUnit*> CQuadField::GetUnitsExact(const float3& pos, float radius, bool spherical)
+void CQuadField::GetUnitsExact(std::vector<CUnit*>& units, const float3& pos, float radius, bool spherical)
 {
 	GML_RECMUTEX_LOCK(qnum); // GetUnitsExact
 
@@ -185,13 +151,12 @@ std::vector<CUnit*> CQuadField::GetUnitsExact(const float3& pos, float radius, b
 
 	GetQuads(pos, radius, begQuad, endQuad);
 
-	std::vector<CUnit*> units;
-	std::list<CUnit*>::iterator ui;
+	units.clear();
 
 	for (int* a = begQuad; a != endQuad; ++a) {
-		Quad& quad = baseQuads[*a];
+		const std::vector<CUnit*>& quadUnits = baseQuads[*a].units;
 
-		for (ui = quad.units.begin(); ui != quad.units.end(); ++ui) {
+		for (std::vector<CUnit*>::const_iterator ui = quadUnits.begin(); ui != quadUnits.end(); ++ui) {
 			if ((*ui)->tempNum == tempNum) { continue; }
 
 			const float totRad       = radius + (*ui)->radius;
@@ -206,37 +171,58 @@ std::vector<CUnit*> CQuadField::GetUnitsExact(const float3& pos, float radius, b
 			units.push_back(*ui);
 		}
 	}
-
-	return units;
 }
 
-std::vector<CUnit*> CQuadField::GetUnitsExact(const float3& mins, const float3& maxs)
+void CQuadField::GetUnitsExact(std::vector<CUnit*>& units, const float3& mins, const float3& maxs)
 {
 	GML_RECMUTEX_LOCK(qnum); // GetUnitsExact
 
-	const std::vector<int>& quads = GetQuadsRectangle(mins, maxs);
 	const int tempNum = gs->tempNum++;
 
-	std::vector<CUnit*> units;
-	std::vector<int>::const_iterator qi;
+	int* begQuad = &tempQuads[0];
+	int* endQuad = &tempQuads[0];
 
-	for (qi = quads.begin(); qi != quads.end(); ++qi) {
-		std::list<CUnit*>& quadUnits = baseQuads[*qi].units;
-		std::list<CUnit*>::iterator ui;
+	GetQuadsRectangle(mins, maxs, begQuad, endQuad);
 
-		for (ui = quadUnits.begin(); ui != quadUnits.end(); ++ui) {
+	units.clear();
+
+	for (int* a = begQuad; a != endQuad; ++a) {
+		const std::vector<CUnit*>& quadUnits = baseQuads[*a].units;
+
+		for (std::vector<CUnit*>::const_iterator ui = quadUnits.begin(); ui != quadUnits.end(); ++ui) {
 			CUnit* unit = *ui;
 			const float3& pos = unit->midPos;
 
 			if (unit->tempNum == tempNum) { continue; }
 			if (pos.x < mins.x || pos.x > maxs.x) { continue; }
 			if (pos.z < mins.z || pos.z > maxs.z) { continue; }
-			
+
 			unit->tempNum = tempNum;
 			units.push_back(unit);
 		}
 	}
+}
+
+
 
+std::vector<CUnit*> CQuadField::GetUnits(const float3& pos, float radius)
+{
+	std::vector<CUnit*> units;
+	GetUnits(units, pos, radius);
+	return units;
+}
+
+std::vector<CUnit*> CQuadField::GetUnitsExact(const float3& pos, float radius, bool spherical)
+{
+	std::vector<CUnit*> units;
+	GetUnitsExact(units, pos, radius, spherical);
+	return units;
+}
+
+std::vector<CUnit*> CQuadField::GetUnitsExact(const float3& mins, const float3& maxs)
+{
+	std::vector<CUnit*> units;
+	GetUnitsExact(units, mins, maxs);
 	return units;
 }
 
@@ -400,44 +386,28 @@ unsigned int CQuadField::GetQuadsOnRay(float3 start, float3 dir, float length, i
 
 void CQuadField::MovedUnit(CUnit* unit)
 {
-	const std::vector<int>& newQuads = GetQuads(unit->pos, unit->radius);
+	std::vector<int>& newQuads = tempUnitQuads;
+
+	// counts even if the quads stay the same, the unit still moved
+	numChanges++;
+
+	GetQuads(newQuads, unit->pos, unit->radius);
 
 	//! compare if the quads have changed, if not stop here
-	if (newQuads.size() == unit->quads.size()) {
-		std::vector<int>::const_iterator qi1, qi2;
-		qi1 = unit->quads.begin();
-		for (qi2 = newQuads.begin(); qi2 != newQuads.end(); ++qi2) {
-			if (*qi1 != *qi2) {
-				break;
-			}
-			++qi1;
-		}
-		if (qi2 == newQuads.end()) {
-			return;
-		}
+	if (newQuads == unit->quads) {
+		return;
 	}
 
 	GML_RECMUTEX_LOCK(quad); // MovedUnit - possible performance hog
 
 	std::vector<int>::const_iterator qi;
 	for (qi = unit->quads.begin(); qi != unit->quads.end(); ++qi) {
-		std::list<CUnit*>::iterator ui;
-		for (ui = baseQuads[*qi].units.begin(); ui != baseQuads[*qi].units.end(); ++ui) {
-			if (*ui == unit) {
-				baseQuads[*qi].units.erase(ui);
-				break;
-			}
-		}
-		for (ui = baseQuads[*qi].teamUnits[unit->allyteam].begin(); ui != baseQuads[*qi].teamUnits[unit->allyteam].end(); ++ui) {
-			if (*ui == unit) {
-				baseQuads[*qi].teamUnits[unit->allyteam].erase(ui);
-				break;
-			}
-		}
+		QuadFieldBuckets::RemoveObject(baseQuads[*qi].units, unit);
+		QuadFieldBuckets::RemoveObject(baseQuads[*qi].teamUnits[unit->allyteam], unit);
 	}
 	for (qi = newQuads.begin(); qi != newQuads.end(); ++qi) {
-		baseQuads[*qi].units.push_front(unit);
-		baseQuads[*qi].teamUnits[unit->allyteam].push_front(unit);
+		QuadFieldBuckets::InsertObject(baseQuads[*qi].units, unit);
+		QuadFieldBuckets::InsertObject(baseQuads[*qi].teamUnits[unit->allyteam], unit);
 	}
 	unit->quads = newQuads;
 }
@@ -446,21 +416,12 @@ void CQuadField::RemoveUnit(CUnit* unit)
 {
 	GML_RECMUTEX_LOCK(quad); // RemoveUnit
 
+	numChanges++;
+
 	std::vector<int>::const_iterator qi;
 	for (qi = unit->quads.begin(); qi != unit->quads.end(); ++qi) {
-		std::list<CUnit*>::iterator ui;
-		for (ui = baseQuads[*qi].units.begin(); ui != baseQuads[*qi].units.end(); ++ui) {
-			if (*ui == unit) {
-				baseQuads[*qi].units.erase(ui);
-				break;
-			}
-		}
-		for (ui = baseQuads[*qi].teamUnits[unit->allyteam].begin(); ui != baseQuads[*qi].teamUnits[unit->allyteam].end(); ++ui) {
-			if (*ui == unit) {
-				baseQuads[*qi].teamUnits[unit->allyteam].erase(ui);
-				break;
-			}
-		}
+		QuadFieldBuckets::RemoveObject(baseQuads[*qi].units, unit);
+		QuadFieldBuckets::RemoveObject(baseQuads[*qi].teamUnits[unit->allyteam], unit);
 	}
 	unit->quads.clear();
 }
@@ -471,11 +432,13 @@ void CQuadField::AddFeature(CFeature* feature)
 {
 	GML_RECMUTEX_LOCK(quad); // AddFeature
 
+	numChanges++;
+
 	const std::vector<int>& newQuads = GetQuads(feature->pos, feature->radius);
 
 	std::vector<int>::const_iterator qi;
 	for (qi = newQuads.begin(); qi != newQuads.end(); ++qi) {
-		baseQuads[*qi].features.push_front(feature);
+		QuadFieldBuckets::InsertObject(baseQuads[*qi].features, feature);
 	}
 }
 
@@ -483,11 +446,13 @@ void CQuadField::RemoveFeature(CFeature* feature)
 {
 	GML_RECMUTEX_LOCK(quad); // RemoveFeature
 
+	numChanges++;
+
 	const std::vector<int>& quads = GetQuads(feature->pos, feature->radius);
 
 	std::vector<int>::const_iterator qi;
 	for (qi = quads.begin(); qi != quads.end(); ++qi) {
-		baseQuads[*qi].features.remove(feature);
+		QuadFieldBuckets::RemoveObject(baseQuads[*qi].features, feature);
 	}
 }
 
@@ -522,10 +487,12 @@ void CQuadField::AddProjectile(CProjectile* p)
 	GML_RECMUTEX_LOCK(quad);
 
 	Quad& q = baseQuads[numQuadsX * cellCoors.y + cellCoors.x];
-	std::list<CProjectile*>& projectiles = q.projectiles;
+	std::vector<CProjectile*>& projectiles = q.projectiles;
 
 	p->SetQuadFieldCellCoors(cellCoors);
-	p->SetQuadFieldCellIter(projectiles.insert(projectiles.end(), p));
+	p->SetQuadFieldCellIdx(projectiles.size());
+
+	projectiles.push_back(p);
 }
 
 void CQuadField::RemoveProjectile(CProjectile* p)
@@ -539,44 +506,40 @@ void CQuadField::RemoveProjectile(CProjectile* p)
 
 	Quad& q = baseQuads[cellIdx];
 
-	std::list<CProjectile*>& projectiles = q.projectiles;
-	std::list<CProjectile*>::iterator pi = p->GetQuadFieldCellIter();
+	std::vector<CProjectile*>& projectiles = q.projectiles;
+	const int projIdx = p->GetQuadFieldCellIdx();
 
-	#ifdef REMOVE_PROJECTILE_FAST
-	if (pi != projectiles.end()) {
-		// this is O(1) instead of O(n) and crucially
-		// important for projectiles, but less clean
-		projectiles.erase(pi);
-	} else {
-		assert(false);
-	}
-	#else
-	for (pi = projectiles.begin(); pi != projectiles.end(); ++pi) {
-		if ((*pi) == p) {
-			projectiles.erase(pi);
-			break;
-		}
-	}
-	#endif
+	// this is O(1) instead of O(n) and crucially important for
+	// projectiles: the last projectile in the cell takes our slot
+	assert(projIdx >= 0 && projIdx < int(projectiles.size()));
+	assert(projectiles[projIdx] == p);
 
-	p->SetQuadFieldCellIter(projectiles.end());
+	projectiles[projIdx] = projectiles.back();
+	projectiles[projIdx]->SetQuadFieldCellIdx(projIdx);
+	projectiles.pop_back();
+
+	p->SetQuadFieldCellIdx(-1);
 }
 
 
 
-std::vector<CFeature*> CQuadField::GetFeaturesExact(const float3& pos, float radius)
+void CQuadField::GetFeaturesExact(std::vector<CFeature*>& features, const float3& pos, float radius)
 {
 	GML_RECMUTEX_LOCK(qnum); // GetFeaturesExact
 
-	const std::vector<int>& quads = GetQuads(pos, radius);
 	const int tempNum = gs->tempNum++;
 
-	std::vector<CFeature*> features;
-	std::vector<int>::const_iterator qi;
-	std::list<CFeature*>::iterator fi;
+	int* begQuad = &tempQuads[0];
+	int* endQuad = &tempQuads[0];
 
-	for (qi = quads.begin(); qi != quads.end(); ++qi) {
-		for (fi = baseQuads[*qi].features.begin(); fi != baseQuads[*qi].features.end(); ++fi) {
+	GetQuads(pos, radius, begQuad, endQuad);
+
+	features.clear();
+
+	for (int* a = begQuad; a != endQuad; ++a) {
+		const std::vector<CFeature*>& quadFeatures = baseQuads[*a].features;
+
+		for (std::vector<CFeature*>::const_iterator fi = quadFeatures.begin(); fi != quadFeatures.end(); ++fi) {
 			const float totRad = radius + (*fi)->radius;
 
 			if ((*fi)->tempNum == tempNum) { continue; }
@@ -586,25 +549,26 @@ std::vector<CFeature*> CQuadField::GetFeaturesExact(const float3& pos, float rad
 			features.push_back(*fi);
 		}
 	}
-
-	return features;
 }
 
-std::vector<CFeature*> CQuadField::GetFeaturesExact(const float3& pos, float radius, bool spherical)
+void CQuadField::GetFeaturesExact(std::vector<CFeature*>& features, const float3& pos, float radius, bool spherical)
 {
 	GML_RECMUTEX_LOCK(qnum); // GetFeaturesExact
 
-	const std::vector<int>& quads = GetQuads(pos, radius);
 	const int tempNum = gs->tempNum++;
-
-	std::vector<CFeature*> features;
-	std::vector<int>::const_iterator qi;
-	std::list<CFeature*>::iterator fi;
 	const float totRadSq = radius * radius;
 
-	for (qi = quads.begin(); qi != quads.end(); ++qi) {
-		for (fi = baseQuads[*qi].features.begin(); fi != baseQuads[*qi].features.end(); ++fi) {
+	int* begQuad = &tempQuads[0];
+	int* endQuad = &tempQuads[0];
+
+	GetQuads(pos, radius, begQuad, endQuad);
+
+	features.clear();
+
+	for (int* a = begQuad; a != endQuad; ++a) {
+		const std::vector<CFeature*>& quadFeatures = baseQuads[*a].features;
 
+		for (std::vector<CFeature*>::const_iterator fi = quadFeatures.begin(); fi != quadFeatures.end(); ++fi) {
 			if ((*fi)->tempNum == tempNum) { continue; }
 			if ((spherical ?
 				(pos - (*fi)->midPos).SqLength() :
@@ -614,25 +578,25 @@ std::vector<CFeature*> CQuadField::GetFeaturesExact(const float3& pos, float rad
 			features.push_back(*fi);
 		}
 	}
-
-	return features;
 }
 
-std::vector<CFeature*> CQuadField::GetFeaturesExact(const float3& mins, const float3& maxs)
+void CQuadField::GetFeaturesExact(std::vector<CFeature*>& features, const float3& mins, const float3& maxs)
 {
 	GML_RECMUTEX_LOCK(qnum); // GetFeaturesExact
 
-	const std::vector<int>& quads = GetQuadsRectangle(mins, maxs);
 	const int tempNum = gs->tempNum++;
 
-	std::vector<CFeature*> features;
-	std::vector<int>::const_iterator qi;
-	std::list<CFeature*>::iterator fi;
+	int* begQuad = &tempQuads[0];
+	int* endQuad = &tempQuads[0];
 
-	for (qi = quads.begin(); qi != quads.end(); ++qi) {
-		std::list<CFeature*>& quadFeatures = baseQuads[*qi].features;
+	GetQuadsRectangle(mins, maxs, begQuad, endQuad);
+
+	features.clear();
+
+	for (int* a = begQuad; a != endQuad; ++a) {
+		const std::vector<CFeature*>& quadFeatures = baseQuads[*a].features;
 
-		for (fi = quadFeatures.begin(); fi != quadFeatures.end(); ++fi) {
+		for (std::vector<CFeature*>::const_iterator fi = quadFeatures.begin(); fi != quadFeatures.end(); ++fi) {
 			CFeature* feature = *fi;
 			const float3& pos = feature->midPos;
 
@@ -644,26 +608,48 @@ std::vector<CFeature*> CQuadField::GetFeaturesExact(const float3& mins, const fl
 			features.push_back(feature);
 		}
 	}
+}
+
+
+
+std::vector<CFeature*> CQuadField::GetFeaturesExact(const float3& pos, float radius)
+{
+	std::vector<CFeature*> features;
+	GetFeaturesExact(features, pos, radius);
+	return features;
+}
+
+std::vector<CFeature*> CQuadField::GetFeaturesExact(const float3& pos, float radius, bool spherical)
+{
+	std::vector<CFeature*> features;
+	GetFeaturesExact(features, pos, radius, spherical);
+	return features;
+}
 
+std::vector<CFeature*> CQuadField::GetFeaturesExact(const float3& mins, const float3& maxs)
+{
+	std::vector<CFeature*> features;
+	GetFeaturesExact(features, mins, maxs);
 	return features;
 }
 
 
 
-std::vector<CProjectile*> CQuadField::GetProjectilesExact(const float3& pos, float radius)
+void CQuadField::GetProjectilesExact(std::vector<CProjectile*>& projectiles, const float3& pos, float radius)
 {
 	GML_RECMUTEX_LOCK(qnum);
 
-	const std::vector<int>& quads = GetQuads(pos, radius);
+	int* begQuad = &tempQuads[0];
+	int* endQuad = &tempQuads[0];
 
-	std::vector<CProjectile*> projectiles;
-	std::vector<int>::const_iterator qi;
-	std::list<CProjectile*>::iterator pi;
+	GetQuads(pos, radius, begQuad, endQuad);
 
-	for (qi = quads.begin(); qi != quads.end(); ++qi) {
-		std::list<CProjectile*>& quadProjectiles = baseQuads[*qi].projectiles;
+	projectiles.clear();
+
+	for (int* a = begQuad; a != endQuad; ++a) {
+		const std::vector<CProjectile*>& quadProjectiles = baseQuads[*a].projectiles;
 
-		for (pi = quadProjectiles.begin(); pi != quadProjectiles.end(); ++pi) {
+		for (std::vector<CProjectile*>::const_iterator pi = quadProjectiles.begin(); pi != quadProjectiles.end(); ++pi) {
 			const float totRad = radius + (*pi)->radius;
 
 			if ((pos - (*pi)->pos).SqLength() >= (totRad * totRad)) {
@@ -673,24 +659,23 @@ std::vector<CProjectile*> CQuadField::GetProjectilesExact(const float3& pos, flo
 			projectiles.push_back(*pi);
 		}
 	}
-
-	return projectiles;
 }
 
-std::vector<CProjectile*> CQuadField::GetProjectilesExact(const float3& mins, const float3& maxs)
+void CQuadField::GetProjectilesExact(std::vector<CProjectile*>& projectiles, const float3& mins, const float3& maxs)
 {
 	GML_RECMUTEX_LOCK(qnum);
 
-	const std::vector<int>& quads = GetQuadsRectangle(mins, maxs);
+	int* begQuad = &tempQuads[0];
+	int* endQuad = &tempQuads[0];
+
+	GetQuadsRectangle(mins, maxs, begQuad, endQuad);
 
-	std::vector<CProjectile*> projectiles;
-	std::vector<int>::const_iterator qi;
-	std::list<CProjectile*>::iterator pi;
+	projectiles.clear();
 
-	for (qi = quads.begin(); qi != quads.end(); ++qi) {
-		std::list<CProjectile*>& quadProjectiles = baseQuads[*qi].projectiles;
+	for (int* a = begQuad; a != endQuad; ++a) {
+		const std::vector<CProjectile*>& quadProjectiles = baseQuads[*a].projectiles;
 
-		for (pi = quadProjectiles.begin(); pi != quadProjectiles.end(); ++pi) {
+		for (std::vector<CProjectile*>::const_iterator pi = quadProjectiles.begin(); pi != quadProjectiles.end(); ++pi) {
 			CProjectile* projectile = *pi;
 			const float3& pos = projectile->pos;
 
@@ -700,25 +685,43 @@ std::vector<CProjectile*> CQuadField::GetProjectilesExact(const float3& mins, co
 			projectiles.push_back(projectile);
 		}
 	}
+}
 
+
+
+std::vector<CProjectile*> CQuadField::GetProjectilesExact(const float3& pos, float radius)
+{
+	std::vector<CProjectile*> projectiles;
+	GetProjectilesExact(projectiles, pos, radius);
+	return projectiles;
+}
+
+std::vector<CProjectile*> CQuadField::GetProjectilesExact(const float3& mins, const float3& maxs)
+{
+	std::vector<CProjectile*> projectiles;
+	GetProjectilesExact(projectiles, mins, maxs);
 	return projectiles;
 }
 
 
 
-std::vector<CSolidObject*> CQuadField::GetSolidsExact(const float3& pos, float radius)
+void CQuadField::GetSolidsExact(std::vector<CSolidObject*>& solids, const float3& pos, float radius)
 {
 	GML_RECMUTEX_LOCK(qnum); // GetSolidsExact
 
-	const std::vector<int>& quads = GetQuads(pos, radius);
 	const int tempNum = gs->tempNum++;
 
-	std::vector<CSolidObject*> solids;
-	std::vector<int>::const_iterator qi;
-	std::list<CUnit*>::iterator ui;
+	int* begQuad = &tempQuads[0];
+	int* endQuad = &tempQuads[0];
 
-	for (qi = quads.begin(); qi != quads.end(); ++qi) {
-		for (ui = baseQuads[*qi].units.begin(); ui != baseQuads[*qi].units.end(); ++ui) {
+	GetQuads(pos, radius, begQuad, endQuad);
+
+	solids.clear();
+
+	for (int* a = begQuad; a != endQuad; ++a) {
+		const Quad& quad = baseQuads[*a];
+
+		for (std::vector<CUnit*>::const_iterator ui = quad.units.begin(); ui != quad.units.end(); ++ui) {
 			const float totRad = radius + (*ui)->radius;
 
 			if (!(*ui)->blocking) { continue; }
@@ -729,8 +732,7 @@ std::vector<CSolidObject*> CQuadField::GetSolidsExact(const float3& pos, float r
 			solids.push_back(*ui);
 		}
 
-		std::list<CFeature*>::iterator fi;
-		for (fi = baseQuads[*qi].features.begin(); fi != baseQuads[*qi].features.end(); ++fi) {
+		for (std::vector<CFeature*>::const_iterator fi = quad.features.begin(); fi != quad.features.end(); ++fi) {
 			const float totRad = radius + (*fi)->radius;
 
 			if (!(*fi)->blocking) { continue; }
@@ -741,7 +743,12 @@ std::vector<CSolidObject*> CQuadField::GetSolidsExact(const float3& pos, float r
 			solids.push_back(*fi);
 		}
 	}
+}
 
+std::vector<CSolidObject*> CQuadField::GetSolidsExact(const float3& pos, float radius)
+{
+	std::vector<CSolidObject*> solids;
+	GetSolidsExact(solids, pos, radius);
 	return solids;
 }
 
@@ -777,10 +784,40 @@ std::vector<int> CQuadField::GetQuadsRectangle(const float3& pos1, const float3&
 	return ret;
 }
 
+unsigned int CQuadField::GetQuadsRectangle(const float3& pos1, const float3& pos2, int*& begQuad, int*& endQuad) const
+{
+	assert(!math::isnan(pos1.x));
+	assert(!math::isnan(pos1.y));
+	assert(!math::isnan(pos1.z));
+	assert(!math::isnan(pos2.x));
+	assert(!math::isnan(pos2.y));
+	assert(!math::isnan(pos2.z));
+
+	assert(begQuad == &tempQuads[0]);
+	assert(endQuad == &tempQuads[0]);
+
+	const int maxx = std::max(0, std::min(((int)(pos2.x)) / QUAD_SIZE + 1, numQuadsX - 1));
+	const int maxz = std::max(0, std::min(((int)(pos2.z)) / QUAD_SIZE + 1, numQuadsZ - 1));
+
+	const int minx = std::max(0, std::min(((int)(pos1.x)) / QUAD_SIZE, numQuadsX - 1));
+	const int minz = std::max(0, std::min(((int)(pos1.z)) / QUAD_SIZE, numQuadsZ - 1));
+
+	if (maxz < minz || maxx < minx)
+		return 0;
+
+	for (int z = minz; z <= maxz; ++z) {
+		for (int x = minx; x <= maxx; ++x) {
+			*endQuad = z * numQuadsX + x; ++endQuad;
+		}
+	}
+
+	return (endQuad - begQuad);
+}
+
 
 
 // optimization specifically for projectile collisions
-void CQuadField::GetUnitsAndFeaturesExact(const float3& pos, float radius, CUnit**& dstUnit, CFeature**& dstFeature)
+void CQuadField::GetUnitsAndFeaturesExact(const float3& pos, float radius, std::vector<CUnit*>& units, std::vector<CFeature*>& features)
 {
 	GML_RECMUTEX_LOCK(qnum); // GetUnitsAndFeaturesExact
 
@@ -791,29 +828,27 @@ void CQuadField::GetUnitsAndFeaturesExact(const float3& pos, float radius, CUnit
 
 	GetQuads(pos, radius, begQuad, endQuad);
 
-	std::list<CUnit*>::iterator ui;
-	std::list<CFeature*>::iterator fi;
+	units.clear();
+	features.clear();
 
 	for (int* a = begQuad; a != endQuad; ++a) {
-		Quad& quad = baseQuads[*a];
+		const Quad& quad = baseQuads[*a];
 
-		for (ui = quad.units.begin(); ui != quad.units.end(); ++ui) {
+		for (std::vector<CUnit*>::const_iterator ui = quad.units.begin(); ui != quad.units.end(); ++ui) {
 			if ((*ui)->tempNum == tempNum) { continue; }
 
 			(*ui)->tempNum = tempNum;
-			*dstUnit = *ui;
-			++dstUnit;
+			units.push_back(*ui);
 		}
 
-		for (fi = quad.features.begin(); fi != quad.features.end(); ++fi) {
+		for (std::vector<CFeature*>::const_iterator fi = quad.features.begin(); fi != quad.features.end(); ++fi) {
 			const float totRad = radius + (*fi)->radius;
 
 			if ((*fi)->tempNum == tempNum) { continue; }
 			if ((pos - (*fi)->midPos).SqLength() >= (totRad * totRad)) { continue; }
 
 			(*fi)->tempNum = tempNum;
-			*dstFeature = *fi;
-			++dstFeature;
+			features.push_back(*fi);
 		}
 	}
 }
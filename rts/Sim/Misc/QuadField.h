@@ -3,9 +3,7 @@
 #ifndef QUAD_FIELD_H
 #define QUAD_FIELD_H
 
-#include <set>
 #include <vector>
-#include <list>
 #include <boost/noncopyable.hpp>
 
 #include "System/creg/creg_cond.h"
@@ -36,8 +34,34 @@ public:
 	// this by itself, for GetQuads the callers take care of it
 	//
 	unsigned int GetQuads(float3 pos, float radius, int*& begQuad, int*& endQuad) const;
+	unsigned int GetQuadsRectangle(const float3& pos1, const float3& pos2, int*& begQuad, int*& endQuad) const;
 	unsigned int GetQuadsOnRay(float3 start, float3 dir, float length, int*& begQuad, int*& endQuad);
-	void GetUnitsAndFeaturesExact(const float3& pos, float radius, CUnit**& dstUnit, CFeature**& dstFeature);
+
+	/**
+	 * Allocation-free query variants: the results are written into
+	 * caller-provided buffers (which are cleared first), so callers
+	 * can keep them around as scratch space between queries. These
+	 * never call back into other code while iterating the quads, so
+	 * a buffer only has to be unique per (possibly re-entrant) caller.
+	 * Duplicates are filtered with the per-object tempNum stamp.
+	 */
+	void GetQuads(std::vector<int>& quads, float3 pos, float radius) const;
+
+	void GetUnits(std::vector<CUnit*>& units, const float3& pos, float radius);
+	void GetUnitsExact(std::vector<CUnit*>& units, const float3& pos, float radius, bool spherical = true);
+	void GetUnitsExact(std::vector<CUnit*>& units, const float3& mins, const float3& maxs);
+
+	void GetFeaturesExact(std::vector<CFeature*>& features, const float3& pos, float radius);
+	void GetFeaturesExact(std::vector<CFeature*>& features, const float3& pos, float radius, bool spherical);
+	void GetFeaturesExact(std::vector<CFeature*>& features, const float3& mins, const float3& maxs);
+
+	void GetProjectilesExact(std::vector<CProjectile*>& projectiles, const float3& pos, float radius);
+	void GetProjectilesExact(std::vector<CProjectile*>& projectiles, const float3& mins, const float3& maxs);
+
+	void GetSolidsExact(std::vector<CSolidObject*>& solids, const float3& pos, float radius);
+
+	/// optimization specifically for projectile collisions
+	void GetUnitsAndFeaturesExact(const float3& pos, float radius, std::vector<CUnit*>& units, std::vector<CFeature*>& features);
 
 	/**
 	 * Returns all units within @c radius of @c pos,
@@ -87,13 +111,20 @@ public:
 	void AddProjectile(CProjectile* projectile);
 	void RemoveProjectile(CProjectile* projectile);
 
+	/**
+	 * Objects are kept in flat buckets, insertion and removal are
+	 * O(1) swap-removes so the order within a bucket is arbitrary.
+	 * Synced projectiles store their bucket index (see
+	 * CProjectile::GetQuadFieldCellIdx) since they are (re)moved
+	 * far more often than units or features.
+	 */
 	struct Quad {
 		CR_DECLARE_STRUCT(Quad);
 		Quad();
-		std::list<CUnit*> units;
-		std::vector< std::list<CUnit*> > teamUnits;
-		std::list<CFeature*> features;
-		std::list<CProjectile*> projectiles;
+		std::vector<CUnit*> units;
+		std::vector< std::vector<CUnit*> > teamUnits;
+		std::vector<CFeature*> features;
+		std::vector<CProjectile*> projectiles;
 	};
 
 	const Quad& GetQuad(int i) const {
@@ -105,6 +136,13 @@ public:
 		return baseQuads[numQuadsX * z + x];
 	}
 
+	/**
+	 * Bumped whenever a unit is added, moved or removed, or a feature is
+	 * added or removed, so results gathered earlier in a frame can be
+	 * checked for staleness (not saved)
+	 */
+	unsigned int GetNumChanges() const { return numChanges; }
+
 	int GetNumQuadsX() const { return numQuadsX; }
 	int GetNumQuadsZ() const { return numQuadsZ; }
 
@@ -116,8 +154,11 @@ private:
 
 	std::vector<Quad> baseQuads;
 	std::vector<int> tempQuads;
+	std::vector<int> tempUnitQuads; ///< scratch buffer for MovedUnit
 	int numQuadsX;
 	int numQuadsZ;
+
+	unsigned int numChanges;
 };
 
 extern CQuadField* qf;
@@ -0,0 +1,62 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#ifndef QUAD_FIELD_BUCKETS_H
+#define QUAD_FIELD_BUCKETS_H
+
+#include <algorithm>
+#include <vector>
+
+#include "System/Util.h"
+
+/**
+ * Quad selection and bucket upkeep of CQuadField, kept free of the
+ * simulation globals so they can be tested on their own.
+ */
+namespace QuadFieldBuckets {
+	/**
+	 * Writes the index of every quad of a numQuadsX * numQuadsZ grid with
+	 * quads of size quadSize that may hold objects within radius of (x, z)
+	 * to out. The position is expected to be clamped to the map already.
+	 * @return the output iterator past the last written index
+	 */
+	template<typename OutputIt>
+	OutputIt GetQuads(float x, float z, float radius, int quadSize, int numQuadsX, int numQuadsZ, OutputIt out)
+	{
+		const int maxx = std::min(((int)(x + radius)) / quadSize + 1, numQuadsX - 1);
+		const int maxz = std::min(((int)(z + radius)) / quadSize + 1, numQuadsZ - 1);
+
+		const int minx = std::max(((int)(x - radius)) / quadSize, 0);
+		const int minz = std::max(((int)(z - radius)) / quadSize, 0);
+
+		if (maxz < minz || maxx < minx) {
+			return out;
+		}
+
+		const float maxSqLength = (radius + quadSize * 0.72f) * (radius + quadSize * 0.72f);
+		for (int qz = minz; qz <= maxz; ++qz) {
+			for (int qx = minx; qx <= maxx; ++qx) {
+				const float dx = x - (qx * quadSize + quadSize * 0.5f);
+				const float dz = z - (qz * quadSize + quadSize * 0.5f);
+
+				if ((dx * dx + dz * dz) < maxSqLength) {
+					*out = qz * numQuadsX + qx; ++out;
+				}
+			}
+		}
+
+		return out;
+	}
+
+	template<typename T>
+	void InsertObject(std::vector<T*>& bucket, T* object) {
+		bucket.push_back(object);
+	}
+
+	/// O(1) after the lookup, the last object of the bucket takes the freed slot
+	template<typename T>
+	void RemoveObject(std::vector<T*>& bucket, T* object) {
+		VectorEraseUnordered(bucket, object);
+	}
+}
+
+#endif /* QUAD_FIELD_BUCKETS_H */
@@ -5,9 +5,12 @@
 #include "RadarHandler.h"
 #include "LosHandler.h"
 #include "Map/ReadMap.h"
+#include "Sim/Misc/SimScheduler.h"
 #include "Sim/Misc/TeamHandler.h"
 #include "System/TimeProfiler.h"
 
+#include <boost/bind.hpp>
+
 
 CR_BIND(CRadarHandler, (false));
 
@@ -59,7 +62,9 @@ CRadarHandler::CRadarHandler(bool circularRadar)
   xsize(std::max(1, gs->mapx >> radarMipLevel)),
   zsize(std::max(1, gs->mapy >> radarMipLevel)),
   targFacEffect(2),
-  radarAlgo(int2(xsize, zsize), -1000, 20, readmap->GetMIPHeightMapSynced(radarMipLevel))
+  radarAlgo(int2(xsize, zsize), -1000, 20, readmap->GetMIPHeightMapSynced(radarMipLevel)),
+  numBatchedUpdates(0),
+  batchMoveUnits(false)
 {
 	commonJammerMap.SetSize(xsize, zsize);
 	commonSonarJammerMap.SetSize(xsize, zsize);
@@ -115,8 +120,12 @@ void CRadarHandler::MoveUnit(CUnit* unit)
 		if (unit->radarRadius) {
 			airRadarMaps[unit->allyteam].AddMapArea(newPos, -123, unit->radarRadius, 1);
 			if (!circularRadar) {
-				radarAlgo.LosAdd(newPos, unit->radarRadius, unit->radarHeight, unit->radarSquares);
-				radarMaps[unit->allyteam].AddMapSquares(unit->radarSquares, -123, 1);
+				if (batchMoveUnits) {
+					QueueRadarUpdate(unit, newPos, true);
+				} else {
+					radarAlgo.LosAdd(newPos, unit->radarRadius, unit->radarHeight, unit->radarSquares);
+					radarMaps[unit->allyteam].AddMapSquares(unit->radarSquares, -123, 1);
+				}
 			}
 		}
 		if (unit->sonarRadius) {
@@ -153,8 +162,12 @@ void CRadarHandler::RemoveUnit(CUnit* unit)
 		if (unit->radarRadius) {
 			airRadarMaps[unit->allyteam].AddMapArea(unit->oldRadarPos, -123, unit->radarRadius, -1);
 			if (!circularRadar) {
-				radarMaps[unit->allyteam].AddMapSquares(unit->radarSquares, -123, -1);
-				unit->radarSquares.clear();
+				if (batchMoveUnits) {
+					QueueRadarUpdate(unit, unit->oldRadarPos, false);
+				} else {
+					radarMaps[unit->allyteam].AddMapSquares(unit->radarSquares, -123, -1);
+					unit->radarSquares.clear();
+				}
 			}
 		}
 		if (unit->sonarRadius) {
@@ -166,3 +179,75 @@ void CRadarHandler::RemoveUnit(CUnit* unit)
 		unit->hasRadarPos = false;
 	}
 }
+
+
+void CRadarHandler::QueueRadarUpdate(CUnit* unit, const int2& pos, bool add)
+{
+	if (numBatchedUpdates == batchedUpdates.size()) {
+		batchedUpdates.push_back(RadarUpdate());
+	}
+
+	// aircraft temporarily change their radarHeight (see AMoveType),
+	// so everything needed later has to be copied right now
+	RadarUpdate& ru = batchedUpdates[numBatchedUpdates++];
+	ru.unit = unit;
+	ru.allyTeam = unit->allyteam;
+	ru.pos = pos;
+	ru.radius = unit->radarRadius;
+	ru.height = unit->radarHeight;
+	ru.add = add;
+	ru.squares.clear();
+}
+
+
+void CRadarHandler::FlushMoveUnits()
+{
+	if (numBatchedUpdates == 0)
+		return;
+
+	SCOPED_TIMER("RadarHandler::FlushMoveUnits");
+
+	// 1. ray-casts, these only depend on the (unchanging) heightmap
+	simScheduler->ParallelFor(numBatchedUpdates, boost::bind(&CRadarHandler::RayCastUpdate, this, _1, _2));
+
+	// 2. hand the squares to and from the units in queue order; a unit can
+	//    have updates in multiple allyteams (when it changes team) so this
+	//    can not be done by the per-allyteam workers
+	for (unsigned int n = 0; n < numBatchedUpdates; n++) {
+		RadarUpdate& ru = batchedUpdates[n];
+
+		if (ru.add) {
+			ru.unit->radarSquares.insert(ru.unit->radarSquares.end(), ru.squares.begin(), ru.squares.end());
+			ru.squares = ru.unit->radarSquares;
+		} else {
+			ru.squares.swap(ru.unit->radarSquares);
+			ru.unit->radarSquares.clear();
+		}
+	}
+
+	// 3. counters, every allyteam applies its own updates in queue order
+	simScheduler->ParallelFor(radarMaps.size(), boost::bind(&CRadarHandler::FlushAllyTeamUpdates, this, _1, _2));
+
+	numBatchedUpdates = 0;
+}
+
+void CRadarHandler::RayCastUpdate(unsigned int updateNum, unsigned int threadNum)
+{
+	RadarUpdate& ru = batchedUpdates[updateNum];
+
+	if (ru.add) {
+		radarAlgo.LosAdd(ru.pos, ru.radius, ru.height, ru.squares);
+	}
+}
+
+void CRadarHandler::FlushAllyTeamUpdates(unsigned int allyTeam, unsigned int threadNum)
+{
+	for (unsigned int n = 0; n < numBatchedUpdates; n++) {
+		const RadarUpdate& ru = batchedUpdates[n];
+
+		if (ru.allyTeam != int(allyTeam))
+			continue;
+
+		radarMaps[allyTeam].AddMapSquares(ru.squares, -123, (ru.add)? 1: -1);
+	}
+}
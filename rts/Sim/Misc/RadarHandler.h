@@ -32,6 +32,14 @@ public:
 	void MoveUnit(CUnit* unit);
 	void RemoveUnit(CUnit* unit);
 
+	/**
+	 * While batching, the ray-casts and radarMaps updates of non-circular
+	 * radar are queued and run on the sim threads by FlushMoveUnits (see
+	 * CLosHandler::SetBatchMoveUnits), all other maps are updated directly.
+	 */
+	void SetBatchMoveUnits(bool b) { batchMoveUnits = b; }
+	void FlushMoveUnits();
+
 	inline int GetSquare(const float3& pos) const
 	{
 		const int gx = pos.x * invRadarDiv;
@@ -125,6 +133,26 @@ public:
 private:
 	CLosAlgorithm radarAlgo;
 
+	struct RadarUpdate {
+		CUnit* unit;
+		int allyTeam;
+		int2 pos;
+		int radius;
+		float height;
+		bool add;
+		/// ray-cast result for add, the unit's old squares for remove
+		std::vector<int> squares;
+	};
+
+	void QueueRadarUpdate(CUnit* unit, const int2& pos, bool add);
+	void RayCastUpdate(unsigned int updateNum, unsigned int threadNum);
+	void FlushAllyTeamUpdates(unsigned int allyTeam, unsigned int threadNum);
+
+	/// elements beyond numBatchedUpdates are kept to reuse their buffers
+	std::vector<RadarUpdate> batchedUpdates;
+	unsigned int numBatchedUpdates;
+	bool batchMoveUnits;
+
 	void Serialize(creg::ISerializer& s);
 };
 
@@ -0,0 +1,28 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include "SimScheduler.h"
+
+#include "System/mmgr.h"
+#include "System/Config/ConfigHandler.h"
+#include "System/Log/ILog.h"
+
+CONFIG(int, SimThreadCount)
+	.defaultValue(0)
+	.minimumValue(0)
+	.description("Number of threads used by the simulation, 0 uses HardwareThreadCount and 1 runs everything serially (for sync debugging). Results do not depend on this value.");
+
+CSimScheduler* simScheduler = NULL;
+
+
+CSimScheduler::CSimScheduler()
+{
+	unsigned int numThreads = configHandler->GetInt("SimThreadCount");
+
+	if (numThreads == 0)
+		numThreads = CThreadPool::GetDefaultNumThreads();
+
+	threadPool.SetNumThreads(numThreads);
+
+	LOG("[%s] using %u simulation thread(s)", __FUNCTION__, threadPool.GetNumThreads());
+}
+
@@ -0,0 +1,40 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#ifndef SIM_SCHEDULER_H
+#define SIM_SCHEDULER_H
+
+#include <boost/noncopyable.hpp>
+
+#include "System/ThreadPool.h"
+
+/**
+ * @brief Owns the thread pool used by the simulation
+ *
+ * SimFrame still runs its stages (uh, ph, loshandler, ...) serially since
+ * nearly all of them can trigger Lua events, use the synced RNG or kill
+ * objects; the parallel work happens in data-parallel loops inside those
+ * stages (see ParallelFor), which must give the same results for every
+ * thread count. SimThreadCount=1 runs everything serially for sync
+ * debugging.
+ */
+class CSimScheduler : public boost::noncopyable
+{
+public:
+	CSimScheduler();
+
+	/**
+	 * Runs func(item, threadNum) for all items in [0, numItems), see
+	 * CThreadPool; must not be nested.
+	 */
+	void ParallelFor(unsigned int numItems, const CThreadPool::ForFunc& func) { threadPool.ParallelFor(numItems, func); }
+
+	unsigned int GetNumThreads() const { return threadPool.GetNumThreads(); }
+	bool IsSerial() const { return (threadPool.GetNumThreads() == 1); }
+
+private:
+	CThreadPool threadPool;
+};
+
+extern CSimScheduler* simScheduler;
+
+#endif // SIM_SCHEDULER_H
@@ -18,6 +18,7 @@
 #include "Sim/Misc/GeometricObjects.h"
 #include "Sim/Misc/ModInfo.h"
 #include "Sim/Misc/QuadField.h"
+#include "Sim/Misc/SimScheduler.h"
 #include "Sim/Misc/TeamHandler.h"
 #include "Sim/Path/IPathManager.h"
 #include "Sim/Units/Scripts/CobInstance.h"
@@ -33,6 +34,9 @@
 #include "System/Vec2.h"
 #include "System/Sound/SoundChannels.h"
 #include "System/Sync/SyncTracer.h"
+#include "System/TimeProfiler.h"
+
+#include <boost/bind.hpp>
 
 
 #define LOG_SECTION_GMT "GroundMoveType"
@@ -56,6 +60,11 @@ LOG_REGISTER_SECTION_GLOBAL(LOG_SECTION_GMT)
 #define WAIT_FOR_PATH 1
 #define PLAY_SOUNDS 1
 
+// largest distance a single collision moves either party (see the
+// sepResponse clamp in HandleUnitCollisions), PrepareUpdates allows
+// for one push of the owner and one of each object around it
+#define NEARBY_OBJECTS_PUSH_MARGIN (SQUARE_SIZE * 2.0f)
+
 
 CR_BIND_DERIVED(CGroundMoveType, AMoveType, (NULL));
 
@@ -161,7 +170,9 @@ CGroundMoveType::CGroundMoveType(CUnit* owner):
 	numIdlingUpdates(0),
 	numIdlingSlowUpdates(0),
 
-	wantedHeading(0)
+	wantedHeading(0),
+
+	nearbyObjectsFrame(-1)
 {
 	assert(owner != NULL);
 	assert(owner->unitDef != NULL);
@@ -260,7 +271,8 @@ bool CGroundMoveType::Update()
 		// (so we want to avoid being considered "idle", since that
 		// will cause our path to be re-requested and again give us
 		// a temporary waypoint, etc.)
-		// NOTE: this is only relevant for QTPFS
+		// NOTE: QTPFS and the queued requests of the default PF
+		// (movement.queuedPathRequests) return such waypoints
 		// if the unit is just turning in-place over several frames
 		// (eg. to maneuver around an obstacle), do not consider it
 		// as "idling"
@@ -498,7 +510,7 @@ void CGroundMoveType::SetDeltaSpeed(float newWantedSpeed, bool wantReverse, bool
 	#if (WAIT_FOR_PATH == 1)
 	// don't move until we have an actual path, trying to hide queuing
 	// lag is too dangerous since units can blindly drive into objects,
-	// cliffs, etc. (requires the QTPFS idle-check in Update)
+	// cliffs, etc. (requires the temporary-waypoint idle-check in Update)
 	if (currWayPoint.y == -1.0f && nextWayPoint.y == -1.0f) {
 		targetSpeed = 0.0f;
 	} else
@@ -1016,7 +1028,8 @@ float3 CGroundMoveType::ObstacleAvoidance(const float3& desiredDir) {
 	CMoveMath* moveMath = moveData->moveMath;
 	moveData->tempOwner = owner;
 
-	const vector<CSolidObject*>& nearbyObjects = qf->GetSolidsExact(owner->pos, avoidanceRadius);
+	static vector<CSolidObject*> nearbyObjects;
+	GetNearbySolids(nearbyObjects, owner->pos, avoidanceRadius);
 
 	for (vector<CSolidObject*>::const_iterator oi = nearbyObjects.begin(); oi != nearbyObjects.end(); ++oi) {
 		CSolidObject* object = *oi;
@@ -1409,8 +1422,11 @@ void CGroundMoveType::HandleUnitCollisions(
 ) {
 	const float searchRadius = std::max(colliderSpeed, 1.0f) * (colliderRadius * 2.0f);
 
-	const std::vector<CUnit*>& nearUnits = qf->GetUnitsExact(colliderCurPos, searchRadius);
-	      std::vector<CUnit*>::const_iterator uit;
+	// NOTE: the collision events can not reach this function again
+	static std::vector<CUnit*> nearUnits;
+	std::vector<CUnit*>::const_iterator uit;
+
+	GetNearbyUnits(nearUnits, colliderCurPos, searchRadius);
 
 	// NOTE: probably too large for most units (eg. causes tree falling animations to be skipped)
 	const int dirSign = int(!reversing) * 2 - 1;
@@ -1568,8 +1584,10 @@ void CGroundMoveType::HandleFeatureCollisions(
 ) {
 	const float searchRadius = std::max(colliderSpeed, 1.0f) * (colliderRadius * 2.0f);
 
-	const std::vector<CFeature*>& nearFeatures = qf->GetFeaturesExact(colliderCurPos, searchRadius);
-	      std::vector<CFeature*>::const_iterator fit;
+	static std::vector<CFeature*> nearFeatures;
+	std::vector<CFeature*>::const_iterator fit;
+
+	GetNearbyFeatures(nearFeatures, colliderCurPos, searchRadius);
 
 	const int dirSign = int(!reversing) * 2 - 1;
 	const float3 crushImpulse = collider->speed * collider->mass * dirSign;
@@ -1645,6 +1663,206 @@ void CGroundMoveType::HandleFeatureCollisions(
 	}
 }
 
+
+
+// per-thread scratch space of GatherNearbyObjects
+struct NearbyObjectsBuffer {
+	NearbyObjectsBuffer(): stamp(0) {}
+
+	std::vector<int> quads;
+	/// unit / feature ID -> stamp of the last query that included it
+	std::vector<unsigned int> unitStamps;
+	std::vector<unsigned int> featureStamps;
+	unsigned int stamp;
+};
+
+static const std::vector<AMoveType*>* preparedMoveTypes = NULL;
+static std::vector<NearbyObjectsBuffer> nearbyObjectsBuffers;
+
+/// upper bound of the distance any unit moves by itself in this frame's MoveType pass
+static float preparedMaxUnitSpeed = 0.0f;
+/// qf->GetNumChanges() when the objects were gathered
+static unsigned int preparedQuadFieldChanges = 0;
+
+static float GetMaxFrameSpeed(const AMoveType* moveType)
+{
+	const CGroundMoveType* groundMoveType = dynamic_cast<const CGroundMoveType*>(moveType);
+	const float ownerSpeed = moveType->owner->speed.Length();
+
+	if (groundMoveType == NULL)
+		return std::max(ownerSpeed, moveType->GetMaxSpeed());
+
+	return std::max(ownerSpeed, std::max(groundMoveType->currentSpeed, groundMoveType->GetMaxSpeed()) + groundMoveType->accRate);
+}
+
+void CGroundMoveType::PrepareUpdates(const std::vector<AMoveType*>& moveTypes)
+{
+	if (!modInfo.twoPhaseGroundMoveUpdate)
+		return;
+
+	SCOPED_TIMER("GroundMoveType::PrepareUpdates");
+
+	// objects around a unit can move towards it before its own
+	// turn, so every search also covers the fastest unit's move
+	preparedMaxUnitSpeed = 0.0f;
+	preparedQuadFieldChanges = qf->GetNumChanges();
+
+	for (std::vector<AMoveType*>::const_iterator mti = moveTypes.begin(); mti != moveTypes.end(); ++mti) {
+		preparedMaxUnitSpeed = std::max(preparedMaxUnitSpeed, GetMaxFrameSpeed(*mti));
+	}
+
+	// the quadfield and all objects are only read until the
+	// end of ParallelFor, so the order of the items is free
+	preparedMoveTypes = &moveTypes;
+	nearbyObjectsBuffers.resize(simScheduler->GetNumThreads());
+
+	simScheduler->ParallelFor(moveTypes.size(), boost::bind(&CGroundMoveType::GatherNearbyObjects, _1, _2));
+
+	preparedMoveTypes = NULL;
+}
+
+void CGroundMoveType::GatherNearbyObjects(unsigned int moveTypeNum, unsigned int threadNum)
+{
+	CGroundMoveType* moveType = dynamic_cast<CGroundMoveType*>((*preparedMoveTypes)[moveTypeNum]);
+
+	if (moveType == NULL)
+		return;
+
+	const CUnit* owner = moveType->owner;
+	const MoveData* md = owner->mobility;
+
+	if (owner->GetTransporter() != NULL)
+		return;
+
+	// upper bound of the speed the owner can have in Update
+	const float maxOwnerSpeed = GetMaxFrameSpeed(moveType);
+	// largest query radius of ObstacleAvoidance and HandleObjectCollisions
+	const float avoidanceRadius = std::max(moveType->currentSpeed, 1.0f) * (owner->radius * 2.0f);
+	const float collisionRadius = std::max(maxOwnerSpeed, 1.0f) * (FOOTPRINT_RADIUS(md->xsize, md->zsize) * 2.0f);
+	// both the owner and the objects around it can move and be pushed before its turn
+	const float margin = maxOwnerSpeed + preparedMaxUnitSpeed + NEARBY_OBJECTS_PUSH_MARGIN * 2.0f;
+	const float radius = std::max(avoidanceRadius, collisionRadius) + margin;
+
+	const float3& pos = owner->pos;
+
+	NearbyObjectsBuffer& buffer = nearbyObjectsBuffers[threadNum];
+
+	if ((++buffer.stamp) == 0) {
+		std::fill(buffer.unitStamps.begin(), buffer.unitStamps.end(), 0);
+		std::fill(buffer.featureStamps.begin(), buffer.featureStamps.end(), 0);
+		buffer.stamp = 1;
+	}
+
+	qf->GetQuads(buffer.quads, pos, radius);
+
+	moveType->nearbyUnits.clear();
+	moveType->nearbyFeatures.clear();
+
+	for (std::vector<int>::const_iterator qi = buffer.quads.begin(); qi != buffer.quads.end(); ++qi) {
+		const CQuadField::Quad& quad = qf->GetQuad(*qi);
+
+		for (std::vector<CUnit*>::const_iterator ui = quad.units.begin(); ui != quad.units.end(); ++ui) {
+			CUnit* unit = *ui;
+
+			assert(unit->id >= 0);
+
+			if (size_t(unit->id) >= buffer.unitStamps.size())
+				buffer.unitStamps.resize(unit->id + 1, 0);
+			if (buffer.unitStamps[unit->id] == buffer.stamp)
+				continue;
+			if ((pos - unit->midPos).SqLength() >= Square(radius + unit->radius))
+				continue;
+
+			buffer.unitStamps[unit->id] = buffer.stamp;
+			moveType->nearbyUnits.push_back(unit);
+		}
+
+		for (std::vector<CFeature*>::const_iterator fi = quad.features.begin(); fi != quad.features.end(); ++fi) {
+			CFeature* feature = *fi;
+
+			assert(feature->id >= 0);
+
+			if (size_t(feature->id) >= buffer.featureStamps.size())
+				buffer.featureStamps.resize(feature->id + 1, 0);
+			if (buffer.featureStamps[feature->id] == buffer.stamp)
+				continue;
+			if ((pos - feature->midPos).SqLength() >= Square(radius + feature->radius))
+				continue;
+
+			buffer.featureStamps[feature->id] = buffer.stamp;
+			moveType->nearbyFeatures.push_back(feature);
+		}
+	}
+
+	moveType->nearbyObjectsFrame = gs->frameNum;
+}
+
+bool CGroundMoveType::HaveNearbyObjects() const
+{
+	if (nearbyObjectsFrame != gs->frameNum)
+		return false;
+
+	// units that were created, teleported or removed and features that
+	// were added or removed since the gathering are not in the lists
+	return (qf->GetNumChanges() == preparedQuadFieldChanges);
+}
+
+void CGroundMoveType::GetNearbySolids(std::vector<CSolidObject*>& solids, const float3& pos, float radius) const
+{
+	if (!HaveNearbyObjects()) {
+		qf->GetSolidsExact(solids, pos, radius);
+		return;
+	}
+
+	solids.clear();
+
+	for (std::vector<CUnit*>::const_iterator ui = nearbyUnits.begin(); ui != nearbyUnits.end(); ++ui) {
+		if (!(*ui)->blocking) { continue; }
+		if ((pos - (*ui)->midPos).SqLength() >= Square(radius + (*ui)->radius)) { continue; }
+
+		solids.push_back(*ui);
+	}
+
+	for (std::vector<CFeature*>::const_iterator fi = nearbyFeatures.begin(); fi != nearbyFeatures.end(); ++fi) {
+		if (!(*fi)->blocking) { continue; }
+		if ((pos - (*fi)->midPos).SqLength() >= Square(radius + (*fi)->radius)) { continue; }
+
+		solids.push_back(*fi);
+	}
+}
+
+void CGroundMoveType::GetNearbyUnits(std::vector<CUnit*>& units, const float3& pos, float radius) const
+{
+	if (!HaveNearbyObjects()) {
+		qf->GetUnitsExact(units, pos, radius);
+		return;
+	}
+
+	units.clear();
+
+	for (std::vector<CUnit*>::const_iterator ui = nearbyUnits.begin(); ui != nearbyUnits.end(); ++ui) {
+		if ((pos - (*ui)->midPos).SqLength() >= Square(radius + (*ui)->radius)) { continue; }
+
+		units.push_back(*ui);
+	}
+}
+
+void CGroundMoveType::GetNearbyFeatures(std::vector<CFeature*>& features, const float3& pos, float radius) const
+{
+	if (!HaveNearbyObjects()) {
+		qf->GetFeaturesExact(features, pos, radius);
+		return;
+	}
+
+	features.clear();
+
+	for (std::vector<CFeature*>::const_iterator fi = nearbyFeatures.begin(); fi != nearbyFeatures.end(); ++fi) {
+		if ((pos - (*fi)->midPos).SqLength() >= Square(radius + (*fi)->radius)) { continue; }
+
+		features.push_back(*fi);
+	}
+}
+
 #undef FOOTPRINT_RADIUS
 
 
@@ -3,12 +3,15 @@
 #ifndef GROUNDMOVETYPE_H
 #define GROUNDMOVETYPE_H
 
+#include <vector>
+
 #include "MoveType.h"
 #include "Sim/Objects/SolidObject.h"
 
 struct UnitDef;
 struct MoveData;
 class CMoveMath;
+class CFeature;
 
 class CGroundMoveType : public AMoveType
 {
@@ -51,6 +54,15 @@ public:
 	static void CreateLineTable();
 	static void DeleteLineTable();
 
+	/**
+	 * First phase of the two-phase update (movement modrule
+	 * twoPhaseGroundMoveUpdate): gathers the objects around every
+	 * ground unit in parallel while nothing moves. Update (the second
+	 * phase, still serial) then steers around and collides with these
+	 * instead of querying the quadfield itself.
+	 */
+	static void PrepareUpdates(const std::vector<AMoveType*>& moveTypes);
+
 
 	float turnRate;
 	float accRate;
@@ -120,6 +132,24 @@ protected:
 	bool FollowPath();
 	bool WantReverse(const float3&) const;
 
+	static void GatherNearbyObjects(unsigned int moveTypeNum, unsigned int threadNum);
+
+	/**
+	 * The objects gathered by PrepareUpdates can be used if they were
+	 * gathered in this frame and the quadfield did not change since.
+	 */
+	bool HaveNearbyObjects() const;
+	/**
+	 * Filter the gathered objects with the predicates of the matching
+	 * CQuadField queries, or run those queries if HaveNearbyObjects is
+	 * false. The gathering allows for normal movement and one push of
+	 * each party; within those limits the results hold the same objects
+	 * as the queries, but in a different order.
+	 */
+	void GetNearbySolids(std::vector<CSolidObject*>& solids, const float3& pos, float radius) const;
+	void GetNearbyUnits(std::vector<CUnit*>& units, const float3& pos, float radius) const;
+	void GetNearbyFeatures(std::vector<CFeature*>& features, const float3& pos, float radius) const;
+
 
 	bool atGoal;
 	bool haveFinalWaypoint;
@@ -160,6 +190,11 @@ protected:
 	int moveSquareY;
 
 	short wantedHeading;
+
+	/// objects around the owner at the start of frame nearbyObjectsFrame (not saved)
+	std::vector<CUnit*> nearbyUnits;
+	std::vector<CFeature*> nearbyFeatures;
+	int nearbyObjectsFrame;
 };
 
 #endif // GROUNDMOVETYPE_H
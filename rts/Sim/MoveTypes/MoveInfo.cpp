@@ -48,6 +48,7 @@ CR_REG_METADATA(MoveData, (
 
 	CR_MEMBER(avoidMobilesOnPath),
 	CR_MEMBER(heatMapping),
+	CR_MEMBER(bidirectionalSearch),
 	CR_MEMBER(heatMod),
 	CR_MEMBER(heatProduced),
 
@@ -203,6 +204,9 @@ MoveData::MoveData() {
 	heatMod           = 0.05f;
 	heatProduced      = GAME_SPEED;
 
+	bidirectionalSearch = false;
+	searchPadding[0] = searchPadding[1] = searchPadding[2] = false;
+
 	moveMath          = NULL;
 	tempOwner         = NULL;
 }
@@ -259,6 +263,7 @@ MoveData::MoveData(CMoveInfo* moveInfo, const LuaTable& moveTable, int moveDefID
 
 	avoidMobilesOnPath = speedModMultsTable.GetBool("avoidMobilesOnPath", true);
 	heatMapping = moveTable.GetBool("heatMapping", false);
+	bidirectionalSearch = moveTable.GetBool("bidirectionalSearch", false);
 	heatMod = moveTable.GetFloat("heatMod", 50.0f);
 	heatProduced = moveTable.GetInt("heatProduced", GAME_SPEED * 2);
 
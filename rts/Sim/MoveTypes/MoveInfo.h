@@ -103,6 +103,11 @@ struct MoveData {
 
 	/// heatmap this unit
 	bool heatMapping;
+	/// search from both ends of a path at once (QTPFS only)
+	bool bidirectionalSearch;
+	/// keeps heatMod on a 4-byte boundary, so GetCheckSum
+	/// does not see uninitialized padding bytes either
+	bool searchPadding[3];
 
 	/// heatmap path cost modifier
 	float heatMod;
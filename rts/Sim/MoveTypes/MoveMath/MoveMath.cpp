@@ -1,6 +1,7 @@
 /* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
 
 #include "MoveMath.h"
+#include "SquareBlocking.h"
 #include "Map/ReadMap.h"
 #include "Map/MapInfo.h"
 #include "Sim/Features/Feature.h"
@@ -100,7 +101,7 @@ bool CMoveMath::IsBlockedStructure(const MoveData& moveData, int xSquare, int zS
 	// (footprints are point-symmetric around <xSquare, zSquare>)
 	for (int x = xmin; x <= xmax; x += xstep) {
 		for (int z = zmin; z <= zmax; z += zstep) {
-			if (SquareIsBlocked(moveData, x, z) & BLOCK_STRUCTURE)
+			if (SquareIsBlockedStructure(moveData, x, z))
 				return true;
 		}
 	}
@@ -117,7 +118,7 @@ bool CMoveMath::IsBlockedStructureXmax(const MoveData& moveData, int xSquare, in
 	const int zstep = 2;
 	// (footprints are point-symmetric around <xSquare, zSquare>)
 	for (int z = zmin; z <= zmax; z += zstep) {
-		if (SquareIsBlocked(moveData, xmax, z) & BLOCK_STRUCTURE)
+		if (SquareIsBlockedStructure(moveData, xmax, z))
 			return true;
 	}
 
@@ -133,7 +134,7 @@ bool CMoveMath::IsBlockedStructureZmax(const MoveData& moveData, int xSquare, in
 	const int xstep = 2;
 	// (footprints are point-symmetric around <xSquare, zSquare>)
 	for (int x = xmin; x <= xmax; x += xstep) {
-		if (SquareIsBlocked(moveData, x, zmax) & BLOCK_STRUCTURE)
+		if (SquareIsBlockedStructure(moveData, x, zmax))
 			return true;
 	}
 
@@ -245,6 +246,38 @@ bool CMoveMath::IsNonBlocking(const MoveData& colliderMD, const CSolidObject* co
 
 
 
+namespace {
+	/// classifies single obstacles for the SquareBlocking functions
+	struct ObstacleClassifier {
+		typedef CMoveMath::BlockType BlockType;
+
+		ObstacleClassifier(const MoveData& md): moveData(md) {}
+
+		bool IsNonBlocking(const CSolidObject* obstacle) const { return CMoveMath::IsNonBlocking(moveData, obstacle); }
+		bool IsImmobile(const CSolidObject* obstacle) const { return obstacle->immobile; }
+
+		BlockType MobileBlockType(const CSolidObject* obstacle) const {
+			if (obstacle->isMoving)
+				return CMoveMath::BLOCK_MOVING;
+
+			const CUnit* u = static_cast<const CUnit*>(obstacle);
+
+			if (!u->beingBuilt && u->commandAI->commandQue.empty()) {
+				// idling mobile unit
+				return CMoveMath::BLOCK_MOBILE;
+			}
+
+			// busy mobile unit (but not following path)
+			return CMoveMath::BLOCK_MOBILE_BUSY;
+		}
+		BlockType ImmobileBlockType(const CSolidObject* obstacle) const {
+			return (CMoveMath::CrushResistant(moveData, obstacle)? CMoveMath::BLOCK_STRUCTURE: CMoveMath::BLOCK_NONE);
+		}
+
+		const MoveData& moveData;
+	};
+}
+
 /* Check if a single square is accessable (for any object which uses the given movedata). */
 CMoveMath::BlockType CMoveMath::SquareIsBlocked(const MoveData& moveData, int xSquare, int zSquare)
 {
@@ -253,36 +286,20 @@ CMoveMath::BlockType CMoveMath::SquareIsBlocked(const MoveData& moveData, int xS
 		return BLOCK_IMPASSABLE;
 	}
 
-	BlockType r = BLOCK_NONE;
-	const BlockingMapCell& c = groundBlockingObjectMap->GetCell(xSquare + zSquare * gs->mapx);
+	const BlockingMapCellObjects c = groundBlockingObjectMap->GetCell(xSquare + zSquare * gs->mapx);
 
-	for (BlockingMapCellIt it = c.begin(); it != c.end(); ++it) {
-		CSolidObject* obstacle = it->second;
-
-		if (IsNonBlocking(moveData, obstacle)) {
-			continue;
-		}
+	return SquareBlocking::GetBlockType(c, ObstacleClassifier(moveData));
+}
 
-		if (!obstacle->immobile) {
-			// mobile obstacle
-			if (obstacle->isMoving) {
-				r |= BLOCK_MOVING;
-			} else {
-				CUnit& u = *static_cast<CUnit*>(obstacle);
-				if (!u.beingBuilt && u.commandAI->commandQue.empty()) {
-					// idling mobile unit
-					r |= BLOCK_MOBILE;
-				} else {
-					// busy mobile unit (but not following path)
-					r |= BLOCK_MOBILE_BUSY;
-				}
-			}
-		} else {
-			if (CrushResistant(moveData, obstacle)) {
-				r |= BLOCK_STRUCTURE;
-			}
-		}
+/* Same as (SquareIsBlocked(...) & BLOCK_STRUCTURE), but only looks at the structures in the square. */
+bool CMoveMath::SquareIsBlockedStructure(const MoveData& moveData, int xSquare, int zSquare)
+{
+	// bounds-check
+	if (xSquare < 0 || zSquare < 0 || xSquare >= gs->mapx || zSquare >= gs->mapy) {
+		return true;
 	}
 
-	return r;
+	const BlockingMapCellObjects c = groundBlockingObjectMap->GetCell(xSquare + zSquare * gs->mapx);
+
+	return SquareBlocking::IsBlockedStructure(c, ObstacleClassifier(moveData));
 }
@@ -59,6 +59,8 @@ public:
 
 	// returns the block-status of a single quare
 	static BlockType SquareIsBlocked(const MoveData& moveData, int xSquare, int zSquare);
+	// returns true if a single square is blocked by a structure (cheaper than SquareIsBlocked)
+	static bool SquareIsBlockedStructure(const MoveData& moveData, int xSquare, int zSquare);
 
 	virtual ~CMoveMath() {}
 };
@@ -0,0 +1,73 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#ifndef SQUARE_BLOCKING_H
+#define SQUARE_BLOCKING_H
+
+#include "Sim/Misc/BlockingMap.h"
+
+/**
+ * The per-square parts of CMoveMath::SquareIsBlocked and
+ * CMoveMath::SquareIsBlockedStructure, written against a classifier
+ * for single obstacles so they do not depend on the rest of the sim.
+ *
+ * A Classifier provides the type BlockType and the members
+ *   bool IsNonBlocking(const CSolidObject*)
+ *   bool IsImmobile(const CSolidObject*)
+ *   BlockType MobileBlockType(const CSolidObject*)
+ *   BlockType ImmobileBlockType(const CSolidObject*), non-zero iff the
+ *     obstacle blocks as a structure
+ */
+namespace SquareBlocking {
+	template<typename Classifier>
+	typename Classifier::BlockType GetBlockType(const BlockingMapCellObjects& c, const Classifier& classifier)
+	{
+		typename Classifier::BlockType r = typename Classifier::BlockType();
+
+		for (unsigned int n = 0; n < c.size(); n++) {
+			const CSolidObject* obstacle = c[n];
+
+			if (classifier.IsNonBlocking(obstacle)) {
+				continue;
+			}
+
+			if (!classifier.IsImmobile(obstacle)) {
+				r |= classifier.MobileBlockType(obstacle);
+			} else {
+				r |= classifier.ImmobileBlockType(obstacle);
+			}
+		}
+
+		return r;
+	}
+
+	/// same as (GetBlockType(...) & structure), but only looks at the structures in the square
+	template<typename Classifier>
+	bool IsBlockedStructure(const BlockingMapCellObjects& c, const Classifier& classifier)
+	{
+		if (!c.HasStructures()) {
+			return false;
+		}
+
+		for (unsigned int n = 0; n < c.size(); n++) {
+			if (!c.MaybeStructure(n)) {
+				continue;
+			}
+
+			const CSolidObject* obstacle = c[n];
+
+			if (!classifier.IsImmobile(obstacle)) {
+				continue;
+			}
+			if (classifier.IsNonBlocking(obstacle)) {
+				continue;
+			}
+			if (classifier.ImmobileBlockType(obstacle) != 0) {
+				return true;
+			}
+		}
+
+		return false;
+	}
+}
+
+#endif // SQUARE_BLOCKING_H
@@ -1,83 +1,177 @@
 /* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
 
-#include <algorithm>
+#include <assert.h>
 #include "System/mmgr.h"
 
 #include "PathCache.h"
 
 #include "Sim/Misc/GlobalSynced.h"
 #include "System/Log/ILog.h"
-
-using namespace std;
-
-CPathCache::CPathCache(int blocksX,int blocksZ)
-: blocksX(blocksX),
-	blocksZ(blocksZ)
+#include "System/TimeProfiler.h"
+
+CPathCache::CPathCache(int blocksX, int blocksZ)
+	: items(MAX_CACHED_PATHS)
+	, firstItem(0)
+	, numItems(0)
+	, table(TABLE_SIZE, -1)
+	, blocksX(blocksX)
+	, blocksZ(blocksZ)
+	, numCacheHits(0)
+	, numCacheMisses(0)
+	, numFrameHits(0)
+	, numFrameMisses(0)
 {
-	numCacheHits=0;
-	numCacheMisses=0;
 }
 
-CPathCache::~CPathCache(void)
+CPathCache::~CPathCache()
 {
-	LOG("Path cache hits %i %.0f%%",
+	LOG("Path cache hits %u %.0f%%",
 			numCacheHits, ((numCacheHits + numCacheMisses) != 0)
 			? (float(numCacheHits) / float(numCacheHits + numCacheMisses) * 100.0f)
 			: 0.0f);
-	for(std::map<unsigned int,CacheItem*>::iterator ci=cachedPaths.begin();ci!=cachedPaths.end();++ci)
-		delete ci->second;
 }
 
-void CPathCache::AddPath(IPath::Path* path, IPath::SearchResult result, int2 startBlock,int2 goalBlock,float goalRadius,int pathType)
+
+unsigned int CPathCache::GetHash(int2 startBlock, int2 goalBlock, float goalRadius, int pathType) const
 {
-	if(cacheQue.size()>100)
-		RemoveFrontQueItem();
+	const unsigned int startIdx = startBlock.y * blocksX + startBlock.x;
+	const unsigned int goalIdx = goalBlock.y * blocksX + goalBlock.x;
 
-	unsigned int hash=(unsigned int)(((((goalBlock.y)*blocksX+goalBlock.x)*blocksZ+startBlock.y)*blocksX)+startBlock.x*(pathType+1)*max(1.0f,goalRadius));
+	unsigned int hash = startIdx * 2654435761U;
+	hash ^= goalIdx * 2246822519U;
+	hash ^= (unsigned int)(pathType) * 3266489917U;
+	hash ^= (unsigned int)(goalRadius) * 668265263U;
+	hash ^= (hash >> 15);
 
-	if(cachedPaths.find(hash)!=cachedPaths.end()){
-		return;
+	return hash;
+}
+
+int CPathCache::FindSlot(unsigned int hash, int2 startBlock, int2 goalBlock, float goalRadius, int pathType) const
+{
+	for (unsigned int slot = hash & (TABLE_SIZE - 1); table[slot] != -1; slot = (slot + 1) & (TABLE_SIZE - 1)) {
+		const CacheItem& ci = items[table[slot]];
+
+		if (ci.hash != hash)
+			continue;
+		if (ci.startBlock.x != startBlock.x || ci.startBlock.y != startBlock.y)
+			continue;
+		if (ci.goalBlock.x != goalBlock.x || ci.goalBlock.y != goalBlock.y)
+			continue;
+		if (ci.goalRadius != goalRadius || ci.pathType != pathType)
+			continue;
+
+		return slot;
 	}
 
-	CacheItem* ci=new CacheItem;
-	ci->path=*path;
-	ci->result=result;
-	ci->startBlock=startBlock;
-	ci->goalBlock=goalBlock;
-	ci->goalRadius=goalRadius;
-	ci->pathType=pathType;
+	return -1;
+}
+
 
-	cachedPaths[hash]=ci;
+void CPathCache::AddPath(const IPath::Path* path, IPath::SearchResult result, int2 startBlock, int2 goalBlock, float goalRadius, int pathType)
+{
+	const unsigned int hash = GetHash(startBlock, goalBlock, goalRadius, pathType);
+
+	if (FindSlot(hash, startBlock, goalBlock, goalRadius, pathType) != -1)
+		return;
+
+	if (numItems == MAX_CACHED_PATHS)
+		RemoveFrontItem();
+
+	const int itemIdx = (firstItem + numItems) % MAX_CACHED_PATHS;
+	CacheItem& ci = items[itemIdx];
 
-	CacheQue cq;
-	cq.hash=hash;
-	cq.timeout=gs->frameNum+200;
+	// assignment reuses the storage of the path that was in this slot before
+	ci.path = *path;
+	ci.result = result;
+	ci.startBlock = startBlock;
+	ci.goalBlock = goalBlock;
+	ci.goalRadius = goalRadius;
+	ci.pathType = pathType;
+	ci.hash = hash;
+	ci.timeout = gs->frameNum + 200;
+
+	numItems += 1;
+
+	unsigned int slot = hash & (TABLE_SIZE - 1);
+
+	while (table[slot] != -1) {
+		slot = (slot + 1) & (TABLE_SIZE - 1);
+	}
 
-	cacheQue.push_back(cq);
+	table[slot] = itemIdx;
 }
 
-CPathCache::CacheItem* CPathCache::GetCachedPath(int2 startBlock,int2 goalBlock,float goalRadius,int pathType)
+const CPathCache::CacheItem* CPathCache::GetCachedPath(int2 startBlock, int2 goalBlock, float goalRadius, int pathType)
 {
-	unsigned int hash=(unsigned int)(((((goalBlock.y)*blocksX+goalBlock.x)*blocksZ+startBlock.y)*blocksX)+startBlock.x*(pathType+1)*max(1.0f,goalRadius));
+	const unsigned int hash = GetHash(startBlock, goalBlock, goalRadius, pathType);
+	const int slot = FindSlot(hash, startBlock, goalBlock, goalRadius, pathType);
 
-	std::map<unsigned int,CacheItem*>::iterator ci=cachedPaths.find(hash);
-	if(ci!=cachedPaths.end() && ci->second->startBlock.x==startBlock.x && ci->second->startBlock.y==startBlock.y && ci->second->goalBlock.x==goalBlock.x && ci->second->pathType==pathType){
+	if (slot != -1) {
 		++numCacheHits;
-		return ci->second;
+		++numFrameHits;
+		return &items[table[slot]];
 	}
+
 	++numCacheMisses;
-	return 0;
+	++numFrameMisses;
+	return NULL;
 }
 
-void CPathCache::Update(void)
+
+void CPathCache::Update()
 {
-	while(!cacheQue.empty() && cacheQue.front().timeout<gs->frameNum)
-		RemoveFrontQueItem();
+	while (numItems > 0 && items[firstItem].timeout < gs->frameNum) {
+		RemoveFrontItem();
+	}
+
+	if (numFrameHits > 0) {
+		profiler.AddCount("PathCache::Hits", numFrameHits);
+		numFrameHits = 0;
+	}
+	if (numFrameMisses > 0) {
+		profiler.AddCount("PathCache::Misses", numFrameMisses);
+		numFrameMisses = 0;
+	}
 }
 
-void CPathCache::RemoveFrontQueItem(void)
+void CPathCache::RemoveFrontItem()
 {
-	delete cachedPaths[cacheQue.front().hash];
-	cachedPaths.erase(cacheQue.front().hash);
-	cacheQue.pop_front();
+	assert(numItems > 0);
+
+	const CacheItem& ci = items[firstItem];
+
+	unsigned int slot = ci.hash & (TABLE_SIZE - 1);
+
+	while (table[slot] != int(firstItem)) {
+		assert(table[slot] != -1);
+		slot = (slot + 1) & (TABLE_SIZE - 1);
+	}
+
+	// backward-shift deletion: move later entries of the probe
+	// sequence into the hole unless that would put them before
+	// their home slot, so no tombstones are needed
+	unsigned int hole = slot;
+	unsigned int next = slot;
+
+	table[hole] = -1;
+
+	for (;;) {
+		next = (next + 1) & (TABLE_SIZE - 1);
+
+		if (table[next] == -1)
+			break;
+
+		const unsigned int home = items[table[next]].hash & (TABLE_SIZE - 1);
+		const unsigned int distHome = (next - home) & (TABLE_SIZE - 1);
+		const unsigned int distHole = (next - hole) & (TABLE_SIZE - 1);
+
+		if (distHome >= distHole) {
+			table[hole] = table[next];
+			table[next] = -1;
+			hole = next;
+		}
+	}
+
+	firstItem = (firstItem + 1) % MAX_CACHED_PATHS;
+	numItems -= 1;
 }
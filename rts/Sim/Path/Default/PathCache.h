@@ -3,17 +3,25 @@
 #ifndef PATHCACHE_H
 #define PATHCACHE_H
 
-#include <map>
-#include <list>
+#include <vector>
 
 #include "IPath.h"
 #include "System/Vec2.h"
 
+/**
+ * Fixed-size cache of recently found estimator paths.
+ *
+ * Items live in a ring buffer in order of insertion, which is also the order
+ * in which they expire; when the buffer is full the oldest item is dropped.
+ * Lookups go through an open-addressing (linear probing) hash table of item
+ * indices. Item slots are reused, so once their paths have grown to a typical
+ * length adding a path no longer allocates.
+ */
 class CPathCache
 {
 public:
-	CPathCache(int blocksX,int blocksZ);
-	~CPathCache(void);
+	CPathCache(int blocksX, int blocksZ);
+	~CPathCache();
 
 	struct CacheItem {
 		IPath::SearchResult result;
@@ -22,26 +30,46 @@ public:
 		int2 goalBlock;
 		float goalRadius;
 		int pathType;
+
+		unsigned int hash;
+		int timeout;
 	};
 
-	void AddPath(IPath::Path* path, IPath::SearchResult result, int2 startBlock,int2 goalBlock,float goalRadius,int pathType);
-	CacheItem* GetCachedPath(int2 startBlock,int2 goalBlock,float goalRadius,int pathType);
-	void Update(void);
+	void AddPath(const IPath::Path* path, IPath::SearchResult result, int2 startBlock, int2 goalBlock, float goalRadius, int pathType);
+	const CacheItem* GetCachedPath(int2 startBlock, int2 goalBlock, float goalRadius, int pathType);
+	void Update();
 
-	std::map<unsigned int,CacheItem*> cachedPaths;
+private:
+	unsigned int GetHash(int2 startBlock, int2 goalBlock, float goalRadius, int pathType) const;
+	/// returns the table slot of the item with the given key, or -1
+	int FindSlot(unsigned int hash, int2 startBlock, int2 goalBlock, float goalRadius, int pathType) const;
 
-	struct CacheQue {
-		int timeout;
-		unsigned int hash;
+	void RemoveFrontItem();
+
+private:
+	enum {
+		MAX_CACHED_PATHS = 128,
+		// at most half full, keeps the probe sequences short
+		TABLE_SIZE = MAX_CACHED_PATHS * 2
 	};
-	std::list<CacheQue> cacheQue;
-	void RemoveFrontQueItem(void);
+
+	/// ring buffer, numItems items starting at firstItem
+	std::vector<CacheItem> items;
+	unsigned int firstItem;
+	unsigned int numItems;
+
+	/// indices into items, -1 for empty slots
+	std::vector<int> table;
 
 	int blocksX;
 	int blocksZ;
 
-	int numCacheHits;
-	int numCacheMisses;
+	unsigned int numCacheHits;
+	unsigned int numCacheMisses;
+
+	/// not yet passed on to the profiler
+	unsigned int numFrameHits;
+	unsigned int numFrameMisses;
 };
 
 #endif
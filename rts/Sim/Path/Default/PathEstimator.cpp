@@ -6,12 +6,15 @@
 
 #include "PathEstimator.h"
 
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
 #include <fstream>
+#include <memory>
 #include <boost/bind.hpp>
 #include <boost/version.hpp>
 #include <boost/version.hpp>
 
-#include "minizip/zip.h"
 #include "System/mmgr.h"
 
 #include "PathAllocator.h"
@@ -21,22 +24,54 @@
 #include "PathLog.h"
 #include "Map/ReadMap.h"
 #include "Game/LoadScreen.h"
+#include "Sim/Misc/SimScheduler.h"
 #include "Sim/MoveTypes/MoveInfo.h"
 #include "Sim/MoveTypes/MoveMath/MoveMath.h"
 #include "Sim/Units/Unit.h"
 #include "Sim/Units/UnitDef.h"
-#include "System/FileSystem/IArchive.h"
-#include "System/FileSystem/ArchiveLoader.h"
 #include "System/FileSystem/DataDirsAccess.h"
 #include "System/FileSystem/FileSystem.h"
 #include "System/FileSystem/FileQueryFlags.h"
 #include "System/Config/ConfigHandler.h"
+#include "System/CRC.h"
 #include "System/NetProtocol.h"
+#include "System/Platform/MappedFile.h"
 
 CONFIG(int, MaxPathCostsMemoryFootPrint).defaultValue(512 * 1024 * 1024);
 
 static const std::string PATH_CACHE_DIR = "cache/paths/";
 
+/// data in the cache files starts at multiples of this (the usual page-size)
+static const unsigned int PATH_CACHE_ALIGNMENT = 4096;
+
+/**
+ * Header of a PE cache file; the block offsets and vertex costs follow it
+ * uncompressed and page-aligned, so that ReadFile can map the file and use
+ * the vertex costs as they are.
+ */
+struct PathCacheHeader {
+	char magic[8];
+	boost::uint32_t version;
+	boost::uint32_t hash;
+	boost::uint32_t mapChecksum;
+	boost::uint32_t moveInfoChecksum;
+	boost::uint32_t blockSize;
+	boost::uint32_t numBlocks;
+	boost::uint32_t numMoveData;
+	boost::uint32_t offsetsPos;
+	boost::uint32_t offsetsSize;
+	boost::uint32_t verticesPos;
+	boost::uint32_t verticesSize;
+	/// CRC over hash, block offsets and vertex costs
+	boost::uint32_t dataChecksum;
+};
+
+static const char PATH_CACHE_MAGIC[8] = {'S', 'P', 'R', 'I', 'N', 'G', 'P', 'E'};
+
+static unsigned int AlignCachePos(unsigned int pos) {
+	return ((pos + PATH_CACHE_ALIGNMENT - 1) / PATH_CACHE_ALIGNMENT) * PATH_CACHE_ALIGNMENT;
+}
+
 static size_t GetNumThreads() {
 	size_t numThreads = std::max(0, configHandler->GetInt("HardwareThreadCount"));
 
@@ -68,6 +103,10 @@ CPathEstimator::CPathEstimator(CPathFinder* pf, unsigned int BSIZE, const std::s
 	nbrOfBlocksX(gs->mapx / BLOCK_SIZE),
 	nbrOfBlocksZ(gs->mapy / BLOCK_SIZE),
 	blockStates(int2(nbrOfBlocksX, nbrOfBlocksZ), int2(gs->mapx, gs->mapy)),
+	vertices(NULL),
+	numVertices(0),
+	cacheFile(NULL),
+	requestBlockIdx(0),
 	pathFinder(pf),
 	pathChecksum(0),
 	offsetBlockNum(nbrOfBlocksX * nbrOfBlocksZ),
@@ -97,7 +136,8 @@ CPathEstimator::CPathEstimator(CPathFinder* pf, unsigned int BSIZE, const std::s
 	goalSqrOffset.x = BLOCK_SIZE / 2;
 	goalSqrOffset.y = BLOCK_SIZE / 2;
 
-	vertices.resize(moveinfo->moveData.size() * blockStates.GetSize() * PATH_DIRECTION_VERTICES, 0.0f);
+	numVertices = moveinfo->moveData.size() * blockStates.GetSize() * PATH_DIRECTION_VERTICES;
+	needUpdateFlags.resize(moveinfo->moveData.size() * blockStates.GetSize(), false);
 
 	// load precalculated data if it exists
 	InitEstimator(cacheFileName, map);
@@ -121,6 +161,7 @@ CPathEstimator::CPathEstimator(CPathFinder* pf, unsigned int BSIZE, const std::s
 CPathEstimator::~CPathEstimator()
 {
 	delete pathCache;
+	delete cacheFile;
 }
 
 
@@ -136,10 +177,11 @@ void CPathEstimator::InitEstimator(const std::string& cacheFileName, const std::
 	pathFinders[0] = pathFinder;
 
 	// Not much point in multithreading these...
-	InitVertices();
 	InitBlocks();
 
 	if (!ReadFile(cacheFileName, map)) {
+		InitVertices();
+
 		// start extra threads if applicable, but always keep the total
 		// memory-footprint made by CPathFinder instances within bounds
 		const unsigned int minMemFootPrint = sizeof(CPathFinder) + pathFinder->GetMemFootPrint();
@@ -184,8 +226,8 @@ void CPathEstimator::InitEstimator(const std::string& cacheFileName, const std::
 
 
 void CPathEstimator::InitVertices() {
-	for (unsigned int i = 0; i < vertices.size(); i++)
-		vertices[i] = PATHCOST_INFINITY;
+	vertexBuffer.assign(numVertices, PATHCOST_INFINITY);
+	vertices = &vertexBuffer[0];
 }
 
 void CPathEstimator::InitBlocks() {
@@ -400,24 +442,32 @@ void CPathEstimator::MapChanged(unsigned int x1, unsigned int z1, unsigned int x
 	lowerX = std::max(0, lowerX);
 	lowerZ = std::max(0, lowerZ);
 
+	const unsigned int numMoveData = moveinfo->moveData.size();
+
 	// mark the blocks inside the rectangle, enqueue them
 	// from upper to lower because of the placement of the
-	// bi-directional vertices
+	// bi-directional vertices (Update also recomputes the
+	// vertices leading into a block, so this only decides
+	// the order among equally important blocks)
 	for (int z = upperZ; z >= lowerZ; z--) {
 		for (int x = upperX; x >= lowerX; x--) {
-			if (!(blockStates.nodeMask[z * nbrOfBlocksX + x] & PATHOPT_OBSOLETE)) {
-				vector<MoveData*>::iterator mi;
-
-				for (mi = moveinfo->moveData.begin(); mi < moveinfo->moveData.end(); ++mi) {
-					if ((*mi)->unitDefRefCount > 0) {
-						SingleBlock sb;
-							sb.block.x = x;
-							sb.block.y = z;
-							sb.moveData = *mi;
-						needUpdate.push_back(sb);
-						blockStates.nodeMask[z * nbrOfBlocksX + x] |= PATHOPT_OBSOLETE;
-					}
-				}
+			const unsigned int blockNr = z * nbrOfBlocksX + x;
+
+			for (unsigned int i = 0; i < numMoveData; i++) {
+				const MoveData* md = moveinfo->moveData[i];
+
+				if (md->unitDefRefCount <= 0)
+					continue;
+				// already waiting for an update
+				if (needUpdateFlags[blockNr * numMoveData + md->pathType])
+					continue;
+
+				SingleBlock sb;
+					sb.block.x = x;
+					sb.block.y = z;
+					sb.moveData = md;
+				needUpdate.push_back(sb);
+				needUpdateFlags[blockNr * numMoveData + md->pathType] = true;
 			}
 		}
 	}
@@ -425,42 +475,120 @@ void CPathEstimator::MapChanged(unsigned int x1, unsigned int z1, unsigned int x
 
 
 /**
- * Update some obsolete blocks using the FIFO-principle
+ * Distance (in blocks) from <block> to the nearest start- or
+ * goal-block of a recent synced search, 0 if there were none
+ */
+unsigned int CPathEstimator::GetUpdatePriority(const int2& block) const {
+	unsigned int minDist = (requestBlocks.empty())? 0: std::numeric_limits<unsigned int>::max();
+
+	for (unsigned int n = 0; n < requestBlocks.size(); n++) {
+		const unsigned int dx = std::abs(block.x - requestBlocks[n].x);
+		const unsigned int dz = std::abs(block.y - requestBlocks[n].y);
+
+		minDist = std::min(minDist, std::max(dx, dz));
+	}
+
+	return minDist;
+}
+
+
+/**
+ * Update some obsolete blocks, those nearest to recent path-requests first
+ * and otherwise using the FIFO-principle. New block offsets are found first
+ * and the vertices depending on them recomputed afterwards, both in parallel
+ * (every vertex and offset is written by one thread only, so the result is
+ * the same for any number of threads).
  */
 void CPathEstimator::Update() {
 	pathCache->Update();
 
-	for (unsigned int n = 0; !needUpdate.empty() && n < BLOCKS_TO_UPDATE; ) {
-		// copy the next block in line
-		const SingleBlock sb = needUpdate.front();
+	if (needUpdate.empty())
+		return;
 
-		const unsigned int blockX = sb.block.x;
-		const unsigned int blockZ = sb.block.y;
-		const unsigned int blockN = blockZ * nbrOfBlocksX + blockX;
+	const unsigned int numMoveData = moveinfo->moveData.size();
+	const unsigned int numUpdates = std::min(needUpdate.size(), size_t(BLOCKS_TO_UPDATE));
 
-		needUpdate.pop_front();
+	updatePriorities.clear();
+	updatePriorities.reserve(needUpdate.size());
 
-		// check if it's not already updated
-		if (blockStates.nodeMask[blockN] & PATHOPT_OBSOLETE) {
-			const MoveData* currBlockMD = sb.moveData;
-			const MoveData* nextBlockMD = (needUpdate.empty())? NULL: (needUpdate.front()).moveData;
+	for (unsigned int n = 0; n < needUpdate.size(); n++) {
+		const int2& block = needUpdate[n].block;
 
-			// no, update the block
-			FindOffset(*currBlockMD, blockX, blockZ);
-			CalculateVertices(*currBlockMD, blockX, blockZ);
+		// all pathTypes of a block are usually marked consecutively
+		if (n > 0 && block.x == needUpdate[n - 1].block.x && block.y == needUpdate[n - 1].block.y) {
+			updatePriorities.push_back(std::make_pair(updatePriorities.back().first, n));
+		} else {
+			updatePriorities.push_back(std::make_pair(GetUpdatePriority(block), n));
+		}
+	}
 
-			// each MapChanged() call adds AT MOST <moveData.size()> SingleBlock's
-			// in ascending pathType order per (x, z) PE-block, therefore when the
-			// next SingleBlock's pathType is less or equal to the current we know
-			// that all have been processed (for one PE-block)
-			if (nextBlockMD == NULL || nextBlockMD->pathType <= currBlockMD->pathType) {
-				blockStates.nodeMask[blockN] &= ~PATHOPT_OBSOLETE;
-			}
+	// (priority, index) pairs are unique, so this order is well-defined
+	std::partial_sort(updatePriorities.begin(), updatePriorities.begin() + numUpdates, updatePriorities.end());
 
-			// one stale SingleBlock consumed
-			n++;
+	updateBlocks.clear();
+	updateVertices.clear();
+
+	for (unsigned int n = 0; n < numUpdates; n++) {
+		const SingleBlock& sb = needUpdate[updatePriorities[n].second];
+		const unsigned int blockNr = sb.block.y * nbrOfBlocksX + sb.block.x;
+		const unsigned int pathType = sb.moveData->pathType;
+		const unsigned int vertexBase = pathType * blockStates.GetSize() * PATH_DIRECTION_VERTICES;
+
+		needUpdateFlags[blockNr * numMoveData + pathType] = false;
+		updateBlocks.push_back(sb);
+
+		// the vertices from this block, and those from its
+		// neighbors into it (which depend on its offset too)
+		for (int dir = 0; dir < PATH_DIRECTION_VERTICES; dir++) {
+			const int parentBlockX = sb.block.x - directionVector[dir].x;
+			const int parentBlockZ = sb.block.y - directionVector[dir].y;
+
+			updateVertices.push_back(vertexBase + blockNr * PATH_DIRECTION_VERTICES + dir);
+
+			if (parentBlockX < 0 || parentBlockZ < 0 || parentBlockX >= nbrOfBlocksX || parentBlockZ >= nbrOfBlocksZ)
+				continue;
+
+			updateVertices.push_back(vertexBase + (parentBlockZ * nbrOfBlocksX + parentBlockX) * PATH_DIRECTION_VERTICES + dir);
+		}
+	}
+
+	// remove the chosen blocks, keeping the order of the others
+	unsigned int numRemaining = 0;
+
+	for (unsigned int n = 0; n < needUpdate.size(); n++) {
+		const SingleBlock& sb = needUpdate[n];
+		const unsigned int blockNr = sb.block.y * nbrOfBlocksX + sb.block.x;
+
+		if (needUpdateFlags[blockNr * numMoveData + sb.moveData->pathType]) {
+			needUpdate[numRemaining++] = sb;
 		}
 	}
+
+	needUpdate.resize(numRemaining);
+
+	// neighboring blocks can share vertices
+	std::sort(updateVertices.begin(), updateVertices.end());
+	updateVertices.erase(std::unique(updateVertices.begin(), updateVertices.end()), updateVertices.end());
+
+	simScheduler->ParallelFor(updateBlocks.size(), boost::bind(&CPathEstimator::UpdateBlockOffset, this, _1, _2));
+	simScheduler->ParallelFor(updateVertices.size(), boost::bind(&CPathEstimator::UpdateVertex, this, _1, _2));
+}
+
+void CPathEstimator::UpdateBlockOffset(unsigned int batchIdx, unsigned int threadNum) {
+	const SingleBlock& sb = updateBlocks[batchIdx];
+
+	FindOffset(*sb.moveData, sb.block.x, sb.block.y);
+}
+
+void CPathEstimator::UpdateVertex(unsigned int batchIdx, unsigned int threadNum) {
+	const int vertexNbr = updateVertices[batchIdx];
+	const int numTypeVertices = blockStates.GetSize() * PATH_DIRECTION_VERTICES;
+
+	const int pathType = vertexNbr / numTypeVertices;
+	const int blockNr = (vertexNbr % numTypeVertices) / PATH_DIRECTION_VERTICES;
+	const unsigned int dir = vertexNbr % PATH_DIRECTION_VERTICES;
+
+	CalculateVertex(*moveinfo->moveData[pathType], blockNr % nbrOfBlocksX, blockNr / nbrOfBlocksX, dir, threadNum);
 }
 
 
@@ -492,7 +620,20 @@ IPath::SearchResult CPathEstimator::GetPath(
 	goalBlock.y = peDef.goalSquareZ / BLOCK_SIZE;
 
 	if (synced) {
-		CPathCache::CacheItem* ci = pathCache->GetCachedPath(startBlock, goalBlock, peDef.sqGoalRadius, moveData.pathType);
+		// remember where units search, Update refreshes these areas first
+		if (requestBlocks.size() < MAX_REQUEST_BLOCKS) {
+			requestBlocks.push_back(startBlock);
+			requestBlocks.push_back(goalBlock);
+		} else {
+			requestBlocks[requestBlockIdx    ] = startBlock;
+			requestBlocks[requestBlockIdx + 1] = goalBlock;
+		}
+
+		requestBlockIdx = (requestBlockIdx + 2) % MAX_REQUEST_BLOCKS;
+	}
+
+	if (synced) {
+		const CPathCache::CacheItem* ci = pathCache->GetCachedPath(startBlock, goalBlock, peDef.sqGoalRadius, moveData.pathType);
 		if (ci) {
 			// use a cached path if we have one (NOTE: only when in synced context)
 			path = ci->path;
@@ -669,7 +810,7 @@ void CPathEstimator::TestBlock(
 		return;
 	}
 
-	if (vertexIdx < 0 || (unsigned int)vertexIdx >= vertices.size())
+	if (vertexIdx < 0 || (unsigned int)vertexIdx >= numVertices)
 		return;
 
 	if (vertices[vertexIdx] >= PATHCOST_INFINITY)
@@ -781,71 +922,73 @@ void CPathEstimator::ResetSearch() {
 }
 
 
+std::string CPathEstimator::GetCacheFileName(const std::string& cacheFileName, const std::string& map) const
+{
+	char hashString[64] = {0};
+	sprintf(hashString, "%u", Hash());
+
+	return (std::string(PATH_CACHE_DIR) + map + hashString + "." + cacheFileName + ".pecache");
+}
+
+
 /**
- * Try to read offset and vertices data from file, return false on failure
- * TODO: Read-error-check.
+ * Try to read offset and vertices data from file, return false on failure.
+ * The file stays mapped and the vertex costs are used straight from it, so
+ * processes on the same host share those pages until a block is updated
+ * (which only copies the pages it writes to).
  */
 bool CPathEstimator::ReadFile(const std::string& cacheFileName, const std::string& map)
 {
-	const unsigned int hash = Hash();
-	char hashString[50];
-	sprintf(hashString, "%u", hash);
+	const std::string filename = GetCacheFileName(cacheFileName, map);
 
-	std::string filename = std::string(PATH_CACHE_DIR) + map + hashString + "." + cacheFileName + ".zip";
 	if (!FileSystem::FileExists(filename))
 		return false;
-	// open file for reading from a suitable location (where the file exists)
-	IArchive* pfile = archiveLoader.OpenArchive(dataDirsAccess.LocateFile(filename), "sdz");
 
-	if (!pfile || !pfile->IsOpen()) {
-		delete pfile;
+	std::auto_ptr<CMappedFile> file(new CMappedFile(dataDirsAccess.LocateFile(filename), true));
+
+	if (!file->IsOpen() || file->GetSize() < sizeof(PathCacheHeader))
 		return false;
-	}
 
 	char calcMsg[512];
 	sprintf(calcMsg, "Reading Estimate PathCosts [%d]", BLOCK_SIZE);
 	loadscreen->SetLoadMessage(calcMsg);
 
-	std::auto_ptr<IArchive> auto_pfile(pfile);
-	IArchive& file(*pfile);
-
-	const unsigned fid = file.FindFile("pathinfo");
+	PathCacheHeader header;
+	std::memcpy(&header, file->GetData(), sizeof(PathCacheHeader));
 
-	if (fid < file.NumFiles()) {
-		pathChecksum = file.GetCrc32(fid);
+	const unsigned int blockSize = moveinfo->moveData.size() * sizeof(int2);
 
-		std::vector<boost::uint8_t> buffer;
-		file.GetFile(fid, buffer);
-
-		if (buffer.size() < 4)
-			return false;
-
-		unsigned filehash = *((unsigned*)&buffer[0]);
-		if (filehash != hash)
-			return false;
+	if (std::memcmp(header.magic, PATH_CACHE_MAGIC, sizeof(PATH_CACHE_MAGIC)) != 0)
+		return false;
+	if (header.version != PATHESTIMATOR_VERSION || header.hash != Hash())
+		return false;
+	if (header.mapChecksum != readmap->mapChecksum || header.moveInfoChecksum != moveinfo->moveInfoChecksum)
+		return false;
+	if (header.blockSize != BLOCK_SIZE || header.numBlocks != blockStates.GetSize() || header.numMoveData != moveinfo->moveData.size())
+		return false;
+	if (header.offsetsSize != (blockSize * blockStates.GetSize()) || header.verticesSize != (numVertices * sizeof(float)))
+		return false;
+	if ((header.verticesPos % PATH_CACHE_ALIGNMENT) != 0)
+		return false;
+	if (file->GetSize() < (header.offsetsPos + header.offsetsSize) || file->GetSize() < (header.verticesPos + header.verticesSize))
+		return false;
 
-		unsigned pos = sizeof(unsigned);
+	// Read block-center-offset data.
+	const boost::uint8_t* offsets = file->GetData() + header.offsetsPos;
 
-		// Read block-center-offset data.
-		const unsigned blockSize = moveinfo->moveData.size() * sizeof(int2);
-		if (buffer.size() < pos + blockSize * blockStates.GetSize())
-			return false;
+	for (int blocknr = 0; blocknr < blockStates.GetSize(); blocknr++) {
+		std::memcpy(&blockStates.peNodeOffsets[blocknr][0], offsets + blocknr * blockSize, blockSize);
+	}
 
-		for (int blocknr = 0; blocknr < blockStates.GetSize(); blocknr++) {
-			std::memcpy(&blockStates.peNodeOffsets[blocknr][0], &buffer[pos], blockSize);
-			pos += blockSize;
-		}
+	// Use the vertices data in place.
+	vertices = reinterpret_cast<float*>(file->GetWritableData() + header.verticesPos);
+	vertexBuffer.clear();
+	cacheFile = file.release();
 
-		// Read vertices data.
-		if (buffer.size() < pos + vertices.size() * sizeof(float))
-			return false;
-		std::memcpy(&vertices[0], &buffer[pos], vertices.size() * sizeof(float));
+	pathChecksum = header.dataChecksum;
 
-		// File read successful.
-		return true;
-	} else {
-		return false;
-	}
+	// File read successful.
+	return true;
 }
 
 
@@ -859,48 +1002,74 @@ void CPathEstimator::WriteFile(const std::string& cacheFileName, const std::stri
 		return;
 
 	const unsigned int hash = Hash();
-	char hashString[64] = {0};
+	const unsigned int blockSize = moveinfo->moveData.size() * sizeof(int2);
+
+	PathCacheHeader header;
+	std::memset(&header, 0, sizeof(PathCacheHeader));
+	std::memcpy(header.magic, PATH_CACHE_MAGIC, sizeof(PATH_CACHE_MAGIC));
+
+	header.version          = PATHESTIMATOR_VERSION;
+	header.hash             = hash;
+	header.mapChecksum      = readmap->mapChecksum;
+	header.moveInfoChecksum = moveinfo->moveInfoChecksum;
+	header.blockSize        = BLOCK_SIZE;
+	header.numBlocks        = blockStates.GetSize();
+	header.numMoveData      = moveinfo->moveData.size();
+	header.offsetsPos       = AlignCachePos(sizeof(PathCacheHeader));
+	header.offsetsSize      = blockSize * blockStates.GetSize();
+	header.verticesPos      = AlignCachePos(header.offsetsPos + header.offsetsSize);
+	header.verticesSize     = numVertices * sizeof(float);
+
+	{
+		CRC crc;
+		crc.Update(&hash, sizeof(hash));
 
-	sprintf(hashString, "%u", hash);
+		for (int blocknr = 0; blocknr < blockStates.GetSize(); blocknr++)
+			crc.Update(&blockStates.peNodeOffsets[blocknr][0], blockSize);
 
-	const std::string filename = std::string(PATH_CACHE_DIR) + map + hashString + "." + cacheFileName + ".zip";
-	zipFile file;
+		crc.Update(vertices, header.verticesSize);
+		header.dataChecksum = crc.GetDigest();
+	}
 
-	// open file for writing in a suitable location
-	file = zipOpen(dataDirsAccess.LocateFile(filename, FileQueryFlags::WRITE).c_str(), APPEND_STATUS_CREATE);
+	// write to a temporary file first, other processes might be
+	// reading (or have mapped) an older version of the cache file
+	const std::string filename = dataDirsAccess.LocateFile(GetCacheFileName(cacheFileName, map), FileQueryFlags::WRITE);
+	const std::string tempFilename = filename + ".tmp";
 
-	if (file) {
-		zipOpenNewFileInZip(file, "pathinfo", NULL, NULL, 0, NULL, 0, NULL, Z_DEFLATED, Z_BEST_COMPRESSION);
+	{
+		std::ofstream file(tempFilename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+		const std::vector<char> padding(PATH_CACHE_ALIGNMENT, 0);
 
-		// Write hash.
-		zipWriteInFileInZip(file, (void*) &hash, 4);
+		file.write(reinterpret_cast<const char*>(&header), sizeof(PathCacheHeader));
+		file.write(&padding[0], header.offsetsPos - sizeof(PathCacheHeader));
 
 		// Write block-center-offsets.
 		for (int blocknr = 0; blocknr < blockStates.GetSize(); blocknr++)
-			zipWriteInFileInZip(file, (void*) &blockStates.peNodeOffsets[blocknr][0], moveinfo->moveData.size() * sizeof(int2));
-
-		// Write vertices.
-		zipWriteInFileInZip(file, &vertices[0], vertices.size() * sizeof(float));
-
-		zipCloseFileInZip(file);
-		zipClose(file, NULL);
+			file.write(reinterpret_cast<const char*>(&blockStates.peNodeOffsets[blocknr][0]), blockSize);
 
+		file.write(&padding[0], header.verticesPos - (header.offsetsPos + header.offsetsSize));
 
-		// get the CRC over the written path data
-		IArchive* pfile = archiveLoader.OpenArchive(dataDirsAccess.LocateFile(filename), "sdz");
+		// Write vertices.
+		file.write(reinterpret_cast<const char*>(vertices), header.verticesSize);
 
-		if (!pfile || !pfile->IsOpen()) {
-			delete pfile;
+		if (!file.good()) {
+			file.close();
+			std::remove(tempFilename.c_str());
 			return;
 		}
+	}
 
-		std::auto_ptr<IArchive> auto_pfile(pfile);
-		IArchive& file(*pfile);
+	if (std::rename(tempFilename.c_str(), filename.c_str()) != 0) {
+		// (renaming onto an existing file fails on some platforms)
+		std::remove(filename.c_str());
 
-		const unsigned fid = file.FindFile("pathinfo");
-		assert(fid < file.NumFiles());
-		pathChecksum = file.GetCrc32(fid);
+		if (std::rename(tempFilename.c_str(), filename.c_str()) != 0) {
+			std::remove(tempFilename.c_str());
+			return;
+		}
 	}
+
+	pathChecksum = header.dataChecksum;
 }
 
 
@@ -6,6 +6,7 @@
 #include <string>
 #include <list>
 #include <queue>
+#include <vector>
 
 #include "IPath.h"
 #include "PathConstants.h"
@@ -23,6 +24,7 @@ class CPathFinder;
 class CPathEstimatorDef;
 class CPathFinderDef;
 class CPathCache;
+class CMappedFile;
 
 class CPathEstimator {
 public:
@@ -96,10 +98,19 @@ public:
 
 
 	/**
-	 * called every frame
+	 * called every frame, recomputes (at most) BLOCKS_TO_UPDATE of the
+	 * blocks marked by MapChanged, those nearest to recent path-requests
+	 * first
 	 */
 	void Update();
 
+	/**
+	 * Sets the CPathFinder instances used by Update, one for each sim
+	 * thread (see CSimScheduler::ParallelFor); [0] must be the instance
+	 * passed to the constructor.
+	 */
+	void SetThreadPathFinders(const std::vector<CPathFinder*>& pfs) { pathFinders = pfs; }
+
 	/**
 	 * Returns a checksum that can be used to check if every player has the same
 	 * path data.
@@ -136,12 +147,17 @@ private:
 	void CalculateVertices(const MoveData&, int, int, int thread = 0);
 	void CalculateVertex(const MoveData&, int, int, unsigned int, int thread = 0);
 
+	unsigned int GetUpdatePriority(const int2& block) const;
+	void UpdateBlockOffset(unsigned int batchIdx, unsigned int threadNum);
+	void UpdateVertex(unsigned int batchIdx, unsigned int threadNum);
+
 	IPath::SearchResult InitSearch(const MoveData&, const CPathFinderDef&, bool);
 	IPath::SearchResult DoSearch(const MoveData&, const CPathFinderDef&, bool);
 	void TestBlock(const MoveData&, const CPathFinderDef&, PathNode&, unsigned int, bool);
 	void FinishSearch(const MoveData& moveData, IPath::Path& path);
 	void ResetSearch();
 
+	std::string GetCacheFileName(const std::string& cacheFileName, const std::string& map) const;
 	bool ReadFile(const std::string& cacheFileName, const std::string& map);
 	void WriteFile(const std::string& cacheFileName, const std::string& map);
 	unsigned int Hash() const;
@@ -156,11 +172,28 @@ private:
 	/// The priority-queue used to select next block to be searched.
 	PathPriorityQueue openBlocks;
 
-	std::vector<float> vertices;
+	/// Vertex costs, point into vertexBuffer or (copy-on-write) into cacheFile.
+	float* vertices;
+	unsigned int numVertices;
+	std::vector<float> vertexBuffer;
+	CMappedFile* cacheFile;
 	/// List of blocks changed in last search.
 	std::list<int> dirtyBlocks;
-	/// Blocks that may need an update due to map changes.
-	std::list<SingleBlock> needUpdate;
+	/// Blocks that may need an update due to map changes, in the order they were marked.
+	std::vector<SingleBlock> needUpdate;
+	/// Whether (blockNr * moveData.size() + pathType) is in needUpdate.
+	std::vector<bool> needUpdateFlags;
+
+	/// Start- and goal-blocks of the last MAX_REQUEST_BLOCKS synced searches.
+	std::vector<int2> requestBlocks;
+	unsigned int requestBlockIdx;
+
+	static const unsigned int MAX_REQUEST_BLOCKS = 64;
+
+	/// Per-Update scratch: (priority, needUpdate index), chosen blocks, vertices to recompute.
+	std::vector< std::pair<unsigned int, unsigned int> > updatePriorities;
+	std::vector<SingleBlock> updateBlocks;
+	std::vector<int> updateVertices;
 
 	static const int PATH_DIRECTIONS = 8;
 	static const int PATH_DIRECTION_VERTICES = PATH_DIRECTIONS / 2;
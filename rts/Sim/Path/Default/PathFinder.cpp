@@ -26,6 +26,7 @@ const CMoveMath::BlockType squareMobileBlockBits = (CMoveMath::BLOCK_MOBILE | CM
 CPathFinder::CPathFinder()
 	: heatMapOffset(0)
 	, heatMapping(true)
+	, sharedState(this)
 	, start(ZeroVector)
 	, startxSqr(0)
 	, startzSqr(0)
@@ -310,14 +311,14 @@ bool CPathFinder::TestSquare(
 	}
 
 	// Include heatmap cost adjustment.
-	if (heatMapping && moveData.heatMapping && GetHeatOwner(square.x, square.y) != ownerId) {
-		heatCostMod += (moveData.heatMod * GetHeatValue(square.x, square.y));
+	if (sharedState->heatMapping && moveData.heatMapping && sharedState->GetHeatOwner(square.x, square.y) != ownerId) {
+		heatCostMod += (moveData.heatMod * sharedState->GetHeatValue(square.x, square.y));
 	}
 
 
 
 	const float dirMoveCost = (heatCostMod * moveCost[enterDirection]);
-	const float extraCost = squareStates.GetNodeExtraCost(square.x, square.y, synced);
+	const float extraCost = sharedState->squareStates.GetNodeExtraCost(square.x, square.y, synced);
 	const float nodeCost = (dirMoveCost / squareSpeedMod) + extraCost;
 
 	const float gCost = parentOpenSquare->gCost + nodeCost;  // g
@@ -577,7 +578,7 @@ void CPathFinder::UpdateHeatMap()
 	++heatMapOffset;
 }
 
-int CPathFinder::GetHeatMapIndex(int x, int y)
+int CPathFinder::GetHeatMapIndex(int x, int y) const
 {
 	assert(!heatmap.empty());
 
@@ -83,13 +83,13 @@ public:
 		}
 	}
 
-	const int GetHeatOwner(const int& x, const int& y)
+	const int GetHeatOwner(const int& x, const int& y) const
 	{
 		const int i = GetHeatMapIndex(x, y);
 		return heatmap[i].ownerId;
 	}
 
-	const int GetHeatValue(const int& x, const int& y)
+	const int GetHeatValue(const int& x, const int& y) const
 	{
 		const int i = GetHeatMapIndex(x, y);
 		return std::max(0, heatmap[i].value - heatMapOffset);
@@ -101,9 +101,17 @@ public:
 
 	PathNodeStateBuffer& GetNodeStateBuffer() { return squareStates; }
 
+	/**
+	 * Makes searches read the heat-map and node extra-costs of <pf>
+	 * instead of our own, so that several instances can run searches
+	 * on the same map state concurrently (as long as nothing modifies
+	 * <pf> meanwhile).
+	 */
+	void SetSharedStateSource(const CPathFinder* pf) { sharedState = pf; }
+
 private:
 	// Heat mapping
-	int GetHeatMapIndex(int x, int y);
+	int GetHeatMapIndex(int x, int y) const;
 
 	/**
 	 * Clear things up from last search.
@@ -156,6 +164,8 @@ private:
 	int heatMapOffset;                 ///< heatmap values are relative to this
 	bool heatMapping;
 
+	const CPathFinder* sharedState;    ///< heat-map and extra-costs source, usually this
+
 	int2 directionVector[16];          ///< Unit square-movement in given direction.
 	float moveCost[16];                ///< The cost of moving in given direction.
 
@@ -8,12 +8,16 @@
 #include "PathEstimator.h"
 #include "Map/MapInfo.h"
 #include "Sim/Misc/GlobalSynced.h"
+#include "Sim/Misc/ModInfo.h"
+#include "Sim/Misc/SimScheduler.h"
 #include "Sim/MoveTypes/MoveInfo.h"
 #include "Sim/MoveTypes/MoveMath/MoveMath.h"
 #include "System/Log/ILog.h"
 #include "System/myMath.h"
 #include "System/TimeProfiler.h"
 
+#include <boost/bind.hpp>
+
 #define PM_UNCONSTRAINED_MAXRES_FALLBACK_SEARCH 0
 #define PM_UNCONSTRAINED_MEDRES_FALLBACK_SEARCH 1
 #define PM_UNCONSTRAINED_LOWRES_FALLBACK_SEARCH 1
@@ -26,6 +30,17 @@ CPathManager::CPathManager(): nextPathId(0)
 	medResPE = new CPathEstimator(maxResPF,  8, "pe",  mapInfo->map.name);
 	lowResPE = new CPathEstimator(maxResPF, 32, "pe2", mapInfo->map.name);
 
+	// extra instances for the parallel searches in Update
+	threadPathFinders.resize(simScheduler->GetNumThreads(), maxResPF);
+
+	for (unsigned int n = 1; n < threadPathFinders.size(); n++) {
+		threadPathFinders[n] = new CPathFinder();
+		threadPathFinders[n]->SetSharedStateSource(maxResPF);
+	}
+
+	medResPE->SetThreadPathFinders(threadPathFinders);
+	lowResPE->SetThreadPathFinders(threadPathFinders);
+
 	LOG("[CPathManager] pathing data checksum: %08x", GetPathCheckSum());
 
 	#ifdef SYNCDEBUG
@@ -40,6 +55,10 @@ CPathManager::CPathManager(): nextPathId(0)
 
 CPathManager::~CPathManager()
 {
+	for (unsigned int n = 1; n < threadPathFinders.size(); n++) {
+		delete threadPathFinders[n];
+	}
+
 	delete lowResPE;
 	delete medResPE;
 	delete maxResPF;
@@ -82,21 +101,62 @@ unsigned int CPathManager::RequestPath(
 ) {
 	SCOPED_TIMER("PathManager::RequestPath");
 
-	MoveData* moveData = moveinfo->moveData[md->pathType];
-	moveData->tempOwner = caller;
+	const MoveData* moveData = moveinfo->moveData[md->pathType];
 
 	// Creates a new multipath.
-	IPath::SearchResult result = IPath::Error;
 	MultiPath* newPath = new MultiPath(startPos, pfDef, moveData);
 	newPath->finalGoal = goalPos;
 	newPath->caller = caller;
 
+	if (caller != NULL && synced && modInfo.queuedPathRequests) {
+		// solved together with all other requests of this frame at
+		// the start of the next one, the owner gets temporary waypoints
+		// until then (see NextWayPoint)
+		newPath->queued = true;
+
+		const unsigned int pathID = Store(newPath);
+		queuedPathIds.push_back(pathID);
+		return pathID;
+	}
+
+	const IPath::SearchResult result = SearchPath(*newPath, NULL, true, synced);
+
+	if (result == IPath::Ok || result == IPath::GoalOutOfRange) {
+		return Store(newPath);
+	}
+
+	delete newPath;
+	return 0;
+}
+
+/*
+Run the searches for a multipath, the detailed part of the path is only
+refined from the estimated one if <refineMaxRes> is true. If the detailed
+search towards a nearby goal was already done, its result is passed in
+<maxResResult>.
+*/
+IPath::SearchResult CPathManager::SearchPath(
+	MultiPath& newPath,
+	const IPath::SearchResult* maxResResult,
+	bool refineMaxRes,
+	bool synced
+) {
+	MoveData* moveData = moveinfo->moveData[newPath.moveData->pathType];
+	CPathFinderDef* pfDef = newPath.peDef;
+	CSolidObject* caller = newPath.caller;
+
+	const float3& startPos = newPath.start;
+	const float3& goalPos = newPath.finalGoal;
+
+	moveData->tempOwner = caller;
+
+	IPath::SearchResult result = IPath::Error;
+
 	if (caller) {
 		caller->UnBlock();
 	}
 
 	const int ownerId = caller? caller->id: 0;
-	unsigned int pathID = 0;
 
 	// choose the PF or the PE depending on the projected 2D goal-distance
 	// NOTE: this distance can be far smaller than the actual path length!
@@ -105,7 +165,11 @@ unsigned int CPathManager::RequestPath(
 	const float goalDist2D = pfDef->Heuristic(startPos.x / SQUARE_SIZE, startPos.z / SQUARE_SIZE) + fabs(goalPos.y - startPos.y) / SQUARE_SIZE;
 
 	if (goalDist2D < DETAILED_DISTANCE) {
-		result = maxResPF->GetPath(*moveData, startPos, *pfDef, newPath->maxResPath, true, false, MAX_SEARCHED_NODES_PF >> 3, true, ownerId, synced);
+		if (maxResResult != NULL) {
+			result = *maxResResult;
+		} else {
+			result = maxResPF->GetPath(*moveData, startPos, *pfDef, newPath.maxResPath, true, false, MAX_SEARCHED_NODES_PF >> 3, true, ownerId, synced);
+		}
 
 		#if (PM_UNCONSTRAINED_MAXRES_FALLBACK_SEARCH == 1)
 		// unnecessary so long as a fallback path exists within the
@@ -117,17 +181,17 @@ unsigned int CPathManager::RequestPath(
 		// fallback (note that this uses the estimators as backup,
 		// unconstrained PF queries are too expensive on average)
 		if (result != IPath::Ok) {
-			result = medResPE->GetPath(*moveData, startPos, *pfDef, newPath->medResPath, MAX_SEARCHED_NODES_PE >> 3, synced);
+			result = medResPE->GetPath(*moveData, startPos, *pfDef, newPath.medResPath, MAX_SEARCHED_NODES_PE >> 3, synced);
 		}
 		if (result != IPath::Ok) {
-			result = lowResPE->GetPath(*moveData, startPos, *pfDef, newPath->lowResPath, MAX_SEARCHED_NODES_PE >> 3, synced);
+			result = lowResPE->GetPath(*moveData, startPos, *pfDef, newPath.lowResPath, MAX_SEARCHED_NODES_PE >> 3, synced);
 		}
 	} else if (goalDist2D < ESTIMATE_DISTANCE) {
-		result = medResPE->GetPath(*moveData, startPos, *pfDef, newPath->medResPath, MAX_SEARCHED_NODES_PE >> 3, synced);
+		result = medResPE->GetPath(*moveData, startPos, *pfDef, newPath.medResPath, MAX_SEARCHED_NODES_PE >> 3, synced);
 
 		// CantGetCloser may be a false positive due to PE approximations and large goalRadius
 		if (result == IPath::CantGetCloser && (startPos - goalPos).SqLength2D() > pfDef->sqGoalRadius)
-			result = maxResPF->GetPath(*moveData, startPos, *pfDef, newPath->maxResPath, true, false, MAX_SEARCHED_NODES_PF >> 3, true, ownerId, synced);
+			result = maxResPF->GetPath(*moveData, startPos, *pfDef, newPath.maxResPath, true, false, MAX_SEARCHED_NODES_PF >> 3, true, ownerId, synced);
 
 		#if (PM_UNCONSTRAINED_MEDRES_FALLBACK_SEARCH == 1)
 		pfDef->DisableConstraint(true);
@@ -135,16 +199,16 @@ unsigned int CPathManager::RequestPath(
 
 		// fallback
 		if (result != IPath::Ok) {
-			result = medResPE->GetPath(*moveData, startPos, *pfDef, newPath->medResPath, MAX_SEARCHED_NODES_PE >> 3, synced);
+			result = medResPE->GetPath(*moveData, startPos, *pfDef, newPath.medResPath, MAX_SEARCHED_NODES_PE >> 3, synced);
 		}
 	} else {
-		result = lowResPE->GetPath(*moveData, startPos, *pfDef, newPath->lowResPath, MAX_SEARCHED_NODES_PE >> 3, synced);
+		result = lowResPE->GetPath(*moveData, startPos, *pfDef, newPath.lowResPath, MAX_SEARCHED_NODES_PE >> 3, synced);
 
 		// CantGetCloser may be a false positive due to PE approximations and large goalRadius
 		if (result == IPath::CantGetCloser && (startPos - goalPos).SqLength2D() > pfDef->sqGoalRadius) {
-			result = medResPE->GetPath(*moveData, startPos, *pfDef, newPath->medResPath, MAX_SEARCHED_NODES_PE >> 3, synced);
+			result = medResPE->GetPath(*moveData, startPos, *pfDef, newPath.medResPath, MAX_SEARCHED_NODES_PE >> 3, synced);
 			if (result == IPath::CantGetCloser) // Same thing again
-				result = maxResPF->GetPath(*moveData, startPos, *pfDef, newPath->maxResPath, true, false, MAX_SEARCHED_NODES_PF >> 3, true, ownerId, synced);
+				result = maxResPF->GetPath(*moveData, startPos, *pfDef, newPath.maxResPath, true, false, MAX_SEARCHED_NODES_PF >> 3, true, ownerId, synced);
 		}
 
 		#if (PM_UNCONSTRAINED_LOWRES_FALLBACK_SEARCH == 1)
@@ -153,18 +217,18 @@ unsigned int CPathManager::RequestPath(
 
 		// fallback
 		if (result != IPath::Ok) {
-			result = lowResPE->GetPath(*moveData, startPos, *pfDef, newPath->lowResPath, MAX_SEARCHED_NODES_PE >> 3, synced);
+			result = lowResPE->GetPath(*moveData, startPos, *pfDef, newPath.lowResPath, MAX_SEARCHED_NODES_PE >> 3, synced);
 		}
 	}
 
 	if (result == IPath::Ok || result == IPath::GoalOutOfRange) {
-		LowRes2MedRes(*newPath, startPos, ownerId, synced);
-		MedRes2MaxRes(*newPath, startPos, ownerId, synced);
+		LowRes2MedRes(newPath, startPos, ownerId, synced);
 
-		newPath->searchResult = result;
-		pathID = Store(newPath);
-	} else {
-		delete newPath;
+		if (refineMaxRes) {
+			MedRes2MaxRes(newPath, *moveData, maxResPF, startPos, ownerId, synced);
+		}
+
+		newPath.searchResult = result;
 	}
 
 	if (caller) {
@@ -172,7 +236,7 @@ unsigned int CPathManager::RequestPath(
 	}
 
 	moveData->tempOwner = NULL;
-	return pathID;
+	return result;
 }
 
 
@@ -187,8 +251,14 @@ unsigned int CPathManager::Store(MultiPath* path)
 
 
 // converts part of a med-res path into a high-res path
-void CPathManager::MedRes2MaxRes(MultiPath& multiPath, const float3& startPos, int ownerId, bool synced) const
-{
+void CPathManager::MedRes2MaxRes(
+	MultiPath& multiPath,
+	const MoveData& moveData,
+	CPathFinder* pathFinder,
+	const float3& startPos,
+	int ownerId,
+	bool synced
+) const {
 	IPath::Path& maxResPath = multiPath.maxResPath;
 	IPath::Path& medResPath = multiPath.medResPath;
 	IPath::Path& lowResPath = multiPath.lowResPath;
@@ -221,9 +291,9 @@ void CPathManager::MedRes2MaxRes(MultiPath& multiPath, const float3& startPos, i
 	IPath::SearchResult result = IPath::Error;
 
 	if (medResPath.path.empty() && lowResPath.path.empty()) {
-		result = maxResPF->GetPath(*multiPath.moveData, startPos, *multiPath.peDef, maxResPath, true, false, MAX_SEARCHED_NODES_PF >> 3, true, ownerId, synced);
+		result = pathFinder->GetPath(moveData, startPos, *multiPath.peDef, maxResPath, true, false, MAX_SEARCHED_NODES_PF >> 3, true, ownerId, synced);
 	} else {
-		result = maxResPF->GetPath(*multiPath.moveData, startPos, rangedGoalPFD, maxResPath, true, false, MAX_SEARCHED_NODES_PF >> 3, true, ownerId, synced);
+		result = pathFinder->GetPath(moveData, startPos, rangedGoalPFD, maxResPath, true, false, MAX_SEARCHED_NODES_PF >> 3, true, ownerId, synced);
 	}
 
 	// If no refined path could be found, set goal as desired goal.
@@ -309,6 +379,15 @@ float3 CPathManager::NextWayPoint(
 
 	MultiPath* multiPath = pi->second;
 
+	if (multiPath->queued) {
+		// request has not been solved yet, just set the owner off
+		// toward its goal (keeping the point a small fixed distance
+		// in front so it asks again soon) and make the y-coordinate
+		// -1 to indicate to GMT that this waypoint is temporary
+		const float3 goalDir = (multiPath->finalGoal - callerPos).SafeNormalize() * SQUARE_SIZE;
+		return float3(callerPos.x + goalDir.x, -1.0f, callerPos.z + goalDir.z);
+	}
+
 	if (callerPos == ZeroVector) {
 		if (!multiPath->maxResPath.path.empty())
 			callerPos = multiPath->maxResPath.path.back();
@@ -330,7 +409,7 @@ float3 CPathManager::NextWayPoint(
 			multiPath->caller->UnBlock();
 		}
 
-		MedRes2MaxRes(*multiPath, callerPos, ownerId, synced);
+		MedRes2MaxRes(*multiPath, *multiPath->moveData, maxResPF, callerPos, ownerId, synced);
 
 		if (multiPath->caller) {
 			multiPath->caller->Block();
@@ -365,7 +444,7 @@ float3 CPathManager::NextWayPoint(
 	} while (callerPos.SqDistance2D(waypoint) < Square(minDistance) && waypoint != multiPath->maxResPath.pathGoal);
 
 	// indicate this is not a temporary waypoint
-	// (the default PFS does not queue requests)
+	// (only the unsolved queued requests have those)
 	waypoint.y = 0.0f;
 
 	return waypoint;
@@ -404,6 +483,102 @@ void CPathManager::Update()
 	maxResPF->UpdateHeatMap();
 	medResPE->Update();
 	lowResPE->Update();
+
+	SolveQueuedPaths();
+}
+
+
+/*
+Solve the requests queued since the last Update, in three passes:
+the detailed searches (for nearby goals) run in parallel, followed
+by the estimator searches which run serially in request order since
+the estimators share their path-caches, and finally the detailed
+refinements of the estimated paths which again run in parallel.
+Every thread has its own node-state buffers, so each search has the
+same outcome no matter on which thread or in which order it runs.
+*/
+void CPathManager::SolveQueuedPaths()
+{
+	if (queuedPathIds.empty())
+		return;
+
+	SCOPED_TIMER("PathManager::SolveQueuedPaths");
+
+	queuedPaths.clear();
+	queuedPaths.reserve(queuedPathIds.size());
+
+	for (unsigned int n = 0; n < queuedPathIds.size(); n++) {
+		const std::map<unsigned int, MultiPath*>::const_iterator pi = pathMap.find(queuedPathIds[n]);
+
+		// skip requests that were deleted before being solved
+		if (pi == pathMap.end())
+			continue;
+
+		queuedPaths.push_back(pi->second);
+	}
+
+	queuedPathIds.clear();
+	queuedResults.clear();
+	queuedResults.resize(queuedPaths.size(), IPath::Error);
+
+	simScheduler->ParallelFor(queuedPaths.size(), boost::bind(&CPathManager::SearchQueuedMaxResPath, this, _1, _2));
+
+	for (unsigned int n = 0; n < queuedPaths.size(); n++) {
+		queuedResults[n] = SearchPath(*queuedPaths[n], &queuedResults[n], false, true);
+	}
+
+	simScheduler->ParallelFor(queuedPaths.size(), boost::bind(&CPathManager::RefineQueuedPath, this, _1, _2));
+
+	for (unsigned int n = 0; n < queuedPaths.size(); n++) {
+		MultiPath* multiPath = queuedPaths[n];
+		multiPath->queued = false;
+
+		if (queuedResults[n] == IPath::Ok || queuedResults[n] == IPath::GoalOutOfRange)
+			continue;
+
+		// make NextWayPoint tell the owner there is no path
+		multiPath->lowResPath.path.clear();
+		multiPath->medResPath.path.clear();
+		multiPath->maxResPath.path.clear();
+		multiPath->maxResPath.squares.clear();
+		multiPath->searchResult = queuedResults[n];
+	}
+
+	queuedPaths.clear();
+}
+
+void CPathManager::SearchQueuedMaxResPath(unsigned int queueIdx, unsigned int threadNum)
+{
+	MultiPath* multiPath = queuedPaths[queueIdx];
+
+	const CPathFinderDef* pfDef = multiPath->peDef;
+	const float3& startPos = multiPath->start;
+	const float3& goalPos = multiPath->finalGoal;
+
+	// same goal-distance test as in SearchPath
+	const float goalDist2D = pfDef->Heuristic(startPos.x / SQUARE_SIZE, startPos.z / SQUARE_SIZE) + fabs(goalPos.y - startPos.y) / SQUARE_SIZE;
+
+	if (goalDist2D >= DETAILED_DISTANCE)
+		return;
+
+	// the shared MoveData can not carry a different tempOwner per thread
+	MoveData moveData(multiPath->moveData);
+	moveData.tempOwner = multiPath->caller;
+
+	queuedResults[queueIdx] = threadPathFinders[threadNum]->GetPath(moveData, startPos, *pfDef, multiPath->maxResPath, true, false, MAX_SEARCHED_NODES_PF >> 3, true, multiPath->caller->id, true);
+}
+
+void CPathManager::RefineQueuedPath(unsigned int queueIdx, unsigned int threadNum)
+{
+	if (queuedResults[queueIdx] != IPath::Ok && queuedResults[queueIdx] != IPath::GoalOutOfRange)
+		return;
+
+	MultiPath* multiPath = queuedPaths[queueIdx];
+
+	MoveData moveData(multiPath->moveData);
+	moveData.tempOwner = multiPath->caller;
+
+	MedRes2MaxRes(*multiPath, moveData, threadPathFinders[threadNum], multiPath->start, multiPath->caller->id, true);
 }
 
 // used to deposit heat on the heat-map as a unit moves along its path
@@ -4,6 +4,7 @@
 #define PATHMANAGER_H
 
 #include <map>
+#include <vector>
 #include <boost/cstdint.hpp> /* Replace with <stdint.h> if appropriate */
 
 #include "Sim/Path/IPathManager.h"
@@ -95,13 +96,14 @@ private:
 	);
 
 	struct MultiPath {
-		MultiPath(const float3& pos, const CPathFinderDef* def, const MoveData* moveData)
+		MultiPath(const float3& pos, CPathFinderDef* def, const MoveData* moveData)
 			: searchResult(IPath::Error)
 			, start(pos)
 			, peDef(def)
 			, moveData(moveData)
 			, finalGoal(ZeroVector)
 			, caller(NULL)
+			, queued(false)
 		{}
 
 		~MultiPath() { delete peDef; }
@@ -114,24 +116,40 @@ private:
 
 		// Request definition
 		const float3 start;
-		const CPathFinderDef* peDef;
+		CPathFinderDef* peDef;
 		const MoveData* moveData;
 
 		// Additional information.
 		float3 finalGoal;
 		CSolidObject* caller;
+
+		/// true until the request has been solved in Update
+		bool queued;
 	};
 
+	IPath::SearchResult SearchPath(MultiPath& path, const IPath::SearchResult* maxResResult, bool refineMaxRes, bool synced);
 	unsigned int Store(MultiPath* path);
 	void LowRes2MedRes(MultiPath& path, const float3& startPos, int ownerId, bool synced) const;
-	void MedRes2MaxRes(MultiPath& path, const float3& startPos, int ownerId, bool synced) const;
+	void MedRes2MaxRes(MultiPath& path, const MoveData& moveData, CPathFinder* pathFinder, const float3& startPos, int ownerId, bool synced) const;
+
+	void SolveQueuedPaths();
+	void SearchQueuedMaxResPath(unsigned int queueIdx, unsigned int threadNum);
+	void RefineQueuedPath(unsigned int queueIdx, unsigned int threadNum);
 
 	CPathFinder* maxResPF;
 	CPathEstimator* medResPE;
 	CPathEstimator* lowResPE;
 
+	/// one per sim-thread for the parallel searches in Update, [0] is maxResPF
+	std::vector<CPathFinder*> threadPathFinders;
+
 	std::map<unsigned int, MultiPath*> pathMap;
 	unsigned int nextPathId;
+
+	/// ids of the (modrule queuedPathRequests) requests made since the last Update, in request order
+	std::vector<unsigned int> queuedPathIds;
+	std::vector<MultiPath*> queuedPaths;
+	std::vector<IPath::SearchResult> queuedResults;
 };
 
 #endif
@@ -3,6 +3,7 @@
 #include <boost/bind.hpp>
 #include <boost/thread.hpp>
 #include <boost/cstdint.hpp>
+#include <set>
 
 #include "System/OpenMP_cond.h"
 #include "lib/gml/gml.h" // for gmlCPUCount
@@ -12,6 +13,7 @@
 #include "Game/GameSetup.h"
 #include "Game/LoadScreen.h"
 #include "Sim/Misc/GlobalSynced.h"
+#include "Sim/Misc/SimScheduler.h"
 #include "Sim/Misc/TeamHandler.h"
 #include "Sim/MoveTypes/MoveInfo.h"
 #include "Sim/MoveTypes/MoveMath/MoveMath.h"
@@ -113,6 +115,11 @@ QTPFS::PathManager::~PathManager() {
 		pathSearches[i].clear(); // TODO: delete values in pathSearches[i]
 	}
 
+	scheduledSearches.clear();
+	scheduledResults.clear();
+	sharedPaths.clear();
+	searchStateOffsets.clear();
+
 	nodeTrees.clear();
 	nodeLayers.clear();
 	pathCaches.clear();
@@ -123,14 +130,12 @@ QTPFS::PathManager::~PathManager() {
 	numCurrExecutedSearches.clear();
 	numPrevExecutedSearches.clear();
 
-	PathSearch::FreeGlobalQueue();
+	PathSearch::FreeGlobalQueues();
 }
 
 void QTPFS::PathManager::Load() {
 	pmLoadScreen.SetLoading(true);
 
-	// NOTE: offset *must* start at a non-zero value
-	searchStateOffset = NODE_STATE_OFFSET;
 	numTerrainChanges = 0;
 	numPathRequests   = 0;
 	maxNumLayerNodes  = 0;
@@ -139,6 +144,14 @@ void QTPFS::PathManager::Load() {
 	nodeLayers.resize(moveinfo->moveData.size());
 	pathCaches.resize(moveinfo->moveData.size());
 	pathSearches.resize(moveinfo->moveData.size());
+	scheduledSearches.resize(moveinfo->moveData.size());
+	scheduledResults.resize(moveinfo->moveData.size());
+	sharedPaths.resize(moveinfo->moveData.size());
+
+	// NOTE: offsets *must* start at a non-zero value
+	// (each layer has its own, since searches never touch
+	// the nodes of any other layer than their own)
+	searchStateOffsets.resize(moveinfo->moveData.size(), NODE_STATE_OFFSET);
 
 	// add one extra element for object-less requests
 	numCurrExecutedSearches.resize(teamHandler->ActiveTeams() + 1, 0);
@@ -171,7 +184,7 @@ void QTPFS::PathManager::Load() {
 			maxNumLayerNodes = std::max(nodeLayers[layerNum].GetNumLeafNodes(), maxNumLayerNodes);
 		}
 
-		PathSearch::InitGlobalQueue(maxNumLayerNodes);
+		PathSearch::InitGlobalQueues(maxNumLayerNodes, simScheduler->GetNumThreads());
 	}
 
 	{
@@ -464,11 +477,24 @@ void QTPFS::PathManager::Update() {
 	static unsigned int minPathTypeUpdate = 0;
 	static unsigned int maxPathTypeUpdate = numPathTypeUpdates;
 
-	sharedPaths.clear();
-
+	// NOTE:
+	//     the searches of different path-types only touch their own
+	//     node-layer and path-cache, so each path-type is one job for
+	//     the sim-threads; everything that is shared between layers
+	//     (team search-limits, the path-type map, traces) is handled
+	//     before and after the jobs in path-type order to stay synced
 	for (unsigned int pathTypeUpdate = minPathTypeUpdate; pathTypeUpdate < maxPathTypeUpdate; pathTypeUpdate++) {
 		QueueDeadPathSearches(pathTypeUpdate);
-		ExecuteQueuedSearches(pathTypeUpdate);
+		ScheduleQueuedSearches(pathTypeUpdate);
+	}
+
+	simScheduler->ParallelFor(
+		maxPathTypeUpdate - minPathTypeUpdate,
+		boost::bind(&PathManager::ExecuteQueuedSearches, this, minPathTypeUpdate, _1, _2)
+	);
+
+	for (unsigned int pathTypeUpdate = minPathTypeUpdate; pathTypeUpdate < maxPathTypeUpdate; pathTypeUpdate++) {
+		FinalizeQueuedSearches(pathTypeUpdate);
 	}
 
 	std::copy(numCurrExecutedSearches.begin(), numCurrExecutedSearches.end(), numPrevExecutedSearches.begin());
@@ -488,96 +514,168 @@ void QTPFS::PathManager::Update() {
 
 
 
-void QTPFS::PathManager::ExecuteQueuedSearches(unsigned int pathType) {
-	NodeLayer& nodeLayer = nodeLayers[pathType];
+void QTPFS::PathManager::ScheduleQueuedSearches(unsigned int pathType) {
 	PathCache& pathCache = pathCaches[pathType];
 
 	std::list<IPathSearch*>& searches = pathSearches[pathType];
 	std::list<IPathSearch*>::iterator searchesIt = searches.begin();
 
-	if (!searches.empty()) {
-		// execute pending searches collected via
-		// RequestPath and QueueDeadPathSearches
-		while (searchesIt != searches.end()) {
-			ExecuteSearch(searches, searchesIt, nodeLayer, pathCache, pathType);
-		}
-	}
-}
-
-void QTPFS::PathManager::ExecuteSearch(
-	PathSearchList& searches,
-	PathSearchListIt& searchesIt,
-	NodeLayer& nodeLayer,
-	PathCache& pathCache,
-	unsigned int pathType
-) {
-	IPathSearch* search = *searchesIt;
-	IPath* path = pathCache.GetTempPath(search->GetID());
-	MoveData* md = moveinfo->moveData[pathType];
-
-	assert(search != NULL);
-	assert(path != NULL);
+	std::vector<PathSearchListIt>& scheduled = scheduledSearches[pathType];
 
-	// temp-path might have been removed already via
-	// DeletePath before we got a chance to process it
-	if (path->GetID() == 0) {
-		*searchesIt = NULL;
-		searchesIt = searches.erase(searchesIt);
-		delete search;
-		return;
-	}
+	#ifdef QTPFS_SEARCH_SHARED_PATHS
+	NodeLayer& nodeLayer = nodeLayers[pathType];
+	std::set<boost::uint64_t> scheduledHashes;
+	#endif
 
-	assert(search->GetID() != 0);
-	assert(path->GetID() == search->GetID());
+	scheduled.clear();
 
-	search->Initialize(&nodeLayer, &pathCache, path->GetSourcePoint(), path->GetTargetPoint());
-	path->SetHash(search->GetHash(gs->mapx * gs->mapy, pathType));
+	// pick the pending searches (collected via RequestPath and
+	// QueueDeadPathSearches) that will be executed this frame
+	while (searchesIt != searches.end()) {
+		IPathSearch* search = *searchesIt;
+		IPath* path = pathCache.GetTempPath(search->GetID());
 
-	{
-		#ifdef QTPFS_SEARCH_SHARED_PATHS
-		SharedPathMap::const_iterator sharedPathsIt = sharedPaths.find(path->GetHash());
+		assert(search != NULL);
+		assert(path != NULL);
 
-		if (sharedPathsIt != sharedPaths.end()) {
-			search->SharedFinalize(sharedPathsIt->second, path);
+		// temp-path might have been removed already via
+		// DeletePath before we got a chance to process it
+		if (path->GetID() == 0) {
 			*searchesIt = NULL;
 			searchesIt = searches.erase(searchesIt);
 			delete search;
-			return;
+			continue;
+		}
+
+		assert(search->GetID() != 0);
+		assert(path->GetID() == search->GetID());
+
+		#ifdef QTPFS_SEARCH_SHARED_PATHS
+		// a search with the same hash as one scheduled before it will
+		// (normally) just copy that one's path in ExecuteSearch, so it
+		// is not counted against the team limit, as before the searches
+		// were scheduled ahead of their execution
+		// NOTE: if the earlier search fails, this one runs uncounted
+		search->Initialize(&nodeLayer, &pathCache, path->GetSourcePoint(), path->GetTargetPoint());
+
+		if (!scheduledHashes.insert(search->GetHash(gs->mapx * gs->mapy, pathType)).second) {
+			scheduled.push_back(searchesIt++); continue;
 		}
 		#endif
 
 		#ifdef QTPFS_LIMIT_TEAM_SEARCHES
+		// the limit has to be applied here rather than when the search
+		// executes, since the per-type jobs would otherwise race for the
+		// team counters and schedule different searches on each client
 		const unsigned int numCurrSearches = numCurrExecutedSearches[search->GetTeam()];
 		const unsigned int numPrevSearches = numPrevExecutedSearches[search->GetTeam()];
 
 		if ((numCurrSearches - numPrevSearches) >= MAX_TEAM_SEARCHES) {
-			++searchesIt; return;
+			#ifdef QTPFS_SEARCH_SHARED_PATHS
+			scheduledHashes.erase(search->GetHash(gs->mapx * gs->mapy, pathType));
+			#endif
+			++searchesIt; continue;
 		}
 
 		numCurrExecutedSearches[search->GetTeam()] += 1;
 		#endif
+
+		scheduled.push_back(searchesIt++);
 	}
 
-	// removes path from temp-paths, adds it to live-paths
-	if (search->Execute(searchStateOffset, numTerrainChanges)) {
-		search->Finalize(path);
+	scheduledResults[pathType].clear();
+	scheduledResults[pathType].resize(scheduled.size(), false);
+}
 
-		#ifdef QTPFS_SEARCH_SHARED_PATHS
-		sharedPaths[path->GetHash()] = path;
-		#endif
+void QTPFS::PathManager::ExecuteQueuedSearches(unsigned int minPathType, unsigned int pathTypeNum, unsigned int threadNum) {
+	const unsigned int pathType = minPathType + pathTypeNum;
+
+	NodeLayer& nodeLayer = nodeLayers[pathType];
+	PathCache& pathCache = pathCaches[pathType];
+
+	const std::vector<PathSearchListIt>& scheduled = scheduledSearches[pathType];
+
+	sharedPaths[pathType].clear();
+
+	// searches on the same layer share its nodes' search-state,
+	// so these have to run one after the other (in queued order)
+	for (unsigned int n = 0; n < scheduled.size(); n++) {
+		scheduledResults[pathType][n] = ExecuteSearch(*scheduled[n], nodeLayer, pathCache, pathType, threadNum);
+	}
+}
+
+void QTPFS::PathManager::FinalizeQueuedSearches(unsigned int pathType) {
+	std::list<IPathSearch*>& searches = pathSearches[pathType];
+	std::vector<PathSearchListIt>& scheduled = scheduledSearches[pathType];
+
+	for (unsigned int n = 0; n < scheduled.size(); n++) {
+		IPathSearch* search = *scheduled[n];
 
 		#ifdef QTPFS_TRACE_PATH_SEARCHES
-		pathTraces[path->GetID()] = search->GetExecutionTrace();
+		if (search->GetExecutionTrace() != NULL) {
+			pathTraces[search->GetID()] = search->GetExecutionTrace();
+
+			LOG_L(L_DEBUG,
+				"[QTPFS::PathManager::%s] path %u: %u nodes expanded, %u nodes pushed",
+				__FUNCTION__, search->GetID(),
+				search->GetExecutionTrace()->GetNumExpandedNodes(),
+				search->GetExecutionTrace()->GetNumPushedNodes());
+		}
 		#endif
-	} else {
-		DeletePath(path->GetID());
+
+		if (!scheduledResults[pathType][n]) {
+			DeletePath(search->GetID());
+		}
+
+		*scheduled[n] = NULL;
+		searches.erase(scheduled[n]);
+		delete search;
 	}
 
-	*searchesIt = NULL;
-	searchesIt = searches.erase(searchesIt);
-	delete search;
+	scheduled.clear();
+}
+
+bool QTPFS::PathManager::ExecuteSearch(
+	IPathSearch* search,
+	NodeLayer& nodeLayer,
+	PathCache& pathCache,
+	unsigned int pathType,
+	unsigned int threadNum
+) {
+	IPath* path = pathCache.GetTempPath(search->GetID());
+
+	assert(search != NULL);
+	assert(path != NULL);
+	assert(path->GetID() != 0);
+
+	search->Initialize(&nodeLayer, &pathCache, path->GetSourcePoint(), path->GetTargetPoint());
+	path->SetHash(search->GetHash(gs->mapx * gs->mapy, pathType));
+
+	#ifdef QTPFS_SEARCH_SHARED_PATHS
+	{
+		SharedPathMap::const_iterator sharedPathsIt = sharedPaths[pathType].find(path->GetHash());
+
+		if (sharedPathsIt != sharedPaths[pathType].end()) {
+			search->SharedFinalize(sharedPathsIt->second, path);
+			return true;
+		}
+	}
+	#endif
+
+	const bool haveResult = search->Execute(searchStateOffsets[pathType], numTerrainChanges, threadNum);
+
+	// removes path from temp-paths, adds it to live-paths
+	// (failed paths are deleted by FinalizeQueuedSearches)
+	if (haveResult) {
+		search->Finalize(path);
+
+		#ifdef QTPFS_SEARCH_SHARED_PATHS
+		sharedPaths[pathType][path->GetHash()] = path;
+		#endif
+	}
 
-	searchStateOffset += NODE_STATE_OFFSET;
+	searchStateOffsets[pathType] += search->GetNumSearchStates();
+	return haveResult;
 }
 
 void QTPFS::PathManager::QueueDeadPathSearches(unsigned int pathType) {
@@ -617,7 +715,7 @@ unsigned int QTPFS::PathManager::QueueSearch(
 	//     calls DeletePath, which ensures any path is removed
 	//     from its cache before we get to ExecuteSearch
 	IPath* newPath = new IPath();
-	IPathSearch* newSearch = new PathSearch(PATH_SEARCH_ASTAR);
+	IPathSearch* newSearch = new PathSearch(PATH_SEARCH_ASTAR, moveData->bidirectionalSearch);
 
 	assert(newPath != NULL);
 	assert(newSearch != NULL);
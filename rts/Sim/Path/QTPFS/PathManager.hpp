@@ -56,7 +56,9 @@ namespace QTPFS {
 
 		static NodeLayer* GetSerializingNodeLayer() { return serializingNodeLayer; }
 
-		static const unsigned int MAX_UPDATE_DELAY = 10;
+		// searches of all path-types now run concurrently,
+		// so every path-type can be updated on each frame
+		static const unsigned int MAX_UPDATE_DELAY = 1;
 		static const unsigned int MAX_TEAM_SEARCHES = 10;
 		static const unsigned int NUM_SPEEDMOD_BINS = 20;
 		static const float MIN_SPEEDMOD_VALUE;
@@ -101,7 +103,9 @@ namespace QTPFS {
 		void InitNodeLayer(unsigned int layerNum, const SRectangle& rect);
 		void UpdateNodeLayer(unsigned int layerNum, const SRectangle& r, bool wantTesselation);
 
-		void ExecuteQueuedSearches(unsigned int pathType);
+		void ScheduleQueuedSearches(unsigned int pathType);
+		void ExecuteQueuedSearches(unsigned int minPathType, unsigned int pathTypeNum, unsigned int threadNum);
+		void FinalizeQueuedSearches(unsigned int pathType);
 		void QueueDeadPathSearches(unsigned int pathType);
 
 		unsigned int QueueSearch(
@@ -114,12 +118,12 @@ namespace QTPFS {
 			const bool synced
 		);
 
-		void ExecuteSearch(
-			PathSearchList& searches,
-			PathSearchListIt& searchesIt,
+		bool ExecuteSearch(
+			IPathSearch* search,
 			NodeLayer& nodeLayer,
 			PathCache& pathCache,
-			unsigned int pathType
+			unsigned int pathType,
+			unsigned int threadNum
 		);
 
 
@@ -133,8 +137,15 @@ namespace QTPFS {
 		std::map<unsigned int, unsigned int> pathTypes;
 		std::map<unsigned int, PathSearchTrace::Execution*> pathTraces;
 
-		// maps "hashes" of executed searches to the found paths
-		std::map<boost::uint64_t, IPath*> sharedPaths;
+		// searches picked by ScheduleQueuedSearches for this frame and
+		// whether each of them found a path, per path-type
+		std::vector< std::vector<PathSearchListIt> > scheduledSearches;
+		std::vector< std::vector<bool> > scheduledResults;
+
+		// maps "hashes" of executed searches to the found paths, per path-type
+		std::vector<SharedPathMap> sharedPaths;
+		// offset that identifies nodes as part of the current search, per path-type
+		std::vector<unsigned int> searchStateOffsets;
 
 		std::vector<unsigned int> numCurrExecutedSearches;
 		std::vector<unsigned int> numPrevExecutedSearches;
@@ -142,7 +153,6 @@ namespace QTPFS {
 
 		static NodeLayer* serializingNodeLayer;
 
-		unsigned int searchStateOffset;
 		unsigned int numTerrainChanges;
 		unsigned int numPathRequests;
 		unsigned int maxNumLayerNodes;
@@ -14,7 +14,7 @@
 #include "Sim/Misc/GlobalSynced.h"
 #endif
 
-QTPFS::binary_heap<QTPFS::INode*> QTPFS::PathSearch::openNodes;
+std::vector< QTPFS::binary_heap<QTPFS::INode*> > QTPFS::PathSearch::openNodeQueues;
 
 
 
@@ -39,15 +39,23 @@ void QTPFS::PathSearch::Initialize(
 	curNode = NULL;
 	nxtNode = NULL;
 	minNode = srcNode;
+
+	fwdMeetNode = NULL;
+	revMeetNode = NULL;
+	meetCost = QTPFS_POSITIVE_INFINITY;
 }
 
 bool QTPFS::PathSearch::Execute(
 	unsigned int searchStateOffset,
-	unsigned int searchMagicNumber
+	unsigned int searchMagicNumber,
+	unsigned int searchThreadNum
 ) {
 	searchState = searchStateOffset;
 	searchMagic = searchMagicNumber;
 
+	openNodes    = &openNodeQueues[searchThreadNum * 2 + 0];
+	openNodesRev = &openNodeQueues[searchThreadNum * 2 + 1];
+
 	haveFullPath = (srcNode == tgtNode);
 	havePartPath = false;
 
@@ -79,32 +87,37 @@ bool QTPFS::PathSearch::Execute(
 	}
 
 	{
-		openNodes.reset();
-		openNodes.push(srcNode);
+		openNodes->reset();
+		openNodes->push(srcNode);
 
-		UpdateNode(srcNode, NULL, 0.0f, (tgtPoint - srcPoint).Length() * hCostMult, srcNode->GetMoveCost());
+		UpdateNode(srcNode, NULL, searchState, 0.0f, (tgtPoint - srcPoint).Length() * hCostMult, srcNode->GetMoveCost());
 	}
 
-	while (!openNodes.empty()) {
-		IterateSearch(allNodes, ngbNodes);
+	if (bidirectional) {
+		haveFullPath = ExecuteBidirectional(allNodes, ngbNodes);
+		havePartPath = (minNode != srcNode);
+	} else {
+		while (!openNodes->empty()) {
+			IterateSearch(allNodes, ngbNodes);
 
-		#ifdef QTPFS_TRACE_PATH_SEARCHES
-		searchExec->AddIteration(searchIter);
-		searchIter.Clear();
-		#endif
+			#ifdef QTPFS_TRACE_PATH_SEARCHES
+			searchExec->AddIteration(searchIter);
+			searchIter.Clear();
+			#endif
 
-		haveFullPath = (curNode == tgtNode);
-		havePartPath = (minNode != srcNode);
+			haveFullPath = (curNode == tgtNode);
+			havePartPath = (minNode != srcNode);
 
-		if (haveFullPath) {
-			openNodes.reset();
+			if (haveFullPath) {
+				openNodes->reset();
+			}
 		}
 	}
 
 	if (srcBlocked) {
 		srcNode->SetMoveCost(QTPFS_POSITIVE_INFINITY);
 	}
-		
+
 
 	#ifdef QTPFS_SUPPORT_PARTIAL_SEARCHES
 	// adjust the target-point if we only got a partial result
@@ -118,11 +131,66 @@ bool QTPFS::PathSearch::Execute(
 	return (haveFullPath || havePartPath);
 }
 
+bool QTPFS::PathSearch::ExecuteBidirectional(
+	const std::vector<INode*>& allNodes,
+	      std::vector<INode*>& ngbNodes
+) {
+	// the target node is the root of the reverse search, so the
+	// same exception as for srcNode applies (a unidirectional search
+	// may also end inside an impassable target node)
+	const bool tgtBlocked = (tgtNode->GetMoveCost() == QTPFS_POSITIVE_INFINITY);
+
+	if (tgtBlocked) {
+		tgtNode->SetMoveCost(0.0f);
+	}
+
+	{
+		openNodesRev->reset();
+		openNodesRev->push(tgtNode);
+
+		UpdateNode(tgtNode, NULL, searchState + NODE_STATE_OFFSET, 0.0f, (srcPoint - tgtPoint).Length() * hCostMult, tgtNode->GetMoveCost());
+	}
+
+	while (!openNodes->empty()) {
+		// stop once neither frontier can still produce a cheaper
+		// meeting; an exhausted reverse frontier counts as infinite
+		// (but the forward search is allowed to run on so that a
+		// partial path can be found if the two never met)
+		const float fwdCost = openNodes->top()->GetPathCost(NODE_PATH_COST_F);
+		const float revCost = openNodesRev->empty()? QTPFS_POSITIVE_INFINITY: openNodesRev->top()->GetPathCost(NODE_PATH_COST_F);
+
+		if (fwdMeetNode != NULL && meetCost <= std::max(fwdCost, revCost))
+			break;
+
+		// always expand the smaller frontier
+		IterateSearch(allNodes, ngbNodes, (!openNodesRev->empty() && openNodesRev->size() < openNodes->size()));
+
+		#ifdef QTPFS_TRACE_PATH_SEARCHES
+		searchExec->AddIteration(searchIter);
+		searchIter.Clear();
+		#endif
+	}
+
+	openNodes->reset();
+	openNodesRev->reset();
+
+	if (tgtBlocked) {
+		tgtNode->SetMoveCost(QTPFS_POSITIVE_INFINITY);
+	}
+
+	if (fwdMeetNode == NULL)
+		return false;
+
+	LinkMeetingNodes();
+	return true;
+}
+
 
 
 void QTPFS::PathSearch::UpdateNode(
 	INode* nxt,
 	INode* cur,
+	unsigned int nodeState,
 	float gCost,
 	float hCost,
 	float mCost
@@ -134,7 +202,7 @@ void QTPFS::PathSearch::UpdateNode(
 	//     associated with it (and these costs can even be less
 	//     than 1) --> paths will not be optimal, but they could
 	//     not be anyway
-	nxt->SetSearchState(searchState | NODE_STATE_OPEN);
+	nxt->SetSearchState(nodeState | NODE_STATE_OPEN);
 	nxt->SetPrevNode(cur);
 	nxt->SetPathCost(NODE_PATH_COST_G, gCost);
 	nxt->SetPathCost(NODE_PATH_COST_H, hCost * hCostMult);
@@ -146,34 +214,91 @@ void QTPFS::PathSearch::UpdateNode(
 	#endif
 }
 
+void QTPFS::PathSearch::UpdateMeeting(INode* fwdNode, INode* revNode) {
+	// each node's g-cost covers the distance up to the edge through
+	// which it was entered, so add the segments across both nodes to
+	// the mid-point of the edge they share
+	const float3 fwdPoint = (fwdNode != srcNode)? fwdNode->GetNeighborEdgeMidPoint(fwdNode->GetPrevNode()): srcPoint;
+	const float3 revPoint = (revNode != tgtNode)? revNode->GetNeighborEdgeMidPoint(revNode->GetPrevNode()): tgtPoint;
+	const float3 midPoint = fwdNode->GetNeighborEdgeMidPoint(revNode);
+
+	const float fwdCost = fwdNode->GetPathCost(NODE_PATH_COST_G) + fwdNode->GetMoveCost() * (midPoint - fwdPoint).Length();
+	const float revCost = revNode->GetPathCost(NODE_PATH_COST_G) + revNode->GetMoveCost() * (revPoint - midPoint).Length();
+
+	// also rejects meetings through impassable nodes (infinite or NaN cost)
+	if (!((fwdCost + revCost) < meetCost))
+		return;
+
+	meetCost = fwdCost + revCost;
+	fwdMeetNode = fwdNode;
+	revMeetNode = revNode;
+}
+
+void QTPFS::PathSearch::LinkMeetingNodes() {
+	// reverse the chain of prev-nodes from the meeting point to
+	// tgtNode, so that TracePath and SmoothPath can walk the path
+	// from tgtNode back to srcNode as if it came from one search
+	INode* tmpNode = revMeetNode;
+	INode* newPrev = fwdMeetNode;
+
+	while (tmpNode != NULL) {
+		INode* oldPrev = tmpNode->GetPrevNode();
+
+		tmpNode->SetPrevNode(newPrev);
+
+		newPrev = tmpNode;
+		tmpNode = oldPrev;
+	}
+
+	assert(newPrev == tgtNode);
+}
+
 void QTPFS::PathSearch::IterateSearch(
 	const std::vector<INode*>& allNodes,
-	      std::vector<INode*>& ngbNodes
+	      std::vector<INode*>& ngbNodes,
+	bool reverse
 ) {
-	curNode = openNodes.top();
-	curNode->SetSearchState(searchState | NODE_STATE_CLOSED);
+	// the reverse search (only run when bidirectional) starts at
+	// tgtNode and heads for srcNode; its nodes get their own states
+	binary_heap<INode*>& openQueue = reverse? *openNodesRev: *openNodes;
+
+	INode* rootNode = reverse? tgtNode: srcNode;
+	INode* goalNode = reverse? srcNode: tgtNode;
+
+	const float3& rootPoint = reverse? tgtPoint: srcPoint;
+	const float3& goalPoint = reverse? srcPoint: tgtPoint;
+
+	const unsigned int ownState = searchState + (NODE_STATE_OFFSET * reverse);
+	const unsigned int oppState = searchState + (NODE_STATE_OFFSET * (!reverse));
+
+	curNode = openQueue.top();
+	curNode->SetSearchState(ownState | NODE_STATE_CLOSED);
 	curNode->SetMagicNumber(searchMagic);
 
-	openNodes.pop();
+	openQueue.pop();
 
 	#ifdef QTPFS_DEBUG_QUEUE
-	openNodes.check_heap_property(0);
+	openQueue.check_heap_property(0);
 	#endif
 
 	#ifdef QTPFS_TRACE_PATH_SEARCHES
 	searchIter.SetPoppedNodeIdx(curNode->zmin() * gs->mapx + curNode->xmin());
 	#endif
 
-	if (curNode != srcNode)
+	if (curNode != rootNode)
 		curPoint = curNode->GetNeighborEdgeMidPoint(curNode->GetPrevNode());
-	if (curNode == tgtNode)
+	else
+		curPoint = rootPoint;
+
+	if (curNode == goalNode)
 		return;
 	if (curNode->GetMoveCost() == QTPFS_POSITIVE_INFINITY)
 		return;
 
 	#ifdef QTPFS_SUPPORT_PARTIAL_SEARCHES
 	// remember the node with lowest h-cost in case the search fails to reach tgtNode
-	if (curNode->GetPathCost(NODE_PATH_COST_H) < minNode->GetPathCost(NODE_PATH_COST_H))
+	// (only nodes reached from srcNode can serve as the end of a partial path)
+	if (!reverse && curNode->GetPathCost(NODE_PATH_COST_H) < minNode->GetPathCost(NODE_PATH_COST_H))
 		minNode = curNode;
 	#endif
 
@@ -224,27 +349,43 @@ void QTPFS::PathSearch::IterateSearch(
 
 		assert(curNode->GetNeighborEdgeMidPoint(nxtNode) == nxtNode->GetNeighborEdgeMidPoint(curNode));
 
-		const bool isCurrent = (nxtNode->GetSearchState() >= searchState);
-		const bool isClosed = ((nxtNode->GetSearchState() & 1) == NODE_STATE_CLOSED);
+		// NOTE:
+		//     nodes of earlier searches always have lower states, and those
+		//     reached by the opposite direction of a bidirectional search are
+		//     left alone (they only mark a place where both searches meet)
+		const unsigned int nxtState = nxtNode->GetSearchState();
+
+		const bool isCurrent = (nxtState >= ownState && nxtState < (ownState + NODE_STATE_OFFSET));
+		const bool isOpposed = (bidirectional && nxtState >= oppState && nxtState < (oppState + NODE_STATE_OFFSET));
+		const bool isClosed = ((nxtState & 1) == NODE_STATE_CLOSED);
+
+		if (isOpposed) {
+			if (reverse) {
+				UpdateMeeting(nxtNode, curNode);
+			} else {
+				UpdateMeeting(curNode, nxtNode);
+			}
+			continue;
+		}
 
 		const float mCost = curNode->GetPathCost(NODE_PATH_COST_M) + curNode->GetMoveCost();
 		const float gCost = curNode->GetPathCost(NODE_PATH_COST_G) + curNode->GetMoveCost() * (nxtPoint - curPoint).Length();
-		const float hCost = (tgtPoint - nxtPoint).Length() * hWeight;
+		const float hCost = (goalPoint - nxtPoint).Length() * hWeight;
 
 		if (!isCurrent) {
 			// at this point, we know that <nxtNode> is either
 			// not from the current search (!current) or (if it
 			// is) already placed in the open queue
-			UpdateNode(nxtNode, curNode, gCost, hCost, mCost);
+			UpdateNode(nxtNode, curNode, ownState, gCost, hCost, mCost);
 
 			#ifdef QTPFS_TRACE_PATH_SEARCHES
 			searchIter.AddPushedNodeIdx(nxtNode->zmin() * gs->mapx + nxtNode->xmin());
 			#endif
 
-			openNodes.push(nxtNode);
+			openQueue.push(nxtNode);
 
 			#ifdef QTPFS_DEBUG_QUEUE
-			openNodes.check_heap_property(0);
+			openQueue.check_heap_property(0);
 			#endif
 			continue;
 		}
@@ -254,17 +395,17 @@ void QTPFS::PathSearch::IterateSearch(
 		if (gCost >= nxtNode->GetPathCost(NODE_PATH_COST_G))
 			continue;
 
-		UpdateNode(nxtNode, curNode, gCost, hCost, mCost);
+		UpdateNode(nxtNode, curNode, ownState, gCost, hCost, mCost);
 
 		// nxtNode was already marked open, restore ordering
 		// (changing the f-cost of an OPEN node messes up the
 		// queue's internal consistency; a pushed node remains
 		// OPEN until it gets popped)
-		openNodes.resort(nxtNode);
+		openQueue.resort(nxtNode);
 	}
 
 	#ifdef QTPFS_DEBUG_QUEUE
-	openNodes.check_heap_property(0);
+	openQueue.check_heap_property(0);
 	#endif
 }
 
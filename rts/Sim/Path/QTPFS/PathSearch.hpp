@@ -36,16 +36,27 @@ namespace QTPFS {
 		};
 
 		struct Execution {
-			Execution(unsigned int f): searchFrame(f) {}
+			Execution(unsigned int f): numExpandedNodes(0), numPushedNodes(0), searchFrame(f) {}
 			~Execution() { iterations.clear(); }
 
-			void AddIteration(const Iteration& iter) { iterations.push_back(iter); }
+			void AddIteration(const Iteration& iter) {
+				iterations.push_back(iter);
+
+				// every iteration pops (expands) exactly one node
+				numExpandedNodes += 1;
+				numPushedNodes += (iter.GetNodeIndices().size() - 1);
+			}
 			const std::list<Iteration>& GetIterations() const { return iterations; }
 
 			unsigned int GetFrame() const { return searchFrame; }
+			unsigned int GetNumExpandedNodes() const { return numExpandedNodes; }
+			unsigned int GetNumPushedNodes() const { return numPushedNodes; }
 		private:
 			std::list<Iteration> iterations;
 
+			unsigned int numExpandedNodes;
+			unsigned int numPushedNodes;
+
 			// sim-frame at which the search was executed
 			unsigned int searchFrame;
 		};
@@ -77,14 +88,20 @@ namespace QTPFS {
 			const float3& sourcePoint,
 			const float3& targetPoint
 		) = 0;
+		// searches executed concurrently (on different node-layers)
+		// must each be given their own thread-number
 		virtual bool Execute(
 			unsigned int searchStateOffset = 0,
-			unsigned int searchMagicNumber = 0
+			unsigned int searchMagicNumber = 0,
+			unsigned int searchThreadNum = 0
 		) = 0;
 		virtual void Finalize(IPath* path) = 0;
 		virtual void SharedFinalize(const IPath* srcPath, IPath* dstPath) {}
 		virtual PathSearchTrace::Execution* GetExecutionTrace() { return NULL; }
 
+		// number of node-states this search claims past its offset
+		virtual unsigned int GetNumSearchStates() const { return NODE_STATE_OFFSET; }
+
 		virtual const boost::uint64_t GetHash(unsigned int N, unsigned int k) const = 0;
 
 		void SetID(unsigned int n) { searchID = n; }
@@ -104,7 +121,7 @@ namespace QTPFS {
 
 	struct PathSearch: public IPathSearch {
 	public:
-		PathSearch(unsigned int pathSearchType)
+		PathSearch(unsigned int pathSearchType, bool bidirectionalSearch = false)
 			: IPathSearch(pathSearchType)
 			, nodeLayer(NULL)
 			, pathCache(NULL)
@@ -113,12 +130,18 @@ namespace QTPFS {
 			, curNode(NULL)
 			, nxtNode(NULL)
 			, minNode(NULL)
+			, openNodes(NULL)
+			, openNodesRev(NULL)
+			, fwdMeetNode(NULL)
+			, revMeetNode(NULL)
 			, searchExec(NULL)
+			, bidirectional(bidirectionalSearch)
 			, haveFullPath(false)
 			, havePartPath(false)
 			, hCostMult(0.0f)
+			, meetCost(0.0f)
 			{}
-		~PathSearch() { openNodes.reset(); }
+		~PathSearch() {}
 
 		void Initialize(
 			NodeLayer* layer,
@@ -128,31 +151,50 @@ namespace QTPFS {
 		);
 		bool Execute(
 			unsigned int searchStateOffset = 0,
-			unsigned int searchMagicNumber = 0
+			unsigned int searchMagicNumber = 0,
+			unsigned int searchThreadNum = 0
 		);
 		void Finalize(IPath* path);
 		void SharedFinalize(const IPath* srcPath, IPath* dstPath);
 		PathSearchTrace::Execution* GetExecutionTrace() { return searchExec; }
 
+		// a bidirectional search marks the nodes it reaches from
+		// the target with states one offset above its own
+		unsigned int GetNumSearchStates() const { return (NODE_STATE_OFFSET * (1 + bidirectional)); }
+
 		const boost::uint64_t GetHash(unsigned int N, unsigned int k) const;
 
-		static void InitGlobalQueue(unsigned int n) { openNodes.reserve(n); }
-		static void FreeGlobalQueue() { openNodes.clear(); }
+		static void InitGlobalQueues(unsigned int n, unsigned int numThreads) {
+			openNodeQueues.resize(numThreads * 2);
+
+			for (unsigned int i = 0; i < openNodeQueues.size(); i++) {
+				openNodeQueues[i].reserve(n);
+			}
+		}
+		static void FreeGlobalQueues() { openNodeQueues.clear(); }
 
 	private:
-		void IterateSearch(
+		bool ExecuteBidirectional(
 			const std::vector<INode*>& allNodes,
 			      std::vector<INode*>& ngbNodes
 		);
+		void IterateSearch(
+			const std::vector<INode*>& allNodes,
+			      std::vector<INode*>& ngbNodes,
+			bool reverse = false
+		);
 		void TracePath(IPath* path);
 		void SmoothPath(IPath* path);
 		void UpdateNode(
 			INode* nxtNode,
 			INode* curNode,
+			unsigned int nodeState,
 			float gCost,
 			float hCost,
 			float mCost
 		);
+		void UpdateMeeting(INode* fwdNode, INode* revNode);
+		void LinkMeetingNodes();
 		void UpdateQueue();
 
 		NodeLayer* nodeLayer;
@@ -165,18 +207,31 @@ namespace QTPFS {
 		INode *curNode, *nxtNode;
 		INode *minNode;
 
+		// the queues of the thread executing us (set by Execute)
+		binary_heap<INode*>* openNodes;
+		binary_heap<INode*>* openNodesRev;
+
+		// the pair of nodes (reached from the source and from the
+		// target respectively) through which the cheapest path found
+		// by a bidirectional search so far passes
+		INode *fwdMeetNode, *revMeetNode;
+
 		// not used unless QTPFS_TRACE_PATH_SEARCHES is defined
 		PathSearchTrace::Execution* searchExec;
 		PathSearchTrace::Iteration searchIter;
 
-		// global queue: allocated once, re-used by all searches without clear()'s
-		// this relies on INode::operator< to sort the INode*'s by increasing f-cost
-		static binary_heap<INode*> openNodes;
+		// global queues: allocated once, re-used by all searches without clear()'s
+		// these rely on INode::operator< to sort the INode*'s by increasing f-cost
+		// (each thread has a pair, the second one holds the nodes reached from the
+		// target in bidirectional searches)
+		static std::vector< binary_heap<INode*> > openNodeQueues;
 
+		bool bidirectional;
 		bool haveFullPath;
 		bool havePartPath;
 
 		float hCostMult;
+		float meetCost;
 	};
 };
 
@@ -5,6 +5,7 @@
 #include <fstream>
 #include <stdexcept>
 #include <cassert>
+#include <cstring>
 #include <boost/cstdint.hpp>
 
 #include "ExplosionGenerator.h"
@@ -17,6 +18,7 @@
 #include "Rendering/GL/myGL.h"
 #include "Rendering/Textures/ColorMap.h"
 #include "Rendering/Textures/TextureAtlas.h"
+#include "Sim/Projectiles/Projectile.h"
 #include "Sim/Projectiles/ProjectileHandler.h"
 #include "Sim/Projectiles/Unsynced/BubbleProjectile.h"
 #include "Sim/Projectiles/Unsynced/DirtProjectile.h"
@@ -429,121 +431,193 @@ bool CStdExplosionGenerator::Explosion(
 
 
 
-void CCustomExplosionGenerator::ExecuteExplosionCode(const char* code, float damage, char* instance, int spawnIndex, const float3& dir, bool synced)
+template<typename T>
+static T ReadExplosionCode(const std::string& code, size_t& pos)
+{
+	// operands are not aligned within the byte-code
+	T v;
+	memcpy(&v, &code[pos], sizeof(T));
+	pos += sizeof(T);
+	return v;
+}
+
+void CCustomExplosionGenerator::DecodeExplosionCode(const std::string& code, std::vector<ExplosionOp>& ops)
+{
+	ops.clear();
+	ops.reserve(code.size() / 3);
+
+	// whether val is zero when the next op runs, and whether
+	// the last decoded op is an OP_ADD that ran with val zero
+	bool valIsZero = true;
+	bool addToZero = false;
+
+	for (size_t pos = 0; pos < code.size(); ) {
+		ExplosionOp op;
+		op.op = code[pos++];
+
+		switch (op.op) {
+			case OP_END: {
+				break;
+			}
+			case OP_STOREI:
+			case OP_STOREF:
+			case OP_STOREC:
+			case OP_STOREP:
+			case OP_DIR: {
+				op.index = ReadExplosionCode<boost::uint16_t>(code, pos);
+				break;
+			}
+			case OP_LOADP: {
+				op.ptr = ReadExplosionCode<void*>(code, pos);
+				break;
+			}
+			case OP_YANK:
+			case OP_MULTIPLY:
+			case OP_ADDBUFF:
+			case OP_POWBUFF: {
+				op.index = ReadExplosionCode<int>(code, pos);
+				break;
+			}
+			default: {
+				op.value = ReadExplosionCode<float>(code, pos);
+				break;
+			}
+		}
+
+		if (op.op == OP_ADD && addToZero) {
+			// fold constant chains like "1 2 r3" into "3 r3"; only
+			// done where val is zero, since ((0 + a) + b) == (a + b)
+			// but ((val + a) + b) need not equal (val + (a + b))
+			ops.back().value += op.value;
+			continue;
+		}
+
+		addToZero = (op.op == OP_ADD && valIsZero);
+
+		switch (op.op) {
+			case OP_STOREI:
+			case OP_STOREF:
+			case OP_STOREC:
+			case OP_YANK: {
+				valIsZero = true;
+				break;
+			}
+			case OP_LOADP:
+			case OP_STOREP:
+			case OP_DIR: {
+				// these do not touch val
+				break;
+			}
+			default: {
+				valIsZero = false;
+				break;
+			}
+		}
+
+		ops.push_back(op);
+
+		if (op.op == OP_END) {
+			break;
+		}
+	}
+
+	if (ops.empty() || ops.back().op != OP_END) {
+		ops.push_back(ExplosionOp());
+	}
+}
+
+void CCustomExplosionGenerator::ExecuteExplosionCode(const ExplosionOp* code, float damage, char* instance, int spawnIndex, const float3& dir, bool synced)
 {
 	float val = 0.0f;
 	void* ptr = NULL;
 	float buffer[16];
 
-	for (;;) {
-		switch (*(code++)) {
+	// the ops are dense, so this compiles to a jump table
+	for (;; code++) {
+		switch (code->op) {
 			case OP_END: {
 				return;
 			}
 			case OP_STOREI: {
-				boost::uint16_t offset = *(boost::uint16_t*) code;
-				code += 2;
-				*(int*) (instance + offset) = (int) val;
+				*(int*) (instance + code->index) = (int) val;
 				val = 0.0f;
 				break;
 			}
 			case OP_STOREF: {
-				boost::uint16_t offset = *(boost::uint16_t*) code;
-				code += 2;
-				*(float*) (instance + offset) = val;
+				*(float*) (instance + code->index) = val;
 				val = 0.0f;
 				break;
 			}
 			case OP_STOREC: {
-				boost::uint16_t offset = *(boost::uint16_t*) code;
-				code += 2;
-				*(unsigned char*) (instance + offset) = (int) val;
+				*(unsigned char*) (instance + code->index) = (int) val;
 				val = 0.0f;
 				break;
 			}
 			case OP_ADD: {
-				val += *(float*) code;
-				code += 4;
+				val += code->value;
 				break;
 			}
 			case OP_RAND: {
 				if (synced) {
-					val += gs->randFloat() * (*(float*) code);
+					val += gs->randFloat() * code->value;
 				} else {
-					val += gu->usRandFloat() * (*(float*) code);
+					val += gu->usRandFloat() * code->value;
 				}
-
-				code += 4;
 				break;
 			}
 			case OP_DAMAGE: {
-				val += damage * (*(float*) code);
-				code += 4;
+				val += damage * code->value;
 				break;
 			}
 			case OP_INDEX: {
-				val += spawnIndex * (*(float*) code);
-				code += 4;
+				val += spawnIndex * code->value;
 				break;
 			}
 			case OP_LOADP: {
-				ptr = *(void**) code;
-				code += sizeof(void*);
+				ptr = code->ptr;
 				break;
 			}
 			case OP_STOREP: {
-				boost::uint16_t offset = *(boost::uint16_t*) code;
-				code += 2;
-				*(void**) (instance + offset) = ptr;
+				*(void**) (instance + code->index) = ptr;
 				ptr = NULL;
 				break;
 			}
 			case OP_DIR: {
-				boost::uint16_t offset = *(boost::uint16_t*) code;
-				code += 2;
-				*(float3*) (instance + offset) = dir;
+				*(float3*) (instance + code->index) = dir;
 				break;
 			}
 			case OP_SAWTOOTH: {
 				// this translates to modulo except it works with floats
-				val -= (*(float*) code) * floor(val / (*(float*) code));
-				code += 4;
+				val -= code->value * floor(val / code->value);
 				break;
 			}
 			case OP_DISCRETE: {
-				val = (*(float*) code) * floor(val / (*(float*) code));
-				code += 4;
+				val = code->value * floor(val / code->value);
 				break;
 			}
 			case OP_SINE: {
-				val = (*(float*) code) * sin(val);
-				code += 4;
+				val = code->value * sin(val);
 				break;
 			}
 			case OP_YANK: {
-				buffer[(*(int*) code)] = val;
+				buffer[code->index] = val;
 				val = 0;
-				code += 4;
 				break;
 			}
 			case OP_MULTIPLY: {
-				val *= buffer[(*(int*) code)];
-				code += 4;
+				val *= buffer[code->index];
 				break;
 			}
 			case OP_ADDBUFF: {
-				val += buffer[(*(int*) code)];
-				code += 4;
+				val += buffer[code->index];
 				break;
 			}
 			case OP_POW: {
-				val = pow(val, (*(float*) code));
-				code += 4;
+				val = pow(val, code->value);
 				break;
 			}
 			case OP_POWBUFF: {
-				val = pow(val, buffer[(*(int*) code)]);
-				code += 4;
+				val = pow(val, buffer[code->index]);
 				break;
 			}
 			default: {
@@ -774,6 +848,8 @@ unsigned int CCustomExplosionGenerator::Load(CExplosionGeneratorHandler* handler
 				psi.flags |= SPW_SYNCED;
 			}
 
+			psi.pooled = psi.projectileClass->IsSubclassOf(CProjectile::StaticClass());
+
 			string code;
 			map<string, string> props;
 			map<string, string>::const_iterator propIt;
@@ -787,8 +863,7 @@ unsigned int CCustomExplosionGenerator::Load(CExplosionGeneratorHandler* handler
 			}
 
 			code += (char)OP_END;
-			psi.code.resize(code.size());
-			copy(code.begin(), code.end(), psi.code.begin());
+			DecodeExplosionCode(code, psi.code);
 
 			cegData.projectileSpawn.push_back(psi);
 		}
@@ -923,10 +998,27 @@ bool CCustomExplosionGenerator::Explosion(
 			continue;
 		}
 
+		// everything but the instances is the same for all of them
+		const creg::ClassBinder* binder = psi.projectileClass->binder;
+		const ExplosionOp* code = &psi.code[0];
+		const bool synced = ((psi.flags & SPW_SYNCED) != 0);
+
+		// Init can draw random numbers too, so each instance
+		// is fully set up before the next one is created
 		for (int c = 0; c < psi.count; c++) {
-			CExpGenSpawnable* projectile = (CExpGenSpawnable*) (psi.projectileClass)->CreateInstance();
+			// same as creg::Class::CreateInstance, except that projectiles
+			// come from the pool they are returned to when deleted
+			void* instance = psi.pooled?
+				CProjectile::operator new(binder->size):
+				::operator new(binder->size);
+
+			if (binder->constructor) {
+				binder->constructor(instance);
+			}
+
+			CExpGenSpawnable* projectile = static_cast<CExpGenSpawnable*>(instance);
 
-			ExecuteExplosionCode(&psi.code[0], damage, (char*) projectile, c, dir, (psi.flags & SPW_SYNCED) != 0);
+			ExecuteExplosionCode(code, damage, (char*) projectile, c, dir, synced);
 			projectile->Init(pos, owner);
 		}
 	}
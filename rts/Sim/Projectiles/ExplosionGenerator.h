@@ -120,27 +120,55 @@ class CCustomExplosionGenerator: public CStdExplosionGenerator
 	CR_DECLARE(CCustomExplosionGenerator);
 
 protected:
+	/**
+	 * One instruction of the explosion script code, decoded from the
+	 * byte-code ParseExplosionCode emits so that no operand has to be
+	 * read (unaligned) from the code stream when the script is executed.
+	 */
+	struct ExplosionOp {
+		ExplosionOp()
+			: op(OP_END)
+			, index(0)
+			, value(0.0f)
+			, ptr(NULL)
+		{}
+
+		int op;
+		/// member offset for the stores and OP_DIR, buffer index for y/x/a/q
+		int index;
+		/// operand of the arithmetic ops
+		float value;
+		/// operand of OP_LOADP
+		void* ptr;
+	};
+
 	struct ProjectileSpawnInfo {
 		ProjectileSpawnInfo()
 			: projectileClass(NULL)
 			, count(0)
 			, flags(0)
+			, pooled(false)
 		{}
 		ProjectileSpawnInfo(const ProjectileSpawnInfo& psi)
 			: projectileClass(psi.projectileClass)
 			, code(psi.code)
 			, count(psi.count)
 			, flags(psi.flags)
+			, pooled(psi.pooled)
 		{}
 
 		creg::Class* projectileClass;
 
-		/// parsed explosion script code
-		std::vector<char> code;
+		/// decoded explosion script code, ends with OP_END
+		std::vector<ExplosionOp> code;
 
 		/// number of projectiles spawned of this type
 		int count;
 		unsigned int flags;
+
+		/// true if projectileClass derives from CProjectile, whose
+		/// instances are allocated from (and deleted into) its pool
+		bool pooled;
 	};
 
 	// TODO: Handle ground flashes with more flexibility like the projectiles
@@ -183,7 +211,8 @@ protected:
 	std::vector<IExplosionGenerator*> spawnExplGens;
 
 	void ParseExplosionCode(ProjectileSpawnInfo* psi, const int offset, const boost::shared_ptr<creg::IType> type, const std::string& script, std::string& code);
-	void ExecuteExplosionCode(const char* code, float damage, char* instance, int spawnIndex, const float3& dir, bool synced);
+	static void DecodeExplosionCode(const std::string& code, std::vector<ExplosionOp>& ops);
+	static void ExecuteExplosionCode(const ExplosionOp* code, float damage, char* instance, int spawnIndex, const float3& dir, bool synced);
 
 public:
 	CCustomExplosionGenerator(): CStdExplosionGenerator() {}
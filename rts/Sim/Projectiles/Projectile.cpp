@@ -9,6 +9,7 @@
 #include "Sim/Projectiles/ProjectileHandler.h"
 #include "Sim/Misc/QuadField.h"
 #include "Sim/Units/Unit.h"
+#include "System/MemPool.h"
 
 CR_BIND_DERIVED(CProjectile, CExpGenSpawnable, );
 
@@ -29,6 +30,7 @@ CR_REG_METADATA(CProjectile,
 	CR_MEMBER(collisionFlags),
 
 	CR_MEMBER(quadFieldCellCoors),
+	CR_MEMBER(quadFieldCellIdx),
 
 	CR_MEMBER(mygravity),
 	CR_MEMBER_BEGINFLAG(CM_Config),
@@ -43,6 +45,9 @@ CR_REG_METADATA(CProjectile,
 bool CProjectile::inArray = false;
 CVertexArray* CProjectile::va = NULL;
 
+static CSlabMemPool projectileMemPool;
+
+
 
 CProjectile::CProjectile():
 	synced(false),
@@ -57,7 +62,8 @@ CProjectile::CProjectile():
 	mygravity(mapInfo? mapInfo->map.gravity: 0.0f),
 	ownerId(-1),
 	projectileType(-1U),
-	collisionFlags(0)
+	collisionFlags(0),
+	quadFieldCellIdx(-1)
 {
 	GML_GET_TICKS(lastProjUpdate);
 }
@@ -76,7 +82,8 @@ CProjectile::CProjectile(const float3& pos, const float3& spd, CUnit* owner, boo
 	mygravity(mapInfo? mapInfo->map.gravity: 0.0f),
 	ownerId(-1),
 	projectileType(-1U),
-	collisionFlags(0)
+	collisionFlags(0),
+	quadFieldCellIdx(-1)
 {
 	Init(ZeroVector, owner);
 	GML_GET_TICKS(lastProjUpdate);
@@ -90,6 +97,21 @@ void CProjectile::Detach() {
 	CExpGenSpawnable::Detach();
 }
 
+void* CProjectile::operator new(size_t size)
+{
+	// unsynced projectiles can be created and deleted by the render thread
+	GML_STDMUTEX_LOCK(projpool); // operator new
+
+	return projectileMemPool.Alloc(size);
+}
+
+void CProjectile::operator delete(void* p, size_t size)
+{
+	GML_STDMUTEX_LOCK(projpool); // operator delete
+
+	projectileMemPool.Free(p, size);
+}
+
 CProjectile::~CProjectile() {
 	// UNSYNCED
 	assert(!synced || detached);
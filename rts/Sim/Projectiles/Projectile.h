@@ -31,6 +31,13 @@ public:
 	virtual ~CProjectile();
 	virtual void Detach();
 
+	/// projectiles of all classes come from a pool, see CSlabMemPool
+	static void* operator new(size_t size);
+	static void operator delete(void* p, size_t size);
+	/// creg constructs in place (declaring the above hides the global one)
+	static void* operator new(size_t size, void* p) { return p; }
+	static void operator delete(void* p, void* q) {}
+
 	virtual void Collision();
 	virtual void Collision(CUnit* unit);
 	virtual void Collision(CFeature* feature);
@@ -55,8 +62,8 @@ public:
 	void SetQuadFieldCellCoors(const int2& cell) { quadFieldCellCoors = cell; }
 	int2 GetQuadFieldCellCoors() const { return quadFieldCellCoors; }
 
-	void SetQuadFieldCellIter(const std::list<CProjectile*>::iterator& it) { quadFieldCellIter = it; }
-	const std::list<CProjectile*>::iterator& GetQuadFieldCellIter() { return quadFieldCellIter; }
+	void SetQuadFieldCellIdx(int idx) { quadFieldCellIdx = idx; }
+	int GetQuadFieldCellIdx() const { return quadFieldCellIdx; }
 
 	unsigned int GetProjectileType() const { return projectileType; }
 	unsigned int GetCollisionFlags() const { return collisionFlags; }
@@ -91,7 +98,7 @@ protected:
 	unsigned int collisionFlags;
 
 	int2 quadFieldCellCoors;
-	std::list<CProjectile*>::iterator quadFieldCellIter;
+	int quadFieldCellIdx; ///< index into the projectile bucket of our quad
 };
 
 #endif /* PROJECTILE_H */
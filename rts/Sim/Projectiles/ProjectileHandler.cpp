@@ -16,6 +16,7 @@
 #include "Sim/Misc/CollisionHandler.h"
 #include "Sim/Misc/CollisionVolume.h"
 #include "Sim/Misc/QuadField.h"
+#include "Sim/Misc/SimScheduler.h"
 #include "Sim/Misc/TeamHandler.h"
 #include "Sim/Projectiles/Unsynced/FlyingPiece.h"
 #include "Sim/Projectiles/Unsynced/GfxProjectile.h"
@@ -25,8 +26,12 @@
 #include "System/EventHandler.h"
 #include "System/Log/ILog.h"
 #include "System/TimeProfiler.h"
-#include "System/creg/STL_Map.h"
+#include "System/myMath.h"
+#include "System/creg/STL_Deque.h"
 #include "System/creg/STL_List.h"
+#include "System/creg/STL_Map.h"
+
+#include <boost/bind.hpp>
 
 // reserve 5% of maxNanoParticles for important stuff such as capture and reclaim other teams' units
 #define NORMAL_NANO_PRIO 0.95f
@@ -84,6 +89,8 @@ void projdetach::Detach(CProjectile *p) { p->Detach(); }
 //////////////////////////////////////////////////////////////////////
 
 CProjectileHandler::CProjectileHandler()
+	: hitSearchProjectiles(NULL)
+	, hitSearchQuadFieldChanges(0)
 {
 	maxParticles     = configHandler->GetInt("MaxParticles");
 	maxNanoParticles = configHandler->GetInt("MaxNanoParticles");
@@ -101,6 +108,9 @@ CProjectileHandler::CProjectileHandler()
 
 	maxUsedSyncedID = freeSyncedIDs.size();
 	maxUsedUnsyncedID = freeUnsyncedIDs.size();
+
+	syncedProjectileIDs.resize(maxUsedSyncedID + 1, ProjectileMapPair(NULL, -1));
+	unsyncedProjectileIDs.resize(maxUsedUnsyncedID + 1, ProjectileMapPair(NULL, -1));
 }
 
 CProjectileHandler::~CProjectileHandler()
@@ -165,9 +175,17 @@ void CProjectileHandler::PostLoad()
 
 
 
-void CProjectileHandler::UpdateProjectileContainer(ProjectileContainer& pc, bool synced) {
-	ProjectileContainer::iterator pci = pc.begin();
+void CProjectileHandler::DestroyProjectileID(ProjectileMap& pm, std::deque<int>& freeIDs, int id)
+{
+	const ProjectileMapPair pp = pm[id];
+
+	eventHandler.ProjectileDestroyed(pp.first, pp.second);
 
+	pm[id] = ProjectileMapPair(NULL, -1);
+	freeIDs.push_back(id);
+}
+
+void CProjectileHandler::UpdateProjectileContainer(ProjectileContainer& pc, bool synced) {
 	#define VECTOR_SANITY_CHECK(v)                              \
 		assert(!math::isnan(v.x) && !math::isinf(v.x)); \
 		assert(!math::isnan(v.y) && !math::isinf(v.y)); \
@@ -183,38 +201,33 @@ void CProjectileHandler::UpdateProjectileContainer(ProjectileContainer& pc, bool
 		VECTOR_SANITY_CHECK(p->pos);   \
 		MAPPOS_SANITY_CHECK(p->pos);
 
-	while (pci != pc.end()) {
-		CProjectile* p = *pci;
+	// the living projectiles are moved to the front in one pass, keeping
+	// their order; projectiles added by Update calls are appended to pc
+	// and still updated this frame (pc.size() is re-read every iteration)
+	size_t numLiving = 0;
+
+	for (size_t i = 0; i < pc.size(); i++) {
+		CProjectile* p = pc[i];
 
 		if (p->deleteMe) {
-			ProjectileMap::iterator pIt;
+			// keep no dangling pointer around until compaction is done
+			pc[i] = NULL;
 
 			if (p->synced) {
-				//! iterator is always valid
-				pIt = syncedProjectileIDs.find(p->id);
-
-				eventHandler.ProjectileDestroyed((pIt->second).first, (pIt->second).second);
-				syncedProjectileIDs.erase(pIt);
-
-				freeSyncedIDs.push_back(p->id);
+				DestroyProjectileID(syncedProjectileIDs, freeSyncedIDs, p->id);
 
 				//! push_back this projectile for deletion
-				pci = pc.erase_delete_synced(pci);
+				pc.delete_synced(p);
 			} else {
 #if UNSYNCED_PROJ_NOEVENT
 				eventHandler.UnsyncedProjectileDestroyed(p);
 #else
-				pIt = unsyncedProjectileIDs.find(p->id);
-
-				eventHandler.ProjectileDestroyed((pIt->second).first, (pIt->second).second);
-				unsyncedProjectileIDs.erase(pIt);
-
-				freeUnsyncedIDs.push_back(p->id);
+				DestroyProjectileID(unsyncedProjectileIDs, freeUnsyncedIDs, p->id);
 #endif
 #if DETACH_SYNCED
-				pci = pc.erase_detach(pci);
+				pc.detach_unsynced(p);
 #else
-				pci = pc.erase_delete(pci);
+				pc.delete_unsynced(p);
 #endif
 			}
 		} else {
@@ -226,9 +239,11 @@ void CProjectileHandler::UpdateProjectileContainer(ProjectileContainer& pc, bool
 			PROJECTILE_SANITY_CHECK(p);
 			GML_GET_TICKS(p->lastProjUpdate);
 
-			++pci;
+			pc[numLiving++] = p;
 		}
 	}
+
+	pc.resize(numLiving);
 }
 
 
@@ -324,8 +339,8 @@ void CProjectileHandler::AddProjectile(CProjectile* p)
 	// already initialized?
 	assert(p->id < 0);
 	
-	std::list<int>* freeIDs = NULL;
-	std::map<int, ProjectileMapPair>* proIDs = NULL;
+	std::deque<int>* freeIDs = NULL;
+	ProjectileMap* proIDs = NULL;
 	int* maxUsedID = NULL;
 	int newID = 0;
 
@@ -366,6 +381,10 @@ void CProjectileHandler::AddProjectile(CProjectile* p)
 
 	ProjectileMapPair pp(p, p->owner() ? p->owner()->allyteam : -1);
 
+	if (newID >= int(proIDs->size())) {
+		proIDs->resize(newID + 1, ProjectileMapPair(NULL, -1));
+	}
+
 	p->id = newID;
 	(*proIDs)[p->id] = pp;
 
@@ -375,36 +394,51 @@ void CProjectileHandler::AddProjectile(CProjectile* p)
 
 
 
-void CProjectileHandler::CheckUnitCollisions(
+static bool CanCollideWithUnit(const CProjectile* p, const CUnit* attacker, const CUnit* unit)
+{
+	// if this unit fired this projectile, always ignore
+	if (attacker == unit) {
+		return false;
+	}
+
+	if (p->GetCollisionFlags() & Collision::NOFRIENDLIES) {
+		if (attacker != NULL && (unit->allyteam == attacker->allyteam)) { return false; }
+	}
+	if (p->GetCollisionFlags() & Collision::NOENEMIES) {
+		if (attacker != NULL && (unit->allyteam != attacker->allyteam)) { return false; }
+	}
+	if (p->GetCollisionFlags() & Collision::NONEUTRALS) {
+		if (unit->IsNeutral()) { return false; }
+	}
+
+	return true;
+}
+
+static bool CanCollideWithFeature(const CFeature* feature)
+{
+	// geothermals do not have a collision volume, skip them
+	return (feature->blocking && !feature->def->geoThermal);
+}
+
+
+bool CProjectileHandler::CheckUnitCollisions(
 	CProjectile* p,
-	std::vector<CUnit*>& tempUnits,
-	CUnit** endUnit,
+	const std::vector<CUnit*>& tempUnits,
 	const float3& ppos0,
 	const float3& ppos1)
 {
 	CollisionQuery q;
 
-	for (CUnit** ui = &tempUnits[0]; ui != endUnit; ++ui) {
+	for (std::vector<CUnit*>::const_iterator ui = tempUnits.begin(); ui != tempUnits.end(); ++ui) {
 		CUnit* unit = *ui;
 
 		const CUnit* attacker = p->owner();
 		const bool raytraced = (unit->collisionVolume->GetTestType() == CollisionVolume::COLVOL_HITTEST_CONT);
 
-		// if this unit fired this projectile, always ignore
-		if (attacker == unit) {
+		if (!CanCollideWithUnit(p, attacker, unit)) {
 			continue;
 		}
 
-		if (p->GetCollisionFlags() & Collision::NOFRIENDLIES) {
-			if (attacker != NULL && (unit->allyteam == attacker->allyteam)) { continue; }
-		}
-		if (p->GetCollisionFlags() & Collision::NOENEMIES) {
-			if (attacker != NULL && (unit->allyteam != attacker->allyteam)) { continue; }
-		}
-		if (p->GetCollisionFlags() & Collision::NONEUTRALS) {
-			if (unit->IsNeutral()) { continue; }
-		}
-
 		if (CCollisionHandler::DetectHit(unit, ppos0, ppos1, &q)) {
 			if (q.lmp != NULL) {
 				unit->SetLastAttackedPiece(q.lmp, gs->frameNum);
@@ -427,31 +461,31 @@ void CProjectileHandler::CheckUnitCollisions(
 			p->pos = (raytraced)? pimpp: ppos0;
 			p->Collision(unit);
 			p->pos = (raytraced)? ppos0: p->pos;
-			break;
+			return true;
 		}
 	}
+
+	return false;
 }
 
-void CProjectileHandler::CheckFeatureCollisions(
+bool CProjectileHandler::CheckFeatureCollisions(
 	CProjectile* p,
-	std::vector<CFeature*>& tempFeatures,
-	CFeature** endFeature,
+	const std::vector<CFeature*>& tempFeatures,
 	const float3& ppos0,
 	const float3& ppos1)
 {
 	if (!p->checkCol) // already collided with unit?
-		return;
+		return false;
 
 	if ((p->GetCollisionFlags() & Collision::NOFEATURES) != 0)
-		return;
+		return false;
 
 	CollisionQuery q;
 
-	for (CFeature** fi = &tempFeatures[0]; fi != endFeature; ++fi) {
+	for (std::vector<CFeature*>::const_iterator fi = tempFeatures.begin(); fi != tempFeatures.end(); ++fi) {
 		CFeature* feature = *fi;
 
-		// geothermals do not have a collision volume, skip them
-		if (!feature->blocking || feature->def->geoThermal) {
+		if (!CanCollideWithFeature(feature)) {
 			continue;
 		}
 
@@ -468,39 +502,189 @@ void CProjectileHandler::CheckFeatureCollisions(
 			p->pos = (raytraced)? pimpp: ppos0;
 			p->Collision(feature);
 			p->pos = (raytraced)? ppos0: p->pos;
-			break;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+
+void CProjectileHandler::FindProjectileHits(ProjectileContainer& pc)
+{
+	// units, features, the quadfield and the projectiles are only read
+	// until ParallelFor returns, so the order of the items does not matter
+	hitSearchProjectiles = &pc;
+	hitSearchQuadFieldChanges = qf->GetNumChanges();
+	hitSearchBuffers.resize(simScheduler->GetNumThreads());
+	projectileHits.clear();
+	projectileHits.resize(pc.size());
+
+	simScheduler->ParallelFor(pc.size(), boost::bind(&CProjectileHandler::FindProjectileHit, this, _1, _2));
+
+	hitSearchProjectiles = NULL;
+}
+
+void CProjectileHandler::FindProjectileHit(unsigned int projectileNum, unsigned int threadNum)
+{
+	const CProjectile* p = (*hitSearchProjectiles)[projectileNum];
+
+	if (!p->checkCol || p->deleteMe)
+		return;
+
+	const CUnit* attacker = p->owner();
+
+	const float3 ppos0 = p->pos;
+	const float3 ppos1 = p->pos + p->speed;
+	const float radius = p->radius + p->speed.Length();
+
+	// same candidates in the same order as GetUnitsAndFeaturesExact, but
+	// with per-thread stamps (so each candidate is tested only once) and
+	// the narrow phase done right away
+	HitSearchBuffer& buffer = hitSearchBuffers[threadNum];
+	ProjectileHits& hits = projectileHits[projectileNum];
+
+	if ((++buffer.stamp) == 0) {
+		std::fill(buffer.unitStamps.begin(), buffer.unitStamps.end(), 0);
+		std::fill(buffer.featureStamps.begin(), buffer.featureStamps.end(), 0);
+		buffer.stamp = 1;
+	}
+
+	qf->GetQuads(buffer.quads, p->pos, radius);
+
+	const bool testFeatures = ((p->GetCollisionFlags() & Collision::NOFEATURES) == 0);
+
+	// only used as scratch space, ApplyProjectileHits queries again
+	CollisionQuery q;
+
+	for (std::vector<int>::const_iterator qi = buffer.quads.begin(); qi != buffer.quads.end(); ++qi) {
+		const CQuadField::Quad& quad = qf->GetQuad(*qi);
+
+		for (std::vector<CUnit*>::const_iterator ui = quad.units.begin(); ui != quad.units.end() && hits.unit == NULL; ++ui) {
+			CUnit* unit = *ui;
+
+			assert(unit->id >= 0);
+
+			if (size_t(unit->id) >= buffer.unitStamps.size())
+				buffer.unitStamps.resize(unit->id + 1, 0);
+			if (buffer.unitStamps[unit->id] == buffer.stamp)
+				continue;
+
+			buffer.unitStamps[unit->id] = buffer.stamp;
+
+			if (!CanCollideWithUnit(p, attacker, unit))
+				continue;
+			if (!CCollisionHandler::DetectHit(unit, ppos0, ppos1, &q))
+				continue;
+
+			hits.unit = unit;
+		}
+
+		for (std::vector<CFeature*>::const_iterator fi = quad.features.begin(); fi != quad.features.end() && testFeatures && hits.feature == NULL; ++fi) {
+			CFeature* feature = *fi;
+
+			assert(feature->id >= 0);
+
+			if (size_t(feature->id) >= buffer.featureStamps.size())
+				buffer.featureStamps.resize(feature->id + 1, 0);
+			if (buffer.featureStamps[feature->id] == buffer.stamp)
+				continue;
+			if ((p->pos - feature->midPos).SqLength() >= Square(radius + feature->radius))
+				continue;
+
+			buffer.featureStamps[feature->id] = buffer.stamp;
+
+			if (!CanCollideWithFeature(feature))
+				continue;
+			if (!CCollisionHandler::DetectHit(feature, ppos0, ppos1, &q))
+				continue;
+
+			hits.feature = feature;
+		}
+	}
+}
+
+void CProjectileHandler::ApplyProjectileHits(
+	CProjectile* p,
+	const ProjectileHits& hits,
+	std::vector<CUnit*>& tempUnits,
+	std::vector<CFeature*>& tempFeatures)
+{
+	const float3 ppos0 = p->pos;
+	const float3 ppos1 = p->pos + p->speed;
+	const float radius = p->radius + p->speed.Length();
+
+	// units and features that were added, moved or removed by collisions
+	// handled earlier in this pass can be hit now but are missing from the
+	// hits, so without a hit all candidates are tested as usual then
+	if ((hits.unit == NULL || hits.feature == NULL) && qf->GetNumChanges() != hitSearchQuadFieldChanges) {
+		qf->GetUnitsAndFeaturesExact(ppos0, radius, tempUnits, tempFeatures);
+
+		CheckUnitCollisions(p, tempUnits, ppos0, ppos1);
+		CheckFeatureCollisions(p, tempFeatures, ppos0, ppos1);
+		return;
+	}
+
+	// the hits are tested again since collisions handled earlier in this
+	// pass can have invalidated them (eg. script-hidden pieces, Lua-moved
+	// units), in which case all candidates are tested as usual
+	if (hits.unit != NULL) {
+		tempUnits.assign(1, hits.unit);
+
+		if (!CheckUnitCollisions(p, tempUnits, ppos0, ppos1)) {
+			qf->GetUnitsAndFeaturesExact(ppos0, radius, tempUnits, tempFeatures);
+
+			CheckUnitCollisions(p, tempUnits, ppos0, ppos1);
+			CheckFeatureCollisions(p, tempFeatures, ppos0, ppos1);
+			return;
+		}
+	}
+
+	if (hits.feature != NULL) {
+		tempFeatures.assign(1, hits.feature);
+
+		if (!CheckFeatureCollisions(p, tempFeatures, ppos0, ppos1) && p->checkCol) {
+			qf->GetUnitsAndFeaturesExact(ppos0, radius, tempUnits, tempFeatures);
+
+			CheckFeatureCollisions(p, tempFeatures, ppos0, ppos1);
 		}
 	}
 }
 
 void CProjectileHandler::CheckUnitFeatureCollisions(ProjectileContainer& pc) {
-	static std::vector<CUnit*> tempUnits(uh->MaxUnits(), NULL);
-	static std::vector<CFeature*> tempFeatures(uh->MaxUnits(), NULL);
+	// reused between calls, these only grow to the largest query
+	static std::vector<CUnit*> tempUnits;
+	static std::vector<CFeature*> tempFeatures;
+
+	FindProjectileHits(pc);
 
-	for (ProjectileContainer::iterator pci = pc.begin(); pci != pc.end(); ++pci) {
-		CProjectile* p = *pci;
+	// collisions can add projectiles to pc, so no iterators
+	for (size_t i = 0; i < pc.size(); i++) {
+		CProjectile* p = pc[i];
 
 		if (p->checkCol && !p->deleteMe) {
+			if (i < projectileHits.size()) {
+				ApplyProjectileHits(p, projectileHits[i], tempUnits, tempFeatures);
+				continue;
+			}
+
+			// added by a collision of this pass, check it the slow way
 			const float3 ppos0 = p->pos;
 			const float3 ppos1 = p->pos + p->speed;
 			const float speedf = p->speed.Length();
 
-			CUnit** endUnit = &tempUnits[0];
-			CFeature** endFeature = &tempFeatures[0];
-
-			qf->GetUnitsAndFeaturesExact(p->pos, p->radius + speedf, endUnit, endFeature);
+			qf->GetUnitsAndFeaturesExact(p->pos, p->radius + speedf, tempUnits, tempFeatures);
 
-			CheckUnitCollisions(p, tempUnits, endUnit, ppos0, ppos1);
-			CheckFeatureCollisions(p, tempFeatures, endFeature, ppos0, ppos1);
+			CheckUnitCollisions(p, tempUnits, ppos0, ppos1);
+			CheckFeatureCollisions(p, tempFeatures, ppos0, ppos1);
 		}
 	}
 }
 
 void CProjectileHandler::CheckGroundCollisions(ProjectileContainer& pc) {
-	ProjectileContainer::iterator pci;
-
-	for (pci = pc.begin(); pci != pc.end(); ++pci) {
-		CProjectile* p = *pci;
+	// collisions can add projectiles to pc, so no iterators
+	for (size_t i = 0; i < pc.size(); i++) {
+		CProjectile* p = pc[i];
 
 		if (!p->checkCol) {
 			continue;
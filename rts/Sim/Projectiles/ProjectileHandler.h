@@ -3,6 +3,7 @@
 #ifndef PROJECTILE_HANDLER_H
 #define PROJECTILE_HANDLER_H
 
+#include <deque>
 #include <list>
 #include <set>
 #include <vector>
@@ -32,8 +33,9 @@ struct projdetach {
 };
 
 typedef std::pair<CProjectile*, int> ProjectileMapPair;
-typedef std::map<int, ProjectileMapPair> ProjectileMap;
-typedef ThreadListSim<std::list<CProjectile*>, std::set<CProjectile*>, CProjectile*, projdetach> ProjectileContainer;
+/// indexed by projectile ID, first is NULL for unused IDs
+typedef std::vector<ProjectileMapPair> ProjectileMap;
+typedef ThreadListSim<std::vector<CProjectile*>, std::set<CProjectile*>, CProjectile*, projdetach> ProjectileContainer;
 typedef ThreadListSimRender<std::list<CGroundFlash*>, std::set<CGroundFlash*>, CGroundFlash*> GroundFlashContainer;
 #if defined(USE_GML) && GML_ENABLE_SIM
 typedef ThreadListSimRender<std::set<FlyingPiece*>, std::set<FlyingPiece*, piececmp>, FlyingPiece*> FlyingPieceContainer;
@@ -54,22 +56,14 @@ public:
 	void PostLoad();
 
 	inline const ProjectileMapPair* GetMapPairBySyncedID(int id) const {
-		ProjectileMap::const_iterator it = syncedProjectileIDs.find(id);
-		if (it == syncedProjectileIDs.end()) {
-			return NULL;
-		}
-		return &(it->second);
+		return GetMapPair(syncedProjectileIDs, id);
 	}
 	inline const ProjectileMapPair* GetMapPairByUnsyncedID(int id) const {
-		ProjectileMap::const_iterator it = unsyncedProjectileIDs.find(id);
-		if (it == unsyncedProjectileIDs.end()) {
-			return NULL;
-		}
-		return &(it->second);
+		return GetMapPair(unsyncedProjectileIDs, id);
 	}
 
-	void CheckUnitCollisions(CProjectile*, std::vector<CUnit*>&, CUnit**, const float3&, const float3&);
-	void CheckFeatureCollisions(CProjectile*, std::vector<CFeature*>&, CFeature**, const float3&, const float3&);
+	bool CheckUnitCollisions(CProjectile*, const std::vector<CUnit*>&, const float3&, const float3&);
+	bool CheckFeatureCollisions(CProjectile*, const std::vector<CFeature*>&, const float3&, const float3&);
 	void CheckUnitFeatureCollisions(ProjectileContainer&);
 	void CheckGroundCollisions(ProjectileContainer&);
 	void CheckCollisions();
@@ -106,10 +100,56 @@ public:
 	float nanoParticleSaturation;
 
 private:
+	static const ProjectileMapPair* GetMapPair(const ProjectileMap& pm, int id) {
+		if (id < 0 || id >= int(pm.size()) || pm[id].first == NULL) {
+			return NULL;
+		}
+		return &pm[id];
+	}
+
+	void DestroyProjectileID(ProjectileMap& pm, std::deque<int>& freeIDs, int id);
+
+	/**
+	 * Broadphase and narrow phase of CheckUnitFeatureCollisions, run in
+	 * parallel over all projectiles of a container before any collision
+	 * is handled: finds the unit and feature each projectile would hit
+	 * first (in quadfield order) and stores them in projectileHits.
+	 */
+	void FindProjectileHits(ProjectileContainer& pc);
+	void FindProjectileHit(unsigned int projectileNum, unsigned int threadNum);
+
+	struct ProjectileHits {
+		ProjectileHits(): unit(NULL), feature(NULL) {}
+
+		CUnit* unit;
+		CFeature* feature;
+	};
+
+	void ApplyProjectileHits(CProjectile* p, const ProjectileHits& hits, std::vector<CUnit*>& tempUnits, std::vector<CFeature*>& tempFeatures);
+
+	/// per-thread scratch space of FindProjectileHit
+	struct HitSearchBuffer {
+		HitSearchBuffer(): stamp(0) {}
+
+		std::vector<int> quads;
+		/// unit / feature ID -> stamp of the last projectile that included it
+		std::vector<unsigned int> unitStamps;
+		std::vector<unsigned int> featureStamps;
+		unsigned int stamp;
+	};
+
+	/// container FindProjectileHits currently works on
+	ProjectileContainer* hitSearchProjectiles;
+	/// CQuadField::GetNumChanges when the hits were found
+	unsigned int hitSearchQuadFieldChanges;
+	/// same indices as *hitSearchProjectiles (not saved)
+	std::vector<ProjectileHits> projectileHits;
+	std::vector<HitSearchBuffer> hitSearchBuffers;
+
 	int maxUsedSyncedID;
 	int maxUsedUnsyncedID;
-	std::list<int> freeSyncedIDs;             // available synced (weapon, piece) projectile ID's
-	std::list<int> freeUnsyncedIDs;           // available unsynced projectile ID's
+	std::deque<int> freeSyncedIDs;            // available synced (weapon, piece) projectile ID's, reused oldest first
+	std::deque<int> freeUnsyncedIDs;          // available unsynced projectile ID's, reused oldest first
 	ProjectileMap syncedProjectileIDs;        // ID ==> <projectile, allyteam> map for living synced projectiles
 	ProjectileMap unsyncedProjectileIDs;      // ID ==> <projectile, allyteam> map for living unsynced projectiles
 };
@@ -9,6 +9,8 @@
 #include "UnitScriptLog.h"
 #include "System/FileSystem/FileHandler.h"
 
+#include <algorithm>
+
 #ifndef _CONSOLE
 #include "System/TimeProfiler.h"
 #endif
@@ -29,7 +31,8 @@ int GCurrentTime;
 
 
 CCobEngine::CCobEngine()
-	: curThread(NULL)
+	: sleepingTime(0)
+	, curThread(NULL)
 {
 	GCurrentTime = 0;
 }
@@ -38,17 +41,16 @@ CCobEngine::CCobEngine()
 CCobEngine::~CCobEngine()
 {
 	//Should delete all things that the scheduler knows
-	for (std::list<CCobThread *>::iterator i = running.begin(); i != running.end(); ++i) {
-		delete *i;
+	for (size_t n = 0; n < running.size(); n++) {
+		delete running[n];
 	}
-	for (std::list<CCobThread *>::iterator i = wantToRun.begin(); i != wantToRun.end(); ++i) {
-		delete *i;
+	for (size_t n = 0; n < wantToRun.size(); n++) {
+		delete wantToRun[n];
 	}
-	while (sleeping.size() > 0) {
-		CCobThread *tmp;
-		tmp = sleeping.top();
-		sleeping.pop();
-		delete tmp;
+	for (int slot = 0; slot < SLEEP_WHEEL_SIZE; slot++) {
+		for (size_t n = 0; n < sleeping[slot].size(); n++) {
+			delete sleeping[slot][n];
+		}
 	}
 }
 
@@ -67,11 +69,15 @@ void CCobEngine::AddThread(CCobThread *thread)
 {
 	switch (thread->state) {
 		case CCobThread::Run:
-			wantToRun.push_front(thread);
-			break;
-		case CCobThread::Sleep:
-			sleeping.push(thread);
+			wantToRun.push_back(thread);
 			break;
+		case CCobThread::Sleep: {
+			// a thread that went back in time (negative sleep) wakes up
+			// in the next slot handled, like one sleeping for 0 ms would
+			const int wakeTime = std::max(thread->GetWakeTime(), sleepingTime);
+
+			sleeping[wakeTime & (SLEEP_WHEEL_SIZE - 1)].push_back(thread);
+		} break;
 		default:
 			LOG_L(L_ERROR, "thread added to scheduler with unknown state (%d)", thread->state);
 			break;
@@ -90,6 +96,22 @@ void CCobEngine::TickThread(CCobThread* thread)
 }
 
 
+void CCobEngine::WakeThread(CCobThread* thread)
+{
+#ifdef _CONSOLE
+	printf("+++\n");
+#endif
+	if (thread->state == CCobThread::Sleep) {
+		thread->state = CCobThread::Run;
+		TickThread(thread);
+	} else if (thread->state == CCobThread::Dead) {
+		delete thread;
+	} else {
+		LOG_L(L_ERROR, "Sleeping thread strange state %d", thread->state);
+	}
+}
+
+
 void CCobEngine::Tick(int deltaTime)
 {
 	SCOPED_TIMER("CobEngine::Tick");
@@ -99,12 +121,12 @@ void CCobEngine::Tick(int deltaTime)
 	LOG_L(L_DEBUG, "----");
 
 	// Advance all running threads
-	for (std::list<CCobThread*>::iterator i = running.begin(); i != running.end(); ++i) {
-		//LOG_L(L_DEBUG, "Now 1running %d: %s", GCurrentTime, (*i)->GetName().c_str());
+	for (size_t n = 0; n < running.size(); n++) {
+		//LOG_L(L_DEBUG, "Now 1running %d: %s", GCurrentTime, running[n]->GetName().c_str());
 #ifdef _CONSOLE
 		printf("----\n");
 #endif
-		TickThread(*i);
+		TickThread(running[n]);
 	}
 
 	// A thread can never go from running->running, so clear the list
@@ -114,40 +136,31 @@ void CCobEngine::Tick(int deltaTime)
 	running.clear();
 
 	// The threads that just ran may have added new threads that should run next tick
-	for (std::list<CCobThread *>::iterator i = wantToRun.begin(); i != wantToRun.end(); ++i) {
-		running.push_front(*i);
-	}
+	running.swap(wantToRun);
 
-	wantToRun.clear();
+	// Check on the sleeping threads, in the order of their wakeTime
+	for (; sleepingTime < GCurrentTime; sleepingTime++) {
+		std::vector<CCobThread*>& slot = sleeping[sleepingTime & (SLEEP_WHEEL_SIZE - 1)];
 
-	//Check on the sleeping threads
-	if (!sleeping.empty()) {
-		CCobThread* cur = sleeping.top();
+		// Waking a thread can quite possibly readd it (or another one) to this
+		// slot, so it is indexed and compacted as it goes; such threads either
+		// went back in time and are woken in this pass as well, or are due in a
+		// later turn of the wheel and kept (sleeps are guaranteed to be >= 0 ms)
+		size_t numKept = 0;
 
-		while ((cur != NULL) && (cur->GetWakeTime() < GCurrentTime)) {
-			// Start with removing the executing thread from the queue
-			sleeping.pop();
+		for (size_t n = 0; n < slot.size(); n++) {
+			CCobThread* cur = slot[n];
 
-			//Run forward again. This can quite possibly readd the thread to the sleeping array again
-			//But it will not interfere since it is guaranteed to sleep > 0 ms
-			//LOG_L(L_DEBUG, "Now 2running %d: %s", GCurrentTime, cur->GetName().c_str());
-#ifdef _CONSOLE
-			printf("+++\n");
-#endif
-			if (cur->state == CCobThread::Sleep) {
-				cur->state = CCobThread::Run;
-				TickThread(cur);
-			} else if (cur->state == CCobThread::Dead) {
-				delete cur;
-			} else {
-				LOG_L(L_ERROR, "Sleeping thread strange state %d", cur->state);
+			if (cur->GetWakeTime() > sleepingTime) {
+				slot[numKept++] = cur;
+				continue;
 			}
 
-			if (!sleeping.empty())
-				cur = sleeping.top();
-			else
-				cur = NULL;
+			//LOG_L(L_DEBUG, "Now 2running %d: %s", GCurrentTime, cur->GetName().c_str());
+			WakeThread(cur);
 		}
+
+		slot.resize(numKept);
 	}
 }
 
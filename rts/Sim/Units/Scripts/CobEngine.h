@@ -11,8 +11,7 @@
 
 #include "CobThread.h"
 
-#include <list>
-#include <queue>
+#include <vector>
 #include <map>
 
 class CCobThread;
@@ -20,26 +19,31 @@ class CCobInstance;
 class CCobFile;
 
 
-class CCobThreadPtr_less : public std::binary_function<CCobThread*, CCobThread*, bool> {
-public:
-	bool operator() (const CCobThread* const& a, const CCobThread* const& b) const {
-		return a->GetWakeTime() > b->GetWakeTime();
-	}
-};
-
-
 class CCobEngine
 {
 protected:
-	std::list<CCobThread*> running;
+	/// must be a power of two, in milliseconds
+	static const int SLEEP_WHEEL_SIZE = 1024;
+
+	std::vector<CCobThread*> running;
 	/**
 	 * Threads are added here if they are in Running.
 	 * And moved to real running after running is empty.
 	 */
-	std::list<CCobThread*> wantToRun;
-	std::priority_queue<CCobThread*, std::vector<CCobThread*>, CCobThreadPtr_less> sleeping;
+	std::vector<CCobThread*> wantToRun;
+	/**
+	 * Timing wheel of sleeping threads: each slot holds the threads whose
+	 * wakeTime equals its index modulo SLEEP_WHEEL_SIZE, in the order they
+	 * went to sleep. Tick handles one slot per elapsed millisecond, threads
+	 * sleeping for more than one turn of the wheel are skipped until then.
+	 */
+	std::vector<CCobThread*> sleeping[SLEEP_WHEEL_SIZE];
+	/// wakeTime of the next slot to handle, all earlier ones are empty
+	int sleepingTime;
+
 	CCobThread* curThread;
 	void TickThread(CCobThread* thread);
+	void WakeThread(CCobThread* thread);
 public:
 	CCobEngine();
 	~CCobEngine();
@@ -6,6 +6,7 @@
 #include "CobFile.h"
 #include "CobInstance.h"
 #include "CobThread.h"
+#include "UnitScriptEngine.h"
 #include "UnitScriptLog.h"
 
 #ifndef _CONSOLE
@@ -76,23 +77,23 @@ CCobInstance::~CCobInstance()
 	//this may be dangerous, is it really desired?
 	//Destroy();
 
-	for (int animType = ATurn; animType <= AMove; animType++) {
-		for (std::list<AnimInfo *>::iterator i = anims[animType].begin(); i != anims[animType].end(); ++i) {
-			// All threads blocking on animations can be killed safely from here since the scheduler does not
-			// know about them
-			for (std::list<IAnimListener *>::iterator j = (*i)->listeners.begin(); j != (*i)->listeners.end(); ++j) {
-				delete *j;
-			}
-			// the anims are deleted in ~CUnitScript
-		}
+	// All threads blocking on animations can be killed safely from here since the scheduler does not
+	// know about them
+	std::vector<IAnimListener*> listeners;
+	GUnitScriptEngine.GetAnimListeners(this, listeners);
+
+	for (size_t n = 0; n < listeners.size(); n++) {
+		delete listeners[n];
 	}
+	// the anims are removed in ~CUnitScript
 
 	// Can't delete the thread here because that would confuse the scheduler to no end
 	// Instead, mark it as dead. It is the function calling Tick that is responsible for delete.
-	// Also unregister all callbacks
+	// Also unregister all callbacks, and ourselves as owner
 	for (std::list<CCobThread *>::iterator i = threads.begin(); i != threads.end(); ++i) {
 		(*i)->state = CCobThread::Dead;
 		(*i)->SetCallback(NULL, NULL, NULL);
+		(*i)->OwnerDied();
 	}
 }
 
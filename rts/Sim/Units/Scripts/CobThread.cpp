@@ -10,10 +10,24 @@
 #include "Lua/LuaRules.h"
 #include "Sim/Misc/GlobalConstants.h"
 #include "Sim/Misc/GlobalSynced.h"
+#include "System/MemPool.h"
 
+#include <cassert>
+#include <cstring>
 #include <sstream>
 
 
+// COB threads are only created and deleted by the simulation
+// NOTE: the pool is never destroyed, since GCobEngine (a static
+// object in another translation unit) deletes its remaining threads
+// on destruction, which can happen after any static pool is gone
+static CSlabMemPool& GetCobThreadMemPool()
+{
+	static CSlabMemPool* cobThreadMemPool = new CSlabMemPool();
+	return *cobThreadMemPool;
+}
+
+
 CCobThread::CCobThread(CCobFile& script, CCobInstance* owner)
 	: script(script)
 	, owner(owner)
@@ -31,7 +45,6 @@ CCobThread::CCobThread(CCobFile& script, CCobInstance* owner)
 		luaArgs[i] = 0;
 	}
 	owner->threads.push_back(this);
-	AddDeathDependence(owner, DEPENDENCE_COBTHREAD);
 }
 
 CCobThread::~CCobThread()
@@ -44,6 +57,16 @@ CCobThread::~CCobThread()
 		owner->threads.remove(this);
 }
 
+void* CCobThread::operator new(size_t size)
+{
+	return GetCobThreadMemPool().Alloc(size);
+}
+
+void CCobThread::operator delete(void* p, size_t size)
+{
+	GetCobThreadMemPool().Free(p, size);
+}
+
 void CCobThread::SetCallback(CBCobThreadFinish cb, void* p1, void* p2)
 {
 	callback = cb;
@@ -198,6 +221,164 @@ const int DROP   = 0x10084000;
 #define LUA9 119
 
 
+// Dense indices of the opcodes above, so the switch in Tick can be compiled
+// to a jump table instead of a search through the sparse opcode values
+enum OpcodeIndex {
+	OPI_UNKNOWN = 0,
+	OPI_MOVE,
+	OPI_TURN,
+	OPI_SPIN,
+	OPI_STOP_SPIN,
+	OPI_SHOW,
+	OPI_HIDE,
+	OPI_CACHE,
+	OPI_DONT_CACHE,
+	OPI_MOVE_NOW,
+	OPI_TURN_NOW,
+	OPI_SHADE,
+	OPI_DONT_SHADE,
+	OPI_EMIT_SFX,
+	OPI_WAIT_TURN,
+	OPI_WAIT_MOVE,
+	OPI_SLEEP,
+	OPI_PUSH_CONSTANT,
+	OPI_PUSH_LOCAL_VAR,
+	OPI_PUSH_STATIC,
+	OPI_CREATE_LOCAL_VAR,
+	OPI_POP_LOCAL_VAR,
+	OPI_POP_STATIC,
+	OPI_POP_STACK,
+	OPI_ADD,
+	OPI_SUB,
+	OPI_MUL,
+	OPI_DIV,
+	OPI_MOD,
+	OPI_BITWISE_AND,
+	OPI_BITWISE_OR,
+	OPI_BITWISE_XOR,
+	OPI_BITWISE_NOT,
+	OPI_RAND,
+	OPI_GET_UNIT_VALUE,
+	OPI_GET,
+	OPI_SET_LESS,
+	OPI_SET_LESS_OR_EQUAL,
+	OPI_SET_GREATER,
+	OPI_SET_GREATER_OR_EQUAL,
+	OPI_SET_EQUAL,
+	OPI_SET_NOT_EQUAL,
+	OPI_LOGICAL_AND,
+	OPI_LOGICAL_OR,
+	OPI_LOGICAL_XOR,
+	OPI_LOGICAL_NOT,
+	OPI_START,
+	OPI_CALL,
+	OPI_REAL_CALL,
+	OPI_LUA_CALL,
+	OPI_JUMP,
+	OPI_RETURN,
+	OPI_JUMP_NOT_EQUAL,
+	OPI_SIGNAL,
+	OPI_SET_SIGNAL_MASK,
+	OPI_EXPLODE,
+	OPI_PLAY_SOUND,
+	OPI_SET,
+	OPI_ATTACH,
+	OPI_DROP
+};
+
+class COpcodeTable
+{
+public:
+	COpcodeTable() {
+		memset(indices, OPI_UNKNOWN, sizeof(indices));
+
+		Add(MOVE, OPI_MOVE);
+		Add(TURN, OPI_TURN);
+		Add(SPIN, OPI_SPIN);
+		Add(STOP_SPIN, OPI_STOP_SPIN);
+		Add(SHOW, OPI_SHOW);
+		Add(HIDE, OPI_HIDE);
+		Add(CACHE, OPI_CACHE);
+		Add(DONT_CACHE, OPI_DONT_CACHE);
+		Add(MOVE_NOW, OPI_MOVE_NOW);
+		Add(TURN_NOW, OPI_TURN_NOW);
+		Add(SHADE, OPI_SHADE);
+		Add(DONT_SHADE, OPI_DONT_SHADE);
+		Add(EMIT_SFX, OPI_EMIT_SFX);
+		Add(WAIT_TURN, OPI_WAIT_TURN);
+		Add(WAIT_MOVE, OPI_WAIT_MOVE);
+		Add(SLEEP, OPI_SLEEP);
+		Add(PUSH_CONSTANT, OPI_PUSH_CONSTANT);
+		Add(PUSH_LOCAL_VAR, OPI_PUSH_LOCAL_VAR);
+		Add(PUSH_STATIC, OPI_PUSH_STATIC);
+		Add(CREATE_LOCAL_VAR, OPI_CREATE_LOCAL_VAR);
+		Add(POP_LOCAL_VAR, OPI_POP_LOCAL_VAR);
+		Add(POP_STATIC, OPI_POP_STATIC);
+		Add(POP_STACK, OPI_POP_STACK);
+		Add(ADD, OPI_ADD);
+		Add(SUB, OPI_SUB);
+		Add(MUL, OPI_MUL);
+		Add(DIV, OPI_DIV);
+		Add(MOD, OPI_MOD);
+		Add(BITWISE_AND, OPI_BITWISE_AND);
+		Add(BITWISE_OR, OPI_BITWISE_OR);
+		Add(BITWISE_XOR, OPI_BITWISE_XOR);
+		Add(BITWISE_NOT, OPI_BITWISE_NOT);
+		Add(RAND, OPI_RAND);
+		Add(GET_UNIT_VALUE, OPI_GET_UNIT_VALUE);
+		Add(GET, OPI_GET);
+		Add(SET_LESS, OPI_SET_LESS);
+		Add(SET_LESS_OR_EQUAL, OPI_SET_LESS_OR_EQUAL);
+		Add(SET_GREATER, OPI_SET_GREATER);
+		Add(SET_GREATER_OR_EQUAL, OPI_SET_GREATER_OR_EQUAL);
+		Add(SET_EQUAL, OPI_SET_EQUAL);
+		Add(SET_NOT_EQUAL, OPI_SET_NOT_EQUAL);
+		Add(LOGICAL_AND, OPI_LOGICAL_AND);
+		Add(LOGICAL_OR, OPI_LOGICAL_OR);
+		Add(LOGICAL_XOR, OPI_LOGICAL_XOR);
+		Add(LOGICAL_NOT, OPI_LOGICAL_NOT);
+		Add(START, OPI_START);
+		Add(CALL, OPI_CALL);
+		Add(REAL_CALL, OPI_REAL_CALL);
+		Add(LUA_CALL, OPI_LUA_CALL);
+		Add(JUMP, OPI_JUMP);
+		Add(RETURN, OPI_RETURN);
+		Add(JUMP_NOT_EQUAL, OPI_JUMP_NOT_EQUAL);
+		Add(SIGNAL, OPI_SIGNAL);
+		Add(SET_SIGNAL_MASK, OPI_SET_SIGNAL_MASK);
+		Add(EXPLODE, OPI_EXPLODE);
+		Add(PLAY_SOUND, OPI_PLAY_SOUND);
+		Add(SET, OPI_SET);
+		Add(ATTACH, OPI_ATTACH);
+		Add(DROP, OPI_DROP);
+	}
+
+	OpcodeIndex Get(int opcode) const {
+		// every opcode is 0x10XX000Y with Y < 8
+		if ((opcode & ~0x000FF007) != 0x10000000)
+			return OPI_UNKNOWN;
+
+		return OpcodeIndex(indices[Key(opcode)]);
+	}
+
+private:
+	static int Key(int opcode) {
+		return ((((opcode >> 12) & 0xFF) << 3) | (opcode & 7));
+	}
+
+	void Add(int opcode, OpcodeIndex index) {
+		assert((opcode & ~0x000FF007) == 0x10000000);
+		assert(indices[Key(opcode)] == OPI_UNKNOWN);
+
+		indices[Key(opcode)] = index;
+	}
+
+	unsigned char indices[256 * 8];
+};
+
+static const COpcodeTable opcodeTable;
+
+
 // Handy macros
 #define GET_LONG_PC() (script.code[PC++])
 //#define POP() (stack.size() > 0) ? stack.back(), stack.pop_back(); : 0
@@ -243,33 +424,33 @@ bool CCobThread::Tick()
 
 		LOG_L(L_DEBUG, "PC: %x opcode: %x (%s)", PC - 1, opcode, GetOpcodeName(opcode).c_str());
 
-		switch(opcode) {
-			case PUSH_CONSTANT:
+		switch (opcodeTable.Get(opcode)) {
+			case OPI_PUSH_CONSTANT:
 				r1 = GET_LONG_PC();
 				stack.push_back(r1);
 				break;
-			case SLEEP:
+			case OPI_SLEEP:
 				r1 = POP();
 				wakeTime = GCurrentTime + r1;
 				state = Sleep;
 				GCobEngine.AddThread(this);
 				LOG_L(L_DEBUG, "%s sleeping for %d ms", script.scriptNames[callStack.back().functionId].c_str(), r1);
 				return true;
-			case SPIN:
+			case OPI_SPIN:
 				r1 = GET_LONG_PC();
 				r2 = GET_LONG_PC();
 				r3 = POP();         // speed
 				r4 = POP();         // accel
 				owner->Spin(r1, r2, r3, r4);
 				break;
-			case STOP_SPIN:
+			case OPI_STOP_SPIN:
 				r1 = GET_LONG_PC();
 				r2 = GET_LONG_PC();
 				r3 = POP();         // decel
 				//LOG_L(L_DEBUG, "Stop spin of %s around %d", script.pieceNames[r1].c_str(), r2);
 				owner->StopSpin(r1, r2, r3);
 				break;
-			case RETURN:
+			case OPI_RETURN:
 				retCode = POP();
 				if (callStack.back().returnAddr == -1) {
 					LOG_L(L_DEBUG, "%s returned %d", script.scriptNames[callStack.back().functionId].c_str(), retCode);
@@ -286,19 +467,19 @@ bool CCobThread::Tick()
 				callStack.pop_back();
 				LOG_L(L_DEBUG, "Returning to %s", script.scriptNames[callStack.back().functionId].c_str());
 				break;
-			case SHADE:
+			case OPI_SHADE:
 				r1 = GET_LONG_PC();
 				break;
-			case DONT_SHADE:
+			case OPI_DONT_SHADE:
 				r1 = GET_LONG_PC();
 				break;
-			case CACHE:
+			case OPI_CACHE:
 				r1 = GET_LONG_PC();
 				break;
-			case DONT_CACHE:
+			case OPI_DONT_CACHE:
 				r1 = GET_LONG_PC();
 				break;
-			case CALL: {
+			case OPI_CALL: {
 				r1 = GET_LONG_PC();
 				PC--;
 				const string& name = script.scriptNames[r1];
@@ -311,7 +492,7 @@ bool CCobThread::Tick()
 
 				// fall through //
 			}
-			case REAL_CALL:
+			case OPI_REAL_CALL:
 				r1 = GET_LONG_PC();
 				r2 = GET_LONG_PC();
 
@@ -330,19 +511,19 @@ bool CCobThread::Tick()
 				PC = script.scriptOffsets[r1];
 				LOG_L(L_DEBUG, "Calling %s", script.scriptNames[r1].c_str());
 				break;
-			case LUA_CALL:
+			case OPI_LUA_CALL:
 				LuaCall();
 				break;
-			case POP_STATIC:
+			case OPI_POP_STATIC:
 				r1 = GET_LONG_PC();
 				r2 = POP();
 				owner->staticVars[r1] = r2;
 				//LOG_L(L_DEBUG, "Pop static var %d val %d", r1, r2);
 				break;
-			case POP_STACK:
+			case OPI_POP_STACK:
 				POP();
 				break;
-			case START: {
+			case OPI_START: {
 				r1 = GET_LONG_PC();
 				r2 = GET_LONG_PC();
 
@@ -365,7 +546,7 @@ bool CCobThread::Tick()
 				thread->signalMask = signalMask;
 				LOG_L(L_DEBUG, "Starting %s %d", script.scriptNames[r1].c_str(), signalMask);
 			} break;
-			case CREATE_LOCAL_VAR:
+			case OPI_CREATE_LOCAL_VAR:
 				if (paramCount == 0) {
 					stack.push_back(0);
 				}
@@ -373,7 +554,7 @@ bool CCobThread::Tick()
 					paramCount--;
 				}
 				break;
-			case GET_UNIT_VALUE:
+			case OPI_GET_UNIT_VALUE:
 				r1 = POP();
 				if ((r1 >= LUA0) && (r1 <= LUA9)) {
 					stack.push_back(luaArgs[r1 - LUA0]);
@@ -382,30 +563,30 @@ bool CCobThread::Tick()
 				r1 = owner->GetUnitVal(r1, 0, 0, 0, 0);
 				stack.push_back(r1);
 				break;
-			case JUMP_NOT_EQUAL:
+			case OPI_JUMP_NOT_EQUAL:
 				r1 = GET_LONG_PC();
 				r2 = POP();
 				if (r2 == 0) {
 					PC = r1;
 				}
 				break;
-			case JUMP:
+			case OPI_JUMP:
 				r1 = GET_LONG_PC();
 				// this seem to be an error in the docs..
 				//r2 = script.scriptOffsets[callStack.back().functionId] + r1;
 				PC = r1;
 				break;
-			case POP_LOCAL_VAR:
+			case OPI_POP_LOCAL_VAR:
 				r1 = GET_LONG_PC();
 				r2 = POP();
 				stack[callStack.back().stackTop + r1] = r2;
 				break;
-			case PUSH_LOCAL_VAR:
+			case OPI_PUSH_LOCAL_VAR:
 				r1 = GET_LONG_PC();
 				r2 = stack[callStack.back().stackTop + r1];
 				stack.push_back(r2);
 				break;
-			case SET_LESS_OR_EQUAL:
+			case OPI_SET_LESS_OR_EQUAL:
 				r2 = POP();
 				r1 = POP();
 				if (r1 <= r2)
@@ -413,41 +594,41 @@ bool CCobThread::Tick()
 				else
 					stack.push_back(0);
 				break;
-			case BITWISE_AND:
+			case OPI_BITWISE_AND:
 				r1 = POP();
 				r2 = POP();
 				stack.push_back(r1 & r2);
 				break;
-			case BITWISE_OR: // seems to want stack contents or'd, result places on stack
+			case OPI_BITWISE_OR: // seems to want stack contents or'd, result places on stack
 				r1 = POP();
 				r2 = POP();
 				stack.push_back(r1 | r2);
 				break;
-			case BITWISE_XOR:
+			case OPI_BITWISE_XOR:
 				r1 = POP();
 				r2 = POP();
 				stack.push_back(r1 ^ r2);
 				break;
-			case BITWISE_NOT:
+			case OPI_BITWISE_NOT:
 				r1 = POP();
 				stack.push_back(~r1);
 				break;
-			case EXPLODE:
+			case OPI_EXPLODE:
 				r1 = GET_LONG_PC();
 				r2 = POP();
 				owner->Explode(r1, r2);
 				break;
-			case PLAY_SOUND:
+			case OPI_PLAY_SOUND:
 				r1 = GET_LONG_PC();
 				r2 = POP();
 				owner->PlayUnitSound(r1, r2);
 				break;
-			case PUSH_STATIC:
+			case OPI_PUSH_STATIC:
 				r1 = GET_LONG_PC();
 				stack.push_back(owner->staticVars[r1]);
 				//LOG_L(L_DEBUG, "Push static %d val %d", r1, owner->staticVars[r1]);
 				break;
-			case SET_NOT_EQUAL:
+			case OPI_SET_NOT_EQUAL:
 				r1 = POP();
 				r2 = POP();
 				if (r1 != r2)
@@ -455,7 +636,7 @@ bool CCobThread::Tick()
 				else
 					stack.push_back(0);
 				break;
-			case SET_EQUAL:
+			case OPI_SET_EQUAL:
 				r1 = POP();
 				r2 = POP();
 				if (r1 == r2)
@@ -463,7 +644,7 @@ bool CCobThread::Tick()
 				else
 					stack.push_back(0);
 				break;
-			case SET_LESS:
+			case OPI_SET_LESS:
 				r2 = POP();
 				r1 = POP();
 				if (r1 < r2)
@@ -471,7 +652,7 @@ bool CCobThread::Tick()
 				else
 					stack.push_back(0);
 				break;
-			case SET_GREATER:
+			case OPI_SET_GREATER:
 				r2 = POP();
 				r1 = POP();
 				if (r1 > r2)
@@ -479,7 +660,7 @@ bool CCobThread::Tick()
 				else
 					stack.push_back(0);
 				break;
-			case SET_GREATER_OR_EQUAL:
+			case OPI_SET_GREATER_OR_EQUAL:
 				r2 = POP();
 				r1 = POP();
 				if (r1 >= r2)
@@ -487,31 +668,31 @@ bool CCobThread::Tick()
 				else
 					stack.push_back(0);
 				break;
-			case RAND:
+			case OPI_RAND:
 				r2 = POP();
 				r1 = POP();
 				r3 = gs->randInt() % (r2 - r1 + 1) + r1;
 				stack.push_back(r3);
 				break;
-			case EMIT_SFX:
+			case OPI_EMIT_SFX:
 				r1 = POP();
 				r2 = GET_LONG_PC();
 				owner->EmitSfx(r1, r2);
 				break;
-			case MUL:
+			case OPI_MUL:
 				r1 = POP();
 				r2 = POP();
 				stack.push_back(r1 * r2);
 				break;
-			case SIGNAL:
+			case OPI_SIGNAL:
 				r1 = POP();
 				owner->Signal(r1);
 				break;
-			case SET_SIGNAL_MASK:
+			case OPI_SET_SIGNAL_MASK:
 				r1 = POP();
 				signalMask = r1;
 				break;
-			case TURN:
+			case OPI_TURN:
 				r2 = POP();
 				r1 = POP();
 				r3 = GET_LONG_PC();
@@ -519,7 +700,7 @@ bool CCobThread::Tick()
 				//LOG_L(L_DEBUG, "Turning piece %s axis %d to %d speed %d", script.pieceNames[r3].c_str(), r4, r2, r1);
 				owner->Turn(r3, r4, r1, r2);
 				break;
-			case GET:
+			case OPI_GET:
 				r5 = POP();
 				r4 = POP();
 				r3 = POP();
@@ -532,18 +713,18 @@ bool CCobThread::Tick()
 				r6 = owner->GetUnitVal(r1, r2, r3, r4, r5);
 				stack.push_back(r6);
 				break;
-			case ADD:
+			case OPI_ADD:
 				r2 = POP();
 				r1 = POP();
 				stack.push_back(r1 + r2);
 				break;
-			case SUB:
+			case OPI_SUB:
 				r2 = POP();
 				r1 = POP();
 				r3 = r1 - r2;
 				stack.push_back(r3);
 				break;
-			case DIV:
+			case OPI_DIV:
 				r2 = POP();
 				r1 = POP();
 				if (r2 != 0)
@@ -554,7 +735,7 @@ bool CCobThread::Tick()
 				}
 				stack.push_back(r3);
 				break;
-			case MOD:
+			case OPI_MOD:
 				r2 = POP();
 				r1 = POP();
 				if (r2 != 0)
@@ -564,26 +745,26 @@ bool CCobThread::Tick()
 					LOG_L(L_ERROR, "modulo division by zero");
 				}
 				break;
-			case MOVE:
+			case OPI_MOVE:
 				r1 = GET_LONG_PC();
 				r2 = GET_LONG_PC();
 				r4 = POP();
 				r3 = POP();
 				owner->Move(r1, r2, r3, r4);
 				break;
-			case MOVE_NOW:{
+			case OPI_MOVE_NOW:{
 				r1 = GET_LONG_PC();
 				r2 = GET_LONG_PC();
 				r3 = POP();
 				owner->MoveNow(r1, r2, r3);
 				break;}
-			case TURN_NOW:{
+			case OPI_TURN_NOW:{
 				r1 = GET_LONG_PC();
 				r2 = GET_LONG_PC();
 				r3 = POP();
 				owner->TurnNow(r1, r2, r3);
 				break;}
-			case WAIT_TURN:
+			case OPI_WAIT_TURN:
 				r1 = GET_LONG_PC();
 				r2 = GET_LONG_PC();
 				//LOG_L(L_DEBUG, "Waiting for turn on piece %s around axis %d", script.pieceNames[r1].c_str(), r2);
@@ -593,7 +774,7 @@ bool CCobThread::Tick()
 				}
 				else
 					break;
-			case WAIT_MOVE:
+			case OPI_WAIT_MOVE:
 				r1 = GET_LONG_PC();
 				r2 = GET_LONG_PC();
 				//LOG_L(L_DEBUG, "Waiting for move on piece %s on axis %d", script.pieceNames[r1].c_str(), r2);
@@ -602,7 +783,7 @@ bool CCobThread::Tick()
 					return true;
 				}
 				break;
-			case SET:
+			case OPI_SET:
 				r2 = POP();
 				r1 = POP();
 				//LOG_L(L_DEBUG, "Setting unit value %d to %d", r1, r2);
@@ -612,24 +793,24 @@ bool CCobThread::Tick()
 				}
 				owner->SetUnitVal(r1, r2);
 				break;
-			case ATTACH:
+			case OPI_ATTACH:
 				r3 = POP();
 				r2 = POP();
 				r1 = POP();
 				owner->AttachUnit(r2, r1);
 				break;
-			case DROP:
+			case OPI_DROP:
 				r1 = POP();
 				owner->DropUnit(r1);
 				break;
-			case LOGICAL_NOT: // Like bitwise, but only on values 1 and 0.
+			case OPI_LOGICAL_NOT: // Like bitwise, but only on values 1 and 0.
 				r1 = POP();
 				if (r1 == 0)
 					stack.push_back(1);
 				else
 					stack.push_back(0);
 				break;
-			case LOGICAL_AND:
+			case OPI_LOGICAL_AND:
 				r1 = POP();
 				r2 = POP();
 				if (r1 && r2)
@@ -637,7 +818,7 @@ bool CCobThread::Tick()
 				else
 					stack.push_back(0);
 				break;
-			case LOGICAL_OR:
+			case OPI_LOGICAL_OR:
 				r1 = POP();
 				r2 = POP();
 				if (r1 || r2)
@@ -645,7 +826,7 @@ bool CCobThread::Tick()
 				else
 					stack.push_back(0);
 				break;
-			case LOGICAL_XOR:
+			case OPI_LOGICAL_XOR:
 				r1 = POP();
 				r2 = POP();
 				if (!!r1 ^ !!r2)
@@ -653,12 +834,12 @@ bool CCobThread::Tick()
 				else
 					stack.push_back(0);
 				break;
-			case HIDE:
+			case OPI_HIDE:
 				r1 = GET_LONG_PC();
 				owner->SetVisibility(r1, false);
 				//LOG_L(L_DEBUG, "Hiding %d", r1);
 				break;
-			case SHOW:{
+			case OPI_SHOW:{
 				r1 = GET_LONG_PC();
 				int i;
 				for (i = 0; i < MAX_WEAPONS_PER_UNIT; ++i)
@@ -783,10 +964,9 @@ string CCobThread::GetOpcodeName(int opcode)
 	return "unknown";
 }
 
-void CCobThread::DependentDied(CObject* o)
+void CCobThread::OwnerDied()
 {
-	if (o == owner)
-		owner = NULL;
+	owner = NULL;
 }
 
 /******************************************************************************/
@@ -4,7 +4,6 @@
 #define COB_THREAD_H
 
 #include "CobInstance.h"
-#include "System/Object.h"
 #include "Lua/LuaRules.h"
 
 #include <string>
@@ -14,13 +13,17 @@ class CCobFile;
 class CCobInstance;
 
 
-class CCobThread : public CObject, public CUnitScript::IAnimListener
+class CCobThread : public CUnitScript::IAnimListener
 {
 public:
 	CCobThread(CCobFile& script, CCobInstance* owner);
 	/// Inform the vultures that we finally croaked
 	~CCobThread();
 
+	/// threads come and go all the time, so they are pooled
+	static void* operator new(size_t size);
+	static void operator delete(void* p, size_t size);
+
 	/**
 	 * Returns false if this thread is dead and needs to be killed.
 	 */
@@ -36,7 +39,11 @@ public:
 	 * There can be only one.
 	 */
 	void SetCallback(CBCobThreadFinish cb, void* p1, void* p2);
-	void DependentDied(CObject* o);
+	/**
+	 * Called by the owning CCobInstance when it is destroyed, which
+	 * knows all its threads (no death dependence is needed).
+	 */
+	void OwnerDied();
 	/**
 	 * @brief Checks whether the stack has at least size items.
 	 * @returns min(size, stack.size())
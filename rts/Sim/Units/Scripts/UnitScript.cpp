@@ -6,6 +6,7 @@
 #include "CobDefines.h"
 #include "CobFile.h"
 #include "CobInstance.h"
+#include "NullUnitScript.h"
 #include "UnitScriptEngine.h"
 
 #ifndef _CONSOLE
@@ -84,20 +85,14 @@ CUnitScript::CUnitScript(CUnit* unit, const std::vector<LocalModelPiece*>& piece
 
 CUnitScript::~CUnitScript()
 {
-	bool haveAnimations = false;
-
-	for (int animType = ATurn; animType <= AMove; animType++) {
-		for (std::list<AnimInfo*>::iterator i = anims[animType].begin(); i != anims[animType].end(); ++i) {
-			// anim listeners are not owned by the anim in general, so don't delete them here
-			delete *i;
-		}
-
-		haveAnimations = (haveAnimations || !anims[animType].empty());
-	}
+	// the null script never animates, and as a static object it can be
+	// destroyed after GUnitScriptEngine (at exit); other scripts always
+	// deregister, their finished anims can still await notification
+	if (this == &CNullUnitScript::value)
+		return;
 
-	// Remove us from possible animation ticking
-	if (haveAnimations)
-		GUnitScriptEngine.RemoveInstance(this);
+	// anim listeners are not owned by the anim in general, so don't delete them here
+	GUnitScriptEngine.RemoveScript(this);
 }
 
 
@@ -106,14 +101,13 @@ CUnitScript::~CUnitScript()
 
 /**
  * @brief Unblocks all threads waiting on an animation
- * @param anim AnimInfo the corresponding animation
+ * @param listeners the listeners of the (already removed) animation
  */
-void CUnitScript::UnblockAll(AnimInfo* anim)
+void CUnitScript::UnblockAll(AnimType type, int piece, int axis, const std::vector<IAnimListener*>& listeners)
 {
-	std::list<IAnimListener *>::iterator li;
-
-	for (li = anim->listeners.begin(); li != anim->listeners.end(); ++li) {
-		(*li)->AnimFinished(anim->type, anim->piece, anim->axis);
+	// AnimFinished can remove the script, which clears the listeners
+	for (size_t n = 0; n < listeners.size(); n++) {
+		listeners[n]->AnimFinished(type, piece, axis);
 	}
 }
 
@@ -215,120 +209,24 @@ bool CUnitScript::DoSpin(float &cur, float dest, float &speed, float accel, int
 
 
 
-void CUnitScript::TickAnims(int deltaTime, AnimType type, std::list< std::list<AnimInfo*>::iterator >& doneAnims) {
-	switch (type) {
-		case AMove: {
-			for (std::list<AnimInfo*>::iterator it = anims[type].begin(); it != anims[type].end(); ++it) {
-				AnimInfo* ai = *it;
-
-				// NOTE: we should not need to copy-and-set here, because
-				// MoveToward/TurnToward/DoSpin modify pos/rot by reference
-				float3 pos = pieces[ai->piece]->GetPosition();
-
-				if (MoveToward(pos[ai->axis], ai->dest, ai->speed / (1000 / deltaTime))) {
-					ai->done = true; doneAnims.push_back(it);
-				}
-
-				pieces[ai->piece]->SetPosition(pos);
-			}
-		} break;
-
-		case ATurn: {
-			for (std::list<AnimInfo*>::iterator it = anims[type].begin(); it != anims[type].end(); ++it) {
-				AnimInfo* ai = *it;
-				float3 rot = pieces[ai->piece]->GetRotation();
-
-				if (TurnToward(rot[ai->axis], ai->dest, ai->speed / (1000 / deltaTime))) {
-					ai->done = true; doneAnims.push_back(it);
-				}
-
-				pieces[ai->piece]->SetRotation(rot);
-			}
-		} break;
-
-		case ASpin: {
-			for (std::list<AnimInfo*>::iterator it = anims[type].begin(); it != anims[type].end(); ++it) {
-				AnimInfo* ai = *it;
-				float3 rot = pieces[ai->piece]->GetRotation();
-
-				if (DoSpin(rot[ai->axis], ai->dest, ai->speed, ai->accel, 1000 / deltaTime)) {
-					ai->done = true; doneAnims.push_back(it);
-				}
-
-				pieces[ai->piece]->SetRotation(rot);
-			}
-		} break;
-
-		default: {
-		} break;
-	}
-}
-
-/**
- * @brief Called by the engine when we are registered as animating.
-          If we return false there are no active animations left.
- * @param deltaTime int delta time to update
- * @return true if there are still active animations
- */
-bool CUnitScript::Tick(int deltaTime)
+int CUnitScript::FindAnim(AnimType type, int piece, int axis) const
 {
-	typedef std::list<AnimInfo*>::iterator AnimInfoIt;
-
-	// list of _iterators_ to finished animations,
-	// so we can get rid of them in constant time
-	std::list<AnimInfoIt> doneAnims;
-
-	for (int animType = ATurn; animType <= AMove; animType++) {
-		TickAnims(deltaTime, AnimType(animType), doneAnims);
-	}
-
-	//! Tell listeners to unblock, and remove finished animations from the unit/script.
-	//! NOTE:
-	//!     removing a finished animation _must_ happen before notifying its listeners,
-	//!     otherwise the callback function (AnimFinished()) can call AddAnimListener()
-	//!     and append it to the listeners-list again (causing an endless loop)!
-	//! NOTE: UnblockAll might result in new anims being added
-	for (std::list<AnimInfoIt>::const_iterator it = doneAnims.begin(); it != doneAnims.end(); ++it) {
-		AnimInfoIt animInfoIt = *it;
-		AnimInfo* animInfo = *animInfoIt;
-
-		anims[animInfo->type].erase(animInfoIt);
-		UnblockAll(animInfo);
-		delete animInfo;
-	}
-
-	return (HaveAnimations());
+	return GUnitScriptEngine.FindAnim(this, type, piece, axis);
 }
 
-
-
-std::list<CUnitScript::AnimInfo*>::iterator CUnitScript::FindAnim(AnimType type, int piece, int axis)
+void CUnitScript::RemoveAnim(AnimType type, int row)
 {
-	for (std::list<AnimInfo*>::iterator i = anims[type].begin(); i != anims[type].end(); ++i) {
-		if (((*i)->piece == piece) && ((*i)->axis == axis))
-			return i;
-	}
-
-	return anims[type].end();
-}
+	if (row >= 0) {
+		const CUnitScriptEngine::AnimTable& table = GUnitScriptEngine.GetAnims(type);
+		const int piece = table.pieceNums[row];
+		const int axis = table.axes[row];
 
-void CUnitScript::RemoveAnim(AnimType type, const std::list<AnimInfo*>::iterator& animInfoIt)
-{
-	if (animInfoIt != anims[type].end()) {
-		AnimInfo* ai = *animInfoIt;
-		anims[type].erase(animInfoIt);
- 
-		// If this was the last animation, remove from currently animating list
-		// FIXME: this could be done in a cleaner way
-		if (!HaveAnimations()) {
-			GUnitScriptEngine.RemoveInstance(this);
-		}
+		std::vector<IAnimListener*> listeners;
+		GUnitScriptEngine.RemoveAnim(type, row, listeners);
 
 		//! We need to unblock threads waiting on this animation, otherwise they will be lost in the void
 		//! NOTE: UnblockAll might result in new anims being added
-		UnblockAll(ai);
-
-		delete ai;
+		UnblockAll(type, piece, axis, listeners);
 	}
 }
 
@@ -354,8 +252,7 @@ void CUnitScript::AddAnim(AnimType type, int piece, int axis, float speed, float
 		}
 	}
 
-	std::list<AnimInfo*>::iterator animInfoIt;
-	AnimInfo* ai = NULL;
+	int row = -1;
 	AnimType overrideType = ANone;
 
 	// first find an animation of a type we override
@@ -365,65 +262,53 @@ void CUnitScript::AddAnim(AnimType type, int piece, int axis, float speed, float
 	switch (type) {
 		case ATurn: {
 			overrideType = ASpin;
-			animInfoIt = FindAnim(overrideType, piece, axis);
+			row = FindAnim(overrideType, piece, axis);
 		} break;
 		case ASpin: {
 			overrideType = ATurn;
-			animInfoIt = FindAnim(overrideType, piece, axis);
+			row = FindAnim(overrideType, piece, axis);
 		} break;
 		case AMove: {
 			// ensure we never remove an animation of this type
 			overrideType = AMove;
-			animInfoIt = anims[overrideType].end();
+			row = -1;
 		} break;
 		default: {
 		} break;
 	}
 
-	if (animInfoIt != anims[overrideType].end())
-		RemoveAnim(overrideType, animInfoIt);
+	if (row >= 0)
+		RemoveAnim(overrideType, row);
 
 	// now find an animation of our own type
-	animInfoIt = FindAnim(type, piece, axis);
-
-	if (animInfoIt == anims[type].end()) {
-		// If we were not animating before, inform the engine of this so it can schedule us
-		// FIXME: this could be done in a cleaner way
-		if (!HaveAnimations()) {
-			GUnitScriptEngine.AddInstance(this);
-		}
+	row = FindAnim(type, piece, axis);
 
-		ai = new AnimInfo();
-		ai->type = type;
-		ai->piece = piece;
-		ai->axis = axis;
-		anims[type].push_back(ai);
-	} else {
-		ai = *animInfoIt;
+	if (row < 0) {
+		row = GUnitScriptEngine.AddAnim(this, type, piece, axis);
 	}
 
-	ai->dest  = destf;
-	ai->speed = speed;
-	ai->accel = accel;
-	ai->done = false;
+	CUnitScriptEngine::AnimTable& table = GUnitScriptEngine.GetAnims(type);
+	table.dests[row]  = destf;
+	table.speeds[row] = speed;
+	table.accels[row] = accel;
 }
 
 
 void CUnitScript::Spin(int piece, int axis, float speed, float accel)
 {
-	std::list<AnimInfo*>::iterator animInfoIt = FindAnim(ASpin, piece, axis);
+	const int row = FindAnim(ASpin, piece, axis);
 
 	//If we are already spinning, we may have to decelerate to the new speed
-	if (animInfoIt != anims[ASpin].end()) {
-		AnimInfo* ai = *animInfoIt;
-		ai->dest = speed;
+	if (row >= 0) {
+		CUnitScriptEngine::AnimTable& table = GUnitScriptEngine.GetAnims(ASpin);
+		table.dests[row] = speed;
 
 		if (accel > 0) {
-			ai->accel = accel;
+			table.accels[row] = accel;
 		} else {
 			//Go there instantly. Or have a defaul accel?
-			ai->speed = speed;
-			ai->accel = 0;
+			table.speeds[row] = speed;
+			table.accels[row] = 0;
 		}
 	} else {
 		//No accel means we start at desired speed instantly
@@ -437,17 +322,17 @@ void CUnitScript::Spin(int piece, int axis, float speed, float accel)
 
 void CUnitScript::StopSpin(int piece, int axis, float decel)
 {
-	std::list<AnimInfo*>::iterator animInfoIt = FindAnim(ASpin, piece, axis);
+	const int row = FindAnim(ASpin, piece, axis);
 
 	if (decel <= 0) {
-		RemoveAnim(ASpin, animInfoIt);
+		RemoveAnim(ASpin, row);
 	} else {
-		if (animInfoIt == anims[ASpin].end())
+		if (row < 0)
 			return;
 
-		AnimInfo* ai = *animInfoIt;
-		ai->dest = 0;
-		ai->accel = decel;
+		CUnitScriptEngine::AnimTable& table = GUnitScriptEngine.GetAnims(ASpin);
+		table.dests[row] = 0;
+		table.accels[row] = decel;
 	}
 }
 
@@ -738,26 +623,14 @@ void CUnitScript::DropUnit(int u)
 //Returns true if there was an animation to listen to
 bool CUnitScript::AddAnimListener(AnimType type, int piece, int axis, IAnimListener *listener)
 {
-	std::list<AnimInfo*>::iterator animInfoIt = FindAnim(type, piece, axis);
+	const int row = FindAnim(type, piece, axis);
 
-	if (animInfoIt != anims[type].end()) {
-		AnimInfo* ai = *animInfoIt;
-
-		if (!ai->done) {
-			ai->listeners.push_back(listener);
-			return true;
-		}
-
-		// if the animation is already finished, listening for
-		// it just adds some overhead since either the current
-		// or the next Tick will remove it and call UnblockAll
-		// (which calls AnimFinished for each listener)
-		//
-		// we could notify the listener here, but a cleaner way
-		// is to treat the animation as if it did not exist and
-		// simply disregard the WaitFor* (no side-effects)
-		//
-		// listener->AnimFinished(ai->type, ai->piece, ai->axis);
+	// finished animations are removed before their listeners are
+	// notified, so listening for one is treated as if it did not
+	// exist and the WaitFor* is simply disregarded (no side-effects)
+	if (row >= 0) {
+		GUnitScriptEngine.GetAnims(type).listeners[row].push_back(listener);
+		return true;
 	}
 
 	return false;
@@ -1674,35 +1547,54 @@ void CUnitScript::SetUnitVal(int val, int param)
 
 void CUnitScript::BenchmarkScript(CUnitScript* script)
 {
+	BenchmarkScript(std::vector<CUnitScript*>(1, script));
+}
+
+
+void CUnitScript::BenchmarkScript(const std::vector<CUnitScript*>& scripts)
+{
+	if (scripts.empty())
+		return;
+
 	const int duration = 10000; // millisecs
+	const unsigned numScripts = scripts.size();
 
 	const unsigned start = SDL_GetTicks();
 	unsigned end = start;
-	int count = 0;
+	unsigned count = 0;
 
 	while ((end - start) < duration) {
-		for (int i = 0; i < 10000; ++i) {
-			script->QueryWeapon(0);
+		// call every instance in turn (rather than one instance over and
+		// over), at least 10000 times between reading the clock
+		for (unsigned i = 0; i < 10000; i += numScripts) {
+			for (unsigned n = 0; n < numScripts; ++n) {
+				scripts[n]->QueryWeapon(0);
+			}
+
+			count += numScripts;
 		}
-		++count;
+
 		end = SDL_GetTicks();
 	}
 
-	LOG("%d0000 calls in %u ms -> %.0f calls/second",
-			count, end - start, float(count) * (10000 / (duration / 1000)));
+	LOG("%u calls on %u instances in %u ms -> %.0f calls/second",
+			count, numScripts, end - start, count * (1000.0f / (end - start)));
 }
 
 
 void CUnitScript::BenchmarkScript(const std::string& unitname)
 {
-	std::list<CUnit*>::iterator ui = uh->activeUnits.begin();
+	std::vector<CUnitScript*> scripts;
+
+	std::vector<CUnit*>::iterator ui = uh->activeUnits.begin();
 	for (; ui != uh->activeUnits.end(); ++ui) {
 		CUnit* unit = *ui;
-		if (unit->unitDef->name == unitname) {
-			BenchmarkScript(unit->script);
-			return;
+		if (unitname == "*" || unit->unitDef->name == unitname) {
+			scripts.push_back(unit->script);
 		}
 	}
+
+	BenchmarkScript(scripts);
 }
 
 #endif
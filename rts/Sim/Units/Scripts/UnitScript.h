@@ -63,33 +63,26 @@ protected:
 	bool yardOpen;
 	bool busy;
 
-	struct AnimInfo {
-		AnimType type;
-		int axis;
-		int piece;
-		float speed;
-		float dest;     // means final position when turning or moving, final speed when spinning
-		float accel;    // used for spinning, can be negative
-		bool done;
-		std::list<IAnimListener*> listeners;
-	};
-
-	std::list<AnimInfo*> anims[AMove + 1];
+	/// rows of our animations in the tables of GUnitScriptEngine, by type
+	std::vector<int> animRows[AMove + 1];
 
 	bool hasSetSFXOccupy;
 	bool hasRockUnit;
 	bool hasStartBuilding;
 
-	void UnblockAll(AnimInfo* anim);
+	static void UnblockAll(AnimType type, int piece, int axis, const std::vector<IAnimListener*>& listeners);
 
-	bool MoveToward(float &cur, float dest, float speed);
-	bool TurnToward(float &cur, float dest, float speed);
-	bool DoSpin(float &cur, float dest, float &speed, float accel, int divisor);
+	static bool MoveToward(float &cur, float dest, float speed);
+	static bool TurnToward(float &cur, float dest, float speed);
+	static bool DoSpin(float &cur, float dest, float &speed, float accel, int divisor);
 
-	std::list<AnimInfo*>::iterator FindAnim(AnimType anim, int piece, int axis);
-	void RemoveAnim(AnimType type, const std::list<AnimInfo*>::iterator& animInfoIt);
+	/// @return row of the animation in GUnitScriptEngine's table for the type, or -1
+	int FindAnim(AnimType type, int piece, int axis) const;
+	void RemoveAnim(AnimType type, int row);
 	void AddAnim(AnimType type, int piece, int axis, float speed, float dest, float accel);
 
+	friend class CUnitScriptEngine;
+
 	virtual void ShowScriptError(const std::string& msg) = 0;
 
 public:
@@ -140,9 +133,6 @@ public:
 	      CUnit* GetUnit()       { return unit; }
 	const CUnit* GetUnit() const { return unit; }
 
-	bool Tick(int deltaTime);
-	void TickAnims(int deltaTime, AnimType type, std::list< std::list<AnimInfo*>::iterator >& doneAnims);
-
 	// animation, used by CCobThread
 	void Spin(int piece, int axis, float speed, float accel);
 	void StopSpin(int piece, int axis, float decel);
@@ -164,11 +154,11 @@ public:
 	int GetUnitVal(int val, int p1, int p2, int p3, int p4);
 	void SetUnitVal(int val, int param);
 
-	bool IsInAnimation(AnimType type, int piece, int axis) {
-		return (FindAnim(type, piece, axis) != anims[type].end());
+	bool IsInAnimation(AnimType type, int piece, int axis) const {
+		return (FindAnim(type, piece, axis) >= 0);
 	}
 	bool HaveAnimations() const {
-		return (!anims[ATurn].empty() || !anims[ASpin].empty() || !anims[AMove].empty());
+		return (!animRows[ATurn].empty() || !animRows[ASpin].empty() || !animRows[AMove].empty());
 	}
 
 	// checks for callin existence
@@ -226,6 +216,8 @@ public:
 
 	// not necessary for normal operation, useful to measure callin speed
 	static void BenchmarkScript(CUnitScript* script);
+	static void BenchmarkScript(const std::vector<CUnitScript*>& scripts);
+	/// benchmarks all units of the given type at once, or all units for "*"
 	static void BenchmarkScript(const std::string& unitname);
 };
 
@@ -8,6 +8,8 @@
 
 #include "System/FileSystem/FileHandler.h"
 
+#include <algorithm>
+
 #ifndef _CONSOLE
 	#include "System/TimeProfiler.h"
 #else
@@ -26,7 +28,7 @@ CUnitScriptEngine GUnitScriptEngine;
 /******************************************************************************/
 
 
-CUnitScriptEngine::CUnitScriptEngine() : currentScript(NULL)
+CUnitScriptEngine::CUnitScriptEngine()
 {
 }
 
@@ -36,42 +38,197 @@ CUnitScriptEngine::~CUnitScriptEngine()
 }
 
 
-void CUnitScriptEngine::CheckForDuplicates(const char* name, CUnitScript* instance)
+int CUnitScriptEngine::FindAnim(const CUnitScript* script, AnimType type, int piece, int axis) const
 {
-	int found = 0;
+	const AnimTable& table = anims[type];
+	const std::vector<int>& rows = script->animRows[type];
 
-	for (std::list<CUnitScript*>::iterator i = animating.begin(); i != animating.end(); ++i) {
-		if (*i == instance)
-			found++;
+	for (size_t n = 0; n < rows.size(); n++) {
+		if ((table.pieceNums[rows[n]] == piece) && (table.axes[rows[n]] == axis))
+			return rows[n];
 	}
 
-	if (found > 1)
-		LOG_L(L_WARNING, "%s found duplicates %d", name, found);
+	return -1;
 }
 
 
-void CUnitScriptEngine::AddInstance(CUnitScript *instance)
+int CUnitScriptEngine::AddAnim(CUnitScript* script, AnimType type, int piece, int axis)
 {
-	if (instance != currentScript)
-		animating.push_front(instance);
+	AnimTable& table = anims[type];
+	const int row = table.size();
 
-	// Error checking
-#ifdef _DEBUG
-	CheckForDuplicates(__FUNCTION__, instance);
-#endif
+	table.scripts.push_back(script);
+	table.pieces.push_back(script->pieces[piece]);
+	table.pieceNums.push_back(piece);
+	table.axes.push_back(axis);
+	table.dests.push_back(0.0f);
+	table.speeds.push_back(0.0f);
+	table.accels.push_back(0.0f);
+	table.listeners.push_back(std::vector<IAnimListener*>());
+
+	script->animRows[type].push_back(row);
+	return row;
 }
 
 
-void CUnitScriptEngine::RemoveInstance(CUnitScript *instance)
+void CUnitScriptEngine::RemoveAnim(AnimType type, int row, std::vector<IAnimListener*>& listeners)
 {
-	// Error checking
-#ifdef _DEBUG
-	CheckForDuplicates(__FUNCTION__, instance);
-#endif
+	AnimTable& table = anims[type];
+	const int lastRow = table.size() - 1;
+
+	listeners.clear();
+	listeners.swap(table.listeners[row]);
 
-	//This is slow. would be better if instance was a hashlist perhaps
-	if (instance != currentScript)
-		animating.remove(instance);
+	// forget the row in its script, then move the last one into it
+	std::vector<int>& rows = table.scripts[row]->animRows[type];
+	rows.erase(std::find(rows.begin(), rows.end(), row));
+
+	if (row != lastRow) {
+		std::vector<int>& lastRows = table.scripts[lastRow]->animRows[type];
+		*std::find(lastRows.begin(), lastRows.end(), lastRow) = row;
+
+		table.scripts[row]   = table.scripts[lastRow];
+		table.pieces[row]    = table.pieces[lastRow];
+		table.pieceNums[row] = table.pieceNums[lastRow];
+		table.axes[row]      = table.axes[lastRow];
+		table.dests[row]     = table.dests[lastRow];
+		table.speeds[row]    = table.speeds[lastRow];
+		table.accels[row]    = table.accels[lastRow];
+		table.listeners[row].swap(table.listeners[lastRow]);
+	}
+
+	table.scripts.pop_back();
+	table.pieces.pop_back();
+	table.pieceNums.pop_back();
+	table.axes.pop_back();
+	table.dests.pop_back();
+	table.speeds.pop_back();
+	table.accels.pop_back();
+	table.listeners.pop_back();
+}
+
+
+void CUnitScriptEngine::RemoveScript(CUnitScript* script)
+{
+	std::vector<IAnimListener*> listeners;
+
+	for (int animType = CUnitScript::ATurn; animType <= CUnitScript::AMove; animType++) {
+		std::vector<int>& rows = script->animRows[animType];
+
+		while (!rows.empty()) {
+			RemoveAnim(AnimType(animType), rows.back(), listeners);
+		}
+	}
+
+	// the script can die while the listeners of finished anims are notified
+	for (size_t n = 0; n < finishedAnims.size(); n++) {
+		if (finishedAnims[n].script != script)
+			continue;
+
+		finishedAnims[n].script = NULL;
+		finishedAnims[n].listeners.clear();
+	}
+}
+
+
+void CUnitScriptEngine::GetAnimListeners(const CUnitScript* script, std::vector<IAnimListener*>& listeners) const
+{
+	for (int animType = CUnitScript::ATurn; animType <= CUnitScript::AMove; animType++) {
+		const AnimTable& table = anims[animType];
+		const std::vector<int>& rows = script->animRows[animType];
+
+		for (size_t n = 0; n < rows.size(); n++) {
+			listeners.insert(listeners.end(), table.listeners[rows[n]].begin(), table.listeners[rows[n]].end());
+		}
+	}
+
+	for (size_t n = 0; n < finishedAnims.size(); n++) {
+		if (finishedAnims[n].script != script)
+			continue;
+
+		listeners.insert(listeners.end(), finishedAnims[n].listeners.begin(), finishedAnims[n].listeners.end());
+	}
+}
+
+
+/******************************************************************************/
+
+
+void CUnitScriptEngine::TickTurnAnims(int divisor)
+{
+	AnimTable& table = anims[CUnitScript::ATurn];
+
+	for (size_t row = 0; row < table.size(); row++) {
+		LocalModelPiece* piece = table.pieces[row];
+		float3 rot = piece->GetRotation();
+
+		if (CUnitScript::TurnToward(rot[table.axes[row]], table.dests[row], table.speeds[row] / divisor)) {
+			finishedRows.push_back(row);
+		}
+
+		piece->SetRotation(rot);
+	}
+}
+
+
+void CUnitScriptEngine::TickSpinAnims(int divisor)
+{
+	AnimTable& table = anims[CUnitScript::ASpin];
+
+	for (size_t row = 0; row < table.size(); row++) {
+		LocalModelPiece* piece = table.pieces[row];
+		float3 rot = piece->GetRotation();
+
+		if (CUnitScript::DoSpin(rot[table.axes[row]], table.dests[row], table.speeds[row], table.accels[row], divisor)) {
+			finishedRows.push_back(row);
+		}
+
+		piece->SetRotation(rot);
+	}
+}
+
+
+void CUnitScriptEngine::TickMoveAnims(int divisor)
+{
+	AnimTable& table = anims[CUnitScript::AMove];
+
+	for (size_t row = 0; row < table.size(); row++) {
+		LocalModelPiece* piece = table.pieces[row];
+		float3 pos = piece->GetPosition();
+
+		if (CUnitScript::MoveToward(pos[table.axes[row]], table.dests[row], table.speeds[row] / divisor)) {
+			finishedRows.push_back(row);
+		}
+
+		piece->SetPosition(pos);
+	}
+}
+
+
+void CUnitScriptEngine::FinishAnims(AnimType type)
+{
+	const AnimTable& table = anims[type];
+	const size_t numFinished = finishedAnims.size();
+
+	finishedAnims.resize(numFinished + finishedRows.size());
+
+	for (size_t n = 0; n < finishedRows.size(); n++) {
+		FinishedAnim& fa = finishedAnims[numFinished + n];
+		const int row = finishedRows[n];
+
+		fa.script = table.scripts[row];
+		fa.type = type;
+		fa.piece = table.pieceNums[row];
+		fa.axis = table.axes[row];
+	}
+
+	// removing a row moves the last one into it, so go
+	// backwards to only ever move rows that keep running
+	for (size_t n = finishedRows.size(); n > 0; n--) {
+		RemoveAnim(type, finishedRows[n - 1], finishedAnims[numFinished + n - 1].listeners);
+	}
+
+	finishedRows.clear();
 }
 
 
@@ -79,18 +236,27 @@ void CUnitScriptEngine::Tick(int deltaTime)
 {
 	SCOPED_TIMER("UnitScriptEngine::Tick");
 
-	// Tick all instances that have registered themselves as animating
-	for (std::list<CUnitScript*>::iterator it = animating.begin(); it != animating.end(); ) {
-		currentScript = *it;
+	const int divisor = 1000 / deltaTime;
 
-		if (currentScript->Tick(deltaTime)) {
-			++it;
-		} else {
-			it = animating.erase(it);
-		}
+	TickTurnAnims(divisor);
+	FinishAnims(CUnitScript::ATurn);
+	TickSpinAnims(divisor);
+	FinishAnims(CUnitScript::ASpin);
+	TickMoveAnims(divisor);
+	FinishAnims(CUnitScript::AMove);
+
+	//! Tell listeners to unblock; the finished animations were removed already.
+	//! NOTE:
+	//!     removing a finished animation _must_ happen before notifying its listeners,
+	//!     otherwise the callback function (AnimFinished()) can call AddAnimListener()
+	//!     and append it to the listeners-list again (causing an endless loop)!
+	//! NOTE: UnblockAll might result in new anims being added, or scripts being removed
+	for (size_t n = 0; n < finishedAnims.size(); n++) {
+		const FinishedAnim& fa = finishedAnims[n];
+		CUnitScript::UnblockAll(fa.type, fa.piece, fa.axis, fa.listeners);
 	}
 
-	currentScript = NULL;
+	finishedAnims.clear();
 }
 
 
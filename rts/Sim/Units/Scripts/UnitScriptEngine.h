@@ -5,27 +5,86 @@
 #ifndef UNIT_SCRIPT_ENGINE_H
 #define UNIT_SCRIPT_ENGINE_H
 
-#include <list>
+#include <vector>
 
-class CUnit;
-class CUnitScript;
+#include "UnitScript.h"
 
 
+/**
+ * Owns the piece animations of all unit scripts and ticks them.
+ *
+ * The animations of each type are kept in one table (a structure of arrays)
+ * for all units, which Tick walks in one loop. Finished animations are taken
+ * out of their table before their listeners are notified, from a list of
+ * them, since AnimFinished may start or stop animations of any unit.
+ */
 class CUnitScriptEngine
 {
-protected:
-	std::list<CUnitScript*> animating; // hash would be optimal, but not crucial
-	void CheckForDuplicates(const char* name, CUnitScript* instance);
+public:
+	typedef CUnitScript::AnimType AnimType;
+	typedef CUnitScript::IAnimListener IAnimListener;
+
+	struct AnimTable {
+		size_t size() const { return scripts.size(); }
+
+		std::vector<CUnitScript*> scripts;
+		std::vector<LocalModelPiece*> pieces;
+		/// script piece numbers (of the pieces above)
+		std::vector<int> pieceNums;
+		std::vector<int> axes;
+		/// final position when turning or moving, final speed when spinning
+		std::vector<float> dests;
+		std::vector<float> speeds;
+		/// used for spinning, can be negative
+		std::vector<float> accels;
+		std::vector< std::vector<IAnimListener*> > listeners;
+	};
 
 public:
 	CUnitScriptEngine();
 	~CUnitScriptEngine();
-	void AddInstance(CUnitScript* instance);
-	void RemoveInstance(CUnitScript* instance);
+
 	void Tick(int deltaTime);
 
+	AnimTable& GetAnims(AnimType type) { return anims[type]; }
+
+	/// @return row of the animation in the table of its type, or -1
+	int FindAnim(const CUnitScript* script, AnimType type, int piece, int axis) const;
+	/// @return row of the new animation, which is not moving yet
+	int AddAnim(CUnitScript* script, AnimType type, int piece, int axis);
+	/**
+	 * Removes an animation without notifying its listeners, which are
+	 * returned instead. This moves the last row of the table into its row.
+	 */
+	void RemoveAnim(AnimType type, int row, std::vector<IAnimListener*>& listeners);
+
+	/// removes all animations of the script, and all pending notifications for them
+	void RemoveScript(CUnitScript* script);
+	/// collects the listeners of all animations of the script
+	void GetAnimListeners(const CUnitScript* script, std::vector<IAnimListener*>& listeners) const;
+
 private:
-	CUnitScript* currentScript;
+	void TickTurnAnims(int divisor);
+	void TickSpinAnims(int divisor);
+	void TickMoveAnims(int divisor);
+	/// moves the rows in finishedRows to finishedAnims
+	void FinishAnims(AnimType type);
+
+	struct FinishedAnim {
+		/// NULL once the script is gone
+		CUnitScript* script;
+		AnimType type;
+		int piece;
+		int axis;
+		std::vector<IAnimListener*> listeners;
+	};
+
+	AnimTable anims[CUnitScript::AMove + 1];
+
+	/// rows that finished in this Tick, in ascending order
+	std::vector<int> finishedRows;
+	/// animations that finished in this Tick, their listeners are notified last
+	std::vector<FinishedAnim> finishedAnims;
 };
 
 extern CUnitScriptEngine GUnitScriptEngine;
@@ -443,6 +443,7 @@ void CUnit::PreInit(const UnitDef* uDef, int uTeam, int facing, const float3& po
 		unitDef->tidalGenerator * mapInfo->map.tidalStrength;
 
 	moveType = MoveTypeFactory::GetMoveType(this, unitDef);
+	uh->UnitMoveTypeChanged(this);
 	script = CUnitScriptFactory::CreateScript(unitDef->scriptPath, this);
 }
 
@@ -618,6 +619,7 @@ void CUnit::EnableScriptMoveType()
 	prevMoveType = moveType;
 	moveType = new CScriptMoveType(this);
 	usingScriptMoveType = true;
+	uh->UnitMoveTypeChanged(this);
 }
 
 void CUnit::DisableScriptMoveType()
@@ -630,6 +632,7 @@ void CUnit::DisableScriptMoveType()
 	moveType = prevMoveType;
 	prevMoveType = NULL;
 	usingScriptMoveType = false;
+	uh->UnitMoveTypeChanged(this);
 
 	// FIXME: prevent the issuing of extra commands ?
 	if (moveType) {
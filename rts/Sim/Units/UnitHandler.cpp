@@ -9,6 +9,7 @@
 #include "UnitDefHandler.h"
 #include "CommandAI/BuilderCAI.h"
 #include "CommandAI/Command.h"
+#include "Game/GameHelper.h"
 #include "Game/GameSetup.h"
 #include "Game/GlobalUnsynced.h"
 #include "Map/Ground.h"
@@ -17,8 +18,11 @@
 #include "Sim/Features/FeatureDef.h"
 #include "Sim/Misc/AirBaseHandler.h"
 #include "Sim/Misc/GroundBlockingObjectMap.h"
+#include "Sim/Misc/LosHandler.h"
 #include "Sim/Misc/QuadField.h"
+#include "Sim/Misc/RadarHandler.h"
 #include "Sim/Misc/TeamHandler.h"
+#include "Sim/MoveTypes/GroundMoveType.h"
 #include "Sim/MoveTypes/MoveType.h"
 #include "System/EventHandler.h"
 #include "System/EventBatchHandler.h"
@@ -57,7 +61,16 @@ CR_REG_METADATA(CUnitHandler, (
 void CUnitHandler::PostLoad()
 {
 	// reset any synced stuff that is not saved
-	slowUpdateIterator = activeUnits.end();
+	activeUnitIndices.clear();
+	activeUnitIndices.resize(units.size(), -1u);
+	activeMoveTypes.resize(activeUnits.size());
+
+	for (unsigned int i = 0; i < activeUnits.size(); i++) {
+		SetActiveUnit(i, activeUnits[i]);
+	}
+
+	numPlacedActiveUnits = activeUnits.size();
+	activeSlowUpdateUnit = activeUnits.size();
 }
 
 
@@ -65,6 +78,8 @@ CUnitHandler::CUnitHandler()
 :
 	maxUnitRadius(0.0f),
 	morphUnitToFeature(true),
+	numPlacedActiveUnits(0),
+	activeSlowUpdateUnit(0),
 	maxUnits(0)
 {
 	// note: the number of active teams can change at run-time, so
@@ -75,6 +90,7 @@ CUnitHandler::CUnitHandler()
 	}
 
 	units.resize(maxUnits, NULL);
+	activeUnitIndices.resize(maxUnits, -1u);
 	unitsByDefs.resize(teamHandler->ActiveTeams(), std::vector<CUnitSet>(unitDefHandler->unitDefs.size()));
 
 	{
@@ -96,14 +112,13 @@ CUnitHandler::CUnitHandler()
 		std::copy(freeIDs.begin(), freeIDs.end(), std::front_inserter(freeUnitIDs));
 	}
 
-	slowUpdateIterator = activeUnits.end();
 	airBaseHandler = new CAirBaseHandler();
 }
 
 
 CUnitHandler::~CUnitHandler()
 {
-	for (std::list<CUnit*>::iterator usi = activeUnits.begin(); usi != activeUnits.end(); ++usi) {
+	for (std::vector<CUnit*>::iterator usi = activeUnits.begin(); usi != activeUnits.end(); ++usi) {
 		// ~CUnit dereferences featureHandler which is destroyed already
 		(*usi)->delayedWreckLevel = -1;
 		delete (*usi);
@@ -127,17 +142,10 @@ bool CUnitHandler::AddUnit(CUnit *unit)
 	freeUnitIDs.pop_front();
 	units[unit->id] = unit;
 
-	std::list<CUnit*>::iterator ui = activeUnits.begin();
-	if (ui != activeUnits.end()) {
-		// randomize this to make the slow-update order random (good if one
-		// builds say many buildings at once and then many mobile ones etc)
-		const unsigned int insertionPos = gs->randFloat() * activeUnits.size();
-
-		for (unsigned int n = 0; n < insertionPos; ++n) {
-			++ui;
-		}
-	}
-	activeUnits.insert(ui, unit);
+	// appended for now, PlaceActiveUnits moves it to its final position
+	activeUnits.push_back(unit);
+	activeMoveTypes.push_back(NULL);
+	SetActiveUnit(activeUnits.size() - 1, unit);
 
 	teamHandler->Team(unit->team)->AddUnit(unit, CTeam::AddBuilt);
 	unitsByDefs[unit->team][unit->unitDef->id].insert(unit);
@@ -155,45 +163,101 @@ void CUnitHandler::DeleteUnit(CUnit* unit)
 
 void CUnitHandler::DeleteUnitNow(CUnit* delUnit)
 {
-	int delTeam = 0;
-	int delType = 0;
-
-	std::list<CUnit*>::iterator usi;
-	for (usi = activeUnits.begin(); usi != activeUnits.end(); ++usi) {
-		if (*usi == delUnit) {
-			if (slowUpdateIterator != activeUnits.end() && *usi == *slowUpdateIterator) {
-				++slowUpdateIterator;
-			}
-			delTeam = delUnit->team;
-			delType = delUnit->unitDef->id;
+	const int delTeam = delUnit->team;
+	const int delType = delUnit->unitDef->id;
+	const int delID = delUnit->id;
 
-			GML_STDMUTEX_LOCK(dque); // DeleteUnitNow
+	assert(activeUnitIndices[delID] < activeUnits.size());
+	assert(activeUnits[activeUnitIndices[delID]] == delUnit);
 
-			int delID = delUnit->id;
-			activeUnits.erase(usi);
-			units[delID] = 0;
-			freeUnitIDs.push_back(delID);
-			teamHandler->Team(delTeam)->RemoveUnit(delUnit, CTeam::RemoveDied);
+	GML_STDMUTEX_LOCK(dque); // DeleteUnitNow
 
-			unitsByDefs[delTeam][delType].erase(delUnit);
+	RemoveActiveUnit(delUnit);
+	units[delID] = 0;
+	freeUnitIDs.push_back(delID);
+	teamHandler->Team(delTeam)->RemoveUnit(delUnit, CTeam::RemoveDied);
 
-			CSolidObject::SetDeletingRefID(delID);
-			delete delUnit;
-			CSolidObject::SetDeletingRefID(-1);
-			break;
-		}
-	}
+	unitsByDefs[delTeam][delType].erase(delUnit);
+
+	CSolidObject::SetDeletingRefID(delID);
+	delete delUnit;
+	CSolidObject::SetDeletingRefID(-1);
+}
 
-#ifdef _DEBUG
-	for (usi = activeUnits.begin(); usi != activeUnits.end(); /* no post-op */) {
-		if (*usi == delUnit) {
-			LOG_L(L_ERROR, "Duplicated unit found in active units on erase");
-			usi = activeUnits.erase(usi);
+
+void CUnitHandler::UnitMoveTypeChanged(const CUnit* unit)
+{
+	activeMoveTypes[activeUnitIndices[unit->id]] = unit->moveType;
+}
+
+
+void CUnitHandler::SetActiveUnit(unsigned int idx, CUnit* unit)
+{
+	activeUnits[idx] = unit;
+	activeUnitIndices[unit->id] = idx;
+
+	activeMoveTypes[idx] = unit->moveType;
+}
+
+void CUnitHandler::PlaceActiveUnits()
+{
+	// move each unit added since the last Update to a random index, this
+	// makes the slow-update order random (good if one builds say many
+	// buildings at once and then many mobile ones etc)
+	//
+	// units before activeSlowUpdateUnit already had their SlowUpdate in
+	// this cycle, those that are moved must stay on the same side of it
+	for (unsigned int idx = numPlacedActiveUnits; idx < activeUnits.size(); idx++) {
+		CUnit* unit = activeUnits[idx];
+
+		const unsigned int pos = gs->randFloat() * idx;
+
+		if (pos < activeSlowUpdateUnit) {
+			// the new unit waits for the next cycle
+			SetActiveUnit(idx, activeUnits[activeSlowUpdateUnit]);
+			SetActiveUnit(activeSlowUpdateUnit, activeUnits[pos]);
+			SetActiveUnit(pos, unit);
+
+			activeSlowUpdateUnit++;
 		} else {
-			++usi;
+			SetActiveUnit(idx, activeUnits[pos]);
+			SetActiveUnit(pos, unit);
 		}
 	}
-#endif
+
+	numPlacedActiveUnits = activeUnits.size();
+}
+
+void CUnitHandler::RemoveActiveUnit(const CUnit* unit)
+{
+	unsigned int idx = activeUnitIndices[unit->id];
+
+	// move the gap to the end without moving any unit across the
+	// activeSlowUpdateUnit or numPlacedActiveUnits boundaries (the
+	// former is never beyond the latter)
+	if (idx < activeSlowUpdateUnit) {
+		activeSlowUpdateUnit--;
+
+		if (idx != activeSlowUpdateUnit)
+			SetActiveUnit(idx, activeUnits[activeSlowUpdateUnit]);
+
+		idx = activeSlowUpdateUnit;
+	}
+	if (idx < numPlacedActiveUnits) {
+		numPlacedActiveUnits--;
+
+		if (idx != numPlacedActiveUnits)
+			SetActiveUnit(idx, activeUnits[numPlacedActiveUnits]);
+
+		idx = numPlacedActiveUnits;
+	}
+	if (idx != (activeUnits.size() - 1)) {
+		SetActiveUnit(idx, activeUnits.back());
+	}
+
+	activeUnitIndices[unit->id] = -1u;
+	activeUnits.pop_back();
+	activeMoveTypes.pop_back();
 }
 
 
@@ -223,6 +287,8 @@ void CUnitHandler::Update()
 			}
 		}
 
+		PlaceActiveUnits();
+
 		eventHandler.UpdateUnits();
 	}
 
@@ -253,14 +319,21 @@ void CUnitHandler::Update()
 
 	{
 		SCOPED_TIMER("Unit::MoveType::Update");
-		std::list<CUnit*>::iterator usi;
-		for (usi = activeUnits.begin(); usi != activeUnits.end(); ++usi) {
-			CUnit* unit = *usi;
-			AMoveType* moveType = unit->moveType;
+
+		// sensor updates of moved units are done in bulk afterwards
+		loshandler->SetBatchMoveUnits(true);
+		radarhandler->SetBatchMoveUnits(true);
+
+		// phase one of the two-phase update (if enabled)
+		CGroundMoveType::PrepareUpdates(activeMoveTypes);
+
+		// NOTE: units created meanwhile are appended, so use indices
+		for (unsigned int i = 0; i < activeUnits.size(); ++i) {
+			CUnit* unit = activeUnits[i];
 
 			UNIT_SANITY_CHECK(unit);
 
-			if (moveType->Update()) {
+			if (activeMoveTypes[i]->Update()) {
 				eventHandler.UnitMoved(unit);
 			}
 			if (!unit->pos.IsInBounds() && (unit->speed.SqLength() > (MAX_UNIT_SPEED * MAX_UNIT_SPEED))) {
@@ -272,13 +345,17 @@ void CUnitHandler::Update()
 			UNIT_SANITY_CHECK(unit);
 			GML_GET_TICKS(unit->lastUnitUpdate);
 		}
+
+		loshandler->SetBatchMoveUnits(false);
+		radarhandler->SetBatchMoveUnits(false);
+		loshandler->FlushMoveUnits();
+		radarhandler->FlushMoveUnits();
 	}
 
 	{
 		SCOPED_TIMER("Unit::Update");
-		std::list<CUnit*>::iterator usi;
-		for (usi = activeUnits.begin(); usi != activeUnits.end(); ++usi) {
-			CUnit* unit = *usi;
+		for (unsigned int i = 0; i < activeUnits.size(); ++i) {
+			CUnit* unit = activeUnits[i];
 
 			UNIT_SANITY_CHECK(unit);
 
@@ -301,23 +378,28 @@ void CUnitHandler::Update()
 	{
 		SCOPED_TIMER("Unit::SlowUpdate");
 
-		// reset the iterator every <UNIT_SLOWUPDATE_RATE> frames
+		// restart the cycle every <UNIT_SLOWUPDATE_RATE> frames
 		if ((gs->frameNum & (UNIT_SLOWUPDATE_RATE - 1)) == 0) {
-			slowUpdateIterator = activeUnits.begin();
+			activeSlowUpdateUnit = 0;
 		}
 
-		// stagger the SlowUpdate's
-		int n = (activeUnits.size() / UNIT_SLOWUPDATE_RATE) + 1;
+		// stagger the SlowUpdate's (units added during this
+		// frame get theirs once PlaceActiveUnits moved them)
+		const unsigned int n = std::min(numPlacedActiveUnits, activeSlowUpdateUnit + (static_cast<unsigned int>(activeUnits.size()) / UNIT_SLOWUPDATE_RATE) + 1);
+
+		// let their weapons share the target searches
+		slowUpdateUnits.assign(activeUnits.begin() + activeSlowUpdateUnit, activeUnits.begin() + n);
+		helper->PrepareWeaponTargets(slowUpdateUnits);
 
-		for (; slowUpdateIterator != activeUnits.end() && n != 0; ++slowUpdateIterator) {
-			CUnit* unit = *slowUpdateIterator;
+		for (unsigned int i = 0; i < slowUpdateUnits.size(); ++i) {
+			CUnit* unit = slowUpdateUnits[i];
 
 			UNIT_SANITY_CHECK(unit);
 			unit->SlowUpdate();
 			UNIT_SANITY_CHECK(unit);
-
-			n--;
 		}
+
+		activeSlowUpdateUnit = n;
 	}
 }
 
@@ -572,7 +654,7 @@ Command CUnitHandler::GetBuildCommand(const float3& pos, const float3& dir) {
 	GML_STDMUTEX_LOCK(cai); // GetBuildCommand
 
 	CCommandQueue::iterator ci;
-	for (std::list<CUnit*>::const_iterator ui = activeUnits.begin(); ui != activeUnits.end(); ++ui) {
+	for (std::vector<CUnit*>::const_iterator ui = activeUnits.begin(); ui != activeUnits.end(); ++ui) {
 		const CUnit* unit = *ui;
 
 		if (unit->team != gu->myTeam) {
@@ -11,6 +11,7 @@
 #include "CommandAI/Command.h"
 
 class CUnit;
+class AMoveType;
 class CBuilderCAI;
 class CFeature;
 class CLoadSaveInterface;
@@ -33,6 +34,9 @@ public:
 
 	unsigned int MaxUnits() const { return maxUnits; }
 
+	/// must be called whenever unit->moveType is replaced
+	void UnitMoveTypeChanged(const CUnit* unit);
+
 	///< test if a unit can be built at specified position
 	///<   return values for the following is
 	///<   0 blocked
@@ -68,7 +72,7 @@ public:
 
 	std::vector< std::vector<CUnitSet> > unitsByDefs; ///< units sorted by team and unitDef
 
-	std::list<CUnit*> activeUnits;                    ///< used to get all active units
+	std::vector<CUnit*> activeUnits;                  ///< used to get all active units (dense, in update order)
 	std::vector<CUnit*> units;                        ///< used to get units from IDs (0 if not created)
 	std::list<CBuilderCAI*> builderCAIs; //FIXME use std::set?
 
@@ -77,8 +81,19 @@ public:
 
 private:
 	std::list<unsigned int> freeUnitIDs;
+	void SetActiveUnit(unsigned int idx, CUnit* unit);
+	void PlaceActiveUnits();
+	void RemoveActiveUnit(const CUnit* unit);
+
 	std::vector<CUnit*> unitsToBeRemoved;            ///< units that will be removed at start of next update
-	std::list<CUnit*>::iterator slowUpdateIterator;
+	std::vector<CUnit*> slowUpdateUnits;             ///< units doing their SlowUpdate in the current frame
+
+	std::vector<unsigned int> activeUnitIndices;     ///< unit ID -> index in activeUnits
+	unsigned int numPlacedActiveUnits;               ///< activeUnits beyond this were added since the last Update
+	unsigned int activeSlowUpdateUnit;               ///< next index in activeUnits to get a SlowUpdate
+
+	/// moveType of activeUnits[i], stored in parallel for the MoveType update pass
+	std::vector<AMoveType*> activeMoveTypes;
 
 	///< global unit-limit (derived from the per-team limit)
 	unsigned int maxUnits;
@@ -727,17 +727,14 @@ void CWeapon::SlowUpdate(bool noAutoTargetOverride)
 	if (!noAutoTargetOverride && AllowWeaponTargetCheck()) {
 		lastTargetRetry = gs->frameNum;
 
-		std::multimap<float, CUnit*> targets;
-		std::multimap<float, CUnit*>::const_iterator nextTargetIt;
-		std::multimap<float, CUnit*>::const_iterator lastTargetIt;
+		// reused by all weapons, TryTarget can not lead back here
+		static std::vector<CGameHelper::WeaponTarget> targets;
 
 		helper->GenerateWeaponTargets(this, targetUnit, targets);
 
-		if (!targets.empty())
-			lastTargetIt = --targets.end();
-
-		for (nextTargetIt = targets.begin(); nextTargetIt != targets.end(); ++nextTargetIt) {
-			CUnit* nextTargetUnit = nextTargetIt->second;
+		// targets are sorted lazily, most weapons accept one of the first few
+		for (size_t numTargets = targets.size(); numTargets > 0; numTargets--) {
+			CUnit* nextTargetUnit = CGameHelper::PopWeaponTarget(targets, numTargets).second;
 
 			if (nextTargetUnit->neutral && (owner->fireState <= FIRESTATE_FIREATWILL)) {
 				continue;
@@ -747,7 +744,7 @@ void CWeapon::SlowUpdate(bool noAutoTargetOverride)
 			// and we want to attack whether it is in our bad target category or not
 			// (if only bad targets are available and this is the last, just pick it)
 			if (nextTargetUnit != targetUnit && (nextTargetUnit->category & badTargetCategory)) {
-				if (nextTargetIt != lastTargetIt) {
+				if (numTargets > 1) {
 					continue;
 				}
 			}
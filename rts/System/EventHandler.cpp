@@ -179,6 +179,7 @@ CEventHandler::CEventHandler()
 	SetupEvent("ShieldPreDamaged",       NULL, CONTROL_BIT);
 	SetupEvent("AllowWeaponTargetCheck", NULL, CONTROL_BIT);
 	SetupEvent("AllowWeaponTarget",      NULL, CONTROL_BIT);
+	SetupEvent("AllowWeaponTargets",     NULL, CONTROL_BIT);
 }
 
 
@@ -18,10 +18,16 @@ bool CBufferedArchive::GetFile(unsigned int fid, std::vector<boost::uint8_t>& bu
 	boost::mutex::scoped_lock lck(archiveLock);
 	assert(IsFileId(fid));
 
+	// only keep a copy of files that are expensive to read
+	// again, otherwise it doubles the memory they take up
+	if (HasLowReadingCost(fid)) {
+		return GetFileImpl(fid, buffer);
+	}
+
 	if (fid >= cache.size()) {
 		cache.resize(fid + 1);
 	}
-	
+
 	if (!cache[fid].populated) {
 		cache[fid].exists = GetFileImpl(fid, cache[fid].data);
 		cache[fid].populated = true;
@@ -11,6 +11,8 @@
 /**
  * Provides a helper implementation for archive types that can only uncompress
  * one file to memory at a time.
+ * Files for which HasLowReadingCost returns false are cached after the first
+ * read.
  */
 class CBufferedArchive : public IArchive
 {
@@ -31,7 +31,7 @@ using std::string;
 /******************************************************************************/
 
 CFileHandler::CFileHandler(const char* fileName, const char* modes)
-	: ifs(NULL), filePos(0), fileSize(-1)
+	: ifs(NULL), fileData(NULL), filePos(0), fileSize(-1)
 {
 	GML_RECMUTEX_LOCK(file); // CFileHandler
 
@@ -40,7 +40,7 @@ CFileHandler::CFileHandler(const char* fileName, const char* modes)
 
 
 CFileHandler::CFileHandler(const string& fileName, const string& modes)
-	: ifs(NULL), filePos(0), fileSize(-1)
+	: ifs(NULL), fileData(NULL), filePos(0), fileSize(-1)
 {
 	GML_RECMUTEX_LOCK(file); // CFileHandler
 
@@ -81,11 +81,22 @@ bool CFileHandler::TryReadFromModFS(const string& fileName)
 	}
 
 	const string file = StringToLower(fileName);
+
+	//! uncompressed files are read straight from the archive
+	const boost::uint8_t* viewData = NULL;
+	size_t viewSize = 0;
+	if (vfsHandler->GetFileView(file, viewData, viewSize)) {
+		fileData = (viewSize > 0)? viewData: NULL;
+		fileSize = viewSize;
+		return true;
+	}
+
 	if (vfsHandler->LoadFile(file, fileBuffer)) {
 		//! did we allocated more mem than needed
 		//! (e.g. because of incorrect usage of std::vector)?
 		assert(fileBuffer.size() == fileBuffer.capacity()); 
 
+		fileData = (!fileBuffer.empty())? &fileBuffer[0]: NULL;
 		fileSize = fileBuffer.size();
 		return true;
 	}
@@ -155,13 +166,13 @@ int CFileHandler::Read(void* buf, int length)
 		ifs->read((char*)buf, length);
 		return ifs->gcount ();
 	}
-	else if (!fileBuffer.empty()) {
+	else if (fileData != NULL) {
 		if ((length + filePos) > fileSize) {
 			length = fileSize - filePos;
 		}
 		if (length > 0) {
-			assert(fileBuffer.size() >= (filePos + length));
-			memcpy(buf, &fileBuffer[filePos], length);
+			assert(fileSize >= (filePos + length));
+			memcpy(buf, fileData + filePos, length);
 			filePos += length;
 		}
 		return length;
@@ -182,7 +193,7 @@ void CFileHandler::Seek(int length, std::ios_base::seekdir where)
 		ifs->clear();
 		ifs->seekg(length, where);
 	}
-	else if (!fileBuffer.empty())
+	else if (fileData != NULL)
 	{
 		if (where == std::ios_base::beg)
 		{
@@ -207,9 +218,9 @@ int CFileHandler::Peek() const
 	if (ifs) {
 		return ifs->peek();
 	}
-	else if (!fileBuffer.empty()) {
-		if (filePos < fileSize) {
-			return fileBuffer.at(filePos);
+	else if (fileData != NULL) {
+		if (filePos >= 0 && filePos < fileSize) {
+			return fileData[filePos];
 		} else {
 			return EOF;
 		}
@@ -225,7 +236,7 @@ bool CFileHandler::Eof() const
 	if (ifs) {
 		return ifs->eof();
 	}
-	if (!fileBuffer.empty()) {
+	if (fileData != NULL) {
 		return (filePos >= fileSize);
 	}
 	return true;
@@ -19,6 +19,10 @@
  * This class should be threadsafe (multiple threads can use multiple
  * CFileHandler pointing to the same file simulatneously) as long as there are
  * no new Archives added to the VFS (which should not happen after PreGame).
+ *
+ * Uncompressed files in archives are not copied but read straight from the
+ * archive, so their archives must not be removed from the VFS while a
+ * CFileHandler for one of those files still exists.
  */
 class CFileHandler
 {
@@ -72,6 +76,8 @@ private:
 	std::string fileName;
 	std::ifstream* ifs;
 	std::vector<boost::uint8_t> fileBuffer;
+	/// points into fileBuffer or a view of the file in its archive
+	const boost::uint8_t* fileData;
 	int filePos;
 	int fileSize;
 };
@@ -194,7 +194,7 @@ std::string FileSystemAbstraction::GetFileModificationDate(const std::string& fi
 		FILETIME /*ftCreate, ftAccess,*/ ftWrite;
 
 		// Retrieve the file times for the file.
-		if (GetFileTime(hFile, NULL, NULL, &ftWrite) != 0) {
+		if (GetFileTime(hFile, NULL, NULL, &ftWrite) == 0) {
 			LOG_L(L_WARNING, "Failed fetching last modification time from file: %s", file.c_str());
 		} else {
 			// Convert the last-write time to local time.
@@ -43,6 +43,15 @@ bool IArchive::HasLowReadingCost(unsigned int fid) const
 unsigned int IArchive::GetCrc32(unsigned int fid)
 {
 	CRC crc;
+
+	const boost::uint8_t* data = NULL;
+	size_t size = 0;
+
+	if (GetFileView(fid, data, size)) {
+		crc.Update(data, size);
+		return crc.GetDigest();
+	}
+
 	std::vector<boost::uint8_t> buffer;
 	if (GetFile(fid, buffer) && !buffer.empty()) {
 		crc.Update(&buffer[0], buffer.size());
@@ -51,6 +60,11 @@ unsigned int IArchive::GetCrc32(unsigned int fid)
 	return crc.GetDigest();
 }
 
+bool IArchive::GetFileView(unsigned int fid, const boost::uint8_t*& data, size_t& size)
+{
+	return false;
+}
+
 bool IArchive::GetFile(const std::string& name, std::vector<boost::uint8_t>& buffer)
 {
 	const unsigned int fid = FindFile(name);
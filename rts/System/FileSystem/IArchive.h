@@ -72,6 +72,14 @@ public:
 	 * @see GetFile(unsigned int fid, std::vector<boost::uint8_t>& buffer)
 	 */
 	bool GetFile(const std::string& name, std::vector<boost::uint8_t>& buffer);
+	/**
+	 * Fetches a read-only view of the content of a file by its ID, without
+	 * copying it. The data stays valid for as long as the archive exists.
+	 * @param fid file ID in [0, NumFiles())
+	 * @return false if the archive can not provide such a view of this file
+	 *   (for example because it is compressed); use GetFile instead then
+	 */
+	virtual bool GetFileView(unsigned int fid, const boost::uint8_t*& data, size_t& size);
 	/**
 	 * Fetches the name and size in bytes of a file by its ID.
 	 */
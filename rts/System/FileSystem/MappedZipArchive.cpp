@@ -0,0 +1,369 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+
+#include "MappedZipArchive.h"
+
+#include <cassert>
+#include <cstring>
+#include <zlib.h>
+
+#include "System/Platform/MappedFile.h"
+#include "System/Util.h"
+#include "System/mmgr.h"
+#include "System/Log/ILog.h"
+
+
+// record signatures and sizes, see PKWARE's APPNOTE.TXT
+static const unsigned int ZIP_LOCAL_HEADER_SIG   = 0x04034b50;
+static const unsigned int ZIP_CENTRAL_HEADER_SIG = 0x02014b50;
+static const unsigned int ZIP_END_RECORD_SIG     = 0x06054b50;
+
+static const size_t ZIP_LOCAL_HEADER_SIZE   = 30;
+static const size_t ZIP_CENTRAL_HEADER_SIZE = 46;
+static const size_t ZIP_END_RECORD_SIZE     = 22;
+static const size_t ZIP_MAX_COMMENT_SIZE    = 0xFFFF;
+
+static const unsigned short ZIP_FLAG_ENCRYPTED = 0x0001;
+
+
+// zip headers are little-endian and not aligned
+static unsigned int ReadU16(const boost::uint8_t* p)
+{
+	return (p[0] | (p[1] << 8));
+}
+
+static unsigned int ReadU32(const boost::uint8_t* p)
+{
+	return (p[0] | (p[1] << 8) | (p[2] << 16) | (boost::uint32_t(p[3]) << 24));
+}
+
+
+/**
+ * @brief Inflates a deflated zip entry straight from the mapping
+ *
+ * Read returns the number of bytes inflated into buf, 0 once the end of
+ * the stream was reached, or -1 if the entry is corrupt (the CRC and size
+ * are checked at the end).
+ */
+class CZipEntryInflater
+{
+public:
+	CZipEntryInflater(const boost::uint8_t* compressedData, size_t compressedSize, int size, unsigned int crc)
+		: size(size)
+		, expectedCrc(crc)
+		, currentCrc(crc32(0L, Z_NULL, 0))
+		, finished(false)
+		, failed(false)
+	{
+		memset(&stream, 0, sizeof(stream));
+
+		// zlib does not write to its input
+		stream.next_in = const_cast<Bytef*>(compressedData);
+		stream.avail_in = compressedSize;
+
+		// zip entries are raw deflate streams, without zlib header
+		failed = (inflateInit2(&stream, -MAX_WBITS) != Z_OK);
+	}
+
+	~CZipEntryInflater() {
+		inflateEnd(&stream);
+	}
+
+	int Read(void* buf, int length) {
+		if (failed)
+			return -1;
+		if (finished || length <= 0)
+			return 0;
+
+		stream.next_out = reinterpret_cast<Bytef*>(buf);
+		stream.avail_out = length;
+
+		while (stream.avail_out > 0) {
+			const int ret = inflate(&stream, Z_NO_FLUSH);
+
+			if (ret == Z_STREAM_END) {
+				finished = true;
+				break;
+			}
+			if (ret != Z_OK) {
+				// also happens for truncated input (Z_BUF_ERROR)
+				failed = true;
+				return -1;
+			}
+		}
+
+		const int numRead = length - stream.avail_out;
+
+		currentCrc = crc32(currentCrc, reinterpret_cast<const Bytef*>(buf), numRead);
+
+		if (finished && (currentCrc != expectedCrc || stream.total_out != static_cast<uLong>(size))) {
+			failed = true;
+			return -1;
+		}
+
+		return numRead;
+	}
+
+private:
+	z_stream stream;
+
+	int size;
+	unsigned int expectedCrc;
+	unsigned int currentCrc;
+
+	bool finished;
+	bool failed;
+};
+
+
+
+CMappedZipArchive::CMappedZipArchive(const std::string& archiveName)
+	: IArchive(archiveName)
+	, mappedFile(new CMappedFile(archiveName, false))
+	, isOpen(false)
+{
+	isOpen = (mappedFile->IsOpen() && ReadCentralDirectory());
+
+	if (!isOpen) {
+		// CZipArchiveFactory falls back to minizip (which reports errors)
+		LOG_L(L_DEBUG, "%s can not be mapped as plain zip archive", archiveName.c_str());
+
+		fileData.clear();
+		lcNameIndex.clear();
+	}
+}
+
+CMappedZipArchive::~CMappedZipArchive()
+{
+	delete mappedFile;
+}
+
+bool CMappedZipArchive::ReadCentralDirectory()
+{
+	const boost::uint8_t* archive = mappedFile->GetData();
+	const size_t archiveSize = mappedFile->GetSize();
+
+	if (archiveSize < ZIP_END_RECORD_SIZE) {
+		return false;
+	}
+
+	// the end-of-central-directory record is followed only by the comment,
+	// so search backwards from the last position it can start at
+	const size_t minEndPos = (archiveSize > (ZIP_END_RECORD_SIZE + ZIP_MAX_COMMENT_SIZE))?
+		(archiveSize - (ZIP_END_RECORD_SIZE + ZIP_MAX_COMMENT_SIZE)): 0;
+
+	size_t endPos = archiveSize - ZIP_END_RECORD_SIZE;
+
+	while (ReadU32(archive + endPos) != ZIP_END_RECORD_SIG) {
+		if (endPos == minEndPos) {
+			return false;
+		}
+
+		endPos--;
+	}
+
+	const boost::uint8_t* endRecord = archive + endPos;
+
+	const unsigned int numEntries = ReadU16(endRecord + 10);
+	const size_t dirSize = ReadU32(endRecord + 12);
+	const size_t dirPos = ReadU32(endRecord + 16);
+
+	// zip64 archives mark these as overflowing
+	if (numEntries == 0xFFFF || dirSize == 0xFFFFFFFF || dirPos == 0xFFFFFFFF) {
+		return false;
+	}
+	if (dirPos > endPos || dirSize > (endPos - dirPos)) {
+		return false;
+	}
+
+	fileData.reserve(numEntries);
+
+	size_t headerPos = dirPos;
+
+	for (unsigned int n = 0; n < numEntries; n++) {
+		if ((dirPos + dirSize - headerPos) < ZIP_CENTRAL_HEADER_SIZE) {
+			return false;
+		}
+
+		const boost::uint8_t* header = archive + headerPos;
+
+		if (ReadU32(header) != ZIP_CENTRAL_HEADER_SIG) {
+			return false;
+		}
+
+		const unsigned int flags = ReadU16(header + 8);
+		const unsigned int method = ReadU16(header + 10);
+		const unsigned int crc = ReadU32(header + 16);
+		const size_t compressedSize = ReadU32(header + 20);
+		const size_t size = ReadU32(header + 24);
+		const size_t nameLen = ReadU16(header + 28);
+		const size_t extraLen = ReadU16(header + 30);
+		const size_t commentLen = ReadU16(header + 32);
+		const size_t localHeaderPos = ReadU32(header + 42);
+
+		const size_t headerSize = ZIP_CENTRAL_HEADER_SIZE + nameLen + extraLen + commentLen;
+
+		if ((dirPos + dirSize - headerPos) < headerSize) {
+			return false;
+		}
+		if (compressedSize == 0xFFFFFFFF || size == 0xFFFFFFFF || localHeaderPos == 0xFFFFFFFF) {
+			return false;
+		}
+
+		const std::string fName(reinterpret_cast<const char*>(header + ZIP_CENTRAL_HEADER_SIZE), nameLen);
+
+		headerPos += headerSize;
+
+		const std::string fLowerName = StringToLower(fName);
+		if (fLowerName.empty()) {
+			continue;
+		}
+		const char last = fLowerName[fLowerName.length() - 1];
+		if ((last == '/') || (last == '\\')) {
+			continue; // exclude directory names
+		}
+
+		// the content follows the local header, whose
+		// name and extra-field can differ from the above
+		if (localHeaderPos > dirPos || (dirPos - localHeaderPos) < ZIP_LOCAL_HEADER_SIZE) {
+			return false;
+		}
+
+		const boost::uint8_t* localHeader = archive + localHeaderPos;
+
+		if (ReadU32(localHeader) != ZIP_LOCAL_HEADER_SIG) {
+			return false;
+		}
+
+		const size_t dataPos = localHeaderPos + ZIP_LOCAL_HEADER_SIZE + ReadU16(localHeader + 26) + ReadU16(localHeader + 28);
+
+		if (dataPos > dirPos || (dirPos - dataPos) < compressedSize) {
+			return false;
+		}
+
+		FileData fd;
+		fd.origName = fName;
+		fd.dataOffset = dataPos;
+		fd.compressedSize = compressedSize;
+		fd.size = size;
+		fd.crc = crc;
+		fd.stored = (method == METHOD_STORED);
+		fd.supported = ((flags & ZIP_FLAG_ENCRYPTED) == 0) && ((method == METHOD_STORED && compressedSize == size) || method == METHOD_DEFLATE);
+		fd.crcState = CRC_UNCHECKED;
+		fileData.push_back(fd);
+		lcNameIndex[fLowerName] = fileData.size() - 1;
+	}
+
+	return true;
+}
+
+bool CMappedZipArchive::IsOpen()
+{
+	return isOpen;
+}
+
+unsigned int CMappedZipArchive::NumFiles() const
+{
+	return fileData.size();
+}
+
+void CMappedZipArchive::FileInfo(unsigned int fid, std::string& name, int& size) const
+{
+	assert(IsFileId(fid));
+
+	name = fileData[fid].origName;
+	size = fileData[fid].size;
+}
+
+unsigned int CMappedZipArchive::GetCrc32(unsigned int fid)
+{
+	assert(IsFileId(fid));
+
+	return fileData[fid].crc;
+}
+
+bool CMappedZipArchive::CheckStoredCrc(unsigned int fid)
+{
+	boost::mutex::scoped_lock lock(crcStateMutex);
+
+	FileData& fd = fileData[fid];
+
+	assert(fd.stored);
+
+	if (fd.crcState == CRC_UNCHECKED) {
+		const boost::uint8_t* data = mappedFile->GetData() + fd.dataOffset;
+		const uLong crc = crc32(crc32(0L, Z_NULL, 0), data, fd.size);
+
+		if (crc != fd.crc) {
+			LOG_L(L_WARNING, "CRC mismatch of %s in %s", fd.origName.c_str(), GetArchiveName().c_str());
+		}
+
+		fd.crcState = (crc == fd.crc)? CRC_VALID: CRC_INVALID;
+	}
+
+	return (fd.crcState == CRC_VALID);
+}
+
+bool CMappedZipArchive::GetFileView(unsigned int fid, const boost::uint8_t*& data, size_t& size)
+{
+	assert(IsFileId(fid));
+
+	const FileData& fd = fileData[fid];
+
+	if (!fd.supported || !fd.stored) {
+		return false;
+	}
+	if (!CheckStoredCrc(fid)) {
+		return false;
+	}
+
+	data = mappedFile->GetData() + fd.dataOffset;
+	size = fd.size;
+	return true;
+}
+
+bool CMappedZipArchive::GetFile(unsigned int fid, std::vector<boost::uint8_t>& buffer)
+{
+	assert(IsFileId(fid));
+
+	const FileData& fd = fileData[fid];
+	const boost::uint8_t* data = mappedFile->GetData() + fd.dataOffset;
+
+	if (!fd.supported) {
+		return false;
+	}
+
+	buffer.resize(fd.size);
+
+	if (fd.stored) {
+		if (!CheckStoredCrc(fid)) {
+			buffer.clear();
+			return false;
+		}
+
+		if (!buffer.empty()) {
+			memcpy(&buffer[0], data, buffer.size());
+		}
+
+		return true;
+	}
+
+	// inflate directly into the caller's buffer; the last Read
+	// must find the end of the stream (and check its CRC)
+	CZipEntryInflater stream(data, fd.compressedSize, fd.size, fd.crc);
+	boost::uint8_t end = 0;
+
+	bool ret = true;
+	if (!buffer.empty() && stream.Read(&buffer[0], buffer.size()) != fd.size) {
+		ret = false;
+	}
+	if (ret && stream.Read(&end, 1) != 0) {
+		ret = false;
+	}
+
+	if (!ret) {
+		buffer.clear();
+	}
+
+	return ret;
+}
@@ -0,0 +1,76 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#ifndef _MAPPED_ZIP_ARCHIVE_H
+#define _MAPPED_ZIP_ARCHIVE_H
+
+#include "IArchive.h"
+
+#include <string>
+#include <vector>
+#include <boost/thread/mutex.hpp>
+
+class CMappedFile;
+
+/**
+ * A zip archive that is memory-mapped as a whole.
+ *
+ * Uncompressed entries can be handed out as views of the mapping, deflated
+ * ones are inflated straight from it into the caller's buffer. The content
+ * of uncompressed entries is checked against its CRC on the first view of
+ * it, deflated ones on every inflate.
+ *
+ * Only plain (non-zip64, unencrypted) archives are supported; IsOpen returns
+ * false for all others, so CZipArchive can be used for those instead.
+ */
+class CMappedZipArchive : public IArchive
+{
+public:
+	CMappedZipArchive(const std::string& archiveName);
+	virtual ~CMappedZipArchive();
+
+	virtual bool IsOpen();
+
+	virtual unsigned int NumFiles() const;
+	virtual bool GetFile(unsigned int fid, std::vector<boost::uint8_t>& buffer);
+	virtual bool GetFileView(unsigned int fid, const boost::uint8_t*& data, size_t& size);
+	virtual void FileInfo(unsigned int fid, std::string& name, int& size) const;
+	virtual unsigned int GetCrc32(unsigned int fid);
+
+private:
+	bool ReadCentralDirectory();
+	/// @return whether the content of a stored entry matches its CRC
+	bool CheckStoredCrc(unsigned int fid);
+
+	CMappedFile* mappedFile;
+
+	enum CompressionMethod {
+		METHOD_STORED  = 0,
+		METHOD_DEFLATE = 8,
+	};
+
+	enum CrcState {
+		CRC_UNCHECKED = 0,
+		CRC_VALID     = 1,
+		CRC_INVALID   = 2,
+	};
+
+	struct FileData {
+		std::string origName;
+		/// offset of the (compressed) content within the archive
+		size_t dataOffset;
+		size_t compressedSize;
+		int size;
+		unsigned int crc;
+		/// false if encrypted or compressed with another method
+		bool supported;
+		bool stored;
+		/// only used for stored entries, set by CheckStoredCrc
+		CrcState crcState;
+	};
+	std::vector<FileData> fileData;
+	boost::mutex crcStateMutex;
+
+	bool isOpen;
+};
+
+#endif // _MAPPED_ZIP_ARCHIVE_H
@@ -166,6 +166,25 @@ bool CVFSHandler::LoadFile(const std::string& filePath, std::vector<boost::uint8
 	return true;
 }
 
+bool CVFSHandler::GetFileView(const std::string& filePath, const boost::uint8_t*& data, size_t& size)
+{
+	LOG_L(L_DEBUG, "GetFileView(filePath = \"%s\", )", filePath.c_str());
+
+	const std::string normalizedPath = GetNormalizedPath(filePath);
+
+	const FileData* fileData = GetFileData(normalizedPath);
+	if (fileData == NULL) {
+		return false;
+	}
+
+	const unsigned int fid = fileData->ar->FindFile(normalizedPath);
+	if (!fileData->ar->IsFileId(fid)) {
+		return false;
+	}
+
+	return fileData->ar->GetFileView(fid, data, size);
+}
+
 bool CVFSHandler::FileExists(const std::string& filePath)
 {
 	LOG_L(L_DEBUG, "FileExists(filePath = \"%s\", )", filePath.c_str());
@@ -37,6 +37,16 @@ public:
 	 * @return true if the file exists in the VFS and was successfully read
 	 */
 	bool LoadFile(const std::string& filePath, std::vector<boost::uint8_t>& buffer);
+	/**
+	 * Fetches a read-only view of a file within the VFS, without copying it.
+	 * The data stays valid until the archive containing the file is removed.
+	 * @param filePath raw file path, for example "maps/myMap.smf",
+	 *   case-insensitive
+	 * @return false if the file does not exist in the VFS, or its archive
+	 *   can not provide a view of it; use LoadFile instead then
+	 * @see IArchive::GetFileView
+	 */
+	bool GetFileView(const std::string& filePath, const boost::uint8_t*& data, size_t& size);
 
 	/**
 	 * Returns all the files in the given (virtual) directory without the
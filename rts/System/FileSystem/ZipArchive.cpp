@@ -2,6 +2,7 @@
 
 
 #include "ZipArchive.h"
+#include "MappedZipArchive.h"
 
 #include <algorithm>
 #include <stdexcept>
@@ -18,6 +19,14 @@ CZipArchiveFactory::CZipArchiveFactory()
 
 IArchive* CZipArchiveFactory::DoCreateArchive(const std::string& filePath) const
 {
+	CMappedZipArchive* mappedArchive = new CMappedZipArchive(filePath);
+
+	if (mappedArchive->IsOpen()) {
+		return mappedArchive;
+	}
+
+	// zip64, encrypted central directory, mmap failure, ...
+	delete mappedArchive;
 	return new CZipArchive(filePath);
 }
 
@@ -8,12 +8,22 @@
 #include "System/Net/RawPacket.h"
 #include "Game/GameVersion.h"
 
+#include <zlib.h>
+#include <algorithm>
 #include <limits.h>
 #include <stdexcept>
 #include <cassert>
 #include <cstring>
 
+static bool FrameBeforeBlock(int frameNum, const DemoStreamIndexEntry& indexEntry)
+{
+	return (frameNum < indexEntry.frameNum);
+}
+
+
 CDemoReader::CDemoReader(const std::string& filename, float curTime)
+	: blockPos(0)
+	, streamEnded(false)
 {
 	playbackDemo.open(filename.c_str(), std::ios::binary);
 
@@ -26,7 +36,7 @@ CDemoReader::CDemoReader(const std::string& filename, float curTime)
 	fileHeader.swab();
 
 	if (memcmp(fileHeader.magic, DEMOFILE_MAGIC, sizeof(fileHeader.magic))
-		|| fileHeader.version != DEMOFILE_VERSION
+		|| (fileHeader.version != DEMOFILE_VERSION && fileHeader.version != DEMOFILE_VERSION_UNCOMPRESSED)
 		|| fileHeader.headerSize != sizeof(fileHeader)
 		|| fileHeader.playerStatElemSize != sizeof(PlayerStatistics)
 		|| fileHeader.teamStatElemSize != sizeof(TeamStatistics)
@@ -47,25 +57,40 @@ CDemoReader::CDemoReader(const std::string& filename, float curTime)
 		delete[] buf;
 	}
 
-	playbackDemo.read((char*)&chunkHeader, sizeof(chunkHeader));
-	chunkHeader.swab();
+	if (IsCompressed()) {
+		if (fileHeader.demoStreamSize != 0) {
+			bytesRemaining = fileHeader.demoStreamSize;
+			ReadBlockIndex();
+		} else {
+			// Spring crashed while recording the demo: read all complete blocks
+			const long curPos = playbackDemo.tellg();
+			playbackDemo.seekg(0, std::ios::end);
+			bytesRemaining = (long) playbackDemo.tellg() - curPos;
+			playbackDemo.seekg(curPos);
+		}
 
-	demoTimeOffset = curTime - chunkHeader.modGameTime - 0.1f;
-	nextDemoReadTime = curTime - 0.01f;
+		ReadChunkHeader();
+	} else {
+		playbackDemo.read((char*)&chunkHeader, sizeof(chunkHeader));
+		chunkHeader.swab();
 
-	if (fileHeader.demoStreamSize != 0) {
-		bytesRemaining = fileHeader.demoStreamSize;
-	}
-	else {
-		// Spring crashed while recording the demo: replay until EOF,
-		// but at most filesize bytes to block watching demo of running game.
-		// For this we must determine the file size.
-		// (if this had still used CFileHandler that would have been easier ;-))
-		long curPos = playbackDemo.tellg();
-		playbackDemo.seekg(0, std::ios::end);
- 		bytesRemaining = (long) playbackDemo.tellg() - curPos;
- 		playbackDemo.seekg(curPos);
+		if (fileHeader.demoStreamSize != 0) {
+			bytesRemaining = fileHeader.demoStreamSize;
+		}
+		else {
+			// Spring crashed while recording the demo: replay until EOF,
+			// but at most filesize bytes to block watching demo of running game.
+			// For this we must determine the file size.
+			// (if this had still used CFileHandler that would have been easier ;-))
+			long curPos = playbackDemo.tellg();
+			playbackDemo.seekg(0, std::ios::end);
+			bytesRemaining = (long) playbackDemo.tellg() - curPos;
+			playbackDemo.seekg(curPos);
+		}
 	}
+
+	demoTimeOffset = curTime - chunkHeader.modGameTime - 0.1f;
+	nextDemoReadTime = curTime - 0.01f;
 }
 
 netcode::RawPacket* CDemoReader::GetData(float readTime)
@@ -78,6 +103,20 @@ netcode::RawPacket* CDemoReader::GetData(float readTime)
 	// check needed
 	if (readTime > nextDemoReadTime) {
 		netcode::RawPacket* buf = new netcode::RawPacket(chunkHeader.length);
+
+		if (IsCompressed()) {
+			// ReadChunkHeader made sure the data is within the block
+			if (chunkHeader.length > 0) {
+				memcpy(buf->data, &blockData[blockPos], chunkHeader.length);
+			}
+
+			blockPos += chunkHeader.length;
+
+			ReadChunkHeader();
+			nextDemoReadTime = chunkHeader.modGameTime + demoTimeOffset;
+			return buf;
+		}
+
 		playbackDemo.read((char*)(buf->data), chunkHeader.length);
 		bytesRemaining -= chunkHeader.length;
 
@@ -97,6 +136,9 @@ netcode::RawPacket* CDemoReader::GetData(float readTime)
 
 bool CDemoReader::ReachedEnd() const
 {
+	if (IsCompressed())
+		return streamEnded;
+
 	if (bytesRemaining <= 0 || playbackDemo.eof())
 		return true;
 	else
@@ -104,6 +146,134 @@ bool CDemoReader::ReachedEnd() const
 }
 
 
+int CDemoReader::SeekToFrame(int frameNum, float curTime)
+{
+	if (blockIndex.empty())
+		return -1;
+
+	// the last block starting at or before frameNum (the
+	// first block also covers the messages before frame 1)
+	std::vector<DemoStreamIndexEntry>::const_iterator it = std::upper_bound(blockIndex.begin(), blockIndex.end(), frameNum, FrameBeforeBlock);
+
+	if (it != blockIndex.begin())
+		--it;
+
+	playbackDemo.clear();
+	playbackDemo.seekg(fileHeader.headerSize + fileHeader.scriptSize + it->blockOffset);
+
+	bytesRemaining = fileHeader.demoStreamSize - it->blockOffset;
+	blockData.clear();
+	blockPos = 0;
+	streamEnded = false;
+
+	ReadChunkHeader();
+
+	demoTimeOffset = curTime - chunkHeader.modGameTime - 0.1f;
+	nextDemoReadTime = curTime - 0.01f;
+
+	return it->frameNum;
+}
+
+
+/** @brief Read the header of the next chunk from the current block, or from the next block if it is used up. */
+void CDemoReader::ReadChunkHeader()
+{
+	if ((blockPos + sizeof(chunkHeader)) > blockData.size() && !ReadBlock()) {
+		streamEnded = true;
+		return;
+	}
+
+	memcpy(&chunkHeader, &blockData[blockPos], sizeof(chunkHeader));
+	chunkHeader.swab();
+	blockPos += sizeof(chunkHeader);
+
+	if ((blockPos + chunkHeader.length) > blockData.size()) {
+		// corrupt block
+		streamEnded = true;
+	}
+}
+
+/** @brief Read and decompress the next block of the demo stream. */
+bool CDemoReader::ReadBlock()
+{
+	DemoStreamBlockHeader blockHeader;
+
+	if (bytesRemaining < (int) sizeof(blockHeader))
+		return false;
+
+	playbackDemo.read((char*) &blockHeader, sizeof(blockHeader));
+	blockHeader.swab();
+	bytesRemaining -= sizeof(blockHeader);
+
+	// the last block may be incomplete if Spring crashed while writing it
+	if (playbackDemo.fail() || blockHeader.compressedSize > (unsigned) bytesRemaining)
+		return false;
+	if (blockHeader.compressedSize == 0 || blockHeader.uncompressedSize == 0)
+		return false;
+
+	compressedData.resize(blockHeader.compressedSize);
+	playbackDemo.read((char*) &compressedData[0], blockHeader.compressedSize);
+	bytesRemaining -= blockHeader.compressedSize;
+
+	if (playbackDemo.fail())
+		return false;
+
+	uLongf uncompressedSize = blockHeader.uncompressedSize;
+	blockData.resize(blockHeader.uncompressedSize);
+	blockPos = 0;
+
+	if (uncompress(&blockData[0], &uncompressedSize, &compressedData[0], compressedData.size()) != Z_OK)
+		return false;
+
+	return (uncompressedSize == blockHeader.uncompressedSize);
+}
+
+/** @brief Read the block index from the end of the file, leaves it empty if there is none (or it is corrupt). */
+void CDemoReader::ReadBlockIndex()
+{
+	const long curPos = playbackDemo.tellg();
+	const long streamEnd = fileHeader.headerSize + fileHeader.scriptSize + fileHeader.demoStreamSize;
+
+	DemoStreamIndexFooter indexFooter;
+
+	playbackDemo.seekg(-((long) sizeof(indexFooter)), std::ios::end);
+
+	const long footerPos = playbackDemo.tellg();
+
+	playbackDemo.read((char*) &indexFooter, sizeof(indexFooter));
+	indexFooter.swab();
+
+	const bool validFooter =
+		   !playbackDemo.fail()
+		&& (indexFooter.numBlocks > 0)
+		&& (indexFooter.indexSize == (indexFooter.numBlocks * (int) sizeof(DemoStreamIndexEntry)))
+		&& ((footerPos - indexFooter.indexSize) >= streamEnd);
+
+	if (validFooter) {
+		blockIndex.resize(indexFooter.numBlocks);
+
+		playbackDemo.seekg(footerPos - indexFooter.indexSize);
+		playbackDemo.read((char*) &blockIndex[0], indexFooter.indexSize);
+
+		for (std::vector<DemoStreamIndexEntry>::iterator it = blockIndex.begin(); it != blockIndex.end(); ++it) {
+			it->swab();
+
+			if (it->blockOffset >= (unsigned) fileHeader.demoStreamSize) {
+				blockIndex.clear();
+				break;
+			}
+		}
+
+		if (playbackDemo.fail()) {
+			blockIndex.clear();
+		}
+	}
+
+	playbackDemo.clear();
+	playbackDemo.seekg(curPos);
+}
+
+
 void CDemoReader::LoadStats()
 {
 	// Stats are not available if Spring crashed while writing the demo.
@@ -135,7 +305,13 @@ void CDemoReader::LoadStats()
 		teamStats.resize(fileHeader.numTeams);
 		// Read the array containing the number of team stats for each team.
 		std::vector<int> numStatsPerTeam(fileHeader.numTeams, 0);
-		playbackDemo.read((char*) (&numStatsPerTeam[0]), numStatsPerTeam.size());
+		if (!numStatsPerTeam.empty()) {
+			playbackDemo.read((char*) (&numStatsPerTeam[0]), numStatsPerTeam.size() * sizeof(int));
+		}
+
+		for (int teamNum = 0; teamNum < fileHeader.numTeams; ++teamNum) {
+			swabDWordInPlace(numStatsPerTeam[teamNum]);
+		}
 
 		for (int teamNum = 0; teamNum < fileHeader.numTeams; ++teamNum) {
 			for (int i = 0; i < numStatsPerTeam[teamNum]; ++i) {
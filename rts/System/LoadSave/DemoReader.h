@@ -37,6 +37,15 @@ public:
 	*/
 	bool ReachedEnd() const;
 
+	/**
+	@brief Continue reading at the block containing the given frame
+	Only possible for compressed demos with a block index, GetData then
+	returns the messages from the start of the block on.
+	@return The first frame of that block, or -1 if the demo can not seek
+	*/
+	int SeekToFrame(int frameNum, float curTime);
+	bool CanSeek() const { return !blockIndex.empty(); }
+
 	float GetModGameTime() const { return chunkHeader.modGameTime; }
 	float GetDemoTimeOffset() const { return demoTimeOffset; }
 	float GetNextDemoReadTime() const { return nextDemoReadTime; }
@@ -53,9 +62,24 @@ public:
 	/// Not needed for normal demo watching
 	void LoadStats();
 
+private:
+	bool IsCompressed() const { return (fileHeader.version > DEMOFILE_VERSION_UNCOMPRESSED); }
+
+	void ReadChunkHeader();
+	bool ReadBlock();
+	void ReadBlockIndex();
+
 private:
 	std::ifstream playbackDemo;
 
+	/// the decompressed block currently being read (compressed demos only)
+	std::vector<unsigned char> blockData;
+	std::vector<unsigned char> compressedData;
+	unsigned int blockPos;
+	bool streamEnded;
+
+	std::vector<DemoStreamIndexEntry> blockIndex;
+
 	float demoTimeOffset;
 	float nextDemoReadTime;
 	int bytesRemaining;
@@ -20,6 +20,7 @@
 #include <cstring>
 
 CDemoRecorder::CDemoRecorder(const std::string& mapName, const std::string& modName)
+	: demoStreamWriter(demoStream)
 {
 	// We want this folder to exist
 	if (!FileSystem::CreateDirectory("demos"))
@@ -52,9 +53,13 @@ CDemoRecorder::CDemoRecorder(const std::string& mapName, const std::string& modN
 
 CDemoRecorder::~CDemoRecorder()
 {
+	demoStreamWriter.FlushBlock();
+	fileHeader.demoStreamSize = demoStreamWriter.GetStreamSize();
+
 	WriteWinnerList();
 	WritePlayerStats();
 	WriteTeamStats();
+	demoStreamWriter.WriteIndex();
 	WriteFileHeader();
 
 	demoStream.close();
@@ -73,15 +78,8 @@ void CDemoRecorder::WriteSetupText(const std::string& text)
 
 void CDemoRecorder::SaveToDemo(const unsigned char* buf, const unsigned length, const float modGameTime)
 {
-	DemoStreamChunkHeader chunkHeader;
-
-	chunkHeader.modGameTime = modGameTime;
-	chunkHeader.length = length;
-	chunkHeader.swab();
-	demoStream.write((char*) &chunkHeader, sizeof(chunkHeader));
-	demoStream.write((char*) buf, length);
-	fileHeader.demoStreamSize += length + sizeof(chunkHeader);
-	demoStream.flush();
+	// written (and flushed) to the file a block at a time
+	demoStreamWriter.AddChunk(buf, length, modGameTime);
 }
 
 void CDemoRecorder::SetName(const std::string& mapname, const std::string& modname)
@@ -8,6 +8,7 @@
 #include <list>
 
 #include "Demo.h"
+#include "DemoStreamWriter.h"
 #include "Game/PlayerStatistics.h"
 #include "Sim/Misc/TeamStatistics.h"
 
@@ -47,6 +48,7 @@ private:
 	void WriteWinnerList();
 
 	std::ofstream demoStream;
+	CDemoStreamWriter demoStreamWriter;
 	std::vector<PlayerStatistics> playerStats;
 	std::vector< std::vector<TeamStatistics> > teamStats;
 	std::vector<unsigned char> winningAllyTeams;
@@ -0,0 +1,110 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include "DemoStreamWriter.h"
+
+#include "System/mmgr.h"
+
+#include "Sim/Misc/GlobalConstants.h"
+#include "System/BaseNetProtocol.h"
+
+#include <zlib.h>
+#include <cassert>
+#include <cstring>
+
+// a block is written once it holds this many bytes or frames (whichever
+// comes first); bigger blocks compress better, smaller ones make seeking
+// cheaper and lose less of the demo if the process crashes
+static const unsigned int DEMO_STREAM_BLOCK_SIZE = 64 * 1024;
+static const int DEMO_STREAM_BLOCK_FRAMES = GAME_SPEED * 5;
+
+
+CDemoStreamWriter::CDemoStreamWriter(std::ostream& stream)
+	: stream(stream)
+	, streamSize(0)
+	, frameNum(0)
+	, blockFrameNum(0)
+{
+	blockBuffer.reserve(DEMO_STREAM_BLOCK_SIZE + 1024);
+}
+
+
+void CDemoStreamWriter::AddChunk(const unsigned char* buf, unsigned int length, float modGameTime)
+{
+	if (length > 0 && (buf[0] == NETMSG_NEWFRAME || buf[0] == NETMSG_KEYFRAME)) {
+		frameNum++;
+
+		// blocks may only be split at the start of a frame
+		// (FlushBlock makes this frame the start of the next)
+		if (blockBuffer.size() >= DEMO_STREAM_BLOCK_SIZE || (frameNum - blockFrameNum) > DEMO_STREAM_BLOCK_FRAMES) {
+			FlushBlock();
+		}
+	}
+
+	DemoStreamChunkHeader chunkHeader;
+	chunkHeader.modGameTime = modGameTime;
+	chunkHeader.length = length;
+	chunkHeader.swab();
+
+	const size_t pos = blockBuffer.size();
+
+	blockBuffer.resize(pos + sizeof(chunkHeader) + length);
+	memcpy(&blockBuffer[pos], &chunkHeader, sizeof(chunkHeader));
+
+	if (length > 0) {
+		memcpy(&blockBuffer[pos + sizeof(chunkHeader)], buf, length);
+	}
+}
+
+
+void CDemoStreamWriter::FlushBlock()
+{
+	if (blockBuffer.empty())
+		return;
+
+	uLongf compressedSize = compressBound(blockBuffer.size());
+	compressBuffer.resize(compressedSize);
+
+	if (compress(&compressBuffer[0], &compressedSize, &blockBuffer[0], blockBuffer.size()) != Z_OK) {
+		// can not happen with a buffer of compressBound() bytes
+		compressedSize = 0;
+	}
+
+	DemoStreamIndexEntry indexEntry;
+	indexEntry.frameNum = blockFrameNum;
+	indexEntry.blockOffset = streamSize;
+	blockIndex.push_back(indexEntry);
+
+	DemoStreamBlockHeader blockHeader;
+	blockHeader.frameNum = blockFrameNum;
+	blockHeader.compressedSize = compressedSize;
+	blockHeader.uncompressedSize = blockBuffer.size();
+	blockHeader.swab();
+
+	stream.write((char*) &blockHeader, sizeof(blockHeader));
+	stream.write((char*) &compressBuffer[0], compressedSize);
+	stream.flush();
+
+	streamSize += (sizeof(blockHeader) + compressedSize);
+
+	blockBuffer.clear();
+	blockFrameNum = frameNum;
+}
+
+
+void CDemoStreamWriter::WriteIndex()
+{
+	assert(blockBuffer.empty());
+
+	for (std::vector<DemoStreamIndexEntry>::iterator it = blockIndex.begin(); it != blockIndex.end(); ++it) {
+		DemoStreamIndexEntry indexEntry = *it;
+		indexEntry.swab();
+		stream.write((char*) &indexEntry, sizeof(indexEntry));
+	}
+
+	DemoStreamIndexFooter indexFooter;
+	indexFooter.numBlocks = blockIndex.size();
+	indexFooter.indexSize = blockIndex.size() * sizeof(DemoStreamIndexEntry);
+	indexFooter.swab();
+
+	stream.write((char*) &indexFooter, sizeof(indexFooter));
+}
@@ -0,0 +1,49 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#ifndef DEMO_STREAM_WRITER
+#define DEMO_STREAM_WRITER
+
+#include <ostream>
+#include <vector>
+
+#include "demofile.h"
+
+/**
+ * @brief Writes a demo stream as compressed blocks (see demofile.h)
+ *
+ * Chunks are collected in memory and written as one zlib-compressed
+ * block once the block is large enough or covers enough frames; each
+ * new block starts with a frame message so readers can seek to it.
+ * Used by CDemoRecorder and by DemoTool to convert old demos.
+ */
+class CDemoStreamWriter
+{
+public:
+	CDemoStreamWriter(std::ostream& stream);
+
+	/// appends one chunk to the stream at the current position of the file
+	void AddChunk(const unsigned char* buf, unsigned int length, float modGameTime);
+	/// writes the block collected so far (if any)
+	void FlushBlock();
+	/// writes the block index and footer at the current position of the file,
+	/// the last block must have been written by FlushBlock before
+	void WriteIndex();
+
+	/// number of bytes of (compressed) demo stream written so far
+	unsigned int GetStreamSize() const { return streamSize; }
+
+private:
+	std::ostream& stream;
+
+	std::vector<unsigned char> blockBuffer;
+	std::vector<unsigned char> compressBuffer;
+	std::vector<DemoStreamIndexEntry> blockIndex;
+
+	unsigned int streamSize;
+
+	/// frames started so far, and the frame the current block starts with
+	int frameNum;
+	int blockFrameNum;
+};
+
+#endif
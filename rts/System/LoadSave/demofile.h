@@ -21,7 +21,13 @@
  * The current demofile version. Only change on major modifications for which
  * appending stuff to DemoFileHeader is not sufficient.
  */
-#define DEMOFILE_VERSION 5
+#define DEMOFILE_VERSION 6
+
+/**
+ * The last version with an uncompressed demo stream, demos of this version
+ * can still be read (and be converted to the current version by DemoTool).
+ */
+#define DEMOFILE_VERSION_UNCOMPRESSED 5
 
 #pragma pack(push, 1)
 
@@ -33,13 +39,16 @@
  * - DemoFileHeader
  *   - Data chunks:
  *     - Startscript (scriptSize)
- *     - Demo stream (demoStreamSize)
+ *     - Demo stream (demoStreamSize), compressed blocks since version 6
+ *     - Winning ally teams (winningAllyTeamsSize)
  *     - Player statistics, one PlayerStatistic for each player
  *     - Team statistics, consisting of:
  *       - Array of numTeams dwords indicating the number of
  *         CTeam::Statistics for each team.
  *       - Array of all CTeam::Statistics (total number of items is the
  *         sum of the elements in the array of dwords).
+ *     - Block index (since version 6), one DemoStreamIndexEntry per block
+ *     - DemoStreamIndexFooter, the last bytes of the file
  *
  * The header is designed to be extensible: it contains a version field and a
  * headerSize field to support this. The version field is a major version number
@@ -48,7 +57,8 @@
  * minor version number, which happens to be equal to sizeof(DemoFileHeader).
  *
  * If Spring did not cleanup properly (crashed), the demoStreamSize is 0 and it
- * can be assumed the demo stream continues until the end of the file.
+ * can be assumed the demo stream continues until the end of the file (there
+ * is no block index in this case).
  */
 struct DemoFileHeader
 {
@@ -95,13 +105,17 @@ struct DemoFileHeader
 /**
  * @brief Spring demo stream chunk header
  *
- * The demo stream layout is as follows:
+ * The (uncompressed) demo stream layout is as follows:
  *
  * - DemoStreamChunkHeader
  * - length bytes raw data from network stream
  * - DemoStreamChunkHeader
  * - length bytes raw data from network stream
  * - ...
+ *
+ * Since version 6 the stream is split into blocks, each is stored as a
+ * DemoStreamBlockHeader followed by the zlib-compressed chunks of the
+ * block (chunks never cross block boundaries).
  */
 struct DemoStreamChunkHeader
 {
@@ -115,6 +129,53 @@ struct DemoStreamChunkHeader
 	}
 };
 
+/**
+ * @brief Spring demo stream block header (version 6+)
+ *
+ * Except for the first one, every block starts with the chunk of a
+ * NETMSG_NEWFRAME or NETMSG_KEYFRAME message, so playback can start
+ * at any block.
+ */
+struct DemoStreamBlockHeader
+{
+	int frameNum;                     ///< Frame started by the first chunk of the block, 0 for the first block.
+	boost::uint32_t compressedSize;   ///< Length of the zlib data following this header.
+	boost::uint32_t uncompressedSize; ///< Length of the chunks after decompression.
+
+	/// Change structure from host endian to little endian or vice versa.
+	void swab() {
+		swabDWordInPlace(frameNum);
+		swabDWordInPlace(compressedSize);
+		swabDWordInPlace(uncompressedSize);
+	}
+};
+
+/** @brief Spring demo stream block index entry (version 6+) */
+struct DemoStreamIndexEntry
+{
+	int frameNum;                ///< DemoStreamBlockHeader::frameNum of the block.
+	boost::uint32_t blockOffset; ///< Offset of the block from the start of the demo stream.
+
+	/// Change structure from host endian to little endian or vice versa.
+	void swab() {
+		swabDWordInPlace(frameNum);
+		swabDWordInPlace(blockOffset);
+	}
+};
+
+/** @brief Spring demo stream block index footer (version 6+) */
+struct DemoStreamIndexFooter
+{
+	int numBlocks;  ///< Number of DemoStreamIndexEntry's preceding the footer.
+	int indexSize;  ///< Size of the block index, numBlocks * sizeof(DemoStreamIndexEntry).
+
+	/// Change structure from host endian to little endian or vice versa.
+	void swab() {
+		swabDWordInPlace(numBlocks);
+		swabDWordInPlace(indexSize);
+	}
+};
+
 #pragma pack(pop)
 
 #endif // DEMO_FILE_H
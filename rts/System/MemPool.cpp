@@ -1,6 +1,9 @@
 /* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
 
 #include "System/MemPool.h"
+
+#include <algorithm>
+#include <cassert>
 //#include "System/mmgr.h"
 
 CMemPool mempool;
@@ -67,3 +70,81 @@ void CMemPool::Free(void* pnt, size_t numBytes)
 CMemPool::~CMemPool()
 {
 }
+
+
+
+CSlabMemPool::CSlabMemPool()
+{
+}
+
+CSlabMemPool::~CSlabMemPool()
+{
+	for (std::map<char*, size_t>::const_iterator it = slabs.begin(); it != slabs.end(); ++it) {
+		::operator delete(it->first);
+	}
+}
+
+void* CSlabMemPool::Alloc(size_t numBytes)
+{
+	// blocks must be able to hold the free-list link
+	numBytes = std::max(numBytes, sizeof(void*));
+
+	if (numBytes >= freeLists.size()) {
+		freeLists.resize(numBytes + 1);
+	}
+
+	FreeList& fl = freeLists[numBytes];
+
+	if (fl.nextFree == NULL) {
+		// consecutive blocks stay aligned since sizeof(T) is a multiple of T's alignment
+		char* slab = static_cast<char*>(::operator new(numBytes * fl.slabItems));
+
+		for (size_t i = 0; i < (fl.slabItems - 1); ++i) {
+			*(void**)&slab[i * numBytes] = (void*)&slab[(i + 1) * numBytes];
+		}
+
+		*(void**)&slab[(fl.slabItems - 1) * numBytes] = NULL;
+
+		slabs[slab] = numBytes * fl.slabItems;
+
+		fl.nextFree = slab;
+		if (fl.slabItems < MAX_SLAB_ITEMS) {
+			fl.slabItems *= 2;
+		}
+	}
+
+	void* pnt = fl.nextFree;
+	fl.nextFree = (*(void**)pnt);
+	return pnt;
+}
+
+void CSlabMemPool::Free(void* pnt, size_t numBytes)
+{
+	if (pnt == NULL) {
+		return;
+	}
+
+	numBytes = std::max(numBytes, sizeof(void*));
+
+	// blocks from ::operator new (eg. allocated by creg when loading a
+	// savegame) are not part of any slab, and are released, not reused
+	char* block = static_cast<char*>(pnt);
+	std::map<char*, size_t>::const_iterator it = slabs.upper_bound(block);
+
+	if (it == slabs.begin()) {
+		::operator delete(pnt);
+		return;
+	}
+
+	--it;
+
+	if (block >= (it->first + it->second)) {
+		::operator delete(pnt);
+		return;
+	}
+
+	assert(numBytes < freeLists.size());
+
+	*(void**)pnt = freeLists[numBytes].nextFree;
+	freeLists[numBytes].nextFree = pnt;
+}
@@ -5,6 +5,8 @@
 
 #include <new>
 #include <cstring> // for size_t
+#include <map>
+#include <vector>
 
 static const size_t MAX_MEM_SIZE = 200;
 
@@ -36,5 +38,40 @@ private:
 
 extern CMemPool mempool;
 
+
+/**
+ * Same idea as CMemPool, but without an upper size limit, meant for larger
+ * objects that come in a few different sizes (eg. the classes derived from
+ * one base). Blocks of each size are carved out of slabs, which double in
+ * size up to MAX_SLAB_ITEMS blocks, and are only released by the destructor.
+ * Blocks that were not allocated from a slab (eg. by creg) are handed to
+ * ::operator delete by Free. Like CMemPool, this is not thread-safe.
+ */
+class CSlabMemPool
+{
+public:
+	CSlabMemPool();
+	~CSlabMemPool();
+
+	void* Alloc(size_t numBytes);
+	void Free(void* pnt, size_t numBytes);
+
+private:
+	static const size_t MIN_SLAB_ITEMS = 16;
+	static const size_t MAX_SLAB_ITEMS = 1024;
+
+	struct FreeList {
+		FreeList(): nextFree(NULL), slabItems(MIN_SLAB_ITEMS) {}
+
+		void* nextFree;
+		size_t slabItems;
+	};
+
+	/// indexed by block size in bytes
+	std::vector<FreeList> freeLists;
+	/// start of each slab, mapped to its size in bytes
+	std::map<char*, size_t> slabs;
+};
+
 #endif // _MEM_POOL_H_
 
@@ -0,0 +1,83 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include "MappedFile.h"
+
+#ifdef _WIN32
+	#include "System/Platform/Win/win32.h"
+#else
+	#include <fcntl.h>
+	#include <unistd.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+#endif
+
+#include "System/mmgr.h"
+
+
+CMappedFile::CMappedFile(const std::string& path, bool copyOnWrite)
+	: data(NULL)
+	, size(0)
+	, copyOnWrite(copyOnWrite)
+#ifdef _WIN32
+	, fileHandle(INVALID_HANDLE_VALUE)
+	, mappingHandle(NULL)
+#endif
+{
+#ifdef _WIN32
+	// like on POSIX, others may still replace, rename or delete the file
+	const DWORD shareMode = FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE;
+
+	fileHandle = CreateFileA(path.c_str(), GENERIC_READ, shareMode, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+
+	if (fileHandle == INVALID_HANDLE_VALUE)
+		return;
+
+	LARGE_INTEGER fileSize;
+
+	if (!GetFileSizeEx(fileHandle, &fileSize) || fileSize.QuadPart == 0)
+		return;
+
+	// PAGE_WRITECOPY and FILE_MAP_COPY give the same semantics as MAP_PRIVATE
+	mappingHandle = CreateFileMappingA(fileHandle, NULL, (copyOnWrite? PAGE_WRITECOPY: PAGE_READONLY), 0, 0, NULL);
+
+	if (mappingHandle == NULL)
+		return;
+
+	data = static_cast<boost::uint8_t*>(MapViewOfFile(mappingHandle, (copyOnWrite? FILE_MAP_COPY: FILE_MAP_READ), 0, 0, 0));
+	size = (data != NULL)? size_t(fileSize.QuadPart): 0;
+#else
+	const int fd = open(path.c_str(), O_RDONLY);
+
+	if (fd < 0)
+		return;
+
+	struct stat info;
+
+	if (fstat(fd, &info) == 0 && info.st_size > 0) {
+		void* mem = mmap(NULL, info.st_size, (copyOnWrite? (PROT_READ | PROT_WRITE): PROT_READ), MAP_PRIVATE, fd, 0);
+
+		if (mem != MAP_FAILED) {
+			data = static_cast<boost::uint8_t*>(mem);
+			size = info.st_size;
+		}
+	}
+
+	// the mapping stays valid without the descriptor
+	close(fd);
+#endif
+}
+
+CMappedFile::~CMappedFile()
+{
+#ifdef _WIN32
+	if (data != NULL)
+		UnmapViewOfFile(data);
+	if (mappingHandle != NULL)
+		CloseHandle(mappingHandle);
+	if (fileHandle != INVALID_HANDLE_VALUE)
+		CloseHandle(fileHandle);
+#else
+	if (data != NULL)
+		munmap(data, size);
+#endif
+}
@@ -0,0 +1,46 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <string>
+#include <boost/noncopyable.hpp>
+#include <boost/cstdint.hpp>
+
+/**
+ * @brief Memory-mapped view of a whole file
+ *
+ * The mapping is private: its pages are shared with every other process
+ * mapping the same file until they are written to, at which point the
+ * writing process gets its own copy of (only) the touched pages. Changes
+ * never reach the file itself.
+ */
+class CMappedFile : public boost::noncopyable
+{
+public:
+	/**
+	 * @param path absolute path of the file
+	 * @param copyOnWrite whether the mapped memory may be written to
+	 */
+	CMappedFile(const std::string& path, bool copyOnWrite);
+	~CMappedFile();
+
+	bool IsOpen() const { return (data != NULL); }
+
+	size_t GetSize() const { return size; }
+	const boost::uint8_t* GetData() const { return data; }
+	/// only valid if the file was opened copy-on-write
+	boost::uint8_t* GetWritableData() { return (copyOnWrite? data: NULL); }
+
+private:
+	boost::uint8_t* data;
+	size_t size;
+	bool copyOnWrite;
+
+#ifdef _WIN32
+	void* fileHandle;
+	void* mappingHandle;
+#endif
+};
+
+#endif // MAPPED_FILE_H
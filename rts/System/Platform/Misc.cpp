@@ -29,6 +29,7 @@
 
 #if !defined(WIN32)
 #include <sys/utsname.h> // for uname()
+#include <sys/resource.h> // for getrusage()
 #include <sys/types.h> // for getpw
 #include <pwd.h> // for getpw
 #endif
@@ -363,6 +364,24 @@ bool Is32BitEmulation()
 }
 #endif
 
+size_t GetPeakResidentMemory()
+{
+#if defined(WIN32)
+	// would need GetProcessMemoryInfo from psapi, which we do not link
+	return 0;
+#else
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0) {
+		return 0;
+	}
+#if defined(__APPLE__)
+	return usage.ru_maxrss; // bytes
+#else
+	return usage.ru_maxrss * size_t(1024); // KiB
+#endif
+#endif
+}
+
 std::string ExecuteProcess(const std::string& file, std::vector<std::string> args)
 {
 	std::string execError = "";
@@ -4,6 +4,7 @@
 #define PLATFORM_MISC_H
 
 #include <string>
+#include <cstddef>
 #include <vector>
 
 namespace Platform
@@ -75,6 +76,13 @@ std::string GetOS();
 bool Is64Bit();
 bool Is32BitEmulation();
 
+/**
+ * Returns the largest amount of physical memory this process used so far
+ * (peak resident set size).
+ * @return peak memory use in bytes, or 0 if not available on this platform
+ */
+size_t GetPeakResidentMemory();
+
 /**
  * Executes a native binary, file and args have to be not escaped!
  * http://linux.die.net/man/3/execvp
@@ -16,6 +16,7 @@
 #include "aGui/Gui.h"
 #include "ExternalAI/IAILibraryManager.h"
 #include "Game/ClientSetup.h"
+#include "Game/DemoBenchmark.h"
 #include "Game/GameServer.h"
 #include "Game/GameSetup.h"
 #include "Game/GameVersion.h"
@@ -729,6 +730,8 @@ void SpringApp::ParseCmdLine()
 	cmdline->AddSwitch(0,   "list-config-vars",   "Dump a list of config vars and meta data to stdout");
 	cmdline->AddSwitch('i', "isolation",          "Limit the data-dir (games & maps) scanner to one directory");
 	cmdline->AddString(0,   "isolation-dir",      "Specify the isolation-mode data-dir (see --isolation)");
+	cmdline->AddString(0,   "benchmark-demo",     "Replay the given demo as fast as possible and write a timing report (see --benchmark-report)");
+	cmdline->AddString(0,   "benchmark-report",   "Write the --benchmark-demo report (JSON) to this file instead of benchmark.json");
 
 	try {
 		cmdline->Parse();
@@ -828,6 +831,20 @@ void SpringApp::ParseCmdLine()
 void SpringApp::Startup()
 {
 	std::string inputFile = cmdline->GetInputFile();
+
+	if (cmdline->IsSet("benchmark-demo")) {
+		inputFile = cmdline->GetString("benchmark-demo");
+
+		const std::string reportFile = cmdline->IsSet("benchmark-report")? cmdline->GetString("benchmark-report"): "benchmark.json";
+
+		if (!StringEndsWith(inputFile, "sdf")) {
+			LOG_L(L_FATAL, "--benchmark-demo needs a demo-file (.sdf), got \"%s\"", inputFile.c_str());
+			exit(1);
+		}
+
+		demoBenchmark = new CDemoBenchmark(inputFile, reportFile);
+	}
+
 	if (inputFile.empty())
 	{
 #ifdef HEADLESS
@@ -842,7 +859,7 @@ void SpringApp::Startup()
 #endif
 		activeController = new SelectMenu(server);
 	}
-	else if (inputFile.rfind("sdf") == inputFile.size() - 3)
+	else if (StringEndsWith(inputFile, "sdf"))
 	{
 		std::string demoFileName = inputFile;
 		std::string demoPlayerName = configHandler->GetString("name");
@@ -866,7 +883,7 @@ void SpringApp::Startup()
 		pregame = new CPreGame(startsetup);
 		pregame->LoadDemo(demoFileName);
 	}
-	else if (inputFile.rfind("ssf") == inputFile.size() - 3)
+	else if (StringEndsWith(inputFile, "ssf"))
 	{
 		std::string savefile = inputFile;
 		startsetup = new ClientSetup();
@@ -1032,6 +1049,7 @@ void SpringApp::Shutdown()
 	DeleteAndNull(game);
 	DeleteAndNull(gameServer);
 	DeleteAndNull(gameSetup);
+	DeleteAndNull(demoBenchmark);
 	CLoadScreen::DeleteInstance();
 	ISound::Shutdown();
 	DeleteAndNull(font);
@@ -0,0 +1,202 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include "System/ThreadPool.h"
+
+#include <algorithm>
+#include <cassert>
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+
+#include "lib/streflop/streflop_cond.h"
+#include "System/mmgr.h"
+#include "System/Config/ConfigHandler.h"
+#include "System/Platform/Threading.h"
+
+
+CThreadPool::CThreadPool(unsigned int numThreads)
+	: jobFunc(NULL)
+	, jobID(0)
+	, jobNumItems(0)
+	, jobNextItem(0)
+	, jobDoneItems(0)
+	, jobChunkSize(1)
+	, inJob(false)
+	, quit(false)
+{
+	SetNumThreads(numThreads);
+}
+
+CThreadPool::~CThreadPool()
+{
+	StopWorkers();
+}
+
+
+unsigned int CThreadPool::GetDefaultNumThreads()
+{
+	unsigned int numThreads = std::max(0, configHandler->GetInt("HardwareThreadCount"));
+
+	if (numThreads == 0) {
+		// auto-detect
+		numThreads = Threading::GetAvailableCores();
+	}
+
+	return std::max(1U, numThreads);
+}
+
+void CThreadPool::SetNumThreads(unsigned int numThreads)
+{
+	assert(!inJob);
+
+#if defined(USE_GML) || defined(USE_MMGR)
+	// GML keeps per-thread state for the threads it knows about,
+	// and mmgr is not thread-safe
+	numThreads = 1;
+#endif
+
+	numThreads = std::max(1U, numThreads);
+
+	if (numThreads == GetNumThreads())
+		return;
+
+	StopWorkers();
+	StartWorkers(numThreads - 1);
+}
+
+
+void CThreadPool::StartWorkers(unsigned int numWorkers)
+{
+	quit = false;
+	workers.reserve(numWorkers);
+
+	for (unsigned int n = 0; n < numWorkers; n++) {
+		// thread 0 is the caller of ParallelFor
+		workers.push_back(new boost::thread(boost::bind(&CThreadPool::WorkerLoop, this, n + 1)));
+	}
+}
+
+void CThreadPool::StopWorkers()
+{
+	{
+		boost::mutex::scoped_lock lock(jobMutex);
+		quit = true;
+	}
+
+	jobStartCond.notify_all();
+
+	for (unsigned int n = 0; n < workers.size(); n++) {
+		workers[n]->join();
+		delete workers[n];
+	}
+
+	workers.clear();
+}
+
+
+void CThreadPool::ParallelFor(unsigned int numItems, const ForFunc& func)
+{
+	assert(!inJob);
+
+	if (numItems == 0)
+		return;
+
+	if (workers.empty() || numItems == 1) {
+		for (unsigned int n = 0; n < numItems; n++) {
+			func(n, 0);
+		}
+		return;
+	}
+
+	{
+		boost::mutex::scoped_lock lock(jobMutex);
+
+		// a few chunks per thread, so threads that finish early can help out
+		jobFunc = &func;
+		jobNumItems = numItems;
+		jobNextItem = 0;
+		jobDoneItems = 0;
+		jobChunkSize = std::max(1U, numItems / (GetNumThreads() * 4));
+
+		inJob = true;
+		jobID++;
+	}
+
+	jobStartCond.notify_all();
+
+	RunChunks(0);
+
+	{
+		boost::unique_lock<boost::mutex> lock(jobMutex);
+
+		while (jobDoneItems < jobNumItems) {
+			jobDoneCond.wait(lock);
+		}
+
+		jobFunc = NULL;
+		inJob = false;
+	}
+}
+
+
+void CThreadPool::RunChunks(unsigned int threadNum)
+{
+	unsigned int begin = 0;
+	unsigned int end = 0;
+
+	for (;;) {
+		{
+			boost::mutex::scoped_lock lock(jobMutex);
+
+			jobDoneItems += (end - begin);
+
+			if (jobDoneItems == jobNumItems) {
+				jobDoneCond.notify_all();
+			}
+			if (jobNextItem >= jobNumItems)
+				return;
+
+			begin = jobNextItem;
+			end = std::min(begin + jobChunkSize, jobNumItems);
+			jobNextItem = end;
+		}
+
+		for (unsigned int n = begin; n < end; n++) {
+			(*jobFunc)(n, threadNum);
+		}
+	}
+}
+
+void CThreadPool::WorkerLoop(unsigned int threadNum)
+{
+	Threading::SetThreadName("threadpool");
+
+	// jobs do synced math, and new threads need not inherit the FPU state
+	streflop_init<streflop::Simple>();
+#if defined(__SUPPORT_SNAN__) && !defined(USE_GML)
+	streflop::feraiseexcept(streflop::FPU_Exceptions(FE_INVALID | FE_DIVBYZERO | FE_OVERFLOW));
+#endif
+
+	unsigned int lastJobID = 0;
+
+	{
+		boost::mutex::scoped_lock lock(jobMutex);
+		lastJobID = jobID;
+	}
+
+	for (;;) {
+		{
+			boost::unique_lock<boost::mutex> lock(jobMutex);
+
+			while (!quit && jobID == lastJobID) {
+				jobStartCond.wait(lock);
+			}
+
+			if (quit)
+				return;
+
+			lastJobID = jobID;
+		}
+
+		RunChunks(threadNum);
+	}
+}
@@ -0,0 +1,79 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <vector>
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+namespace boost {
+	class thread;
+};
+
+/**
+ * @brief Fixed set of worker threads for data-parallel loops
+ *
+ * The thread calling ParallelFor always takes part in the work as
+ * thread 0, so a pool with N threads starts N - 1 workers. Items are
+ * handed out in small chunks on demand, idle threads keep taking new
+ * chunks until the loop is done (so uneven per-item costs balance out).
+ *
+ * The order in which items are processed is NOT deterministic, so for
+ * synced code every item may only write state owned by that item (or
+ * by the executing thread, see the threadNum argument); anything that
+ * has to be combined must be merged by the caller afterwards in a fixed
+ * order.
+ */
+class CThreadPool : public boost::noncopyable
+{
+public:
+	/// called as func(itemIndex, threadNum) with threadNum in [0, GetNumThreads())
+	typedef boost::function<void(unsigned int, unsigned int)> ForFunc;
+
+	CThreadPool(unsigned int numThreads = 1);
+	~CThreadPool();
+
+	/// (re)starts the workers, 1 runs everything on the calling thread
+	void SetNumThreads(unsigned int numThreads);
+	unsigned int GetNumThreads() const { return (workers.size() + 1); }
+
+	/**
+	 * Runs func for every item in [0, numItems) and returns when all of
+	 * them are done. Must not be called from within a ParallelFor job.
+	 */
+	void ParallelFor(unsigned int numItems, const ForFunc& func);
+
+	/// the number of threads to use when none is configured
+	static unsigned int GetDefaultNumThreads();
+
+private:
+	void StartWorkers(unsigned int numWorkers);
+	void StopWorkers();
+
+	void WorkerLoop(unsigned int threadNum);
+	/// claims and runs chunks of the current job until none are left
+	void RunChunks(unsigned int threadNum);
+
+private:
+	std::vector<boost::thread*> workers;
+
+	boost::mutex jobMutex;
+	boost::condition_variable jobStartCond;
+	boost::condition_variable jobDoneCond;
+
+	const ForFunc* jobFunc;
+
+	unsigned int jobID;
+	unsigned int jobNumItems;
+	unsigned int jobNextItem;
+	unsigned int jobDoneItems;
+	unsigned int jobChunkSize;
+
+	bool inJob;
+	bool quit;
+};
+
+#endif // THREAD_POOL_H
@@ -10,6 +10,16 @@
 #include "System/Log/ILog.h"
 #include "System/UnsyncedRNG.h"
 
+#ifdef USE_GML
+	#define PROFILE_LOCK() GML_STDMUTEX_LOCK_NOPROF(time)
+#else
+	#include <boost/thread/mutex.hpp>
+
+	// timers can also be destroyed by CThreadPool workers
+	static boost::mutex profileMutex;
+	#define PROFILE_LOCK() boost::mutex::scoped_lock profileLock(profileMutex)
+#endif
+
 
 BasicTimer::BasicTimer(const char* const myname) : name(myname), starttime(SDL_GetTicks())
 {
@@ -46,7 +56,7 @@ CTimeProfiler::~CTimeProfiler()
 
 void CTimeProfiler::Update()
 {
-	GML_STDMUTEX_LOCK_NOPROF(time); // Update
+	PROFILE_LOCK(); // Update
 
 	++currentPosition;
 	currentPosition &= TimeRecord::frames_size-1;
@@ -72,20 +82,25 @@ void CTimeProfiler::Update()
 			else
 				pi->second.newpeak = false;
 		}
+		for (std::map<std::string,CountRecord>::iterator ci = counts.begin(); ci != counts.end(); ++ci)
+		{
+			ci->second.last = ci->second.current;
+			ci->second.current = 0;
+		}
 		lastBigUpdate = curTime;
 	}
 }
 
 float CTimeProfiler::GetPercent(const char* name)
 {
-	GML_STDMUTEX_LOCK_NOPROF(time); // GetTimePercent
+	PROFILE_LOCK(); // GetTimePercent
 
 	return profile[name].percent;
 }
 
 void CTimeProfiler::AddTime(const std::string& name, unsigned time, bool showGraph)
 {
-	GML_STDMUTEX_LOCK_NOPROF(time); // AddTime
+	PROFILE_LOCK(); // AddTime
 
 	std::map<std::string, TimeRecord>::iterator pi;
 	if ( (pi = profile.find(name)) != profile.end() ) {
@@ -108,6 +123,25 @@ void CTimeProfiler::AddTime(const std::string& name, unsigned time, bool showGra
 	}
 }
 
+void CTimeProfiler::AddCount(const std::string& name, unsigned count)
+{
+	PROFILE_LOCK(); // AddCount
+
+	CountRecord& cr = counts[name];
+	cr.total += count;
+	cr.current += count;
+}
+
+void CTimeProfiler::GetTotals(std::map<std::string, unsigned>& totals) const
+{
+	PROFILE_LOCK(); // GetTotals
+
+	std::map<std::string, TimeRecord>::const_iterator pi;
+	for (pi = profile.begin(); pi != profile.end(); ++pi) {
+		totals[pi->first] = pi->second.total;
+	}
+}
+
 void CTimeProfiler::PrintProfilingInfo() const
 {
 	LOG("%35s|%18s|%s",
@@ -121,4 +155,19 @@ void CTimeProfiler::PrintProfilingInfo() const
 				((float)pi->second.total) / 1000.f,
 				pi->second.percent * 100);
 	}
+
+	if (counts.empty())
+		return;
+
+	LOG("%35s|%18s|%s",
+			"Counter",
+			"Total",
+			"Count of the last 0.5s");
+	std::map<std::string, CTimeProfiler::CountRecord>::const_iterator ci;
+	for (ci = counts.begin(); ci != counts.end(); ++ci) {
+		LOG("%35s %17u %6u",
+				ci->first.c_str(),
+				ci->second.total,
+				ci->second.last);
+	}
 }
@@ -79,16 +79,31 @@ public:
 		bool newpeak;
 	};
 
+	/// event counts (cache hits etc.) shown next to the timers
+	struct CountRecord {
+		CountRecord() : total(0), current(0), last(0) {}
+		unsigned total;
+		/// count since the last 0.5s update
+		unsigned current;
+		/// count within the last complete 0.5s
+		unsigned last;
+	};
+
 	CTimeProfiler();
 	~CTimeProfiler();
 
 	float GetPercent(const char *name);
 	void AddTime(const std::string& name, unsigned time, bool showGraph = false);
+	void AddCount(const std::string& name, unsigned count);
 	void Update();
 
+	/// copies the total time of each timer, for sampling them per frame
+	void GetTotals(std::map<std::string, unsigned>& totals) const;
+
 	void PrintProfilingInfo() const;
 
 	std::map<std::string,TimeRecord> profile;
+	std::map<std::string,CountRecord> counts;
 
 private:
 	unsigned lastBigUpdate;
@@ -6,6 +6,7 @@
 #include <string>
 #include <sstream>
 #include <algorithm>
+#include <vector>
 
 #include "System/maindefines.h"
 
@@ -133,6 +134,25 @@ namespace proc {
 	unsigned int GetProcSSEBits();
 }
 
+/**
+ * @brief Erases the first occurrence of an element from a vector
+ * The last element is moved into the freed slot, so this does not
+ * preserve element order but avoids shifting the tail of the vector.
+ * @return true if the element was found (and erased)
+ */
+template<typename T>
+static inline bool VectorEraseUnordered(std::vector<T>& v, const T& e)
+{
+	typename std::vector<T>::iterator it = std::find(v.begin(), v.end(), e);
+
+	if (it == v.end())
+		return false;
+
+	*it = v.back();
+	v.pop_back();
+	return true;
+}
+
 // set.erase(iterator++) is prone to crash with MSVC
 template <class S, class I>
 inline I set_erase(S &s, I i) {
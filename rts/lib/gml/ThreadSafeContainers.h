@@ -948,6 +948,31 @@ public:
 		return cont.erase(it);
 	}
 
+	//! for random-access containers, which are cheaper to compact in one
+	//! pass by the caller than to erase from element by element; these
+	//! do the same as the erase_* versions, except for the erasing
+	T& operator[](const size_t& i) {
+		return cont[i];
+	}
+
+	void delete_synced(const T& x) {
+		del.push_back(x);
+	}
+
+	void delete_unsynced(const T& x) {
+#if !defined(USE_GML) || !GML_ENABLE_SIM
+		delete x;
+#endif
+	}
+
+	void detach_unsynced(const T& x) {
+#if !defined(USE_GML) || !GML_ENABLE_SIM
+		delete x;
+#else
+		D::Detach(x);
+#endif
+	}
+
 public:
 	typedef SimIT iterator;
 
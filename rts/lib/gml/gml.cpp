@@ -264,6 +264,7 @@ boost::mutex ntexmutex;
 boost::mutex lodmutex;
 boost::mutex catmutex;
 boost::mutex grpchgmutex;
+boost::mutex projpoolmutex;
 
 #include <boost/thread/recursive_mutex.hpp>
 boost::recursive_mutex unitmutex;
@@ -57,6 +57,7 @@ extern boost::mutex ntexmutex;
 extern boost::mutex lodmutex;
 extern boost::mutex catmutex;
 extern boost::mutex grpchgmutex;
+extern boost::mutex projpoolmutex;
 
 #include <boost/thread/recursive_mutex.hpp>
 extern boost::recursive_mutex unitmutex;
@@ -0,0 +1,321 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+// Compares the old (std::map per square) and the current (BlockingMap)
+// layouts of the ground-blocking map: both have to hold the same objects
+// in the same order after random adds and removes, and the square checks
+// of CMoveMath (see SquareBlocking.h) have to agree with a plain loop over
+// the objects; both are timed on a map covered in buildings with some
+// units on top
+
+#include "Sim/Misc/BlockingMap.h"
+#include "Sim/MoveTypes/MoveMath/SquareBlocking.h"
+#include <map>
+#include <vector>
+#include <stdlib.h>
+#include <time.h>
+
+#define BOOST_TEST_MODULE BlockingMap
+#include <boost/test/unit_test.hpp>
+
+// stand-in for the engine class, BlockingMap only stores pointers to it
+class CSolidObject {
+public:
+	int id;
+	int x, z;
+	int xsize, zsize;
+	bool blocking;
+	bool immobile;
+	bool isMoving;
+	bool crushable;
+	float crushResistance;
+};
+
+static const int MAP_SIZE = 512;
+static const int NUM_SQUARES = MAP_SIZE * MAP_SIZE;
+
+static const int BUILDING_SIZE = 4;
+static const int NUM_UNITS = 4000;
+static const int NUM_PASSES = 20;
+
+// fixed, so failures can be reproduced
+static const unsigned int RANDOM_SEED = 0xb10c;
+
+enum {
+	BLOCK_NONE      = 0,
+	BLOCK_MOVING    = 1,
+	BLOCK_MOBILE    = 2,
+	BLOCK_STRUCTURE = 8
+};
+
+
+static inline float randf()
+{
+	return rand() / float(RAND_MAX);
+}
+
+// stand-in for the obstacle checks of CMoveMath (IsNonBlocking, CrushResistant, ...)
+struct TestClassifier {
+	typedef int BlockType;
+
+	TestClassifier(float cs): crushStrength(cs) {}
+
+	bool IsNonBlocking(const CSolidObject* obstacle) const { return !obstacle->blocking; }
+	bool IsImmobile(const CSolidObject* obstacle) const { return obstacle->immobile; }
+
+	BlockType MobileBlockType(const CSolidObject* obstacle) const {
+		return (obstacle->isMoving? BLOCK_MOVING: BLOCK_MOBILE);
+	}
+	BlockType ImmobileBlockType(const CSolidObject* obstacle) const {
+		if (!obstacle->crushable || obstacle->crushResistance > crushStrength)
+			return BLOCK_STRUCTURE;
+
+		return BLOCK_NONE;
+	}
+
+	float crushStrength;
+};
+
+static inline int ObstacleBlockType(const CSolidObject* obstacle, float crushStrength)
+{
+	const TestClassifier classifier(crushStrength);
+
+	if (classifier.IsNonBlocking(obstacle))
+		return BLOCK_NONE;
+	if (!obstacle->immobile)
+		return classifier.MobileBlockType(obstacle);
+
+	return classifier.ImmobileBlockType(obstacle);
+}
+
+
+struct MapLayout {
+	typedef std::map<int, CSolidObject*> Cell;
+
+	MapLayout(): cells(NUM_SQUARES) {}
+
+	void Insert(int idx, CSolidObject* o) { cells[idx][o->id] = o; }
+	void Remove(int idx, CSolidObject* o) { cells[idx].erase(o->id); }
+
+	void GetIDs(int idx, std::vector<int>& ids) const {
+		ids.clear();
+		for (Cell::const_iterator it = cells[idx].begin(); it != cells[idx].end(); ++it) {
+			ids.push_back(it->first);
+		}
+	}
+
+	int SquareIsBlocked(int idx, float crushStrength) const {
+		int r = BLOCK_NONE;
+		for (Cell::const_iterator it = cells[idx].begin(); it != cells[idx].end(); ++it) {
+			r |= ObstacleBlockType(it->second, crushStrength);
+		}
+		return r;
+	}
+
+	bool SquareIsBlockedStructure(int idx, float crushStrength) const {
+		return ((SquareIsBlocked(idx, crushStrength) & BLOCK_STRUCTURE) != 0);
+	}
+
+	std::vector<Cell> cells;
+};
+
+struct CellLayout {
+	CellLayout(): cells(NUM_SQUARES) {}
+
+	void Insert(int idx, CSolidObject* o) { cells.Insert(idx, o->id, o, o->immobile); }
+	void Remove(int idx, CSolidObject* o) { cells.Remove(idx, o->id); }
+
+	void GetIDs(int idx, std::vector<int>& ids) const {
+		const BlockingMapCellObjects c = cells.GetObjects(idx);
+		ids.clear();
+		for (unsigned int n = 0; n < c.size(); n++) {
+			BOOST_CHECK(c[n]->id == c.objectIDs[n]);
+			BOOST_CHECK(c.MaybeStructure(n) || !c[n]->immobile);
+			ids.push_back(c.objectIDs[n]);
+		}
+	}
+
+	int SquareIsBlocked(int idx, float crushStrength) const {
+		return SquareBlocking::GetBlockType(cells.GetObjects(idx), TestClassifier(crushStrength));
+	}
+
+	bool SquareIsBlockedStructure(int idx, float crushStrength) const {
+		return SquareBlocking::IsBlockedStructure(cells.GetObjects(idx), TestClassifier(crushStrength));
+	}
+
+	BlockingMap cells;
+};
+
+
+template<typename Layout>
+static void Block(Layout& layout, CSolidObject* o)
+{
+	for (int z = o->z; z < o->z + o->zsize; z++) {
+		for (int x = o->x; x < o->x + o->xsize; x++) {
+			layout.Insert(x + z * MAP_SIZE, o);
+		}
+	}
+}
+
+template<typename Layout>
+static void UnBlock(Layout& layout, CSolidObject* o)
+{
+	for (int z = o->z; z < o->z + o->zsize; z++) {
+		for (int x = o->x; x < o->x + o->xsize; x++) {
+			layout.Remove(x + z * MAP_SIZE, o);
+		}
+	}
+}
+
+
+// a map covered in buildings (every third one crushable) with units on top,
+// some of them stacked (as at a factory exit) so cells overflow
+static void CreateObjects(std::vector<CSolidObject>& objects)
+{
+	const int numBuildings = (MAP_SIZE / BUILDING_SIZE) * (MAP_SIZE / BUILDING_SIZE);
+
+	objects.resize(numBuildings + NUM_UNITS);
+
+	for (int n = 0; n < numBuildings; n++) {
+		CSolidObject& o = objects[n];
+
+		o.x = (n % (MAP_SIZE / BUILDING_SIZE)) * BUILDING_SIZE;
+		o.z = (n / (MAP_SIZE / BUILDING_SIZE)) * BUILDING_SIZE;
+		o.xsize = BUILDING_SIZE;
+		o.zsize = BUILDING_SIZE;
+		o.blocking = ((n % 7) != 0);
+		o.immobile = true;
+		o.isMoving = false;
+		o.crushable = ((n % 3) == 0);
+		o.crushResistance = randf() * 100.0f;
+	}
+
+	for (int n = numBuildings; n < numBuildings + NUM_UNITS; n++) {
+		CSolidObject& o = objects[n];
+		const bool stacked = ((n % 10) == 0);
+
+		o.x = stacked? (MAP_SIZE / 2): int(randf() * (MAP_SIZE - 2));
+		o.z = stacked? (MAP_SIZE / 2): int(randf() * (MAP_SIZE - 2));
+		o.xsize = 2;
+		o.zsize = 2;
+		o.blocking = ((n % 5) != 0);
+		o.immobile = false;
+		o.isMoving = ((n % 2) == 0);
+		o.crushable = true;
+		o.crushResistance = 0.0f;
+	}
+
+	// ids are not in insertion order
+	std::vector<int> ids(objects.size());
+
+	for (size_t n = 0; n < ids.size(); n++) {
+		ids[n] = n;
+	}
+	for (size_t n = ids.size() - 1; n > 0; n--) {
+		std::swap(ids[n], ids[rand() % (n + 1)]);
+	}
+	for (size_t n = 0; n < ids.size(); n++) {
+		objects[n].id = ids[n];
+	}
+}
+
+
+template<typename Layout>
+static int CheckSquares(const Layout& layout, float crushStrength, clock_t* elapsed)
+{
+	int checkSum = 0;
+	const clock_t start = clock();
+
+	for (int p = 0; p < NUM_PASSES; p++) {
+		for (int idx = 0; idx < NUM_SQUARES; idx++) {
+			checkSum += layout.SquareIsBlocked(idx, crushStrength);
+		}
+	}
+
+	*elapsed = clock() - start;
+	return checkSum;
+}
+
+template<typename Layout>
+static int CheckStructureSquares(const Layout& layout, float crushStrength, clock_t* elapsed)
+{
+	int checkSum = 0;
+	const clock_t start = clock();
+
+	for (int p = 0; p < NUM_PASSES; p++) {
+		for (int idx = 0; idx < NUM_SQUARES; idx++) {
+			checkSum += layout.SquareIsBlockedStructure(idx, crushStrength);
+		}
+	}
+
+	*elapsed = clock() - start;
+	return checkSum;
+}
+
+
+BOOST_AUTO_TEST_CASE( BlockingMapLayouts )
+{
+	srand(RANDOM_SEED);
+
+	std::vector<CSolidObject> objects;
+	CreateObjects(objects);
+
+	MapLayout* mapLayout = new MapLayout();
+	CellLayout* cellLayout = new CellLayout();
+
+	for (size_t n = 0; n < objects.size(); n++) {
+		Block(*mapLayout, &objects[n]);
+		Block(*cellLayout, &objects[n]);
+	}
+
+	// move units around (and occasionally rebuild a structure)
+	// so cells overflow and return to inline storage repeatedly
+	for (int n = 0; n < NUM_UNITS * 4; n++) {
+		CSolidObject& o = objects[rand() % objects.size()];
+
+		UnBlock(*mapLayout, &o);
+		UnBlock(*cellLayout, &o);
+
+		if (!o.immobile) {
+			const bool stacked = ((rand() % 10) == 0);
+
+			o.x = stacked? (MAP_SIZE / 2): int(randf() * (MAP_SIZE - 2));
+			o.z = stacked? (MAP_SIZE / 2): int(randf() * (MAP_SIZE - 2));
+		}
+
+		Block(*mapLayout, &o);
+		Block(*cellLayout, &o);
+	}
+
+	std::vector<int> mapIDs;
+	std::vector<int> cellIDs;
+	int numMismatches = 0;
+
+	for (int idx = 0; idx < NUM_SQUARES; idx++) {
+		mapLayout->GetIDs(idx, mapIDs);
+		cellLayout->GetIDs(idx, cellIDs);
+		numMismatches += (mapIDs != cellIDs);
+	}
+
+	BOOST_CHECK_MESSAGE(numMismatches == 0, "layouts contain different objects in " << numMismatches << " squares!");
+
+	const float crushStrength = 50.0f;
+
+	clock_t mapTime = 0, cellTime = 0;
+	clock_t mapStructTime = 0, cellStructTime = 0;
+
+	const int mapSum = CheckSquares(*mapLayout, crushStrength, &mapTime);
+	const int cellSum = CheckSquares(*cellLayout, crushStrength, &cellTime);
+	const int mapStructSum = CheckStructureSquares(*mapLayout, crushStrength, &mapStructTime);
+	const int cellStructSum = CheckStructureSquares(*cellLayout, crushStrength, &cellStructTime);
+
+	BOOST_CHECK_MESSAGE(mapSum == cellSum, "SquareIsBlocked results differ!");
+	BOOST_CHECK_MESSAGE(mapStructSum == cellStructSum, "SquareIsBlockedStructure results differ!");
+
+	const int numChecks = NUM_PASSES * NUM_SQUARES;
+
+	BOOST_TEST_MESSAGE("map-cells:  SquareIsBlocked " << (mapTime * 1000 / CLOCKS_PER_SEC) << "ms, structures-only " << (mapStructTime * 1000 / CLOCKS_PER_SEC) << "ms (" << numChecks << " squares)");
+	BOOST_TEST_MESSAGE("flat-cells: SquareIsBlocked " << (cellTime * 1000 / CLOCKS_PER_SEC) << "ms, structures-only " << (cellStructTime * 1000 / CLOCKS_PER_SEC) << "ms (" << numChecks << " squares)");
+
+	delete cellLayout;
+	delete mapLayout;
+}
@@ -0,0 +1,119 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+// Checks that CLosAlgorithm::LosAdd (SIMD) returns exactly the same squares,
+// in the same order, as the scalar reference LosAddScalar
+
+#include "Sim/Misc/LosAlgorithm.h"
+#include <cmath>
+#include <vector>
+#include <stdlib.h>
+
+#define BOOST_TEST_MODULE LosAlgorithm
+#include <boost/test/unit_test.hpp>
+
+static const int MAP_SIZE_X = 256;
+static const int MAP_SIZE_Z = 192;
+
+
+static inline float randf()
+{
+	return rand() / float(RAND_MAX);
+}
+
+static std::vector<float> FlatHeightMap()
+{
+	return std::vector<float>(MAP_SIZE_X * MAP_SIZE_Z, 100.0f);
+}
+
+static std::vector<float> NoiseHeightMap()
+{
+	std::vector<float> hm(MAP_SIZE_X * MAP_SIZE_Z);
+
+	for (size_t n = 0; n < hm.size(); n++) {
+		hm[n] = -50.0f + randf() * 300.0f;
+	}
+
+	return hm;
+}
+
+static std::vector<float> HillsHeightMap()
+{
+	std::vector<float> hm(MAP_SIZE_X * MAP_SIZE_Z);
+
+	for (int z = 0; z < MAP_SIZE_Z; z++) {
+		for (int x = 0; x < MAP_SIZE_X; x++) {
+			hm[z * MAP_SIZE_X + x] = 200.0f * std::sin(x * 0.07f) * std::cos(z * 0.05f) + 30.0f * std::sin((x + z) * 0.31f);
+		}
+	}
+
+	return hm;
+}
+
+static std::vector<float> RidgesHeightMap()
+{
+	std::vector<float> hm(MAP_SIZE_X * MAP_SIZE_Z, 0.0f);
+
+	// walls and spikes, lots of squares hidden right behind them
+	for (int z = 0; z < MAP_SIZE_Z; z++) {
+		for (int x = 0; x < MAP_SIZE_X; x++) {
+			if ((x % 37) == 0 || (z % 29) == 0)
+				hm[z * MAP_SIZE_X + x] = 400.0f;
+			if (((x * 7 + z * 13) % 101) == 0)
+				hm[z * MAP_SIZE_X + x] = 1000.0f;
+		}
+	}
+
+	return hm;
+}
+
+
+static void CompareLosAdd(const std::vector<float>& heightmap, float minMaxAng, float extraHeight)
+{
+	CLosAlgorithm algo(int2(MAP_SIZE_X, MAP_SIZE_Z), minMaxAng, extraHeight, &heightmap[0]);
+
+	std::vector<int> squares;
+	std::vector<int> squaresRef;
+
+	int numMismatches = 0;
+
+	for (int i = 0; i < 400; i++) {
+		// includes positions outside of the map and near its edges
+		const int2 pos(int(randf() * (MAP_SIZE_X + 20)) - 10, int(randf() * (MAP_SIZE_Z + 20)) - 10);
+		const int radius = (i < 120)? i: int(randf() * 130);
+		const float baseHeight = randf() * 150.0f;
+
+		// both append, so start with some existing content
+		squares.assign(3, -1);
+		squaresRef.assign(3, -1);
+
+		algo.LosAdd(pos, radius, baseHeight, squares);
+		algo.LosAddScalar(pos, radius, baseHeight, squaresRef);
+
+		numMismatches += (squares != squaresRef);
+	}
+
+	BOOST_CHECK_MESSAGE(numMismatches == 0, numMismatches << " LosAdd results differ from the reference!");
+}
+
+
+BOOST_AUTO_TEST_CASE( LosAlgorithm )
+{
+	srand(1234);
+
+	const std::vector<float> flat = FlatHeightMap();
+	const std::vector<float> noise = NoiseHeightMap();
+	const std::vector<float> hills = HillsHeightMap();
+	const std::vector<float> ridges = RidgesHeightMap();
+
+	// LOS (see CLosHandler)
+	CompareLosAdd(flat, -1e6f, 15.0f);
+	CompareLosAdd(noise, -1e6f, 15.0f);
+	CompareLosAdd(hills, -1e6f, 15.0f);
+	CompareLosAdd(ridges, -1e6f, 15.0f);
+
+	// radar (see CRadarHandler)
+	CompareLosAdd(flat, -1000.0f, 20.0f);
+	CompareLosAdd(noise, -1000.0f, 20.0f);
+	CompareLosAdd(hills, -1000.0f, 20.0f);
+	CompareLosAdd(ridges, -1000.0f, 20.0f);
+}
@@ -0,0 +1,178 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+// Replays random unit movements on the quad-selection and bucket code
+// of CQuadField (see QuadFieldBuckets.h) and compares the results of
+// radius queries over the buckets with a brute-force search
+
+#include "Sim/Misc/QuadFieldBuckets.h"
+#include <algorithm>
+#include <iterator>
+#include <vector>
+#include <stdlib.h>
+#include <time.h>
+
+#define BOOST_TEST_MODULE QuadFieldBuckets
+#include <boost/test/unit_test.hpp>
+
+// a 32x32 map has 32*64 heightmap squares of size 8 per side
+static const int MAP_SIZE   = 32 * 64 * 8;
+static const int QUAD_SIZE  = 256;
+static const int NUM_QUADS  = MAP_SIZE / QUAD_SIZE;
+
+static const int NUM_UNITS  = 4000;
+static const int NUM_FRAMES = 100;
+static const int NUM_QUERIES_PER_FRAME = 200;
+
+// fixed, so failures can be reproduced
+static const unsigned int RANDOM_SEED = 0x5eed;
+
+
+struct TestUnit {
+	float x, z;
+	float radius;
+	int tempNum;
+	std::vector<int> quads;
+};
+
+typedef std::vector<TestUnit*> Bucket;
+
+
+static inline float randf()
+{
+	return rand() / float(RAND_MAX);
+}
+
+static void GetQuads(std::vector<int>& quads, float x, float z, float radius)
+{
+	quads.clear();
+	QuadFieldBuckets::GetQuads(x, z, radius, QUAD_SIZE, NUM_QUADS, NUM_QUADS, std::back_inserter(quads));
+}
+
+static bool InRange(const TestUnit* u, float x, float z, float radius)
+{
+	const float dx = x - u->x;
+	const float dz = z - u->z;
+	const float totRad = radius + u->radius;
+
+	return ((dx * dx + dz * dz) < (totRad * totRad));
+}
+
+
+// same steps as CQuadField::MovedUnit
+static void MovedUnit(std::vector<Bucket>& buckets, TestUnit* u, std::vector<int>& newQuads)
+{
+	GetQuads(newQuads, u->x, u->z, u->radius);
+
+	if (newQuads == u->quads)
+		return;
+
+	for (size_t n = 0; n < u->quads.size(); n++) {
+		QuadFieldBuckets::RemoveObject(buckets[u->quads[n]], u);
+	}
+	for (size_t n = 0; n < newQuads.size(); n++) {
+		QuadFieldBuckets::InsertObject(buckets[newQuads[n]], u);
+	}
+
+	u->quads = newQuads;
+}
+
+// same steps as CQuadField::GetUnitsExact (in 2D)
+static void GetUnitsExact(
+	const std::vector<Bucket>& buckets,
+	std::vector<TestUnit*>& units,
+	std::vector<int>& quads,
+	int tempNum,
+	float x, float z, float radius
+) {
+	units.clear();
+	GetQuads(quads, x, z, radius);
+
+	for (size_t n = 0; n < quads.size(); n++) {
+		const Bucket& bucket = buckets[quads[n]];
+
+		for (Bucket::const_iterator it = bucket.begin(); it != bucket.end(); ++it) {
+			TestUnit* u = *it;
+
+			if (u->tempNum == tempNum)
+				continue;
+			if (!InRange(u, x, z, radius))
+				continue;
+
+			u->tempNum = tempNum;
+			units.push_back(u);
+		}
+	}
+}
+
+
+BOOST_AUTO_TEST_CASE( BucketQueries )
+{
+	std::vector<Bucket> buckets(NUM_QUADS * NUM_QUADS);
+	std::vector<TestUnit> units(NUM_UNITS);
+
+	std::vector<int> tempQuads;
+	std::vector<TestUnit*> found;
+	std::vector<TestUnit*> expected;
+
+	srand(RANDOM_SEED);
+
+	for (int i = 0; i < NUM_UNITS; ++i) {
+		units[i].x = randf() * MAP_SIZE;
+		units[i].z = randf() * MAP_SIZE;
+		units[i].radius = 8.0f + randf() * 40.0f;
+		units[i].tempNum = 0;
+	}
+
+	int tempNum = 0;
+	int numMismatches = 0;
+	const clock_t start = clock();
+
+	for (int f = 0; f < NUM_FRAMES; ++f) {
+		for (int i = 0; i < NUM_UNITS; ++i) {
+			TestUnit& u = units[i];
+
+			u.x = std::max(0.0f, std::min(u.x + (randf() - 0.5f) * 8.0f, MAP_SIZE - 1.0f));
+			u.z = std::max(0.0f, std::min(u.z + (randf() - 0.5f) * 8.0f, MAP_SIZE - 1.0f));
+
+			MovedUnit(buckets, &u, tempQuads);
+		}
+
+		for (int q = 0; q < NUM_QUERIES_PER_FRAME; ++q) {
+			const float x = randf() * MAP_SIZE;
+			const float z = randf() * MAP_SIZE;
+			const float r = 100.0f + randf() * 500.0f;
+
+			GetUnitsExact(buckets, found, tempQuads, ++tempNum, x, z, r);
+
+			expected.clear();
+
+			for (int i = 0; i < NUM_UNITS; ++i) {
+				if (InRange(&units[i], x, z, r)) {
+					expected.push_back(&units[i]);
+				}
+			}
+
+			std::sort(found.begin(), found.end());
+			numMismatches += (found != expected);
+		}
+	}
+
+	// every unit must be in exactly the buckets of its quads
+	size_t numEntries = 0;
+	size_t numQuads = 0;
+
+	for (size_t n = 0; n < buckets.size(); n++) {
+		numEntries += buckets[n].size();
+
+		for (Bucket::const_iterator it = buckets[n].begin(); it != buckets[n].end(); ++it) {
+			BOOST_CHECK(std::find((*it)->quads.begin(), (*it)->quads.end(), int(n)) != (*it)->quads.end());
+		}
+	}
+	for (int i = 0; i < NUM_UNITS; ++i) {
+		numQuads += units[i].quads.size();
+	}
+
+	BOOST_CHECK_EQUAL(numEntries, numQuads);
+	BOOST_CHECK_MESSAGE(numMismatches == 0, numMismatches << " bucket queries differ from the brute-force results");
+	BOOST_TEST_MESSAGE("replay: " << ((clock() - start) * 1000 / CLOCKS_PER_SEC) << "ms");
+}
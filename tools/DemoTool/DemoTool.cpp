@@ -1,12 +1,16 @@
 /* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
 
+#include <algorithm>
 #include <string>
 #include <iostream>
+#include <fstream>
+#include <cfloat>
 #include <boost/program_options.hpp>
 
 #include "StringSerializer.h"
 
 #include "System/LoadSave/DemoReader.h"
+#include "System/LoadSave/DemoStreamWriter.h"
 #include "System/BaseNetProtocol.h"
 #include "System/Net/RawPacket.h"
 #include "Sim/Units/CommandAI/Command.h"
@@ -24,8 +28,9 @@ When compiling for windows with MinGW, make sure to use the
 no console output (you still could use this.exe > z.tzt though).
 */
 
-void TrafficDump(CDemoReader& reader, bool trafficStats);
+void TrafficDump(CDemoReader& reader, bool trafficStats, int startFrame);
 void WriteTeamstatHistory(CDemoReader& reader, unsigned team, const std::string& file);
+int ConvertDemo(CDemoReader& reader, const std::string& inFile, const std::string& outFile);
 
 int main (int argc, char* argv[])
 {
@@ -38,6 +43,8 @@ int main (int argc, char* argv[])
 	p.add("demofile", 1);
 	all.add_options()("help,h", "This one");
 	all.add_options()("dump,d", "Only dump networc traffic saved in demo");
+	all.add_options()("frame", po::value<int>(), "Start the dump at the given frame (compressed demos only)");
+	all.add_options()("convert,c", po::value<std::string>(), "Convert an old (uncompressed) demo to the current format, written to the given file");
 	all.add_options()("stats,s", "Print all game, player and team stats");
 	all.add_options()("header,H", "Print demoheader content");
 	all.add_options()("playerstats,p", "Print playerstats");
@@ -69,9 +76,24 @@ int main (int argc, char* argv[])
 	const bool printStats = vm.count("stats");
 	CDemoReader reader(filename, 0.0f);
 	reader.LoadStats();
+	if (vm.count("convert"))
+	{
+		return ConvertDemo(reader, filename, vm["convert"].as<std::string>());
+	}
 	if (vm.count("dump"))
 	{
-		TrafficDump(reader, true);
+		int startFrame = 0;
+		if (vm.count("frame"))
+		{
+			// dump starts at the beginning of the block containing the frame
+			startFrame = reader.SeekToFrame(vm["frame"].as<int>(), 0.0f);
+			if (startFrame < 0)
+			{
+				std::cout << "Demo has no block index, can not seek" << std::endl;
+				return 1;
+			}
+		}
+		TrafficDump(reader, true, startFrame);
 		return 0;
 	}
 	if (vm.count("teamsstatcsv"))
@@ -195,11 +217,12 @@ const std::string& GetCommandName(int commandId)
 	return CMD_NAME_UNKNOWN;
 }
 
-void TrafficDump(CDemoReader& reader, bool trafficStats)
+void TrafficDump(CDemoReader& reader, bool trafficStats, int startFrame)
 {
 	InitCommandNames();
 	std::vector<unsigned> trafficCounter(NETMSG_LAST, 0);
-	int frame = 0;
+	// blocks (except the first) start with the message of their first frame
+	int frame = std::max(0, startFrame - 1);
 	int cmdId = 0;
 	while (!reader.ReachedEnd())
 	{
@@ -296,6 +319,69 @@ void TrafficDump(CDemoReader& reader, bool trafficStats)
 	}
 }
 
+int ConvertDemo(CDemoReader& reader, const std::string& inFile, const std::string& outFile)
+{
+	DemoFileHeader header = reader.GetFileHeader();
+
+	if (header.version != DEMOFILE_VERSION_UNCOMPRESSED)
+	{
+		std::cout << "Only demos of version " << DEMOFILE_VERSION_UNCOMPRESSED << " can be converted, this one is version " << header.version << std::endl;
+		return 1;
+	}
+
+	std::ifstream in(inFile.c_str(), std::ios::in | std::ios::binary);
+	std::ofstream out(outFile.c_str(), std::ios::out | std::ios::binary);
+	if (!in.is_open() || !out.is_open())
+	{
+		std::cout << "Could not open " << outFile << " for writing" << std::endl;
+		return 1;
+	}
+
+	// placeholder, rewritten once the size of the stream is known
+	out.write((char*) &header, sizeof(header));
+	out.write(reader.GetSetupScript().c_str(), header.scriptSize);
+
+	CDemoStreamWriter streamWriter(out);
+	while (!reader.ReachedEnd())
+	{
+		const float modGameTime = reader.GetModGameTime();
+		netcode::RawPacket* packet = reader.GetData(FLT_MAX);
+		if (packet == NULL)
+			continue;
+		streamWriter.AddChunk(packet->data, packet->length, modGameTime);
+		delete packet;
+	}
+	streamWriter.FlushBlock();
+
+	// winners, player- and team-stats are copied unchanged
+	// (not present if Spring crashed while recording)
+	if (header.demoStreamSize != 0)
+	{
+		in.seekg(header.headerSize + header.scriptSize + header.demoStreamSize);
+
+		char buf[4096];
+		while (in.read(buf, sizeof(buf)) || in.gcount() > 0)
+			out.write(buf, in.gcount());
+	}
+
+	streamWriter.WriteIndex();
+
+	header.version = DEMOFILE_VERSION;
+	header.demoStreamSize = streamWriter.GetStreamSize();
+	header.swab(); // to little endian
+
+	out.seekp(0);
+	out.write((char*) &header, sizeof(header));
+
+	if (out.fail())
+	{
+		std::cout << "Error while writing " << outFile << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
+
 template<typename T>
 void PrintSep(std::ofstream& file, T value)
 {